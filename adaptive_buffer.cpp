@@ -0,0 +1,252 @@
+#include "adaptive_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+// how long playback has to go without an underrun before the target is lowered
+const double STABLE_SECONDS = 60;
+
+// the number of underruns kept in the history
+const std::size_t MAX_HISTORY = 32;
+
+
+
+
+/* Adaptive_Buffer constructor
+ * @param min_target - the lowest target in microseconds
+ * @param max_target - the highest target in microseconds
+ * @param initial_target - the target to start with in microseconds, clamped to the bounds
+ * @note call Adaptive_Buffer::start() when playback starts
+ */
+Adaptive_Buffer::Adaptive_Buffer(uint64_t min_target, uint64_t max_target, uint64_t initial_target) :
+    m_min_target{min_target}, m_max_target{std::max(min_target, max_target)}
+{
+    m_target = std::min(std::max(initial_target, m_min_target), m_max_target);
+    m_last_latency = 0;
+    m_writing = false;
+    m_underruns = 0;
+    m_raises = 0;
+    m_lowers = 0;
+
+    start();
+}
+
+
+
+
+/* Adaptive_Buffer::start() function
+ * @desc marks the start of playback, the history is timed from here and the first stable period starts
+ */
+void Adaptive_Buffer::start()
+{
+    m_start = std::chrono::steady_clock::now();
+    m_last_change = m_start;
+    m_writing = false;
+}
+
+
+
+
+/* Adaptive_Buffer::begin_write() function
+ * @desc call right before writing to the sink, detects whether the sink ran dry since the last write
+ * @return ADAPT_RAISED if it did and the target was raised, ADAPT_NONE otherwise
+ * @note the sink buffer is empty when this returns ADAPT_RAISED, so it can be reconnected with the new target for free
+ */
+Adaptive_Change Adaptive_Buffer::begin_write()
+{
+    if(!m_writing)
+    {
+        return ADAPT_NONE;
+    }
+
+    m_writing = false;
+
+    std::chrono::duration<double> gap = std::chrono::steady_clock::now() - m_last_write;
+    double buffered = m_last_latency / 1e6;
+
+    if(gap.count() <= buffered)
+    {
+        return ADAPT_NONE;
+    }
+
+    return underrun((gap.count() - buffered) * 1000);
+}
+
+
+
+
+/* Adaptive_Buffer::end_write() function
+ * @desc call right after writing to the sink
+ * @param latency - the sink latency measured after the write in microseconds, how long the buffered audio lasts
+ */
+void Adaptive_Buffer::end_write(uint64_t latency)
+{
+    m_last_write = std::chrono::steady_clock::now();
+    m_last_latency = latency;
+    m_writing = true;
+}
+
+
+
+
+/* Adaptive_Buffer::end_write() function
+ * @desc call right after a write to the sink when the latency was not measured, the last measurement is kept.
+ * @desc A write blocks while the sink buffer is full, so after one the sink holds about what it held after the last measured one
+ * @note measure again after the sink was reconnected, the last measurement is from the old buffering
+ */
+void Adaptive_Buffer::end_write()
+{
+    m_last_write = std::chrono::steady_clock::now();
+    m_writing = true;
+}
+
+
+
+
+/* Adaptive_Buffer::reset_write() function
+ * @desc forgets the last write, call it after the sink was drained or reconnected on purpose,
+ * @desc so the time that took is not mistaken for an underrun by the next Adaptive_Buffer::begin_write()
+ */
+void Adaptive_Buffer::reset_write()
+{
+    m_writing = false;
+}
+
+
+
+
+/* Adaptive_Buffer::report_underrun() function
+ * @desc reports an underrun detected elsewhere, EX: by the real time output thread
+ * @return ADAPT_RAISED if the target was raised, ADAPT_NONE if it already is at the maximum
+ */
+Adaptive_Change Adaptive_Buffer::report_underrun()
+{
+    return underrun(0);
+}
+
+
+
+
+/* Adaptive_Buffer::update() function
+ * @desc lowers the target by a quarter if there was no underrun for STABLE_SECONDS, call it regularly
+ * @return ADAPT_LOWERED if the target was lowered, ADAPT_NONE otherwise
+ * @note the lower is committed and counted here, call it only when the new target can be applied, see Adaptive_Buffer::lower_due()
+ */
+Adaptive_Change Adaptive_Buffer::update()
+{
+    if(!lower_due())
+    {
+        return ADAPT_NONE;
+    }
+
+    m_target = std::max(m_target - m_target / 4, m_min_target);
+    m_last_change = std::chrono::steady_clock::now();
+    m_lowers++;
+
+    return ADAPT_LOWERED;
+}
+
+
+
+
+/* Adaptive_Buffer::lower_due() function
+ * @desc tells whether Adaptive_Buffer::update() would lower the target now, without changing it
+ * @return true if there was no underrun for STABLE_SECONDS and the target is above the minimum
+ * @note stays true until the lower is made or an underrun happens, so a caller can wait for a good moment to apply it
+ */
+bool Adaptive_Buffer::lower_due() const
+{
+    std::chrono::duration<double> stable = std::chrono::steady_clock::now() - m_last_change;
+
+    return stable.count() >= STABLE_SECONDS && m_target > m_min_target;
+}
+
+
+
+
+/* Adaptive_Buffer::get_target() function
+ * @return the current target in microseconds
+ */
+uint64_t Adaptive_Buffer::get_target() const
+{
+    return m_target;
+}
+
+
+
+
+/* Adaptive_Buffer::get_underruns() function
+ * @return the number of underruns so far
+ */
+uint64_t Adaptive_Buffer::get_underruns() const
+{
+    return m_underruns;
+}
+
+
+
+
+/* Adaptive_Buffer::get_raises() function
+ * @return the number of times the target was raised
+ */
+uint64_t Adaptive_Buffer::get_raises() const
+{
+    return m_raises;
+}
+
+
+
+
+/* Adaptive_Buffer::get_lowers() function
+ * @return the number of times the target was lowered
+ */
+uint64_t Adaptive_Buffer::get_lowers() const
+{
+    return m_lowers;
+}
+
+
+
+
+/* Adaptive_Buffer::get_history() function
+ * @return the most recent underruns, oldest first
+ */
+const std::deque<Underrun_Event> &Adaptive_Buffer::get_history() const
+{
+    return m_history;
+}
+
+
+
+
+/* Adaptive_Buffer::underrun() function
+ * @desc records an underrun and doubles the target
+ * @param gap_ms - how long the output had nothing to play, 0 if unknown
+ * @return ADAPT_RAISED if the target was raised, ADAPT_NONE if it already is at the maximum
+ * @note this function is under the private specifier
+ */
+Adaptive_Change Adaptive_Buffer::underrun(double gap_ms)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    uint64_t previous = m_target;
+
+    m_target = std::min(m_target * 2, m_max_target);
+    m_last_change = now;
+    m_underruns++;
+
+    if(m_history.size() >= MAX_HISTORY)
+    {
+        m_history.pop_front();
+    }
+    m_history.push_back(Underrun_Event{std::chrono::duration<double>(now - m_start).count(), gap_ms, m_target});
+
+    if(m_target == previous)
+    {
+        return ADAPT_NONE;
+    }
+
+    m_raises++;
+    return ADAPT_RAISED;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+/* Adaptive_Change Enum
+ * @desc what an Adaptive_Buffer did with its target
+ */
+enum Adaptive_Change
+{
+    ADAPT_NONE,
+    ADAPT_RAISED,
+    ADAPT_LOWERED,
+};
+
+/* Underrun_Event Struct
+ * @desc one underrun noticed by an Adaptive_Buffer
+ * @member time - seconds since Adaptive_Buffer::start()
+ * @member gap_ms - how long the output had nothing to play, 0 if unknown
+ * @member target - the buffer target in microseconds after reacting to the underrun
+ */
+struct Underrun_Event
+{
+    double time;
+    double gap_ms;
+    uint64_t target;
+};
+
+/* Adaptive_Buffer Class
+ * @desc Decides how much audio to keep buffered ahead of the output. Every underrun doubles the target,
+ * @desc each STABLE_SECONDS without one lowers it by a quarter, within the given bounds.
+ * @desc Underruns are detected from the writes to the sink: a write blocks while the sink buffer is full, so if the time
+ * @desc between two writes is longer than the latency measured after the first, the sink ran out of audio in between.
+ * @member m_min_target - the lowest target in microseconds
+ * @member m_max_target - the highest target in microseconds
+ * @member m_target - the current target in microseconds
+ * @member m_start - when playback started, the time base of the history
+ * @member m_last_change - when the target last changed or the last underrun happened
+ * @member m_last_write - when the last write to the sink ended
+ * @member m_last_latency - the latency measured after the last write, in microseconds
+ * @member m_writing - true between Adaptive_Buffer::end_write() and the next Adaptive_Buffer::begin_write()
+ * @member m_underruns - the number of underruns
+ * @member m_raises - the number of times the target was raised
+ * @member m_lowers - the number of times the target was lowered
+ * @member m_history - the most recent underruns, at most MAX_HISTORY
+ * @note see adaptive_buffer.cpp for comments on functions
+ */
+class Adaptive_Buffer
+{
+    uint64_t m_min_target;
+    uint64_t m_max_target;
+    uint64_t m_target;
+
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_last_change;
+    std::chrono::steady_clock::time_point m_last_write;
+    uint64_t m_last_latency;
+    bool m_writing;
+
+    uint64_t m_underruns;
+    uint64_t m_raises;
+    uint64_t m_lowers;
+    std::deque<Underrun_Event> m_history;
+
+    public:
+
+    Adaptive_Buffer(uint64_t, uint64_t, uint64_t);
+
+    void start();
+    Adaptive_Change begin_write();
+    void end_write(uint64_t);
+    void end_write();
+    void reset_write();
+    Adaptive_Change report_underrun();
+    Adaptive_Change update();
+    bool lower_due() const;
+
+    uint64_t get_target() const;
+    uint64_t get_underruns() const;
+    uint64_t get_raises() const;
+    uint64_t get_lowers() const;
+    const std::deque<Underrun_Event> &get_history() const;
+
+    private:
+
+    Adaptive_Change underrun(double);
+};
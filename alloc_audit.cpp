@@ -0,0 +1,176 @@
+#include "alloc_audit.h"
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef ALLOC_AUDIT
+
+#include <dlfcn.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // counts allocations made while the calling thread is armed
+    std::atomic<uint64_t> allocation_count{0};
+    thread_local bool armed = false;
+
+    void count_allocation()
+    {
+        if(armed)
+        {
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void *checked_malloc(std::size_t size)
+    {
+        count_allocation();
+
+        void *pointer = std::malloc(size ? size : 1);
+        if(!pointer)
+        {
+            throw std::bad_alloc{};
+        }
+
+        return pointer;
+    }
+
+    // looks up the next definition of an FFmpeg allocator, the one in libavutil
+    template<typename Function>
+    Function next_symbol(const char *name)
+    {
+        return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+    }
+}
+
+void *operator new(std::size_t size)
+{
+    return checked_malloc(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return checked_malloc(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    count_allocation();
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    count_allocation();
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+extern "C"
+{
+    void *av_malloc(size_t size)
+    {
+        static auto next = next_symbol<void *(*)(size_t)>("av_malloc");
+        count_allocation();
+        return next(size);
+    }
+
+    void *av_mallocz(size_t size)
+    {
+        static auto next = next_symbol<void *(*)(size_t)>("av_mallocz");
+        count_allocation();
+        return next(size);
+    }
+
+    void *av_realloc(void *pointer, size_t size)
+    {
+        static auto next = next_symbol<void *(*)(void *, size_t)>("av_realloc");
+        count_allocation();
+        return next(pointer, size);
+    }
+}
+
+
+
+
+/* alloc_audit_arm() function
+ * @desc starts counting allocations made by the calling thread
+ */
+void alloc_audit_arm()
+{
+    armed = true;
+}
+
+
+
+
+/* alloc_audit_disarm() function
+ * @desc stops counting allocations made by the calling thread
+ */
+void alloc_audit_disarm()
+{
+    armed = false;
+}
+
+
+
+
+/* alloc_audit_count() function
+ * @return the number of allocations made by armed threads so far
+ */
+uint64_t alloc_audit_count()
+{
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* alloc_audit_enabled() function
+ * @return true, the audit was compiled in
+ */
+bool alloc_audit_enabled()
+{
+    return true;
+}
+
+#else
+
+void alloc_audit_arm()
+{}
+
+void alloc_audit_disarm()
+{}
+
+uint64_t alloc_audit_count()
+{
+    return 0;
+}
+
+bool alloc_audit_enabled()
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Allocation auditing for the real time output path.
+//
+// When built with ALLOC_AUDIT defined (see the Player_Audit target in the makefile), operator new
+// and av_malloc() / av_mallocz() / av_realloc() are interposed and every allocation made by a thread
+// that has armed the audit is counted. Without ALLOC_AUDIT these functions do nothing and
+// alloc_audit_count() always returns 0, so callers don't need their own #ifdefs.
+
+void alloc_audit_arm();
+void alloc_audit_disarm();
+uint64_t alloc_audit_count();
+bool alloc_audit_enabled();
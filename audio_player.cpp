@@ -1,15 +1,21 @@
 #include "audio_player.h"
+#include "event_trace.h"
 
 extern "C"
 {
 #include <pulse/simple.h>
+#include <pulse/error.h>
 #include <libavutil/avutil.h>
 #include <libavutil/frame.h>
 }
 
+#include <mutex>
 #include <string>
 #include <queue>
 
+// errors past this many are dropped oldest first
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
 
 
 
@@ -24,7 +30,12 @@ extern "C"
 Audio_Player::Audio_Player(pa_sample_format_t sample_format, uint8_t channels, uint32_t sample_rate, const std::string &name, const std::string &stream_name) :
     m_sample_format{sample_format}, m_channels{channels}, m_sample_rate{sample_rate}, m_name{name}, m_stream_name{stream_name}
 {
+    m_backend = BACKEND_PULSE;
+    m_initialized = false;
     m_player = nullptr;
+    m_frame_size = 0;
+    m_target_latency = 0;
+    m_bytes_written = 0;
 }
 
 
@@ -45,7 +56,7 @@ Audio_Player::~Audio_Player()
 
 
 /* Audio_Player::init() function
- * @desc initialze the audio player
+ * @desc initialze the audio player, connecting to the server unless the null or simulated backend is used
  * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
  */
 Return_Status Audio_Player::init()
@@ -53,6 +64,9 @@ Return_Status Audio_Player::init()
     m_sample_spec.format = m_sample_format;
     m_sample_spec.channels = m_channels;
     m_sample_spec.rate = m_sample_rate;
+    m_frame_size = pa_frame_size(&m_sample_spec);
+    m_initialized = false;
+    m_bytes_written = 0;
 
     if(m_player)
     {
@@ -60,14 +74,50 @@ Return_Status Audio_Player::init()
         m_player = nullptr;
     }
 
-    m_player = pa_simple_new(nullptr, m_name.c_str(), PA_STREAM_PLAYBACK, nullptr, m_stream_name.c_str(), &m_sample_spec, nullptr, nullptr, nullptr);
+    if(m_backend == BACKEND_NULL)
+    {
+        m_initialized = true;
+        return STATUS_SUCCESS;
+    }
+
+    if(m_backend == BACKEND_SIMULATED)
+    {
+        // the target latency sizes the simulated buffer like it sizes the server's
+        if(m_simulated_sink.init(m_sample_rate, m_frame_size, m_target_latency) == STATUS_FAILURE)
+        {
+            enqueue_error("Failed to create a simulated sink");
+            enqueue_error(m_simulated_sink.poll_error());
+            return STATUS_FAILURE;
+        }
+
+        m_initialized = true;
+        return STATUS_SUCCESS;
+    }
+
+    pa_buffer_attr *buffer_attr = nullptr;
+    if(m_target_latency > 0)
+    {
+        // (uint32_t) -1 lets the server choose, only the target length is requested.
+        // pa_simple streams adjust latency, so tlength is the total output latency
+        m_buffer_attr.maxlength = static_cast<uint32_t>(-1);
+        m_buffer_attr.tlength = pa_usec_to_bytes(m_target_latency, &m_sample_spec);
+        m_buffer_attr.prebuf = static_cast<uint32_t>(-1);
+        m_buffer_attr.minreq = static_cast<uint32_t>(-1);
+        m_buffer_attr.fragsize = static_cast<uint32_t>(-1);
+        buffer_attr = &m_buffer_attr;
+    }
+
+    int error = 0;
+    m_player = pa_simple_new(nullptr, m_name.c_str(), PA_STREAM_PLAYBACK, nullptr, m_stream_name.c_str(), &m_sample_spec, nullptr, buffer_attr, &error);
 
     if(!m_player)
     {
         enqueue_error("Failed to create a PulseAudio client");
+        enqueue_error(pa_strerror(error));
         return STATUS_FAILURE;
     }
 
+    m_initialized = true;
     return STATUS_SUCCESS;
 }
 
@@ -82,14 +132,52 @@ Return_Status Audio_Player::init()
  */
 Return_Status Audio_Player::play_frame(AVFrame *frame)
 {
-    if(!m_player)
+    return play_buffer(frame->extended_data[0], calculate_size(frame));
+}
+
+
+
+
+/* Audio_Player::play_buffer() function
+ * @desc plays the given interleaved samples
+ * @param data - the samples, in the format the player was initialized with
+ * @param size - the size of the data in bytes, should be a multiple of the sample frame size
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note nothing is allocated unless an error occurs, so this is safe to call from a real time thread
+ */
+Return_Status Audio_Player::play_buffer(const uint8_t *data, std::size_t size)
+{
+    if(!m_initialized)
     {
         enqueue_error("Not initialized");
         return STATUS_FAILURE;
     }
 
+    m_bytes_written += size;
+
+    if(m_backend == BACKEND_NULL)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    if(m_backend == BACKEND_SIMULATED)
+    {
+        trace_begin("simulated_write");
+        Return_Status status = m_simulated_sink.write(size);
+        trace_end("simulated_write");
+
+        if(status == STATUS_FAILURE)
+        {
+            enqueue_error("Failed to play frame");
+            enqueue_error(m_simulated_sink.poll_error());
+        }
+        return status;
+    }
+
     int error = 0;
-    error = pa_simple_write(m_player, frame->extended_data[0], calculate_size(frame), nullptr);
+    trace_begin("pa_simple_write");
+    error = pa_simple_write(m_player, data, size, nullptr);
+    trace_end("pa_simple_write");
 
     if(error < 0)
     {
@@ -103,6 +191,141 @@ Return_Status Audio_Player::play_frame(AVFrame *frame)
 
 
 
+/* Audio_Player::drain() function
+ * @desc blocks until all data written so far has been played
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Audio_Player::drain()
+{
+    if(!m_initialized)
+    {
+        enqueue_error("Not initialized");
+        return STATUS_FAILURE;
+    }
+
+    if(m_backend == BACKEND_NULL)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    if(m_backend == BACKEND_SIMULATED)
+    {
+        if(m_simulated_sink.drain() == STATUS_FAILURE)
+        {
+            enqueue_error("Failed to drain playback buffer");
+            enqueue_error(m_simulated_sink.poll_error());
+            return STATUS_FAILURE;
+        }
+        return STATUS_SUCCESS;
+    }
+
+    int error = 0;
+    if(pa_simple_drain(m_player, &error) < 0)
+    {
+        enqueue_error("Failed to drain playback buffer");
+        enqueue_error(pa_strerror(error));
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Audio_Player::flush() function
+ * @desc discards all data written so far that has not been played yet, EX: when seeking
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Audio_Player::flush()
+{
+    if(!m_initialized)
+    {
+        enqueue_error("Not initialized");
+        return STATUS_FAILURE;
+    }
+
+    if(m_backend == BACKEND_NULL)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    if(m_backend == BACKEND_SIMULATED)
+    {
+        if(m_simulated_sink.flush() == STATUS_FAILURE)
+        {
+            enqueue_error("Failed to flush playback buffer");
+            enqueue_error(m_simulated_sink.poll_error());
+            return STATUS_FAILURE;
+        }
+        return STATUS_SUCCESS;
+    }
+
+    int error = 0;
+    if(pa_simple_flush(m_player, &error) < 0)
+    {
+        enqueue_error("Failed to flush playback buffer");
+        enqueue_error(pa_strerror(error));
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Audio_Player::get_latency() function
+ * @desc queries the server for the current output latency, the time until a sample written now is heard
+ * @param latency - set to the latency in microseconds on success
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note this is a round trip to the server, so don't call it for every frame, the simulated backend works it out locally
+ */
+Return_Status Audio_Player::get_latency(pa_usec_t &latency)
+{
+    if(!m_initialized)
+    {
+        enqueue_error("Not initialized");
+        return STATUS_FAILURE;
+    }
+
+    if(m_backend == BACKEND_NULL)
+    {
+        // nothing is buffered, samples are discarded as they are written
+        latency = 0;
+        return STATUS_SUCCESS;
+    }
+
+    if(m_backend == BACKEND_SIMULATED)
+    {
+        uint64_t simulated = 0;
+        if(m_simulated_sink.get_latency(simulated) == STATUS_FAILURE)
+        {
+            enqueue_error("Failed to query latency");
+            enqueue_error(m_simulated_sink.poll_error());
+            return STATUS_FAILURE;
+        }
+
+        latency = simulated;
+        return STATUS_SUCCESS;
+    }
+
+    int error = 0;
+    pa_usec_t result = pa_simple_get_latency(m_player, &error);
+    if(result == static_cast<pa_usec_t>(-1))
+    {
+        enqueue_error("Failed to query latency");
+        enqueue_error(pa_strerror(error));
+        return STATUS_FAILURE;
+    }
+
+    latency = result;
+    return STATUS_SUCCESS;
+}
+
+
+
+
 /* Audio_Player::reset_sample_format() function
  * @desc resets the players sample format, m_sample_format
  * @note in order for new specifications to take affect Audio_Player::init() must be called again
@@ -138,12 +361,95 @@ void Audio_Player::reset_sample_rate(uint32_t sample_rate)
 
 
 
+/* Audio_Player::reset_target_latency() function
+ * @desc resets the requested output latency, m_target_latency
+ * @param target_latency - latency in microseconds, small values for interactive use, large values save power,
+ * @param target_latency - 0 lets the server decide (around 2 seconds by default)
+ * @note in order for new specifications to take affect Audio_Player::init() must be called again
+ */
+void Audio_Player::reset_target_latency(pa_usec_t target_latency)
+{
+    m_target_latency = target_latency;
+}
+
+
+
+
+/* Audio_Player::reset_backend() function
+ * @desc resets where the samples are sent, m_backend
+ * @note in order for new specifications to take affect Audio_Player::init() must be called again
+ */
+void Audio_Player::reset_backend(Audio_Backend backend)
+{
+    m_backend = backend;
+}
+
+
+
+
+/* Audio_Player::reset_simulation() function
+ * @desc resets how the sink of the simulated backend behaves, EX: its clock, jitter and stalls, see simulated_sink.h
+ * @note in order for new specifications to take affect Audio_Player::init() must be called again
+ */
+void Audio_Player::reset_simulation(const Simulated_Sink_Config &config)
+{
+    m_simulated_sink.reset_config(config);
+}
+
+
+
+
+/* Audio_Player::get_target_latency() function
+ * @return m_target_latency, the requested output latency in microseconds, 0 if left to the server
+ */
+pa_usec_t Audio_Player::get_target_latency()
+{
+    return m_target_latency;
+}
+
+
+
+/* Audio_Player::get_backend() function
+ * @return m_backend, where the samples are sent
+ */
+Audio_Backend Audio_Player::get_backend()
+{
+    return m_backend;
+}
+
+
+
+
+/* Audio_Player::get_bytes_written() function
+ * @return m_bytes_written, the number of bytes played since Audio_Player::init()
+ */
+uint64_t Audio_Player::get_bytes_written()
+{
+    return m_bytes_written;
+}
+
+
+
+
+/* Audio_Player::get_simulated_sink() function
+ * @return m_simulated_sink, the sink of the simulated backend, to read its stats or step its clock
+ */
+Simulated_Sink &Audio_Player::get_simulated_sink()
+{
+    return m_simulated_sink;
+}
+
+
+
+
 /* Audio_Player::poll_error() function
  * @desc used to get std::string errors enqueued onto m_errors
  * @return error message as std::string, if no errors on enqueued and empty std::string is returned
  */
 std::string Audio_Player::poll_error()
 {
+    std::lock_guard<std::mutex> lock{m_error_mutex};
+
     if(!m_errors.empty())
     {
         std::string error;
@@ -163,11 +469,12 @@ std::string Audio_Player::poll_error()
  * @desc used to calculate the correct size of the data in an AVFrame
  * @param frame - the AVFrame whos data size is to be calculated
  * @return the calculated data size of the passed AVFrame
+ * @note the frame must be in the format the player was initialized with, the sample frame size is worked out once in Audio_Player::init()
  * @note this function is under the private specifier
  */
 std::size_t Audio_Player::calculate_size(AVFrame *frame)
 {
-   return av_samples_get_buffer_size(frame->linesize, frame->channels, frame->nb_samples, static_cast<enum AVSampleFormat>(frame->format), 0);
+   return frame->nb_samples * m_frame_size;
 }
 
 
@@ -179,5 +486,13 @@ std::size_t Audio_Player::calculate_size(AVFrame *frame)
  */
 void Audio_Player::enqueue_error(const std::string &error)
 {
+    std::lock_guard<std::mutex> lock{m_error_mutex};
+
+    // drop the oldest error so a long run of failures can't grow the queue without bound
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
     m_errors.push(error);
 }
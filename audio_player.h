@@ -6,6 +6,9 @@ extern "C"
 #include <libavutil/frame.h>
 }
 
+#include "simulated_sink.h"
+
+#include <mutex>
 #include <string>
 #include <queue>
 
@@ -18,31 +21,62 @@ enum Return_Status
 };
 #endif
 
+/* Audio_Backend Enum
+ * @desc where an Audio_Player sends its samples
+ * @member BACKEND_PULSE - a PulseAudio server, the default
+ * @member BACKEND_NULL - nowhere, samples are counted and discarded, for benchmarks and tests without an audio server
+ * @member BACKEND_SIMULATED - a Simulated_Sink that plays them at the sample rate on its own clock, for testing buffering
+ * @member BACKEND_SIMULATED - and latency without an audio server, see Audio_Player::reset_simulation()
+ */
+enum Audio_Backend
+{
+    BACKEND_PULSE,
+    BACKEND_NULL,
+    BACKEND_SIMULATED,
+};
+
 /* Audio_Player Class
  * @desc The Audio_Player class utilizes the pulsaudio simple api to play audio from AVFrames
- * @member m_player - pa_simple* the pulseaudio simple player
+ * @member m_backend - where the samples are sent, set with Audio_Player::reset_backend()
+ * @member m_initialized - true once Audio_Player::init() succeeded
+ * @member m_player - pa_simple* the pulseaudio simple player, nullptr with the null and simulated backends
+ * @member m_simulated_sink - the sink of the simulated backend, sized for the stream by Audio_Player::init()
  * @member m_sample_spec - pa_sample_spec* specifications regarding the samples to be played
  * @member m_sample_format - the format of the samples to be played
  * @member m_channels - number of audio channels
  * @member m_sample_rate - the sample rate of the input audio, EX: 48000 Hz
+ * @member m_frame_size - the size of one sample frame in bytes, set by Audio_Player::init()
+ * @member m_target_latency - the requested output latency in microseconds, 0 leaves the buffering to the server
+ * @member m_buffer_attr - pa_buffer_attr built from m_target_latency when Audio_Player::init() is called
+ * @member m_bytes_written - the number of bytes played since Audio_Player::init()
  * @member m_name - The name of the audio player, for pulseaudio
  * @member m_stream_name - The name of the stream, for pulseaudio
  * @member m_errors - a std::queue<std::string> of error messages
+ * @member m_error_mutex - guards m_errors, an Output_Thread adds to it while the main thread polls it
  * @note see audio_player.cpp for comments on functions
  */
 class Audio_Player
 {
+    Audio_Backend m_backend;
+    bool m_initialized;
     pa_simple *m_player;
+    Simulated_Sink m_simulated_sink;
     pa_sample_spec m_sample_spec;
 
     pa_sample_format_t m_sample_format;
     uint8_t m_channels;
     uint32_t m_sample_rate;
+    std::size_t m_frame_size;
+
+    pa_usec_t m_target_latency;
+    pa_buffer_attr m_buffer_attr;
+    uint64_t m_bytes_written;
 
     std::string m_name;
     std::string m_stream_name;
 
     std::queue<std::string> m_errors;
+    std::mutex m_error_mutex;
 
     public:
 
@@ -51,10 +85,22 @@ class Audio_Player
 
     Return_Status init();
     Return_Status play_frame(AVFrame *);
+    Return_Status play_buffer(const uint8_t *, std::size_t);
+    Return_Status drain();
+    Return_Status flush();
+    Return_Status get_latency(pa_usec_t &);
 
     void reset_sample_format(pa_sample_format_t);
     void reset_number_of_channels(uint8_t);
     void reset_sample_rate(uint32_t);
+    void reset_target_latency(pa_usec_t);
+    void reset_backend(Audio_Backend);
+    void reset_simulation(const Simulated_Sink_Config&);
+
+    pa_usec_t get_target_latency();
+    Audio_Backend get_backend();
+    uint64_t get_bytes_written();
+    Simulated_Sink &get_simulated_sink();
 
     std::string poll_error();
 
@@ -0,0 +1,313 @@
+#include "audio_source.h"
+
+extern "C"
+{
+#include <libavutil/audio_fifo.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+}
+
+#include <string>
+#include <queue>
+
+
+
+
+/* Audio_Source constructor
+ * @desc sets variables, does not open the file
+ * @param filename - the file to decode
+ * @param sample_rate - the sample rate to convert to
+ * @param channels - the number of channels to convert to, using the default layout for that count
+ */
+Audio_Source::Audio_Source(const std::string &filename, int sample_rate, int channels) :
+    m_decoder{filename, AVMEDIA_TYPE_AUDIO},
+    m_resampler{av_get_default_channel_layout(channels), AV_SAMPLE_FMT_FLT, sample_rate, 0, AV_SAMPLE_FMT_NONE, 0},
+    m_sample_rate{sample_rate}, m_channels{channels}
+{
+    m_fifo = nullptr;
+    m_resampler_ready = false;
+    m_finished_decoding = false;
+}
+
+
+
+
+/* Audio_Source destructor
+ * @desc frees m_fifo if allocated
+ */
+Audio_Source::~Audio_Source()
+{
+    if(m_fifo)
+    {
+        av_audio_fifo_free(m_fifo);
+    }
+}
+
+
+
+
+/* Audio_Source::open() function
+ * @desc opens the file and initializes the decoder, this is the expensive part so do it off the playback path
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Audio_Source::open()
+{
+    if(m_decoder.open_file() == STATUS_FAILURE || m_decoder.init() == STATUS_FAILURE)
+    {
+        take_decoder_errors();
+        enqueue_error("Failed to open " + m_decoder.get_filename());
+        return STATUS_FAILURE;
+    }
+
+    // one second to start with, the fifo grows if a fill asks for more
+    m_fifo = av_audio_fifo_alloc(AV_SAMPLE_FMT_FLT, m_channels, m_sample_rate);
+    if(!m_fifo)
+    {
+        enqueue_error("Failed to allocate AVAudioFifo");
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Audio_Source::fill() function
+ * @desc decodes until at least nb_samples sample frames are buffered or the end of the file is reached
+ * @param nb_samples - the number of sample frames wanted
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Audio_Source::fill(int nb_samples)
+{
+    if(!m_fifo)
+    {
+        enqueue_error("Not opened");
+        return STATUS_FAILURE;
+    }
+
+    while(av_audio_fifo_size(m_fifo) < nb_samples && !m_finished_decoding)
+    {
+        AVFrame *decoded_frame = m_decoder.decode_frame();
+
+        if(!decoded_frame && m_decoder.end_of_file_reached())
+        {
+            m_finished_decoding = true;
+
+            if(m_resampler_ready)
+            {
+                // get the samples still held by the resampler
+                return push_frame(nullptr);
+            }
+
+            break;
+        }
+
+        else if(!decoded_frame)
+        {
+            take_decoder_errors();
+            return STATUS_FAILURE;
+        }
+
+        if(!m_resampler_ready)
+        {
+            if(m_resampler.reset_channel_layout(false, decoded_frame->channel_layout) == STATUS_FAILURE ||
+               m_resampler.reset_sample_format(false, static_cast<enum AVSampleFormat>(decoded_frame->format)) == STATUS_FAILURE ||
+               m_resampler.reset_sample_rate(false, decoded_frame->sample_rate) == STATUS_FAILURE ||
+               m_resampler.init() == STATUS_FAILURE)
+            {
+                take_resampler_errors();
+                return STATUS_FAILURE;
+            }
+
+            m_resampler_ready = true;
+        }
+
+        if(push_frame(decoded_frame) == STATUS_FAILURE)
+        {
+            return STATUS_FAILURE;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Audio_Source::read() function
+ * @desc reads buffered sample frames, call Audio_Source::fill() first
+ * @param destination - room for nb_samples * channels floats
+ * @param nb_samples - the number of sample frames to read
+ * @return the number of sample frames read, less than nb_samples only at the end of the file
+ */
+int Audio_Source::read(float *destination, int nb_samples)
+{
+    if(!m_fifo)
+    {
+        return 0;
+    }
+
+    void *planes[1] = {destination};
+    int read = av_audio_fifo_read(m_fifo, planes, nb_samples);
+
+    return read < 0 ? 0 : read;
+}
+
+
+
+
+/* Audio_Source::finished() function
+ * @return true once everything has been decoded and read
+ */
+bool Audio_Source::finished()
+{
+    return m_finished_decoding && get_buffered_samples() == 0;
+}
+
+
+
+
+/* Audio_Source::decoding_finished() function
+ * @return true once the whole file has been decoded, the remaining samples are all buffered
+ */
+bool Audio_Source::decoding_finished()
+{
+    return m_finished_decoding;
+}
+
+
+
+
+/* Audio_Source::get_buffered_samples() function
+ * @return the number of converted sample frames waiting to be read
+ */
+int Audio_Source::get_buffered_samples()
+{
+    return m_fifo ? av_audio_fifo_size(m_fifo) : 0;
+}
+
+
+
+
+/* Audio_Source::reset_quality() function
+ * @desc sets the quality tier the file is resampled with, see Resample_Quality
+ * @param quality - the tier
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note call it before decoding starts, EX: before Audio_Source::open()
+ */
+Return_Status Audio_Source::reset_quality(enum Resample_Quality quality)
+{
+    if(m_resampler.reset_quality(quality) == STATUS_FAILURE)
+    {
+        take_resampler_errors();
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Audio_Source::get_filename() function
+ * @return the name of the decoded file
+ */
+std::string Audio_Source::get_filename()
+{
+    return m_decoder.get_filename();
+}
+
+
+
+
+/* Audio_Source::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors, including those of the decoder and resampler
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Audio_Source::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error = m_errors.front();
+        m_errors.pop();
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Audio_Source::push_frame() function
+ * @desc converts a decoded frame and appends it to m_fifo
+ * @param decoded_frame - the frame to convert, nullptr flushes the resampler
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note this function is under the private specifier
+ */
+Return_Status Audio_Source::push_frame(AVFrame *decoded_frame)
+{
+    AVFrame *resampled_frame = m_resampler.resample_frame(decoded_frame);
+    if(!resampled_frame)
+    {
+        take_resampler_errors();
+        return STATUS_FAILURE;
+    }
+
+    if(resampled_frame->nb_samples == 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    int written = av_audio_fifo_write(m_fifo, reinterpret_cast<void **>(resampled_frame->extended_data), resampled_frame->nb_samples);
+    if(written < resampled_frame->nb_samples)
+    {
+        enqueue_error("Failed to buffer converted samples");
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Audio_Source::take_decoder_errors() function
+ * @desc moves all errors enqueued by the decoder onto m_errors
+ * @note this function is under the private specifier
+ */
+void Audio_Source::take_decoder_errors()
+{
+    for(std::string error = m_decoder.poll_error(); !error.empty(); error = m_decoder.poll_error())
+    {
+        enqueue_error(error);
+    }
+}
+
+
+
+
+/* Audio_Source::take_resampler_errors() function
+ * @desc moves all errors enqueued by the resampler onto m_errors
+ * @note this function is under the private specifier
+ */
+void Audio_Source::take_resampler_errors()
+{
+    for(std::string error = m_resampler.poll_error(); !error.empty(); error = m_resampler.poll_error())
+    {
+        enqueue_error(error);
+    }
+}
+
+
+
+
+/* Audio_Source::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @note this function is under the private specifier
+ */
+void Audio_Source::enqueue_error(const std::string &error)
+{
+    m_errors.push(error);
+}
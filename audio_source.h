@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ffmpeg_decoder.h"
+#include "ffmpeg_resampler.h"
+
+extern "C"
+{
+#include <libavutil/audio_fifo.h>
+#include <libavutil/frame.h>
+}
+
+#include <string>
+#include <queue>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Audio_Source Class
+ * @desc Decodes a file and converts it to interleaved 32 bit float at a fixed sample rate and channel count,
+ * @desc buffering the result so it can be read in any block size. Used by the Mixer and for crossfading.
+ * @member m_decoder - decodes the file
+ * @member m_resampler - converts decoded frames to the output format, initialized from the first decoded frame
+ * @member m_fifo - converted samples waiting to be read
+ * @member m_sample_rate - the output sample rate
+ * @member m_channels - the number of output channels
+ * @member m_resampler_ready - true once m_resampler has been initialized
+ * @member m_finished_decoding - true once the decoder and resampler have been flushed, only m_fifo is left
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see audio_source.cpp for comments on functions
+ */
+class Audio_Source
+{
+    FFmpeg_Decoder m_decoder;
+    FFmpeg_Frame_Resampler m_resampler;
+    AVAudioFifo *m_fifo;
+
+    int m_sample_rate;
+    int m_channels;
+
+    bool m_resampler_ready;
+    bool m_finished_decoding;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Audio_Source(const std::string&, int, int);
+    ~Audio_Source();
+
+    Return_Status open();
+    Return_Status reset_quality(enum Resample_Quality);
+    Return_Status fill(int);
+    int read(float *, int);
+
+    bool finished();
+    bool decoding_finished();
+    int get_buffered_samples();
+    std::string get_filename();
+
+    std::string poll_error();
+
+    private:
+
+    Return_Status push_frame(AVFrame *);
+    void take_decoder_errors();
+    void take_resampler_errors();
+    void enqueue_error(const std::string &error);
+};
@@ -0,0 +1,3729 @@
+#include "alloc_audit.h"
+#include "audio_player.h"
+#include "benchmark_fixtures.h"
+#include "channel_mapper.h"
+#include "coroutine_pipeline.h"
+#include "daemon_client.h"
+#include "event_trace.h"
+#include "ffmpeg_decoder.h"
+#include "ffmpeg_resampler.h"
+#include "frame_fanout.h"
+#include "frame_handle.h"
+#include "frame_sinks.h"
+#include "media_library.h"
+#include "memory_usage.h"
+#include "metadata_reader.h"
+#include "mixer.h"
+#include "output_thread.h"
+#include "playback_clock.h"
+#include "pipe_input.h"
+#include "player_daemon.h"
+#include "ring_buffer.h"
+#include "sample_convert.h"
+#include "silence_detector.h"
+#include "simulated_sink.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Benchmarks for the decode / resample / play pipeline.
+// Everything is synthesized, no audio server or input files are needed. Encoded fixtures are written to a
+// temporary directory which is removed when the benchmark exits.
+// Given a baseline file the results are compared against it and the program exits with 1 when a metric got
+// slower than the tolerance allows, "make check" does this with benchmark_baseline.txt.
+
+// the ratio/ metrics divide two times measured in the same run, the machine's noise mostly cancels, so they are held
+// to this tolerance even when a looser one is given, EX: a trace overhead of 1.0 fails past 5%
+const double RATIO_TOLERANCE = 0.05;
+
+// metrics timed per call for every class of input, a baseline has to hold them, they are what a regression in a hot path shows up in
+const std::vector<std::string> REQUIRED_PREFIXES = {"decode_frame/", "resample_frame/", "play_frame/"};
+
+/* Benchmark_Result Struct
+ * @desc one measured metric
+ * @member name - unique name of the metric, EX: "convert/fltp->s16/2ch/specialized"
+ * @member value - the measurement, lower is better
+ * @member unit - the unit of value, EX: "ns/frame"
+ */
+struct Benchmark_Result
+{
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+/* time_per_iteration() function
+ * @desc runs a function repeatedly for at least min_seconds and returns the average wall time of one run
+ * @param function - the function to time
+ * @param min_seconds - how long to keep repeating it
+ * @return seconds per run
+ */
+double time_per_iteration(const std::function<void()> &function, double min_seconds)
+{
+    // one untimed run to warm caches and lazily initialized state
+    function();
+
+    uint64_t iterations = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{0};
+
+    do
+    {
+        function();
+        iterations++;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    while(elapsed.count() < min_seconds);
+
+    return elapsed.count() / iterations;
+}
+
+/* make_test_frame() function
+ * @desc allocates a frame of pseudo random full scale noise in the given format
+ * @return the frame, the caller frees it with av_frame_free(), nullptr on failure
+ */
+AVFrame *make_test_frame(enum AVSampleFormat format, int channels, int nb_samples, int sample_rate)
+{
+    AVFrame *frame = av_frame_alloc();
+    if(!frame)
+    {
+        return nullptr;
+    }
+
+    frame->format = format;
+    frame->channel_layout = av_get_default_channel_layout(channels);
+    frame->channels = channels;
+    frame->nb_samples = nb_samples;
+    frame->sample_rate = sample_rate;
+
+    if(av_frame_get_buffer(frame, 0) < 0)
+    {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+
+    std::vector<float> noise(static_cast<std::size_t>(nb_samples) * channels);
+    uint32_t state = 12345;
+
+    for(float &sample : noise)
+    {
+        state = state * 1664525u + 1013904223u;
+        sample = static_cast<float>(static_cast<int32_t>(state)) / 2147483648.0f * 0.9f;
+    }
+
+    // convert the float noise to the wanted format with swresample, it handles every format
+    int64_t layout = av_get_default_channel_layout(channels);
+    SwrContext *swr = swr_alloc_set_opts(nullptr, layout, format, sample_rate, layout, AV_SAMPLE_FMT_FLT, sample_rate, 0, nullptr);
+    const uint8_t *source[1] = {reinterpret_cast<const uint8_t *>(noise.data())};
+
+    if(!swr || swr_init(swr) < 0 || swr_convert(swr, frame->extended_data, nb_samples, source, nb_samples) < 0)
+    {
+        av_frame_free(&frame);
+    }
+
+    swr_free(&swr);
+    return frame;
+}
+
+/* benchmark_conversion() function
+ * @desc times sample format conversion with the specialized converters against libswresample doing the same conversion
+ * @param min_seconds - how long to time each case
+ * @return ns per sample frame for every case
+ */
+std::vector<Benchmark_Result> benchmark_conversion(double min_seconds)
+{
+    const int NB_SAMPLES = 4096;
+    const int SAMPLE_RATE = 48000;
+    const enum AVSampleFormat INPUTS[] = {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP};
+    const enum AVSampleFormat OUTPUTS[] = {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLT};
+    const int CHANNELS[] = {1, 2};
+
+    std::vector<Benchmark_Result> results;
+
+    for(int channels : CHANNELS)
+    {
+        for(enum AVSampleFormat in : INPUTS)
+        {
+            for(enum AVSampleFormat out : OUTPUTS)
+            {
+                std::string name = std::string{"convert/"} + av_get_sample_fmt_name(in) + "->" + av_get_sample_fmt_name(out)
+                                   + "/" + std::to_string(channels) + "ch";
+
+                AVFrame *input = make_test_frame(in, channels, NB_SAMPLES, SAMPLE_RATE);
+                AVFrame *output = make_test_frame(out, channels, NB_SAMPLES, SAMPLE_RATE);
+                if(!input || !output)
+                {
+                    std::cerr << "Failed to allocate frames for " << name << '\n';
+                    av_frame_free(&input);
+                    av_frame_free(&output);
+                    continue;
+                }
+
+                Convert_Function convert = find_sample_converter(in, out, channels);
+                if(convert)
+                {
+                    double seconds = time_per_iteration([&]()
+                    {
+                        convert(input->extended_data, output->extended_data, NB_SAMPLES);
+                    }, min_seconds);
+
+                    results.push_back(Benchmark_Result{name + "/specialized", seconds / NB_SAMPLES * 1e9, "ns/frame"});
+                }
+
+                int64_t layout = av_get_default_channel_layout(channels);
+                SwrContext *swr = swr_alloc_set_opts(nullptr, layout, out, SAMPLE_RATE, layout, in, SAMPLE_RATE, 0, nullptr);
+                if(swr && swr_init(swr) >= 0)
+                {
+                    double seconds = time_per_iteration([&]()
+                    {
+                        swr_convert(swr, output->extended_data, NB_SAMPLES, const_cast<const uint8_t **>(input->extended_data), NB_SAMPLES);
+                    }, min_seconds);
+
+                    results.push_back(Benchmark_Result{name + "/swresample", seconds / NB_SAMPLES * 1e9, "ns/frame"});
+                }
+                swr_free(&swr);
+
+                av_frame_free(&input);
+                av_frame_free(&output);
+            }
+        }
+    }
+
+    return results;
+}
+
+/* cpu_seconds() function
+ * @return the CPU time used by the process so far, in seconds
+ */
+double cpu_seconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* decode_file() function
+ * @desc decodes a whole file, optionally resampling every frame to 48000 Hz signed 16 bit stereo like the player does
+ * @param filename - the file to decode
+ * @param resample - if true every decoded frame is also resampled
+ * @param audio_seconds - set to the length of the decoded audio in seconds
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, the errors are printed
+ */
+Return_Status decode_file(const std::string &filename, bool resample, double &audio_seconds)
+{
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+    FFmpeg_Frame_Resampler resampler{av_get_default_channel_layout(2), AV_SAMPLE_FMT_S16, 48000, 0, AV_SAMPLE_FMT_NONE, 0};
+    bool resampler_ready = false;
+
+    audio_seconds = 0;
+
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    while(!decoder.end_of_file_reached())
+    {
+        AVFrame *frame = decoder.decode_frame();
+        if(!frame)
+        {
+            if(decoder.end_of_file_reached())
+            {
+                break;
+            }
+
+            std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+            return STATUS_FAILURE;
+        }
+
+        audio_seconds += static_cast<double>(frame->nb_samples) / frame->sample_rate;
+
+        if(!resample)
+        {
+            continue;
+        }
+
+        if(!resampler_ready)
+        {
+            resampler.reset_channel_layout(false, frame->channel_layout);
+            resampler.reset_sample_format(false, static_cast<enum AVSampleFormat>(frame->format));
+            resampler.reset_sample_rate(false, frame->sample_rate);
+
+            if(resampler.init() != STATUS_SUCCESS)
+            {
+                std::cerr << "Failed to initialize resampler: " << resampler.poll_error() << '\n';
+                return STATUS_FAILURE;
+            }
+            resampler_ready = true;
+        }
+
+        if(!resampler.resample_frame(frame))
+        {
+            std::cerr << "Failed to resample " << filename << ": " << resampler.poll_error() << '\n';
+            return STATUS_FAILURE;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* benchmark_decode() function
+ * @desc measures the CPU time the decode stage, and the decode plus resample stages, need per second of audio
+ * @desc on synthesized WAV and FLAC files. This is the figure compared between build profiles by "make profile-report"
+ * @param directory - where to write the fixtures
+ * @param min_seconds - how much CPU time to spend on each case at least
+ * @return CPU milliseconds per second of audio for every case
+ */
+std::vector<Benchmark_Result> benchmark_decode(const std::string &directory, double min_seconds)
+{
+    const Fixture_Spec FIXTURES[] = {
+        {directory + "/sweep.wav", AV_CODEC_ID_PCM_S16LE, 44100, 2, 30},
+        {directory + "/sweep.flac", AV_CODEC_ID_FLAC, 44100, 2, 30},
+    };
+
+    std::vector<Benchmark_Result> results;
+
+    for(const Fixture_Spec &fixture : FIXTURES)
+    {
+        std::string error;
+        if(write_fixture(fixture, error) != STATUS_SUCCESS)
+        {
+            std::cerr << error << '\n';
+            continue;
+        }
+
+        std::string extension = fixture.path.substr(fixture.path.rfind('.') + 1);
+
+        for(bool resample : {false, true})
+        {
+            double audio_seconds = 0;
+            double total_audio_seconds = 0;
+            double start = cpu_seconds();
+            Return_Status status = STATUS_SUCCESS;
+
+            do
+            {
+                status = decode_file(fixture.path, resample, audio_seconds);
+                total_audio_seconds += audio_seconds;
+            }
+            while(status == STATUS_SUCCESS && cpu_seconds() - start < min_seconds);
+
+            if(status == STATUS_SUCCESS && total_audio_seconds > 0)
+            {
+                std::string name = "decode/" + extension + (resample ? "/resample-48k-s16" : "");
+                results.push_back(Benchmark_Result{name, (cpu_seconds() - start) * 1000 / total_audio_seconds, "ms/audio-s"});
+            }
+        }
+
+        unlink(fixture.path.c_str());
+    }
+
+    return results;
+}
+
+/* benchmark_decode_frame() function
+ * @desc times FFmpeg_Decoder::decode_frame() alone, opening the file is not timed
+ * @param directory - where to write the fixtures
+ * @param min_seconds - how long to time each case at least
+ * @return ns per decoded sample frame for every fixture
+ */
+std::vector<Benchmark_Result> benchmark_decode_frame(const std::string &directory, double min_seconds)
+{
+    const Fixture_Spec FIXTURES[] = {
+        {directory + "/frames.wav", AV_CODEC_ID_PCM_S16LE, 44100, 2, 10},
+        {directory + "/frames.flac", AV_CODEC_ID_FLAC, 44100, 2, 10},
+    };
+
+    std::vector<Benchmark_Result> results;
+
+    for(const Fixture_Spec &fixture : FIXTURES)
+    {
+        std::string error;
+        if(write_fixture(fixture, error) != STATUS_SUCCESS)
+        {
+            std::cerr << error << '\n';
+            continue;
+        }
+
+        std::string extension = fixture.path.substr(fixture.path.rfind('.') + 1);
+        FFmpeg_Decoder decoder{fixture.path, AVMEDIA_TYPE_AUDIO};
+        std::chrono::duration<double> elapsed{0};
+        uint64_t samples = 0;
+        bool failed = false;
+
+        while(!failed && elapsed.count() < min_seconds)
+        {
+            decoder.reset(fixture.path, AVMEDIA_TYPE_AUDIO);
+            if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+            {
+                std::cerr << "Failed to open " << fixture.path << ": " << decoder.poll_error() << '\n';
+                failed = true;
+                break;
+            }
+
+            while(!decoder.end_of_file_reached())
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                AVFrame *frame = decoder.decode_frame();
+                elapsed += std::chrono::steady_clock::now() - start;
+
+                if(!frame)
+                {
+                    failed = !decoder.end_of_file_reached();
+                    break;
+                }
+                samples += frame->nb_samples;
+            }
+        }
+
+        if(!failed && samples > 0)
+        {
+            results.push_back(Benchmark_Result{"decode_frame/" + extension, elapsed.count() / samples * 1e9, "ns/sample"});
+        }
+
+        else
+        {
+            std::cerr << "Failed to decode " << fixture.path << ": " << decoder.poll_error() << '\n';
+        }
+
+        unlink(fixture.path.c_str());
+    }
+
+    return results;
+}
+
+/* benchmark_resample_frame() function
+ * @desc times FFmpeg_Frame_Resampler::resample_frame() for each input format and rate to the formats the player outputs,
+ * @desc pairs with equal rates take the specialized converter, the others go through swresample
+ * @param min_seconds - how long to time each case at least
+ * @return ns per input sample frame for every format pair
+ */
+std::vector<Benchmark_Result> benchmark_resample_frame(double min_seconds)
+{
+    const int NB_SAMPLES = 1024;
+    const int CHANNELS = 2;
+    const int OUT_SAMPLE_RATE = 48000;
+    const enum AVSampleFormat INPUTS[] = {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP};
+    const enum AVSampleFormat OUTPUTS[] = {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLT};
+    const int IN_SAMPLE_RATES[] = {44100, 48000};
+
+    int64_t layout = av_get_default_channel_layout(CHANNELS);
+    std::vector<Benchmark_Result> results;
+
+    for(int in_sample_rate : IN_SAMPLE_RATES)
+    {
+        for(enum AVSampleFormat in : INPUTS)
+        {
+            for(enum AVSampleFormat out : OUTPUTS)
+            {
+                std::string name = std::string{"resample_frame/"} + av_get_sample_fmt_name(in) + "@" + std::to_string(in_sample_rate / 1000)
+                                   + "k->" + av_get_sample_fmt_name(out) + "@48k";
+
+                AVFrame *input = make_test_frame(in, CHANNELS, NB_SAMPLES, in_sample_rate);
+                FFmpeg_Frame_Resampler resampler{layout, out, OUT_SAMPLE_RATE, layout, in, in_sample_rate};
+
+                if(!input || resampler.init() != STATUS_SUCCESS)
+                {
+                    std::cerr << "Failed to set up " << name << ": " << resampler.poll_error() << '\n';
+                    av_frame_free(&input);
+                    continue;
+                }
+
+                bool failed = false;
+                double seconds = time_per_iteration([&]()
+                {
+                    failed = failed || !resampler.resample_frame(input);
+                }, min_seconds);
+
+                if(failed)
+                {
+                    std::cerr << "Failed to resample " << name << ": " << resampler.poll_error() << '\n';
+                }
+
+                else
+                {
+                    results.push_back(Benchmark_Result{name, seconds / NB_SAMPLES * 1e9, "ns/sample"});
+                }
+
+                av_frame_free(&input);
+            }
+        }
+    }
+
+    return results;
+}
+
+/* benchmark_channel_mapping() function
+ * @desc times downmixing 5.1 and 7.1 float planar frames to stereo s16 with the Channel_Mapper against swresample, once with
+ * @desc the matrix swresample works out itself and once with the Channel_Mapper's matrix given to it with swr_set_matrix()
+ * @param min_seconds - how long to time each case
+ * @param matching - set to false if the Channel_Mapper and swresample with the same matrix differ by more than 1 in any sample
+ * @return ns per sample frame for every case
+ */
+std::vector<Benchmark_Result> benchmark_channel_mapping(double min_seconds, bool &matching)
+{
+    const int NB_SAMPLES = 1024;
+    const int SAMPLE_RATE = 48000;
+    const int64_t OUT_LAYOUT = AV_CH_LAYOUT_STEREO;
+    const int IN_CHANNELS[] = {6, 8};
+
+    std::vector<Benchmark_Result> results;
+    matching = true;
+
+    for(int channels : IN_CHANNELS)
+    {
+        std::string name = "channel_map/" + std::to_string(channels) + "ch-fltp->stereo-s16";
+        int64_t in_layout = av_get_default_channel_layout(channels);
+
+        AVFrame *input = make_test_frame(AV_SAMPLE_FMT_FLTP, channels, NB_SAMPLES, SAMPLE_RATE);
+
+        Channel_Mapper mapper;
+        if(!input || mapper.set_downmix(in_layout, OUT_LAYOUT, true) != STATUS_SUCCESS ||
+           mapper.set_formats(AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_S16) != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to set up " << name << ": " << mapper.poll_error() << '\n';
+            av_frame_free(&input);
+            matching = false;
+            continue;
+        }
+
+        std::vector<double> matrix{mapper.get_matrix().begin(), mapper.get_matrix().end()};
+
+        SwrContext *swr_default = swr_alloc_set_opts(nullptr, OUT_LAYOUT, AV_SAMPLE_FMT_S16, SAMPLE_RATE, in_layout, AV_SAMPLE_FMT_FLTP, SAMPLE_RATE, 0, nullptr);
+        SwrContext *swr_matrix = swr_alloc_set_opts(nullptr, OUT_LAYOUT, AV_SAMPLE_FMT_S16, SAMPLE_RATE, in_layout, AV_SAMPLE_FMT_FLTP, SAMPLE_RATE, 0, nullptr);
+
+        if(!swr_default || !swr_matrix || swr_init(swr_default) < 0 || swr_set_matrix(swr_matrix, matrix.data(), channels) < 0 || swr_init(swr_matrix) < 0)
+        {
+            std::cerr << "Failed to set up swresample for " << name << '\n';
+            swr_free(&swr_default);
+            swr_free(&swr_matrix);
+            av_frame_free(&input);
+            matching = false;
+            continue;
+        }
+
+        std::vector<int16_t> swr_default_out(NB_SAMPLES * 2);
+        std::vector<int16_t> swr_matrix_out(NB_SAMPLES * 2);
+        std::vector<int16_t> mapper_out(NB_SAMPLES * 2);
+
+        uint8_t *swr_default_planes[1] = {reinterpret_cast<uint8_t *>(swr_default_out.data())};
+        uint8_t *swr_matrix_planes[1] = {reinterpret_cast<uint8_t *>(swr_matrix_out.data())};
+        uint8_t *mapper_planes[1] = {reinterpret_cast<uint8_t *>(mapper_out.data())};
+        const uint8_t **in_planes = const_cast<const uint8_t **>(input->extended_data);
+
+        double swr_default_seconds = time_per_iteration([&]()
+        {
+            swr_convert(swr_default, swr_default_planes, NB_SAMPLES, in_planes, NB_SAMPLES);
+        }, min_seconds);
+
+        double swr_matrix_seconds = time_per_iteration([&]()
+        {
+            swr_convert(swr_matrix, swr_matrix_planes, NB_SAMPLES, in_planes, NB_SAMPLES);
+        }, min_seconds);
+
+        double mapper_seconds = time_per_iteration([&]()
+        {
+            mapper.map(input->extended_data, mapper_planes, NB_SAMPLES);
+        }, min_seconds);
+
+        for(std::size_t i = 0; i < mapper_out.size(); i++)
+        {
+            if(std::abs(mapper_out[i] - swr_matrix_out[i]) > 1)
+            {
+                std::cerr << name << ": sample " << i << " is " << mapper_out[i] << ", swresample gives " << swr_matrix_out[i] << '\n';
+                matching = false;
+                break;
+            }
+        }
+
+        results.push_back(Benchmark_Result{name + "/swresample", swr_default_seconds / NB_SAMPLES * 1e9, "ns/sample"});
+        results.push_back(Benchmark_Result{name + "/swr_set_matrix", swr_matrix_seconds / NB_SAMPLES * 1e9, "ns/sample"});
+        results.push_back(Benchmark_Result{name + "/channel_mapper", mapper_seconds / NB_SAMPLES * 1e9, "ns/sample"});
+
+        swr_free(&swr_default);
+        swr_free(&swr_matrix);
+        av_frame_free(&input);
+    }
+
+    return results;
+}
+
+/* resample_signal() function
+ * @desc resamples a synthetic float stereo signal, in frames of 1024 sample frames, with the given quality tier
+ * @param quality - the tier
+ * @param in_sample_rate, out_sample_rate - the rates to resample between
+ * @param signal - the input, one sample for every sample frame, both channels get the same samples
+ * @param output - set to the first channel of the resampled signal
+ * @param cpu - set to the CPU seconds spent resampling, generating the input is not counted
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the tier is not available or resampling failed
+ */
+Return_Status resample_signal(enum Resample_Quality quality, int in_sample_rate, int out_sample_rate, const std::vector<float> &signal,
+                              std::vector<float> &output, double &cpu)
+{
+    const int NB_SAMPLES = 1024;
+    const int CHANNELS = 2;
+
+    int64_t layout = av_get_default_channel_layout(CHANNELS);
+    FFmpeg_Frame_Resampler resampler{layout, AV_SAMPLE_FMT_FLT, out_sample_rate, layout, AV_SAMPLE_FMT_FLT, in_sample_rate};
+
+    AVFrame *input = make_test_frame(AV_SAMPLE_FMT_FLT, CHANNELS, NB_SAMPLES, in_sample_rate);
+    if(!input || resampler.reset_quality(quality) != STATUS_SUCCESS || resampler.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to set up " << get_quality_name(quality) << " resampling: " << resampler.poll_error() << '\n';
+        av_frame_free(&input);
+        return STATUS_FAILURE;
+    }
+
+    // the input is interleaved up front so only resampling is timed
+    std::vector<float> interleaved(signal.size() * CHANNELS);
+    for(std::size_t i = 0; i < signal.size(); i++)
+    {
+        interleaved[i * CHANNELS] = signal[i];
+        interleaved[i * CHANNELS + 1] = signal[i];
+    }
+
+    output.clear();
+    output.reserve(signal.size() * out_sample_rate / in_sample_rate + NB_SAMPLES);
+
+    Return_Status status = STATUS_SUCCESS;
+    double start = cpu_seconds();
+
+    for(std::size_t offset = 0; offset < signal.size() && status == STATUS_SUCCESS; offset += NB_SAMPLES)
+    {
+        int count = static_cast<int>(std::min<std::size_t>(NB_SAMPLES, signal.size() - offset));
+        input->nb_samples = count;
+        std::memcpy(input->data[0], interleaved.data() + offset * CHANNELS, static_cast<std::size_t>(count) * CHANNELS * sizeof(float));
+
+        AVFrame *frame = resampler.resample_frame(input);
+        if(!frame)
+        {
+            std::cerr << "Failed to resample with " << get_quality_name(quality) << " quality: " << resampler.poll_error() << '\n';
+            status = STATUS_FAILURE;
+            continue;
+        }
+
+        const float *samples = reinterpret_cast<const float *>(frame->data[0]);
+        for(int i = 0; i < frame->nb_samples; i++)
+        {
+            output.push_back(samples[i * CHANNELS]);
+        }
+    }
+
+    cpu = cpu_seconds() - start;
+
+    av_frame_free(&input);
+    return status;
+}
+
+/* tone_level() function
+ * @desc resamples a sine tone with the given quality tier and measures how loud it comes out
+ * @param quality - the tier
+ * @param in_sample_rate, out_sample_rate - the rates to resample between
+ * @param frequency - the frequency of the tone in Hz
+ * @param level - set to the RMS level of the output relative to the input in dB, the filter's start up is skipped
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if resampling failed
+ */
+Return_Status tone_level(enum Resample_Quality quality, int in_sample_rate, int out_sample_rate, double frequency, double &level)
+{
+    const double SECONDS = 1.0;
+    const double AMPLITUDE = 0.5;
+    const std::size_t SETTLE_SAMPLES = 4096;
+    const double PI = 3.14159265358979323846;
+
+    std::vector<float> tone(static_cast<std::size_t>(SECONDS * in_sample_rate));
+    for(std::size_t i = 0; i < tone.size(); i++)
+    {
+        tone[i] = static_cast<float>(AMPLITUDE * std::sin(2 * PI * frequency * i / in_sample_rate));
+    }
+
+    std::vector<float> output;
+    double cpu = 0;
+
+    if(resample_signal(quality, in_sample_rate, out_sample_rate, tone, output, cpu) != STATUS_SUCCESS || output.size() <= SETTLE_SAMPLES * 2)
+    {
+        return STATUS_FAILURE;
+    }
+
+    double sum = 0;
+    for(std::size_t i = SETTLE_SAMPLES; i < output.size() - SETTLE_SAMPLES; i++)
+    {
+        sum += static_cast<double>(output[i]) * output[i];
+    }
+
+    double rms = std::sqrt(sum / (output.size() - SETTLE_SAMPLES * 2));
+    level = 20 * std::log10(std::max(rms, 1e-9) / (AMPLITUDE / std::sqrt(2.0)));
+    return STATUS_SUCCESS;
+}
+
+/* benchmark_resample_quality() function
+ * @desc measures what each Resample_Quality tier costs and what it buys:
+ * @desc the CPU time to resample a 44.1 kHz log sweep to 48 kHz, how much a 20 kHz tone loses going from 44.1 kHz to 48 kHz,
+ * @desc and how loud a 23 kHz tone is after going from 48 kHz to 44.1 kHz, where it is above Nyquist and can only alias to 21.1 kHz
+ * @param min_seconds - how much audio CPU time to average over at least, the sweep is resampled again until it was spent
+ * @return CPU ms per audio second, passband loss in dB and alias level in dB for every tier that is available
+ * @note the soxr tier is skipped with a message when FFmpeg was built without libsoxr
+ */
+std::vector<Benchmark_Result> benchmark_resample_quality(double min_seconds)
+{
+    const int IN_SAMPLE_RATE = 44100;
+    const int OUT_SAMPLE_RATE = 48000;
+    const double SWEEP_SECONDS = 10.0;
+    const double SWEEP_START = 20.0;
+    const double SWEEP_END = 20000.0;
+    const double PI = 3.14159265358979323846;
+    const enum Resample_Quality QUALITIES[] = {RESAMPLE_FAST, RESAMPLE_DEFAULT, RESAMPLE_HIGH, RESAMPLE_SOXR};
+
+    // an exponential sweep spends the same time in every octave, so every part of the filter is exercised
+    std::vector<float> sweep(static_cast<std::size_t>(SWEEP_SECONDS * IN_SAMPLE_RATE));
+    double rate = std::log(SWEEP_END / SWEEP_START);
+
+    for(std::size_t i = 0; i < sweep.size(); i++)
+    {
+        double t = static_cast<double>(i) / IN_SAMPLE_RATE;
+        double phase = 2 * PI * SWEEP_START * SWEEP_SECONDS / rate * (std::exp(t / SWEEP_SECONDS * rate) - 1);
+        sweep[i] = static_cast<float>(0.5 * std::sin(phase));
+    }
+
+    std::vector<Benchmark_Result> results;
+
+    for(enum Resample_Quality quality : QUALITIES)
+    {
+        std::string name = std::string{"resample_quality/"} + get_quality_name(quality);
+
+        std::vector<float> output;
+        double cpu = 0;
+        double total_cpu = 0;
+        double audio_seconds = 0;
+        Return_Status status = STATUS_SUCCESS;
+
+        do
+        {
+            status = resample_signal(quality, IN_SAMPLE_RATE, OUT_SAMPLE_RATE, sweep, output, cpu);
+            total_cpu += cpu;
+            audio_seconds += SWEEP_SECONDS;
+        }
+        while(status == STATUS_SUCCESS && total_cpu < min_seconds);
+
+        double passband = 0;
+        double alias = 0;
+
+        if(status != STATUS_SUCCESS || tone_level(quality, IN_SAMPLE_RATE, OUT_SAMPLE_RATE, 20000.0, passband) != STATUS_SUCCESS ||
+           tone_level(quality, OUT_SAMPLE_RATE, IN_SAMPLE_RATE, 23000.0, alias) != STATUS_SUCCESS)
+        {
+            std::cerr << "Skipping " << name << '\n';
+            continue;
+        }
+
+        results.push_back(Benchmark_Result{name + "/cpu", total_cpu * 1000 / audio_seconds, "ms-cpu/audio-s"});
+        results.push_back(Benchmark_Result{name + "/passband-loss-20k", -passband, "dB"});
+        results.push_back(Benchmark_Result{name + "/alias-23k", alias, "dB"});
+    }
+
+    return results;
+}
+
+/* benchmark_play_frame() function
+ * @desc times Audio_Player::play_frame() with the null backend, which measures the player's own overhead per call
+ * @param min_seconds - how long to time it at least
+ * @return ns per call
+ */
+std::vector<Benchmark_Result> benchmark_play_frame(double min_seconds)
+{
+    const int NB_SAMPLES = 1024;
+    std::vector<Benchmark_Result> results;
+
+    AVFrame *frame = make_test_frame(AV_SAMPLE_FMT_S16, 2, NB_SAMPLES, 48000);
+    Audio_Player audio_player{PA_SAMPLE_S16NE, 2, 48000, "Benchmark", "Null"};
+    audio_player.reset_backend(BACKEND_NULL);
+
+    if(!frame || audio_player.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to set up the null sink: " << audio_player.poll_error() << '\n';
+        av_frame_free(&frame);
+        return results;
+    }
+
+    double seconds = time_per_iteration([&]()
+    {
+        audio_player.play_frame(frame);
+    }, min_seconds);
+
+    results.push_back(Benchmark_Result{"play_frame/null/s16/1024", seconds * 1e9, "ns/call"});
+
+    av_frame_free(&frame);
+    return results;
+}
+
+/* benchmark_streaming_memory() function
+ * @desc decodes a 10 hour file in the decoder's streaming mode to the null sink and checks that memory stays flat,
+ * @desc the resident set size after the first hour is the reference, from then on it may grow by at most MAX_GROWTH_KB
+ * @param directory - where to write the fixture
+ * @param flat - set to false if memory grew more than allowed or the file could not be decoded
+ * @return the growth of the resident set size after the first hour in KiB
+ * @note the fixture is silence in a sparse file, 8000 Hz mono, so it takes no disk space
+ */
+std::vector<Benchmark_Result> benchmark_streaming_memory(const std::string &directory, bool &flat)
+{
+    const int SAMPLE_RATE = 8000;
+    const double HOURS = 10;
+    const uint64_t SAMPLES_PER_CHECK = SAMPLE_RATE * 600;   // every ten minutes of audio
+    const uint64_t SAMPLES_PER_HOUR = SAMPLE_RATE * 3600;
+    const std::size_t MAX_GROWTH_KB = 1024;
+
+    std::vector<Benchmark_Result> results;
+    std::string path = directory + "/long.wav";
+    std::string error;
+
+    flat = false;
+
+    if(write_silent_wav(path, SAMPLE_RATE, 1, HOURS * 3600, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    FFmpeg_Decoder decoder{path, AVMEDIA_TYPE_AUDIO};
+    decoder.set_streaming(true);
+
+    Audio_Player audio_player{PA_SAMPLE_S16LE, 1, SAMPLE_RATE, "Benchmark", "Null"};
+    audio_player.reset_backend(BACKEND_NULL);
+
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS || audio_player.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << path << ": " << decoder.poll_error() << audio_player.poll_error() << '\n';
+        unlink(path.c_str());
+        return results;
+    }
+
+    Memory_Usage usage;
+    std::size_t reference_kb = 0;
+    std::size_t largest_kb = 0;
+    uint64_t samples = 0;
+    uint64_t next_check = SAMPLES_PER_HOUR;
+    bool failed = false;
+
+    while(!decoder.end_of_file_reached())
+    {
+        AVFrame *frame = decoder.decode_frame();
+        if(!frame)
+        {
+            failed = !decoder.end_of_file_reached();
+            break;
+        }
+
+        if(audio_player.play_frame(frame) != STATUS_SUCCESS)
+        {
+            failed = true;
+            break;
+        }
+
+        samples += frame->nb_samples;
+        if(samples >= next_check && read_memory_usage(usage) == STATUS_SUCCESS)
+        {
+            if(reference_kb == 0)
+            {
+                reference_kb = usage.resident_kb;
+            }
+
+            largest_kb = std::max(largest_kb, usage.resident_kb);
+            next_check += SAMPLES_PER_CHECK;
+        }
+    }
+
+    unlink(path.c_str());
+
+    if(failed || samples < HOURS * SAMPLES_PER_HOUR || reference_kb == 0)
+    {
+        std::cerr << "Failed to decode " << path << " to the end: " << decoder.poll_error() << audio_player.poll_error() << '\n';
+        return results;
+    }
+
+    std::size_t growth_kb = largest_kb - reference_kb;
+    flat = growth_kb <= MAX_GROWTH_KB;
+
+    if(!flat)
+    {
+        std::cerr << "Memory grew by " << growth_kb << " KiB while streaming, at most " << MAX_GROWTH_KB << " KiB is allowed\n";
+    }
+
+    results.push_back(Benchmark_Result{"stream/10h/rss-growth", static_cast<double>(growth_kb), "KiB"});
+    return results;
+}
+
+/* benchmark_chapter_jump() function
+ * @desc times FFmpeg_Decoder::seek_chapter() followed by decoding the first frame, jumping between the chapters
+ * @desc of a 2 hour Matroska file out of order, and checks that every jump lands exactly on the chapter start
+ * @param directory - where to write the fixture
+ * @param accurate - set to false if a jump landed anywhere but the first sample of the chapter or failed
+ * @return the average and the slowest jump in ms
+ */
+std::vector<Benchmark_Result> benchmark_chapter_jump(const std::string &directory, bool &accurate)
+{
+    const int SAMPLE_RATE = 8000;
+    const int CHAPTERS = 24;
+    const int STRIDE = 7;    // visits every chapter once, out of order, as CHAPTERS is not a multiple of it
+
+    Fixture_Spec fixture{directory + "/chapters.mkv", AV_CODEC_ID_FLAC, SAMPLE_RATE, 1, 2 * 3600, CHAPTERS};
+    std::vector<Benchmark_Result> results;
+    std::string error;
+
+    accurate = false;
+
+    if(write_fixture(fixture, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    FFmpeg_Decoder decoder{fixture.path, AVMEDIA_TYPE_AUDIO};
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << fixture.path << ": " << decoder.poll_error() << '\n';
+        unlink(fixture.path.c_str());
+        return results;
+    }
+
+    std::vector<Chapter> chapters = decoder.get_chapters();
+    AVRational time_base = decoder.get_stream()->time_base;
+    std::chrono::duration<double> total{0};
+    std::chrono::duration<double> slowest{0};
+    int misses = 0;
+
+    for(int i = 0; i < static_cast<int>(chapters.size()); i++)
+    {
+        const Chapter &chapter = chapters[(i * STRIDE) % chapters.size()];
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        AVFrame *frame = nullptr;
+        if(decoder.seek_chapter(chapter.index) == STATUS_SUCCESS)
+        {
+            frame = decoder.decode_frame();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        total += elapsed;
+        slowest = std::max(slowest, elapsed);
+
+        int64_t expected = av_rescale_q(chapter.start, AVRational{1, AV_TIME_BASE}, AVRational{1, SAMPLE_RATE});
+        if(!frame || av_rescale_q(frame->pts, time_base, AVRational{1, SAMPLE_RATE}) != expected)
+        {
+            std::cerr << "Jump to chapter " << chapter.index + 1 << " did not land on sample " << expected << ": " << decoder.poll_error() << '\n';
+            misses++;
+        }
+    }
+
+    unlink(fixture.path.c_str());
+
+    if(chapters.size() != static_cast<std::size_t>(CHAPTERS))
+    {
+        std::cerr << "Expected " << CHAPTERS << " chapters in " << fixture.path << ", found " << chapters.size() << '\n';
+        return results;
+    }
+
+    accurate = misses == 0;
+
+    results.push_back(Benchmark_Result{"chapter_jump/mkv-flac/2h/average", total.count() / chapters.size() * 1000, "ms"});
+    results.push_back(Benchmark_Result{"chapter_jump/mkv-flac/2h/slowest", slowest.count() * 1000, "ms"});
+    return results;
+}
+
+/* produce_bursts() function
+ * @desc the producer process of benchmark_pipe_input(), writes data to a pipe in bursts of random size with random pauses between them
+ * @param file_descriptor - the write end of the pipe, closed when done
+ * @param data - what to write
+ */
+void produce_bursts(int file_descriptor, const std::vector<uint8_t> &data)
+{
+    const std::size_t MIN_BURST = 16 * 1024;
+    const std::size_t MAX_BURST = 256 * 1024;
+    const long MAX_PAUSE_MS = 150;
+
+    uint32_t state = 42;
+    std::size_t position = 0;
+
+    while(position < data.size())
+    {
+        state = state * 1664525u + 1013904223u;
+        std::size_t burst = std::min(MIN_BURST + state % (MAX_BURST - MIN_BURST), data.size() - position);
+
+        while(burst > 0)
+        {
+            ssize_t written = write(file_descriptor, data.data() + position, burst);
+            if(written < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+
+                close(file_descriptor);
+                return;
+            }
+
+            position += written;
+            burst -= written;
+        }
+
+        state = state * 1664525u + 1013904223u;
+        struct timespec pause = {0, static_cast<long>(state % MAX_PAUSE_MS) * 1000000};
+        nanosleep(&pause, nullptr);
+    }
+
+    close(file_descriptor);
+}
+
+/* benchmark_pipe_input() function
+ * @desc plays a FLAC file piped from a producer process that writes in bursts, through a Pipe_Input to the null backend,
+ * @desc paced at SPEEDUP times real time so the producer is only slightly faster than playback on average
+ * @param directory - where to write the fixture
+ * @param complete - set to false if the piped file was not decoded to the end
+ * @return the number of jitter buffer underruns and the time to the first decoded frame in ms
+ */
+std::vector<Benchmark_Result> benchmark_pipe_input(const std::string &directory, bool &complete)
+{
+    const int SPEEDUP = 10;
+    const std::size_t BUFFER_BYTES = 1024 * 1024;
+    const std::size_t PREFILL_BYTES = 128 * 1024;
+
+    Fixture_Spec fixture{directory + "/piped.flac", AV_CODEC_ID_FLAC, 44100, 2, 20};
+    std::vector<Benchmark_Result> results;
+    std::string error;
+
+    complete = false;
+
+    if(write_fixture(fixture, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    std::ifstream file{fixture.path, std::ios::binary};
+    std::vector<uint8_t> data{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    file.close();
+    unlink(fixture.path.c_str());
+
+    int pipe_ends[2];
+    if(pipe(pipe_ends) < 0)
+    {
+        std::cerr << "Failed to create a pipe\n";
+        return results;
+    }
+
+    pid_t producer = fork();
+    if(producer < 0)
+    {
+        std::cerr << "Failed to start the producer\n";
+        close(pipe_ends[0]);
+        close(pipe_ends[1]);
+        return results;
+    }
+
+    if(producer == 0)
+    {
+        close(pipe_ends[0]);
+        produce_bursts(pipe_ends[1], data);
+        _exit(0);
+    }
+
+    close(pipe_ends[1]);
+
+    uint64_t samples = 0;
+    double first_frame_ms = 0;
+    Pipe_Input_Stats stats{};
+
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        Pipe_Input input{pipe_ends[0], BUFFER_BYTES, PREFILL_BYTES};
+        FFmpeg_Decoder decoder{"-", AVMEDIA_TYPE_AUDIO};
+        Audio_Player audio_player{PA_SAMPLE_S16NE, 2, 44100, "Benchmark", "Null"};
+        audio_player.reset_backend(BACKEND_NULL);
+
+        bool opened = input.start() == STATUS_SUCCESS;
+        if(opened)
+        {
+            decoder.set_input(input.get_io_context());
+            opened = decoder.open_file() == STATUS_SUCCESS && decoder.init() == STATUS_SUCCESS && audio_player.init() == STATUS_SUCCESS;
+        }
+
+        if(!opened)
+        {
+            std::cerr << "Failed to open the pipe: " << input.poll_error() << decoder.poll_error() << audio_player.poll_error() << '\n';
+        }
+
+        while(opened && !decoder.end_of_file_reached())
+        {
+            AVFrame *frame = decoder.decode_frame();
+            if(!frame)
+            {
+                if(!decoder.end_of_file_reached())
+                {
+                    std::cerr << "Failed to decode the pipe: " << decoder.poll_error() << '\n';
+                }
+                break;
+            }
+
+            if(samples == 0)
+            {
+                first_frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            audio_player.play_frame(frame);
+            samples += frame->nb_samples;
+
+            // play no faster than SPEEDUP times real time, like a sink would
+            std::this_thread::sleep_until(start + std::chrono::duration<double>(static_cast<double>(samples) / fixture.sample_rate / SPEEDUP));
+        }
+
+        input.stop();
+        stats = input.get_stats();
+    }
+
+    close(pipe_ends[0]);
+    kill(producer, SIGTERM);
+    waitpid(producer, nullptr, 0);
+
+    complete = samples == static_cast<uint64_t>(fixture.seconds * fixture.sample_rate);
+    if(!complete)
+    {
+        std::cerr << "Decoded " << samples << " samples from the pipe, expected " << fixture.seconds * fixture.sample_rate << '\n';
+        return results;
+    }
+
+    results.push_back(Benchmark_Result{"pipe/bursty/underruns", static_cast<double>(stats.underruns), "underruns"});
+    results.push_back(Benchmark_Result{"pipe/bursty/first-frame", first_frame_ms, "ms"});
+    return results;
+}
+
+/* median_milliseconds() function
+ * @param durations - the measured times, reordered
+ * @return the median of durations in milliseconds, 0 if empty
+ */
+double median_milliseconds(std::vector<std::chrono::duration<double>> &durations)
+{
+    if(durations.empty())
+    {
+        return 0;
+    }
+
+    std::nth_element(durations.begin(), durations.begin() + durations.size() / 2, durations.end());
+    return durations[durations.size() / 2].count() * 1000;
+}
+
+/* cold_start() function
+ * @desc what a player invocation does before the first sample reaches the sink, minus process start and linking:
+ * @desc fresh decoder, resampler and sink, open the file, decode and resample the first frame and play it
+ * @param filename - the file to start
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status cold_start(const std::string &filename)
+{
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+    FFmpeg_Frame_Resampler resampler{av_get_default_channel_layout(2), AV_SAMPLE_FMT_S16, 48000, 0, AV_SAMPLE_FMT_NONE, 0};
+    Audio_Player audio_player{PA_SAMPLE_S16NE, 2, 48000, "Benchmark", "Null"};
+    audio_player.reset_backend(BACKEND_NULL);
+
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS || audio_player.init() != STATUS_SUCCESS)
+    {
+        return STATUS_FAILURE;
+    }
+
+    AVFrame *frame = decoder.decode_frame();
+    if(!frame || resampler.reset_options(av_get_default_channel_layout(2), AV_SAMPLE_FMT_S16, 48000, frame->channel_layout,
+                                         static_cast<enum AVSampleFormat>(frame->format), frame->sample_rate) != STATUS_SUCCESS ||
+       resampler.init() != STATUS_SUCCESS)
+    {
+        return STATUS_FAILURE;
+    }
+
+    AVFrame *resampled_frame = resampler.resample_frame(frame);
+    if(!resampled_frame)
+    {
+        return STATUS_FAILURE;
+    }
+
+    return audio_player.play_frame(resampled_frame);
+}
+
+/* benchmark_daemon() function
+ * @desc runs a Player_Daemon with the null backend on a thread and times commands sent to it by a Daemon_Client,
+ * @desc against starting the same file with fresh objects as a player invocation does
+ * @param directory - where to write the fixture and the socket
+ * @param responsive - set to false if a command failed
+ * @return the median time of a cold start, of PLAY until the first sample is written and of SEEK, in ms
+ * @note neither side includes process start or connecting to an audio server, both of which the daemon also saves
+ */
+std::vector<Benchmark_Result> benchmark_daemon(const std::string &directory, bool &responsive)
+{
+    const int ROUNDS = 25;
+
+    Fixture_Spec fixture{directory + "/daemon.flac", AV_CODEC_ID_FLAC, 44100, 2, 10};
+    std::string socket_path = directory + "/daemon.sock";
+    std::vector<Benchmark_Result> results;
+    std::string error;
+
+    responsive = false;
+
+    if(write_fixture(fixture, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    std::vector<std::chrono::duration<double>> cold_times;
+    for(int i = 0; i < ROUNDS; i++)
+    {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        if(cold_start(fixture.path) != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to start " << fixture.path << '\n';
+            unlink(fixture.path.c_str());
+            return results;
+        }
+        cold_times.push_back(std::chrono::steady_clock::now() - begin);
+    }
+
+    Player_Daemon daemon{socket_path, BACKEND_NULL, 0};
+    if(daemon.start() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to start the daemon: " << daemon.poll_error() << '\n';
+        unlink(fixture.path.c_str());
+        return results;
+    }
+
+    std::thread server{[&daemon]()
+    {
+        while(daemon.is_running() && daemon.serve() == STATUS_SUCCESS)
+        {
+            daemon.poll_error();
+        }
+    }};
+
+    Daemon_Client client;
+    std::vector<std::chrono::duration<double>> play_times;
+    std::vector<std::chrono::duration<double>> seek_times;
+    std::string reply;
+
+    responsive = client.connect(socket_path) == STATUS_SUCCESS;
+
+    // every PLAY replaces the track still playing from the round before, as a listener skipping tracks would
+    for(int i = 0; responsive && i < ROUNDS; i++)
+    {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        responsive = client.send_command("PLAY " + fixture.path, reply) == STATUS_SUCCESS && reply.compare(0, 2, "OK") == 0;
+        play_times.push_back(std::chrono::steady_clock::now() - begin);
+
+        begin = std::chrono::steady_clock::now();
+        responsive = responsive && client.send_command("SEEK " + std::to_string(fixture.seconds / 2), reply) == STATUS_SUCCESS &&
+                     reply.compare(0, 2, "OK") == 0;
+        seek_times.push_back(std::chrono::steady_clock::now() - begin);
+    }
+
+    if(!responsive)
+    {
+        std::cerr << "Daemon command failed: " << reply << client.poll_error() << '\n';
+    }
+
+    // SHUTDOWN ends the server loop, if the connection is gone a fresh one is tried
+    if(client.send_command("SHUTDOWN", reply) != STATUS_SUCCESS)
+    {
+        client.connect(socket_path);
+        client.send_command("SHUTDOWN", reply);
+    }
+
+    server.join();
+    unlink(fixture.path.c_str());
+
+    if(!responsive)
+    {
+        return results;
+    }
+
+    results.push_back(Benchmark_Result{"daemon/cold-start/flac", median_milliseconds(cold_times), "ms"});
+    results.push_back(Benchmark_Result{"daemon/play/flac", median_milliseconds(play_times), "ms"});
+    results.push_back(Benchmark_Result{"daemon/seek/flac", median_milliseconds(seek_times), "ms"});
+    return results;
+}
+
+/* benchmark_clock() function
+ * @desc plays a one hour file with a click every second into a simulated sink, whose clock runs SINK_PPM faster than the
+ * @desc system clock, buffers SINK_LATENCY and reports latencies off by up to JITTER_US, and compares a Playback_Clock
+ * @desc with the moment each click is heard. Time is simulated, so the hour takes as long as decoding it.
+ * @desc Reads of the clock are also timed, alone and while another thread keeps updating it.
+ * @param directory - where to write the fixture
+ * @param min_seconds - how long to time the reads for
+ * @param accurate - set to false if a click was heard more than MAX_ERROR_MS away from the clock, a click was decoded
+ * @param accurate - at the wrong position or the clock went backwards
+ * @return the largest and the last difference between the clock and a click in ms, and the time of a read in ns
+ */
+std::vector<Benchmark_Result> benchmark_clock(const std::string &directory, double min_seconds, bool &accurate)
+{
+    const int SAMPLE_RATE = 48000;
+    const int CHANNELS = 2;
+    const double SECONDS = 3600;
+    const double SINK_PPM = 50;
+    const double SINK_LATENCY = 0.1;
+    const double JITTER_US = 1000;
+    const int64_t MEASURE_INTERVAL_NS = 100000000;
+    const double MAX_ERROR_MS = 2;
+
+    std::string path = directory + "/clicks.wav";
+    std::vector<Benchmark_Result> results;
+    std::string error;
+
+    accurate = false;
+
+    if(write_clicks_wav(path, SAMPLE_RATE, CHANNELS, SECONDS, 1.0, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    FFmpeg_Decoder decoder{path, AVMEDIA_TYPE_AUDIO};
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << path << ": " << decoder.poll_error() << '\n';
+        unlink(path.c_str());
+        return results;
+    }
+
+    Playback_Clock clock{SAMPLE_RATE};
+    double sink_rate = SAMPLE_RATE * (1 + SINK_PPM / 1e6);
+
+    // the sink starts playing at start, the simulated time only moves when a write blocks
+    int64_t start = Playback_Clock::now();
+    int64_t time = start;
+    int64_t written = 0;
+    auto played = [&](int64_t at)
+    {
+        return std::min(static_cast<double>(at - start) / 1e9 * sink_rate, static_cast<double>(written));
+    };
+
+    int64_t last_measurement = 0;
+    int64_t last_position = 0;
+    uint32_t state = 42;
+
+    std::vector<int64_t> clicks;
+    std::size_t clicks_heard = 0;
+    double max_error = 0;
+    double last_error = 0;
+    bool monotonic = true;
+    bool decoded = true;
+
+    while(1)
+    {
+        AVFrame *frame = decoder.decode_frame();
+        if(!frame)
+        {
+            decoded = decoder.end_of_file_reached();
+            if(!decoded)
+            {
+                std::cerr << "Failed to decode " << path << ": " << decoder.poll_error() << '\n';
+            }
+            break;
+        }
+
+        if(written == 0)
+        {
+            clock.reset(av_rescale_q(frame->best_effort_timestamp, decoder.get_stream()->time_base, AVRational{1, AV_TIME_BASE}));
+        }
+
+        const int16_t *samples = reinterpret_cast<const int16_t*>(frame->extended_data[0]);
+        for(int i = 0; i < frame->nb_samples; i++)
+        {
+            if(samples[i * CHANNELS] != 0)
+            {
+                clicks.push_back(written + i);
+            }
+        }
+
+        // the write blocks until the frame fits into the sink buffer
+        double excess = written - played(time) + frame->nb_samples - SINK_LATENCY * SAMPLE_RATE;
+        if(excess > 0)
+        {
+            time += static_cast<int64_t>(std::ceil(excess / sink_rate * 1e9));
+        }
+
+        // every click heard while the write blocked is compared with what the clock said at that moment
+        for(; clicks_heard < clicks.size() && clicks[clicks_heard] < written; clicks_heard++)
+        {
+            int64_t heard = start + static_cast<int64_t>(std::ceil(clicks[clicks_heard] / sink_rate * 1e9));
+            if(heard > time)
+            {
+                break;
+            }
+
+            last_error = static_cast<double>(clock.get_samples_at(heard) - clicks[clicks_heard]) * 1000 / SAMPLE_RATE;
+            max_error = std::max(max_error, std::fabs(last_error));
+        }
+
+        written += frame->nb_samples;
+        clock.advance(frame->nb_samples);
+
+        if(clock.get_updates() == 0 || time - last_measurement >= MEASURE_INTERVAL_NS)
+        {
+            state = state * 1664525u + 1013904223u;
+            double jitter = (static_cast<double>(state >> 8) / (1 << 24) * 2 - 1) * JITTER_US;
+            double latency = std::max((written - played(time)) * 1e6 / SAMPLE_RATE + jitter, 0.0);
+
+            clock.update_latency(static_cast<uint64_t>(latency), time);
+            last_measurement = time;
+        }
+
+        int64_t position = clock.get_samples_at(time);
+        monotonic = monotonic && position >= last_position;
+        last_position = position;
+    }
+
+    unlink(path.c_str());
+
+    // the clicks have to come out of the decoder exactly where they were written
+    bool positioned = clicks.size() == static_cast<std::size_t>(SECONDS);
+    for(std::size_t i = 0; positioned && i < clicks.size(); i++)
+    {
+        positioned = clicks[i] == static_cast<int64_t>(i) * SAMPLE_RATE;
+    }
+
+    accurate = decoded && positioned && monotonic && max_error <= MAX_ERROR_MS;
+    if(!accurate)
+    {
+        std::cerr << "Playback clock: " << clicks.size() << " clicks decoded" << (positioned ? "" : " at the wrong positions")
+                  << ", largest error " << max_error << " ms" << (monotonic ? "" : ", went backwards") << '\n';
+    }
+
+    results.push_back(Benchmark_Result{"clock/clicks/1h/max-error", max_error, "ms"});
+    results.push_back(Benchmark_Result{"clock/clicks/1h/final-error", std::fabs(last_error), "ms"});
+
+    int64_t total = 0;
+    double seconds = time_per_iteration([&]()
+    {
+        total += clock.get_samples();
+    }, min_seconds);
+    results.push_back(Benchmark_Result{"clock/read", seconds * 1e9, "ns/call"});
+
+    // the writer updates far more often than a real one would, so the readers keep hitting the sequence lock
+    std::atomic<bool> stop{false};
+    std::thread writer{[&clock, &stop]()
+    {
+        while(!stop.load(std::memory_order_relaxed))
+        {
+            clock.advance(1);
+            clock.update_latency(1000);
+        }
+    }};
+
+    seconds = time_per_iteration([&]()
+    {
+        total += clock.get_samples();
+    }, min_seconds);
+    results.push_back(Benchmark_Result{"clock/read/contended", seconds * 1e9, "ns/call"});
+
+    stop.store(true, std::memory_order_relaxed);
+    writer.join();
+
+    // keeps the reads from being optimized away
+    if(total < 0)
+    {
+        std::cerr << "Playback clock went negative\n";
+    }
+
+    return results;
+}
+
+/* Stalled_Sink Class
+ * @desc a Frame_Sink that takes far longer than real time for every frame, EX: a tap writing to a hung network share
+ */
+class Stalled_Sink : public Frame_Sink
+{
+    std::chrono::milliseconds m_stall;
+
+    public:
+
+    explicit Stalled_Sink(std::chrono::milliseconds stall) : m_stall{stall}
+    {
+
+    }
+
+    std::string get_name() override
+    {
+        return "stalled";
+    }
+
+    Return_Status consume(AVFrame *) override
+    {
+        std::this_thread::sleep_for(m_stall);
+        return STATUS_SUCCESS;
+    }
+
+    std::string poll_error() override
+    {
+        return std::string{};
+    }
+};
+
+/* benchmark_fanout() function
+ * @desc times handing frames to a null player, a WAV file and a meter through a Frame_Fanout, which shares each frame
+ * @desc by reference, against copying the frame for every sink. Then a tap that stalls for STALL per frame is added
+ * @desc next to the null player and a minute of audio is pushed, the player must get every frame without waiting on it.
+ * @param directory - where to write the WAV file
+ * @param min_seconds - how long to time the copies for
+ * @param isolated - set to false if a frame was copied, the player missed frames or the stalled tap held up the pushes
+ * @return ns per frame pushed and copied, and the lag of the player and of the stalled tap in ms
+ */
+std::vector<Benchmark_Result> benchmark_fanout(const std::string &directory, double min_seconds, bool &isolated)
+{
+    const int NB_SAMPLES = 1024;
+    const int SAMPLE_RATE = 48000;
+    const int SINKS = 3;
+    const int FRAMES = SAMPLE_RATE * 60 / NB_SAMPLES;
+    const std::chrono::milliseconds STALL{5};
+
+    std::vector<Benchmark_Result> results;
+    isolated = false;
+
+    AVFrame *frame = make_test_frame(AV_SAMPLE_FMT_S16, 2, NB_SAMPLES, SAMPLE_RATE);
+    Audio_Player audio_player{PA_SAMPLE_S16NE, 2, SAMPLE_RATE, "Benchmark", "Null"};
+    audio_player.reset_backend(BACKEND_NULL);
+
+    if(!frame || audio_player.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to set up the null sink: " << audio_player.poll_error() << '\n';
+        av_frame_free(&frame);
+        return results;
+    }
+
+    std::string path = directory + "/fanout.wav";
+    bool complete = true;
+    double push_seconds = 0;
+
+    {
+        Frame_Fanout fanout;
+        fanout.add_sink(std::unique_ptr<Frame_Sink>{new Player_Sink{audio_player}}, FANOUT_BLOCK, 64);
+        fanout.add_sink(std::unique_ptr<Frame_Sink>{new Wav_Sink{path}}, FANOUT_BLOCK, 64);
+        fanout.add_sink(std::unique_ptr<Frame_Sink>{new Meter_Sink{nullptr, 1.0}}, FANOUT_BLOCK, 64);
+
+        complete = fanout.start() == STATUS_SUCCESS;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(int i = 0; i < FRAMES && complete; i++)
+        {
+            complete = fanout.push(frame) == STATUS_SUCCESS;
+        }
+        complete = fanout.finish() == STATUS_SUCCESS && complete;
+        push_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        complete = complete && fanout.get_frames_copied() == 0;
+        for(const Fanout_Sink_Stats &sink : fanout.get_stats())
+        {
+            complete = complete && sink.frames_consumed == static_cast<uint64_t>(FRAMES);
+        }
+
+        for(std::string error = fanout.poll_error(); !error.empty(); error = fanout.poll_error())
+        {
+            std::cerr << error << '\n';
+        }
+    }
+    unlink(path.c_str());
+
+    results.push_back(Benchmark_Result{"fanout/share/3-sinks", push_seconds / FRAMES * 1e9, "ns/frame"});
+
+    // what a fanout without refcounting would do, a copy of the samples for every sink
+    std::size_t size = static_cast<std::size_t>(NB_SAMPLES) * 2 * sizeof(int16_t);
+    double copy_seconds = time_per_iteration([&]()
+    {
+        for(int sink = 0; sink < SINKS; sink++)
+        {
+            AVFrame *copy = av_frame_alloc();
+            copy->format = frame->format;
+            copy->channel_layout = frame->channel_layout;
+            copy->channels = frame->channels;
+            copy->nb_samples = frame->nb_samples;
+            copy->sample_rate = frame->sample_rate;
+
+            if(av_frame_get_buffer(copy, 0) == 0)
+            {
+                std::memcpy(copy->extended_data[0], frame->extended_data[0], size);
+            }
+            av_frame_free(&copy);
+        }
+    }, min_seconds);
+
+    results.push_back(Benchmark_Result{"fanout/copy/3-sinks", copy_seconds * 1e9, "ns/frame"});
+
+    Fanout_Sink_Stats player_stats{};
+    Fanout_Sink_Stats stalled_stats{};
+    double stalled_push_seconds = 0;
+
+    {
+        Frame_Fanout fanout;
+        fanout.add_sink(std::unique_ptr<Frame_Sink>{new Player_Sink{audio_player}}, FANOUT_BLOCK, 64);
+        fanout.add_sink(std::unique_ptr<Frame_Sink>{new Stalled_Sink{STALL}}, FANOUT_DROP, 8);
+
+        complete = fanout.start() == STATUS_SUCCESS && complete;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(int i = 0; i < FRAMES; i++)
+        {
+            complete = fanout.push(frame) == STATUS_SUCCESS && complete;
+        }
+        stalled_push_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        complete = fanout.finish() == STATUS_SUCCESS && complete;
+
+        std::vector<Fanout_Sink_Stats> stats = fanout.get_stats();
+        player_stats = stats[0];
+        stalled_stats = stats[1];
+    }
+
+    // a push that waited on the stalled tap would take STALL, all of them together take longer than that for a few frames
+    bool unblocked = stalled_push_seconds < std::chrono::duration<double>(STALL).count() * FRAMES / 10;
+    isolated = complete && unblocked && player_stats.frames_consumed == static_cast<uint64_t>(FRAMES) && stalled_stats.frames_dropped > 0;
+
+    results.push_back(Benchmark_Result{"fanout/stalled-tap/player-lag", player_stats.lag_max_ms, "ms"});
+    results.push_back(Benchmark_Result{"fanout/stalled-tap/tap-lag", stalled_stats.lag_avg_ms, "ms"});
+
+    av_frame_free(&frame);
+    return results;
+}
+
+/* decode_pipelined() function
+ * @desc decodes a whole file on one thread and resamples it to 48000 Hz signed 16 bit stereo on the calling thread,
+ * @desc the decoded frames are moved out of the decoder into frames of a pool and queued, nothing is copied
+ * @param filename - the file to decode
+ * @param pool - the frames the decoding thread may fill, it waits while all of them are queued or being resampled
+ * @param audio_seconds - set to the length of the resampled audio in seconds
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, the errors are printed
+ */
+Return_Status decode_pipelined(const std::string &filename, Frame_Pool &pool, double &audio_seconds)
+{
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+    FFmpeg_Frame_Resampler resampler{av_get_default_channel_layout(2), AV_SAMPLE_FMT_S16, 48000, 0, AV_SAMPLE_FMT_NONE, 0};
+    bool resampler_ready = false;
+
+    audio_seconds = 0;
+
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::deque<Frame_Handle> queue;
+    bool decoded = false;
+    bool decode_failed = false;
+
+    std::thread decoding{[&]()
+    {
+        while(1)
+        {
+            Frame_Handle frame = pool.acquire();
+            if(!frame)
+            {
+                break;
+            }
+
+            if(decoder.decode_frame(frame) != STATUS_SUCCESS)
+            {
+                decode_failed = !decoder.end_of_file_reached();
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            queue.push_back(std::move(frame));
+            queued.notify_one();
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        decoded = true;
+        queued.notify_one();
+    }};
+
+    Return_Status status = STATUS_SUCCESS;
+    Frame_Handle resampled;
+
+    while(status == STATUS_SUCCESS)
+    {
+        Frame_Handle frame;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            queued.wait(lock, [&]()
+            {
+                return !queue.empty() || decoded;
+            });
+
+            if(queue.empty())
+            {
+                break;
+            }
+
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        if(!resampler_ready)
+        {
+            resampler.reset_channel_layout(false, frame->channel_layout);
+            resampler.reset_sample_format(false, static_cast<enum AVSampleFormat>(frame->format));
+            resampler.reset_sample_rate(false, frame->sample_rate);
+
+            if(resampler.init() != STATUS_SUCCESS)
+            {
+                std::cerr << "Failed to initialize resampler: " << resampler.poll_error() << '\n';
+                status = STATUS_FAILURE;
+                break;
+            }
+            resampler_ready = true;
+        }
+
+        if(resampler.resample_frame(frame.get(), resampled) != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to resample " << filename << ": " << resampler.poll_error() << '\n';
+            status = STATUS_FAILURE;
+            break;
+        }
+
+        audio_seconds += static_cast<double>(resampled->nb_samples) / resampled->sample_rate;
+    }
+
+    // wakes the decoding thread if it waits for a frame, the frames still queued go back to the pool with the queue
+    pool.close();
+    decoding.join();
+
+    if(decode_failed)
+    {
+        std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+        status = STATUS_FAILURE;
+    }
+
+    return status;
+}
+
+/* benchmark_pipeline() function
+ * @desc times decoding and resampling a FLAC file on one thread against decoding it on a second thread that hands
+ * @desc its frames over through a Frame_Pool of POOL_FRAMES frames, in wall time since the point is using two cores
+ * @param directory - where to write the fixture
+ * @param min_seconds - how long to time each case at least
+ * @param bounded - set to false if the pipeline lost audio or had more than POOL_FRAMES frames in flight
+ * @return wall milliseconds per second of audio for both cases, and the frames in flight
+ */
+std::vector<Benchmark_Result> benchmark_pipeline(const std::string &directory, double min_seconds, bool &bounded)
+{
+    const Fixture_Spec FIXTURE{directory + "/pipeline.flac", AV_CODEC_ID_FLAC, 44100, 2, 30};
+    const std::size_t POOL_FRAMES = 8;
+
+    std::vector<Benchmark_Result> results;
+    bounded = false;
+
+    std::string error;
+    if(write_fixture(FIXTURE, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    double single_seconds = 0;
+    double pipelined_seconds = 0;
+    std::size_t max_in_use = 0;
+
+    double single = time_per_iteration([&]()
+    {
+        if(decode_file(FIXTURE.path, true, single_seconds) != STATUS_SUCCESS)
+        {
+            single_seconds = 0;
+        }
+    }, min_seconds);
+
+    double pipelined = time_per_iteration([&]()
+    {
+        Frame_Pool pool{POOL_FRAMES};
+        if(decode_pipelined(FIXTURE.path, pool, pipelined_seconds) != STATUS_SUCCESS)
+        {
+            pipelined_seconds = 0;
+        }
+        max_in_use = std::max(max_in_use, pool.get_max_in_use());
+    }, min_seconds);
+
+    unlink(FIXTURE.path.c_str());
+
+    if(single_seconds <= 0 || pipelined_seconds <= 0)
+    {
+        return results;
+    }
+
+    // resampling can hold back a few samples at the very end, anything more is lost audio
+    bounded = std::fabs(single_seconds - pipelined_seconds) < 0.01 && max_in_use <= POOL_FRAMES;
+
+    results.push_back(Benchmark_Result{"pipeline/flac/resample-48k-s16/1-thread", single * 1000 / single_seconds, "wall-ms/audio-s"});
+    results.push_back(Benchmark_Result{"pipeline/flac/resample-48k-s16/2-threads", pipelined * 1000 / pipelined_seconds, "wall-ms/audio-s"});
+    results.push_back(Benchmark_Result{"pipeline/frames-in-flight", static_cast<double>(max_in_use), "frames"});
+
+    return results;
+}
+
+/* Simulated_Playback Struct
+ * @desc what simulate_playback() measured
+ * @member audio_seconds - the length of the audio played
+ * @member wakeups - the number of times a thread was woken, for a sink write that blocked or a decoder burst
+ * @member bursts - the number of times the decoder was woken to refill the buffer, 0 without burst mode
+ * @member cpu_seconds - the CPU time spent decoding, resampling and buffering
+ */
+struct Simulated_Playback
+{
+    double audio_seconds;
+    uint64_t wakeups;
+    uint64_t bursts;
+    double cpu_seconds;
+};
+
+/* simulate_playback() function
+ * @desc plays a file into a simulated sink the way the player does. The sink buffers SINK_SECONDS and plays in real time,
+ * @desc but time is simulated and only moves when a write blocks, so every write that blocks is one wakeup of a thread
+ * @desc and the whole file takes as long as decoding it.
+ * @desc Without burst every resampled frame is written to the sink as it is decoded, like main_loop(). With burst the frames
+ * @desc go into a Ring_Buffer of BURST_SECONDS that feeds the sink PERIOD_SECONDS at a time and is refilled in one go once
+ * @desc it drained to LOW_WATERMARK_SECONDS, like the player's --burst.
+ * @param filename - the file to play
+ * @param burst - true to play it in bursts
+ * @param playback - set to what was measured
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, the errors are printed
+ */
+Return_Status simulate_playback(const std::string &filename, bool burst, Simulated_Playback &playback)
+{
+    const double SINK_SECONDS = 2;
+    const double BURST_SECONDS = 30;
+    const double LOW_WATERMARK_SECONDS = 5;
+    const double PERIOD_SECONDS = 0.5;
+    const int CHANNELS = 2;
+    const std::size_t FRAME_SIZE = CHANNELS * sizeof(int16_t);
+
+    playback = Simulated_Playback{0, 0, 0, 0};
+    double start = cpu_seconds();
+
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    AVFrame *first = decoder.decode_frame();
+    if(!first)
+    {
+        std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    // signed 16 bit stereo at the file's own rate, like the player
+    int sample_rate = first->sample_rate;
+    FFmpeg_Frame_Resampler resampler{av_get_default_channel_layout(CHANNELS), AV_SAMPLE_FMT_S16, sample_rate,
+                                     static_cast<int64_t>(first->channel_layout), static_cast<enum AVSampleFormat>(first->format), sample_rate};
+    if(resampler.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to initialize resampler: " << resampler.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    bool failed = false;
+    auto next_frame = [&]() -> AVFrame*
+    {
+        AVFrame *decoded = first ? first : decoder.decode_frame();
+        first = nullptr;
+
+        if(!decoded)
+        {
+            if(!decoder.end_of_file_reached())
+            {
+                std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+                failed = true;
+            }
+            return nullptr;
+        }
+
+        AVFrame *resampled = resampler.resample_frame(decoded);
+        if(!resampled)
+        {
+            std::cerr << "Failed to resample " << filename << ": " << resampler.poll_error() << '\n';
+            failed = true;
+        }
+        return resampled;
+    };
+
+    // the sink plays from the first write on, a write blocks until what it writes fits into the sink buffer
+    double sink_samples = SINK_SECONDS * sample_rate;
+    double now = 0;
+    int64_t written = 0;
+    std::vector<uint8_t> sink(static_cast<std::size_t>(PERIOD_SECONDS * sample_rate) * FRAME_SIZE);
+
+    auto sink_write = [&](const uint8_t *data, std::size_t size)
+    {
+        // the server copies what it is given, so does this
+        for(std::size_t offset = 0; offset < size; offset += sink.size())
+        {
+            std::memcpy(sink.data(), data + offset, std::min(sink.size(), size - offset));
+        }
+
+        int64_t samples = static_cast<int64_t>(size / FRAME_SIZE);
+        double fits_at = written + samples - sink_samples;
+        if(fits_at > now)
+        {
+            now = fits_at;
+            playback.wakeups++;
+        }
+        written += samples;
+    };
+
+    if(!burst)
+    {
+        for(AVFrame *frame = next_frame(); frame; frame = next_frame())
+        {
+            sink_write(frame->extended_data[0], static_cast<std::size_t>(frame->nb_samples) * FRAME_SIZE);
+        }
+    }
+
+    else
+    {
+        Ring_Buffer ring{static_cast<std::size_t>(BURST_SECONDS * sample_rate) * FRAME_SIZE};
+        std::size_t low_watermark = static_cast<std::size_t>(LOW_WATERMARK_SECONDS * sample_rate) * FRAME_SIZE;
+        std::vector<uint8_t> period(static_cast<std::size_t>(PERIOD_SECONDS * sample_rate) * FRAME_SIZE);
+
+        // the part of a frame that did not fit into the ring buffer, written first in the next burst
+        std::vector<uint8_t> pending;
+        bool end = false;
+
+        while(!failed)
+        {
+            if(!end && ring.read_available() <= low_watermark)
+            {
+                playback.bursts++;
+                playback.wakeups++;
+
+                while(1)
+                {
+                    if(pending.empty())
+                    {
+                        AVFrame *frame = next_frame();
+                        if(!frame)
+                        {
+                            end = true;
+                            break;
+                        }
+                        pending.assign(frame->extended_data[0], frame->extended_data[0] + static_cast<std::size_t>(frame->nb_samples) * FRAME_SIZE);
+                    }
+
+                    std::size_t size = ring.write(pending.data(), pending.size());
+                    pending.erase(pending.begin(), pending.begin() + size);
+
+                    if(!pending.empty())
+                    {
+                        break;
+                    }
+                }
+            }
+
+            std::size_t size = ring.read(period.data(), period.size());
+            if(size == 0)
+            {
+                break;
+            }
+            sink_write(period.data(), size);
+        }
+    }
+
+    playback.audio_seconds = static_cast<double>(written) / sample_rate;
+    playback.cpu_seconds = cpu_seconds() - start;
+    return failed ? STATUS_FAILURE : STATUS_SUCCESS;
+}
+
+/* benchmark_burst() function
+ * @desc plays a FLAC file into a simulated sink frame by frame and in bursts, see simulate_playback(), and compares
+ * @desc how often threads are woken and the CPU time both take. The player's --stats reports the same for a real sink.
+ * @param directory - where to write the fixture
+ * @param fewer_wakeups - set to false if bursts did not at least halve the wakeups or did not play the whole file
+ * @return wakeups per second of audio and CPU milliseconds per minute of audio, frame by frame and in bursts
+ */
+std::vector<Benchmark_Result> benchmark_burst(const std::string &directory, bool &fewer_wakeups)
+{
+    const Fixture_Spec FIXTURE{directory + "/burst.flac", AV_CODEC_ID_FLAC, 44100, 2, 180};
+
+    std::vector<Benchmark_Result> results;
+    fewer_wakeups = false;
+
+    std::string error;
+    if(write_fixture(FIXTURE, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    Simulated_Playback frames{};
+    Simulated_Playback bursts{};
+
+    Return_Status status = simulate_playback(FIXTURE.path, false, frames);
+    if(status == STATUS_SUCCESS)
+    {
+        status = simulate_playback(FIXTURE.path, true, bursts);
+    }
+
+    unlink(FIXTURE.path.c_str());
+
+    if(status != STATUS_SUCCESS || frames.audio_seconds <= 0 || bursts.audio_seconds <= 0)
+    {
+        return results;
+    }
+
+    fewer_wakeups = bursts.audio_seconds == frames.audio_seconds && bursts.wakeups * 2 <= frames.wakeups;
+    if(!fewer_wakeups)
+    {
+        std::cerr << "Burst playback: " << bursts.wakeups << " wakeups in " << bursts.audio_seconds << " s, frame by frame "
+                  << frames.wakeups << " in " << frames.audio_seconds << " s\n";
+    }
+
+    results.push_back(Benchmark_Result{"burst/flac/per-frame/wakeups", frames.wakeups / frames.audio_seconds, "wakeups/s"});
+    results.push_back(Benchmark_Result{"burst/flac/burst/wakeups", bursts.wakeups / bursts.audio_seconds, "wakeups/s"});
+    results.push_back(Benchmark_Result{"burst/flac/per-frame/cpu", frames.cpu_seconds * 60000 / frames.audio_seconds, "ms-cpu/audio-min"});
+    results.push_back(Benchmark_Result{"burst/flac/burst/cpu", bursts.cpu_seconds * 60000 / bursts.audio_seconds, "ms-cpu/audio-min"});
+
+    return results;
+}
+
+/* benchmark_silence_kernels() function
+ * @desc times the SIMD silence search on a second of silent stereo audio, where it has to look at every sample,
+ * @desc next to the plain loop it replaces
+ * @param min_seconds - how long to time each case at least
+ * @return ns per sample frame for every case
+ */
+std::vector<Benchmark_Result> benchmark_silence_kernels(double min_seconds)
+{
+    const int CHANNELS = 2;
+    const std::size_t COUNT = 48000 * CHANNELS;
+    const int16_t THRESHOLD_S16 = 32;
+    const float THRESHOLD_FLT = 0.001f;
+
+    std::vector<int16_t> s16(COUNT, 0);
+    std::vector<float> flt(COUNT, 0.0f);
+    std::vector<Benchmark_Result> results;
+
+    // read after timing so the searches are not optimized away
+    std::size_t found = 0;
+
+    double seconds = time_per_iteration([&]()
+    {
+        std::size_t i = 0;
+        while(i < COUNT && s16[i] <= THRESHOLD_S16 && s16[i] >= -THRESHOLD_S16)
+        {
+            i++;
+        }
+        found += i;
+    }, min_seconds);
+    results.push_back(Benchmark_Result{"silence/s16/scalar", seconds / (COUNT / CHANNELS) * 1e9, "ns/frame"});
+
+    seconds = time_per_iteration([&]()
+    {
+        found += find_loud_s16(s16.data(), COUNT, THRESHOLD_S16);
+    }, min_seconds);
+    results.push_back(Benchmark_Result{"silence/s16/simd", seconds / (COUNT / CHANNELS) * 1e9, "ns/frame"});
+
+    seconds = time_per_iteration([&]()
+    {
+        std::size_t i = 0;
+        while(i < COUNT && std::fabs(flt[i]) <= THRESHOLD_FLT)
+        {
+            i++;
+        }
+        found += i;
+    }, min_seconds);
+    results.push_back(Benchmark_Result{"silence/flt/scalar", seconds / (COUNT / CHANNELS) * 1e9, "ns/frame"});
+
+    seconds = time_per_iteration([&]()
+    {
+        found += find_loud_flt(flt.data(), COUNT, THRESHOLD_FLT);
+    }, min_seconds);
+    results.push_back(Benchmark_Result{"silence/flt/simd", seconds / (COUNT / CHANNELS) * 1e9, "ns/frame"});
+
+    if(found % COUNT != 0)
+    {
+        std::cerr << "The silence search found a loud sample in silence\n";
+    }
+
+    return results;
+}
+
+/* trim_streaming() function
+ * @desc plays a file into nothing through a Silence_Trimmer, as the player does with --trim-silence and no silence map
+ * @param filename - the file to play
+ * @param played - set to the number of sample frames that came out of the trimmer
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, the errors are printed
+ */
+Return_Status trim_streaming(const std::string &filename, int64_t &played)
+{
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+    FFmpeg_Frame_Resampler resampler{av_get_default_channel_layout(2), AV_SAMPLE_FMT_S16, 0, 0, AV_SAMPLE_FMT_NONE, 0};
+    Silence_Trimmer trimmer{-60.0, 2.0};
+    Frame_Handle resampled;
+    bool resampler_ready = false;
+
+    played = 0;
+
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    for(AVFrame *frame = decoder.decode_frame(); frame; frame = decoder.decode_frame())
+    {
+        if(!resampler_ready)
+        {
+            resampler.reset_channel_layout(false, frame->channel_layout);
+            resampler.reset_sample_format(false, static_cast<enum AVSampleFormat>(frame->format));
+            resampler.reset_sample_rate(false, frame->sample_rate);
+            resampler.reset_sample_rate(true, frame->sample_rate);
+
+            if(resampler.init() != STATUS_SUCCESS)
+            {
+                std::cerr << "Failed to initialize resampler: " << resampler.poll_error() << '\n';
+                return STATUS_FAILURE;
+            }
+            resampler_ready = true;
+        }
+
+        if(resampler.resample_frame(frame, resampled) != STATUS_SUCCESS || trimmer.push(std::move(resampled)) != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to trim " << filename << ": " << resampler.poll_error() << trimmer.poll_error() << '\n';
+            return STATUS_FAILURE;
+        }
+
+        for(Frame_Handle out = trimmer.pop(); out; out = trimmer.pop())
+        {
+            played += out->nb_samples;
+        }
+    }
+
+    if(!decoder.end_of_file_reached())
+    {
+        std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    trimmer.finish();
+    for(Frame_Handle out = trimmer.pop(); out; out = trimmer.pop())
+    {
+        played += out->nb_samples;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* trim_with_map() function
+ * @desc plays a file into nothing from the end of its leading silence to the start of its trailing silence,
+ * @desc as the player does with --trim-silence once the file was scanned
+ * @param filename - the file to play, with a silence map next to it
+ * @param played - set to the number of sample frames decoded
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, the errors are printed
+ */
+Return_Status trim_with_map(const std::string &filename, int64_t &played)
+{
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+    Silence_Map map;
+    std::string error;
+
+    played = 0;
+
+    if(read_silence_map(filename, map, error) != STATUS_SUCCESS || map.ranges.size() != 2)
+    {
+        std::cerr << "Expected a leading and a trailing silence in the map of " << filename << ": " << error << '\n';
+        return STATUS_FAILURE;
+    }
+
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS || decoder.seek(map.ranges.front().end) != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    AVRational time_base = decoder.get_stream()->time_base;
+    int64_t end = map.ranges.back().start;
+
+    for(AVFrame *frame = decoder.decode_frame(); frame; frame = decoder.decode_frame())
+    {
+        if(av_rescale_q(frame->best_effort_timestamp, time_base, AVRational{1, AV_TIME_BASE}) >= end)
+        {
+            return STATUS_SUCCESS;
+        }
+
+        played += frame->nb_samples;
+    }
+
+    if(!decoder.end_of_file_reached())
+    {
+        std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* benchmark_silence_trim() function
+ * @desc plays a FLAC file of 10 s of silence, a 20 s sweep and 10 s of silence with its silence trimmed while it plays,
+ * @desc and with a silence map written by a pre-scan, and compares the CPU time both take
+ * @param directory - where to write the fixture
+ * @param trimmed - set to false if either way did not play the 20 s of sweep and nothing much more
+ * @return CPU milliseconds per playback for both ways and for the pre-scan
+ */
+std::vector<Benchmark_Result> benchmark_silence_trim(const std::string &directory, bool &trimmed)
+{
+    const int SAMPLE_RATE = 44100;
+    const double SIGNAL_SECONDS = 20;
+    const double TOLERANCE_SECONDS = 0.2;    // the mapped playback stops on a frame boundary
+
+    Fixture_Spec fixture{directory + "/silence.flac", AV_CODEC_ID_FLAC, SAMPLE_RATE, 2, SIGNAL_SECONDS};
+    fixture.silence_before = 10;
+    fixture.silence_after = 10;
+
+    std::vector<Benchmark_Result> results;
+    std::string error;
+
+    trimmed = false;
+
+    if(write_fixture(fixture, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    int64_t streamed = 0;
+    int64_t mapped = 0;
+    Silence_Map map;
+
+    double start = cpu_seconds();
+    Return_Status status = trim_streaming(fixture.path, streamed);
+    double streaming_seconds = cpu_seconds() - start;
+
+    start = cpu_seconds();
+    if(status == STATUS_SUCCESS)
+    {
+        status = scan_silence_map(fixture.path, -60.0, 2.0, map, error);
+        if(status == STATUS_SUCCESS)
+        {
+            status = write_silence_map(fixture.path, map, error);
+        }
+        if(status != STATUS_SUCCESS)
+        {
+            std::cerr << error << '\n';
+        }
+    }
+    double scan_seconds = cpu_seconds() - start;
+
+    start = cpu_seconds();
+    if(status == STATUS_SUCCESS)
+    {
+        status = trim_with_map(fixture.path, mapped);
+    }
+    double mapped_seconds = cpu_seconds() - start;
+
+    unlink(get_silence_map_path(fixture.path).c_str());
+    unlink(fixture.path.c_str());
+
+    if(status != STATUS_SUCCESS)
+    {
+        return results;
+    }
+
+    double streamed_seconds = static_cast<double>(streamed) / SAMPLE_RATE;
+    double mapped_audio_seconds = static_cast<double>(mapped) / SAMPLE_RATE;
+    trimmed = std::fabs(streamed_seconds - SIGNAL_SECONDS) <= TOLERANCE_SECONDS && std::fabs(mapped_audio_seconds - SIGNAL_SECONDS) <= TOLERANCE_SECONDS;
+    if(!trimmed)
+    {
+        std::cerr << "Trimmed playback of " << SIGNAL_SECONDS << " s of signal: " << streamed_seconds << " s while playing, "
+                  << mapped_audio_seconds << " s with the silence map\n";
+    }
+
+    results.push_back(Benchmark_Result{"silence_trim/flac/40s/streaming/cpu", streaming_seconds * 1000, "ms-cpu"});
+    results.push_back(Benchmark_Result{"silence_trim/flac/40s/map/cpu", mapped_seconds * 1000, "ms-cpu"});
+    results.push_back(Benchmark_Result{"silence_trim/flac/40s/scan/cpu", scan_seconds * 1000, "ms-cpu"});
+
+    return results;
+}
+
+/* benchmark_metadata() function
+ * @desc builds a synthetic library of LIBRARY_FILES tagged FLAC, WAV and Matroska files in 100 album directories, hard links
+ * @desc of three fixtures so it takes no disk space, and times reading the metadata of every file with Metadata_Reader on one
+ * @desc thread and on every core, against opening the first files with FFmpeg_Decoder::open_file() and init()
+ * @param directory - where to build the library
+ * @param consistent - set to false if a file could not be read or its metadata did not match its fixture
+ * @return microseconds per file for every case, the inverse of the files per second
+ */
+std::vector<Benchmark_Result> benchmark_metadata(const std::string &directory, bool &consistent)
+{
+    const int LIBRARY_FILES = 10000;
+    const int ALBUMS = 100;
+    const int DECODER_FILES = 500;
+    const int64_t DURATION_TOLERANCE = AV_TIME_BASE / 20;
+
+    std::vector<Fixture_Spec> fixtures{Fixture_Spec{directory + "/tagged.flac", AV_CODEC_ID_FLAC, 44100, 2, 2},
+                                       Fixture_Spec{directory + "/tagged.wav", AV_CODEC_ID_PCM_S16LE, 48000, 2, 1},
+                                       Fixture_Spec{directory + "/tagged.mkv", AV_CODEC_ID_FLAC, 96000, 1, 3}};
+
+    std::vector<Benchmark_Result> results;
+    std::string library = directory + "/library";
+    std::string error;
+
+    consistent = false;
+
+    for(Fixture_Spec &fixture : fixtures)
+    {
+        fixture.tags["title"] = "Sweep " + fixture.path.substr(fixture.path.rfind('.') + 1);
+        fixture.tags["artist"] = "Benchmark";
+
+        if(write_fixture(fixture, error) != STATUS_SUCCESS)
+        {
+            std::cerr << error << '\n';
+            return results;
+        }
+    }
+
+    // the files of an album are spread over the fixtures, like a library of mixed formats
+    bool linked = mkdir(library.c_str(), 0700) == 0;
+    for(int album = 0; linked && album < ALBUMS; album++)
+    {
+        std::string album_directory = library + "/album" + std::to_string(album);
+        linked = mkdir(album_directory.c_str(), 0700) == 0;
+
+        for(int track = 0; linked && track < LIBRARY_FILES / ALBUMS; track++)
+        {
+            const Fixture_Spec &fixture = fixtures[track % fixtures.size()];
+            std::string path = album_directory + "/track" + std::to_string(track) + fixture.path.substr(fixture.path.rfind('.'));
+            linked = link(fixture.path.c_str(), path.c_str()) == 0;
+        }
+    }
+
+    std::vector<std::string> paths;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(linked && list_media_files(library, paths, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        linked = false;
+    }
+    std::chrono::duration<double> listing = std::chrono::steady_clock::now() - start;
+
+    std::vector<Media_Metadata> metadata;
+    std::chrono::duration<double> single{0};
+    std::chrono::duration<double> parallel{0};
+    std::chrono::duration<double> decoder_open{0};
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if(linked)
+    {
+        start = std::chrono::steady_clock::now();
+        scan_metadata(paths, 1, metadata);
+        single = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        scan_metadata(paths, threads, metadata);
+        parallel = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < DECODER_FILES && i < static_cast<int>(paths.size()); i++)
+        {
+            FFmpeg_Decoder decoder{paths[i], AVMEDIA_TYPE_AUDIO};
+            if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+            {
+                std::cerr << "Failed to open " << paths[i] << ": " << decoder.poll_error() << '\n';
+                linked = false;
+                break;
+            }
+        }
+        decoder_open = std::chrono::steady_clock::now() - start;
+    }
+
+    // the hard links share the fixtures' data, unlinking them is quick
+    for(const std::string &path : paths)
+    {
+        unlink(path.c_str());
+    }
+    for(int album = 0; album < ALBUMS; album++)
+    {
+        rmdir((library + "/album" + std::to_string(album)).c_str());
+    }
+    rmdir(library.c_str());
+
+    for(const Fixture_Spec &fixture : fixtures)
+    {
+        unlink(fixture.path.c_str());
+    }
+
+    if(!linked || paths.size() != static_cast<std::size_t>(LIBRARY_FILES))
+    {
+        std::cerr << "Failed to build a library of " << LIBRARY_FILES << " files in " << library << '\n';
+        return results;
+    }
+
+    int mismatches = 0;
+    for(const Media_Metadata &entry : metadata)
+    {
+        std::string extension = entry.path.substr(entry.path.rfind('.'));
+        const Fixture_Spec *fixture = nullptr;
+        for(const Fixture_Spec &candidate : fixtures)
+        {
+            if(candidate.path.substr(candidate.path.rfind('.')) == extension)
+            {
+                fixture = &candidate;
+            }
+        }
+
+        std::map<std::string, std::string>::const_iterator title = entry.tags.find("title");
+        int64_t expected = static_cast<int64_t>(fixture->seconds * AV_TIME_BASE);
+        if(!entry.error.empty() || entry.sample_rate != fixture->sample_rate || entry.channels != fixture->channels ||
+           entry.duration == AV_NOPTS_VALUE || std::llabs(entry.duration - expected) > DURATION_TOLERANCE ||
+           title == entry.tags.end() || title->second != fixture->tags.at("title"))
+        {
+            if(mismatches++ == 0)
+            {
+                std::cerr << "Metadata of " << entry.path << ": " << entry.error << " " << entry.sample_rate << " Hz, "
+                          << entry.channels << " channels, " << entry.duration << " us, title "
+                          << (title == entry.tags.end() ? std::string{"missing"} : title->second) << '\n';
+            }
+        }
+    }
+
+    consistent = mismatches == 0;
+
+    results.push_back(Benchmark_Result{"metadata/10k/list", listing.count() / LIBRARY_FILES * 1e6, "us/file"});
+    results.push_back(Benchmark_Result{"metadata/10k/reader/1-thread", single.count() / LIBRARY_FILES * 1e6, "us/file"});
+    results.push_back(Benchmark_Result{"metadata/10k/reader/all-threads", parallel.count() / LIBRARY_FILES * 1e6, "us/file"});
+    results.push_back(Benchmark_Result{"metadata/10k/decoder-open", decoder_open.count() / DECODER_FILES * 1e6, "us/file"});
+
+    return results;
+}
+
+/* benchmark_trace() function
+ * @desc times a Trace_Scope with tracing off and on, and decoding and resampling a FLAC file without and with tracing,
+ * @desc then writes the trace and checks it
+ * @param complete - set to true if the trace has every begin matched by an end and the decoder and resampler events
+ * @return ns per scope, off and on, and CPU ms per second of audio, untraced and traced
+ * @note tracing is stopped again before it returns, the events recorded stay in memory until the benchmark exits
+ */
+std::vector<Benchmark_Result> benchmark_trace(const std::string &directory, double min_seconds, bool &complete)
+{
+    const std::size_t TRACE_EVENTS_PER_THREAD = 1024 * 1024;
+    const int SCOPES = 100000;
+    const char *const EXPECTED_EVENTS[] = {"decoder_fill", "av_read_frame", "avcodec_receive_frame", "swr_convert_frame"};
+
+    Fixture_Spec fixture{directory + "/traced.flac", AV_CODEC_ID_FLAC, 44100, 2, 30};
+    std::string trace_path = directory + "/trace.json";
+
+    std::vector<Benchmark_Result> results;
+    std::string error;
+
+    complete = false;
+
+    if(write_fixture(fixture, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    // a fixed number of scopes, so the traced loop stays within the buffer instead of timing dropped events
+    auto time_scopes = [&]()
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(int i = 0; i < SCOPES; i++)
+        {
+            Trace_Scope scope{"benchmark"};
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / SCOPES;
+    };
+
+    auto time_decode = [&]()
+    {
+        double audio_seconds = 0;
+        double total_audio_seconds = 0;
+        double start = cpu_seconds();
+        Return_Status status = STATUS_SUCCESS;
+
+        do
+        {
+            status = decode_file(fixture.path, true, audio_seconds);
+            total_audio_seconds += audio_seconds;
+        }
+        while(status == STATUS_SUCCESS && cpu_seconds() - start < min_seconds);
+
+        return status == STATUS_SUCCESS && total_audio_seconds > 0 ? (cpu_seconds() - start) * 1000 / total_audio_seconds : -1.0;
+    };
+
+    double scope_off = time_scopes();
+    double decode_off = time_decode();
+
+    trace_start(TRACE_EVENTS_PER_THREAD);
+    trace_name_thread("benchmark");
+
+    double scope_on = time_scopes();
+    double decode_on = time_decode();
+
+    trace_stop();
+
+    Return_Status written = trace_write(trace_path, error);
+    if(written != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+    }
+
+    std::ifstream in{trace_path};
+    std::string trace{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    in.close();
+
+    auto occurrences = [&trace](const std::string &text)
+    {
+        std::size_t count = 0;
+        for(std::size_t at = trace.find(text); at != std::string::npos; at = trace.find(text, at + text.size()))
+        {
+            count++;
+        }
+        return count;
+    };
+
+    std::size_t begins = occurrences("\"ph\":\"B\"");
+    std::size_t ends = occurrences("\"ph\":\"E\"");
+    bool expected_found = true;
+    for(const char *name : EXPECTED_EVENTS)
+    {
+        expected_found = expected_found && occurrences("\"name\":\"" + std::string{name} + '"') > 0;
+    }
+
+    unlink(trace_path.c_str());
+    unlink(fixture.path.c_str());
+
+    if(decode_off < 0 || decode_on < 0)
+    {
+        return results;
+    }
+
+    complete = written == STATUS_SUCCESS && begins > 0 && begins == ends && expected_found && trace_dropped_events() == 0;
+    if(!complete)
+    {
+        std::cerr << "Trace of " << trace.size() << " bytes: " << begins << " begin and " << ends << " end events, "
+                  << trace_dropped_events() << " dropped, decoder and resampler events " << (expected_found ? "found" : "missing") << '\n';
+    }
+
+    results.push_back(Benchmark_Result{"trace/scope/off", scope_off, "ns"});
+    results.push_back(Benchmark_Result{"trace/scope/on", scope_on, "ns"});
+    results.push_back(Benchmark_Result{"trace/decode/flac/resample-48k-s16/untraced", decode_off, "ms/audio-s"});
+    results.push_back(Benchmark_Result{"trace/decode/flac/resample-48k-s16/traced", decode_on, "ms/audio-s"});
+
+    return results;
+}
+
+/* benchmark_library() function
+ * @desc builds a Media_Library of 100k hard links to ten tagged fixtures, saves and loads it, then times a rescan of the
+ * @desc unchanged tree and lookups by path and by tag
+ * @param incremental - set to true if the rescans only read what changed and the lookups found every file
+ * @return the build per file, save, load and rescan times and the lookup times
+ */
+std::vector<Benchmark_Result> benchmark_library(const std::string &directory, bool &incremental)
+{
+    const int LIBRARY_FILES = 100000;
+    const int ALBUMS = 1000;
+    const int ARTISTS = 10;
+    const int LOOKUPS = 10000;
+
+    std::vector<Benchmark_Result> results;
+    std::string library = directory + "/library";
+    std::string index_path = directory + "/library.index";
+    std::string changed_path = directory + "/changed.flac";
+    std::string error;
+
+    incremental = false;
+
+    // one fixture per artist, every link to it carries its tags
+    std::vector<Fixture_Spec> fixtures;
+    for(int artist = 0; artist < ARTISTS; artist++)
+    {
+        fixtures.push_back(Fixture_Spec{directory + "/artist" + std::to_string(artist) + ".flac", AV_CODEC_ID_FLAC, 44100, 2, 1});
+        fixtures.back().tags["artist"] = "Artist " + std::to_string(artist);
+        fixtures.back().tags["title"] = "Sweep";
+    }
+    fixtures.push_back(Fixture_Spec{changed_path, AV_CODEC_ID_FLAC, 48000, 2, 2});
+
+    for(const Fixture_Spec &fixture : fixtures)
+    {
+        if(write_fixture(fixture, error) != STATUS_SUCCESS)
+        {
+            std::cerr << error << '\n';
+            return results;
+        }
+    }
+
+    bool linked = mkdir(library.c_str(), 0700) == 0;
+    for(int album = 0; linked && album < ALBUMS; album++)
+    {
+        std::string album_directory = library + "/album" + std::to_string(album);
+        linked = mkdir(album_directory.c_str(), 0700) == 0;
+
+        for(int track = 0; linked && track < LIBRARY_FILES / ALBUMS; track++)
+        {
+            std::string path = album_directory + "/track" + std::to_string(track) + ".flac";
+            linked = link(fixtures[track % ARTISTS].path.c_str(), path.c_str()) == 0;
+        }
+    }
+
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    Library_Update_Stats built;
+    Library_Update_Stats unchanged;
+    Library_Update_Stats changed;
+    std::chrono::duration<double> build{0};
+    std::chrono::duration<double> save{0};
+    std::chrono::duration<double> load{0};
+    std::chrono::duration<double> rescan{0};
+    std::chrono::duration<double, std::micro> find_path{0};
+    std::chrono::duration<double, std::micro> find_tag{0};
+    std::size_t loaded = 0;
+    std::size_t found_paths = 0;
+    std::size_t found_tags = 0;
+
+    if(linked)
+    {
+        Media_Library built_library{index_path};
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        linked = built_library.update(library, threads, built) == STATUS_SUCCESS;
+        build = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        linked = linked && built_library.save() == STATUS_SUCCESS;
+        save = std::chrono::steady_clock::now() - start;
+
+        // a new run, EX: the player started again, picks the index up from the file
+        Media_Library library_index{index_path};
+
+        start = std::chrono::steady_clock::now();
+        linked = linked && library_index.load() == STATUS_SUCCESS;
+        load = std::chrono::steady_clock::now() - start;
+        loaded = library_index.get_entries().size();
+
+        start = std::chrono::steady_clock::now();
+        linked = linked && library_index.update(library, threads, unchanged) == STATUS_SUCCESS;
+        rescan = std::chrono::steady_clock::now() - start;
+
+        std::vector<std::string> paths;
+        for(int i = 0; i < LOOKUPS; i++)
+        {
+            paths.push_back(library + "/album" + std::to_string(i * 7919 % ALBUMS) + "/track" + std::to_string(i % (LIBRARY_FILES / ALBUMS)) + ".flac");
+        }
+
+        start = std::chrono::steady_clock::now();
+        for(const std::string &path : paths)
+        {
+            found_paths += library_index.find(path) != nullptr;
+        }
+        find_path = (std::chrono::steady_clock::now() - start) / LOOKUPS;
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < ARTISTS; i++)
+        {
+            found_tags += library_index.find_by_tag("ARTIST", "artist " + std::to_string(i)).size();
+        }
+        find_tag = (std::chrono::steady_clock::now() - start) / ARTISTS;
+
+        // one file replaced by another and one deleted, only the replaced one is read
+        std::string replaced = library + "/album0/track0.flac";
+        std::string deleted = library + "/album0/track1.flac";
+        linked = linked && unlink(replaced.c_str()) == 0 && link(changed_path.c_str(), replaced.c_str()) == 0 && unlink(deleted.c_str()) == 0;
+        linked = linked && library_index.update(library, threads, changed) == STATUS_SUCCESS;
+
+        const Library_Entry *entry = library_index.find(replaced);
+        linked = linked && entry && entry->metadata.sample_rate == 48000 && !library_index.find(deleted);
+
+        for(std::string message = library_index.poll_error(); !message.empty(); message = library_index.poll_error())
+        {
+            std::cerr << message << '\n';
+        }
+    }
+
+    std::vector<std::string> paths;
+    list_media_files(library, paths, error);
+    for(const std::string &path : paths)
+    {
+        unlink(path.c_str());
+    }
+    for(int album = 0; album < ALBUMS; album++)
+    {
+        rmdir((library + "/album" + std::to_string(album)).c_str());
+    }
+    rmdir(library.c_str());
+    unlink(index_path.c_str());
+
+    for(const Fixture_Spec &fixture : fixtures)
+    {
+        unlink(fixture.path.c_str());
+    }
+
+    std::size_t files = static_cast<std::size_t>(LIBRARY_FILES);
+    if(!linked || built.added != files || built.failed != 0 || loaded != files)
+    {
+        std::cerr << "Failed to build a library of " << LIBRARY_FILES << " files in " << library << ", " << built.added
+                  << " indexed, " << built.failed << " unreadable, " << loaded << " loaded\n";
+        return results;
+    }
+
+    incremental = unchanged.unchanged == files && unchanged.added + unchanged.changed + unchanged.removed == 0 &&
+                  changed.changed == 1 && changed.removed == 1 && changed.unchanged == files - 2 && changed.added == 0 &&
+                  found_paths == static_cast<std::size_t>(LOOKUPS) && found_tags == files;
+
+    if(!incremental)
+    {
+        std::cerr << "Library rescans: unchanged tree " << unchanged.unchanged << " kept, " << unchanged.added + unchanged.changed
+                  << " read, " << unchanged.removed << " removed; one file changed and one deleted " << changed.changed << " read, "
+                  << changed.removed << " removed; " << found_paths << " paths and " << found_tags << " tagged files found\n";
+    }
+
+    results.push_back(Benchmark_Result{"library/100k/build", build.count() / LIBRARY_FILES * 1e6, "us/file"});
+    results.push_back(Benchmark_Result{"library/100k/save", save.count() * 1e3, "ms"});
+    results.push_back(Benchmark_Result{"library/100k/load", load.count() * 1e3, "ms"});
+    results.push_back(Benchmark_Result{"library/100k/rescan-unchanged", rescan.count() * 1e3, "ms"});
+    results.push_back(Benchmark_Result{"library/100k/find-path", find_path.count(), "us"});
+    results.push_back(Benchmark_Result{"library/100k/find-tag-10k", find_tag.count(), "us"});
+
+    return results;
+}
+
+/* play_simulated() function
+ * @desc decodes a file and plays it as signed 16 bit stereo at its own rate into an Audio_Player with the simulated backend,
+ * @desc like main_loop() does without --realtime, reading the latency after every frame, then drains it
+ * @param filename - the file to play
+ * @param config - the simulated sink
+ * @param latency - the buffer of the sink in microseconds
+ * @param stats - set to what the sink did
+ * @param sink_time - set to the sink time once everything was played, in seconds
+ * @param audio_seconds - set to the length of the audio played
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, the errors are printed
+ */
+Return_Status play_simulated(const std::string &filename, const Simulated_Sink_Config &config, pa_usec_t latency,
+                             Simulated_Sink_Stats &stats, double &sink_time, double &audio_seconds)
+{
+    const int CHANNELS = 2;
+
+    audio_seconds = 0;
+
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+    if(decoder.open_file() != STATUS_SUCCESS || decoder.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to open " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    AVFrame *frame = decoder.decode_frame();
+    if(!frame)
+    {
+        std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    int sample_rate = frame->sample_rate;
+    FFmpeg_Frame_Resampler resampler{av_get_default_channel_layout(CHANNELS), AV_SAMPLE_FMT_S16, sample_rate,
+                                     static_cast<int64_t>(frame->channel_layout), static_cast<enum AVSampleFormat>(frame->format), sample_rate};
+    if(resampler.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to initialize resampler: " << resampler.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    Audio_Player audio_player{PA_SAMPLE_S16NE, CHANNELS, static_cast<uint32_t>(sample_rate), "Benchmark", "Simulated"};
+    audio_player.reset_backend(BACKEND_SIMULATED);
+    audio_player.reset_simulation(config);
+    audio_player.reset_target_latency(latency);
+
+    if(audio_player.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to set up the simulated sink: " << audio_player.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    int64_t samples = 0;
+    for(; frame; frame = decoder.decode_frame())
+    {
+        AVFrame *resampled = resampler.resample_frame(frame);
+        if(!resampled)
+        {
+            std::cerr << "Failed to resample " << filename << ": " << resampler.poll_error() << '\n';
+            return STATUS_FAILURE;
+        }
+
+        pa_usec_t measured = 0;
+        if(audio_player.play_frame(resampled) != STATUS_SUCCESS || audio_player.get_latency(measured) != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to play " << filename << ": " << audio_player.poll_error() << '\n';
+            return STATUS_FAILURE;
+        }
+        samples += resampled->nb_samples;
+    }
+
+    if(!decoder.end_of_file_reached())
+    {
+        std::cerr << "Failed to decode " << filename << ": " << decoder.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    if(audio_player.drain() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to drain the simulated sink: " << audio_player.poll_error() << '\n';
+        return STATUS_FAILURE;
+    }
+
+    stats = audio_player.get_simulated_sink().get_stats();
+    sink_time = audio_player.get_simulated_sink().get_time() / 1e9;
+    audio_seconds = static_cast<double>(samples) / sample_rate;
+    return STATUS_SUCCESS;
+}
+
+/* benchmark_simulated_sink() function
+ * @desc plays a three minute FLAC file into the simulated sink on its stepped clock, with a buffer of LATENCY, periods taken
+ * @desc up to JITTER_US late and the sink stalled a minute in. A stall longer than the buffer has to cause exactly one
+ * @desc underrun, the same run twice has to give the same results, and a stall the buffer covers none. Then silence is
+ * @desc played on the accelerated clock, SPEED times faster than real time.
+ * @param directory - where to write the fixture
+ * @param deterministic - set to false if two runs differed, the underruns were not the ones expected, audio was lost,
+ * @param deterministic - the sink time did not match the audio and the silence played or the accelerated clock was not faster
+ * @return wall ms per second of audio on both clocks, the silence and the largest latency with the long stall in ms
+ */
+std::vector<Benchmark_Result> benchmark_simulated_sink(const std::string &directory, bool &deterministic)
+{
+    const Fixture_Spec FIXTURE{directory + "/simulated.flac", AV_CODEC_ID_FLAC, 44100, 2, 180};
+    const pa_usec_t LATENCY = 200000;
+    const uint64_t JITTER_US = 2000;
+    const int64_t STALL_AT_NS = 60000000000;
+    const int64_t LONG_STALL_NS = 300000000;
+    const int64_t SHORT_STALL_NS = 150000000;
+    const double MAX_TIME_ERROR = 0.01;
+    const double SPEED = 20;
+    const double ACCELERATED_SECONDS = 10;
+    const int SAMPLE_RATE = 48000;
+    const int BLOCK_SAMPLES = 1024;
+
+    std::vector<Benchmark_Result> results;
+    deterministic = false;
+
+    std::string error;
+    if(write_fixture(FIXTURE, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    Simulated_Sink_Config config;
+    config.clock = SINK_CLOCK_STEPPED;
+    config.jitter = JITTER_US;
+    config.stalls = {Sink_Stall{STALL_AT_NS, LONG_STALL_NS}};
+
+    Simulated_Sink_Stats first{};
+    Simulated_Sink_Stats second{};
+    Simulated_Sink_Stats covered{};
+    double first_time = 0;
+    double second_time = 0;
+    double covered_time = 0;
+    double audio_seconds = 0;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    Return_Status status = play_simulated(FIXTURE.path, config, LATENCY, first, first_time, audio_seconds);
+    std::chrono::duration<double> stepped = std::chrono::steady_clock::now() - begin;
+
+    if(status == STATUS_SUCCESS)
+    {
+        status = play_simulated(FIXTURE.path, config, LATENCY, second, second_time, audio_seconds);
+    }
+
+    if(status == STATUS_SUCCESS)
+    {
+        config.stalls = {Sink_Stall{STALL_AT_NS, SHORT_STALL_NS}};
+        status = play_simulated(FIXTURE.path, config, LATENCY, covered, covered_time, audio_seconds);
+    }
+
+    unlink(FIXTURE.path.c_str());
+
+    if(status != STATUS_SUCCESS || audio_seconds <= 0)
+    {
+        return results;
+    }
+
+    // silence written block by block, the accelerated clock sleeps for real, just shorter
+    Audio_Player audio_player{PA_SAMPLE_S16NE, 2, SAMPLE_RATE, "Benchmark", "Accelerated"};
+    config.clock = SINK_CLOCK_ACCELERATED;
+    config.speed = SPEED;
+    config.stalls.clear();
+    audio_player.reset_backend(BACKEND_SIMULATED);
+    audio_player.reset_simulation(config);
+    audio_player.reset_target_latency(LATENCY);
+
+    if(audio_player.init() != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to set up the simulated sink: " << audio_player.poll_error() << '\n';
+        return results;
+    }
+
+    std::vector<int16_t> block(BLOCK_SAMPLES * 2, 0);
+    int blocks = static_cast<int>(ACCELERATED_SECONDS * SAMPLE_RATE / BLOCK_SAMPLES);
+
+    begin = std::chrono::steady_clock::now();
+    for(int i = 0; i < blocks && status == STATUS_SUCCESS; i++)
+    {
+        status = audio_player.play_buffer(reinterpret_cast<const uint8_t*>(block.data()), block.size() * sizeof(int16_t));
+    }
+    if(status == STATUS_SUCCESS)
+    {
+        status = audio_player.drain();
+    }
+    std::chrono::duration<double> accelerated = std::chrono::steady_clock::now() - begin;
+
+    if(status != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to play into the simulated sink: " << audio_player.poll_error() << '\n';
+        return results;
+    }
+
+    const Simulated_Sink_Stats &fast = audio_player.get_simulated_sink().get_stats();
+    double accelerated_seconds = static_cast<double>(blocks) * BLOCK_SAMPLES / SAMPLE_RATE;
+
+    bool repeated = first.samples_written == second.samples_written && first.samples_played == second.samples_played &&
+                    first.underruns == second.underruns && first.silence == second.silence &&
+                    first.blocked_writes == second.blocked_writes && first.stalls == second.stalls &&
+                    first.max_latency == second.max_latency && first_time == second_time;
+
+    // the device plays at its rate, so the sink time is the audio plus the silence after the underrun
+    bool timed = std::fabs(first_time - audio_seconds - first.silence / 1e9) < MAX_TIME_ERROR &&
+                 std::fabs(covered_time - audio_seconds - covered.silence / 1e9) < MAX_TIME_ERROR;
+
+    deterministic = repeated && timed && first.underruns == 1 && first.silence > 0 && first.stalls == 1 && covered.underruns == 0 &&
+                    covered.stalls == 1 && first.samples_played == first.samples_written &&
+                    covered.samples_played == covered.samples_written && fast.samples_played == fast.samples_written &&
+                    accelerated.count() < accelerated_seconds / 2;
+
+    if(!deterministic)
+    {
+        std::cerr << "Simulated sink: " << (repeated ? "" : "runs differed, ") << first.underruns << " underruns with the long stall, "
+                  << covered.underruns << " with the short one, sink time " << first_time << " s for " << audio_seconds
+                  << " s of audio and " << first.silence / 1e9 << " s of silence, " << accelerated_seconds << " s accelerated in "
+                  << accelerated.count() << " s\n";
+    }
+
+    results.push_back(Benchmark_Result{"sink/stepped/flac/wall", stepped.count() * 1000 / audio_seconds, "ms/audio-s"});
+    results.push_back(Benchmark_Result{"sink/stepped/stall-300ms/silence", first.silence / 1e6, "ms"});
+    results.push_back(Benchmark_Result{"sink/stepped/stall-300ms/max-latency", first.max_latency / 1000.0, "ms"});
+    results.push_back(Benchmark_Result{"sink/accelerated/20x/wall", accelerated.count() * 1000 / accelerated_seconds, "ms/audio-s"});
+
+    return results;
+}
+
+/* benchmark_output_thread() function
+ * @desc feeds a minute of silence through an Output_Thread started in real time mode, keeping a Playback_Clock, into the null
+ * @desc sink and into the simulated sink on its stepped clock. The Benchmark is built with the allocation audit, see alloc_audit.h,
+ * @desc so every allocation the output thread makes once its warm up is over is counted.
+ * @param allocation_free - set to false if the output thread allocated after the warm up, a sink did not get every period
+ * @param allocation_free - or the audit is not built in
+ * @return wall ns per period handed over for each sink
+ * @note real time scheduling and locked memory need privileges, without them the thread runs the same code at normal priority
+ */
+std::vector<Benchmark_Result> benchmark_output_thread(bool &allocation_free)
+{
+    const int SAMPLE_RATE = 48000;
+    const int CHANNELS = 2;
+    const std::size_t FRAME_SIZE = CHANNELS * sizeof(int16_t);
+    const std::size_t PERIOD_FRAMES = 1024;
+    const int SECONDS = 60;
+    const int REALTIME_PRIORITY = 20;
+
+    std::vector<Benchmark_Result> results;
+    allocation_free = false;
+
+    if(!alloc_audit_enabled())
+    {
+        std::cerr << "Output thread: the Benchmark was built without the allocation audit\n";
+        return results;
+    }
+
+    std::vector<uint8_t> block(PERIOD_FRAMES * FRAME_SIZE, 0);
+    uint64_t blocks = static_cast<uint64_t>(SECONDS) * SAMPLE_RATE / PERIOD_FRAMES;
+    bool clean = true;
+
+    for(Audio_Backend backend : {BACKEND_NULL, BACKEND_SIMULATED})
+    {
+        std::string name = backend == BACKEND_NULL ? "null" : "simulated";
+
+        Audio_Player audio_player{PA_SAMPLE_S16NE, CHANNELS, SAMPLE_RATE, "Benchmark", "Output thread"};
+        audio_player.reset_backend(backend);
+        if(audio_player.init() != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to set up the " << name << " sink: " << audio_player.poll_error() << '\n';
+            return results;
+        }
+
+        Playback_Clock clock{SAMPLE_RATE};
+        Output_Thread output{audio_player, SAMPLE_RATE / 2 * FRAME_SIZE, PERIOD_FRAMES * FRAME_SIZE};
+        output.set_clock(&clock, FRAME_SIZE);
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        if(output.start(true, REALTIME_PRIORITY) != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to start the output thread: " << output.poll_error() << '\n';
+            return results;
+        }
+
+        // failing to get real time scheduling is expected without privileges
+        while(!output.poll_error().empty())
+        {
+        }
+
+        Return_Status status = STATUS_SUCCESS;
+        for(uint64_t i = 0; i < blocks && status == STATUS_SUCCESS; i++)
+        {
+            status = output.write(block.data(), block.size());
+        }
+
+        if(output.finish() != STATUS_SUCCESS || status != STATUS_SUCCESS)
+        {
+            std::cerr << "The output thread failed on the " << name << " sink: " << audio_player.poll_error() << '\n';
+            return results;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        // the audit is armed after the warm up periods, a run shorter than that would check nothing
+        uint64_t allocations = output.get_audit_allocations();
+        bool complete = output.get_periods_written() == blocks && audio_player.get_bytes_written() == blocks * block.size();
+        if(allocations > 0 || !complete)
+        {
+            std::cerr << "Output thread on the " << name << " sink: " << allocations << " allocations after the warm up, "
+                      << output.get_periods_written() << " of " << blocks << " periods written\n";
+            clean = false;
+        }
+
+        results.push_back(Benchmark_Result{"output_thread/" + name + "/handover", elapsed.count() / blocks * 1e9, "ns/period"});
+    }
+
+    // the real time start locks all memory of the process, the benchmarks that follow should not run with it
+    munlockall();
+
+    allocation_free = clean;
+    return results;
+}
+
+/* benchmark_mixer() function
+ * @desc mixes 1, 8 and 32 copies of a FLAC file with a Mixer, the CPU time of decoding, converting and mixing them is
+ * @desc reported per source, so a cost that grows faster than the number of sources shows up as a larger number
+ * @param directory - where to write the fixture
+ * @param faded_in - set to false if a newly added source did not start at silence and ramp up over the first block
+ * @return CPU milliseconds per second of audio and source, for each number of sources
+ */
+std::vector<Benchmark_Result> benchmark_mixer(const std::string &directory, bool &faded_in)
+{
+    const Fixture_Spec FIXTURE{directory + "/mixer.flac", AV_CODEC_ID_FLAC, 48000, 2, 10};
+    const int BLOCK_SAMPLES = 1024;
+    const float GAIN = 0.5f;
+
+    std::vector<Benchmark_Result> results;
+    faded_in = false;
+
+    std::string error;
+    if(write_fixture(FIXTURE, error) != STATUS_SUCCESS)
+    {
+        std::cerr << error << '\n';
+        return results;
+    }
+
+    std::vector<float> block(static_cast<std::size_t>(BLOCK_SAMPLES) * FIXTURE.channels);
+    bool ramped = true;
+
+    for(int count : {1, 8, 32})
+    {
+        Mixer mixer{FIXTURE.sample_rate, FIXTURE.channels};
+        for(int i = 0; i < count; i++)
+        {
+            if(mixer.add_source(FIXTURE.path, GAIN) < 0)
+            {
+                std::cerr << "Failed to add a mixer source: " << mixer.poll_error() << '\n';
+                unlink(FIXTURE.path.c_str());
+                return results;
+            }
+        }
+
+        uint64_t samples = 0;
+        double start = cpu_seconds();
+        for(int mixed = mixer.mix(block.data(), BLOCK_SAMPLES); mixed > 0; mixed = mixer.mix(block.data(), BLOCK_SAMPLES))
+        {
+            // the first block fades the sources in from silence
+            if(samples == 0 && (block[0] != 0.0f || block[1] != 0.0f ||
+               std::all_of(block.begin(), block.end(), [](float sample) { return sample == 0.0f; })))
+            {
+                ramped = false;
+            }
+            samples += BLOCK_SAMPLES;
+        }
+        double cpu = cpu_seconds() - start;
+
+        std::string message = mixer.poll_error();
+        if(!message.empty() || samples == 0)
+        {
+            std::cerr << "Failed to mix " << count << " sources: " << message << '\n';
+            unlink(FIXTURE.path.c_str());
+            return results;
+        }
+
+        double audio_seconds = static_cast<double>(samples) / FIXTURE.sample_rate;
+        results.push_back(Benchmark_Result{"mixer/" + std::to_string(count) + "/per-source",
+                                           cpu * 1000 / audio_seconds / count, "ms-cpu/audio-s"});
+    }
+
+    unlink(FIXTURE.path.c_str());
+
+    if(!ramped)
+    {
+        std::cerr << "Mixer: the first block of a new source did not ramp up from silence\n";
+    }
+
+    faded_in = ramped;
+    return results;
+}
+
+/* reference_source() function
+ * @desc a pipeline stage sending count references to the same frame, standing in for the decoder so only the scheduling is timed
+ * @return the stage, see Pipeline_Executor::spawn()
+ */
+Pipeline_Task reference_source(const AVFrame *frame, uint64_t count, Frame_Channel &out, Pipeline_Context &context)
+{
+    for(uint64_t i = 0; i < count && !context.is_cancelled(); i++)
+    {
+        Frame_Handle reference = Frame_Handle::allocate();
+        if(!reference || av_frame_ref(reference.get(), frame) < 0)
+        {
+            context.fail("Failed to reference the test frame");
+            break;
+        }
+
+        if(!co_await out.send(std::move(reference)))
+        {
+            break;
+        }
+    }
+
+    out.close();
+}
+
+/* forward_stage() function
+ * @desc a pipeline stage passing its frames on untouched, standing in for the resampler
+ * @return the stage, see Pipeline_Executor::spawn()
+ */
+Pipeline_Task forward_stage(Frame_Channel &in, Frame_Channel &out, Pipeline_Context &context)
+{
+    while(!context.is_cancelled())
+    {
+        Frame_Handle frame = co_await in.receive();
+        if(!frame || !co_await out.send(std::move(frame)))
+        {
+            break;
+        }
+    }
+
+    in.close();
+    out.close();
+}
+
+/* run_coroutine_pipeline() function
+ * @desc runs reference_source(), forward_stage() and sink_stage() on an executor until frames frames reached the sink
+ * @return the number of frames the sink got
+ */
+uint64_t run_coroutine_pipeline(const AVFrame *frame, uint64_t frames, std::size_t threads)
+{
+    const std::size_t CHANNEL_FRAMES = 4;
+
+    Pipeline_Executor executor;
+    if(executor.start(threads) != STATUS_SUCCESS)
+    {
+        return 0;
+    }
+
+    Pipeline_Context context;
+    Frame_Channel first{executor, CHANNEL_FRAMES};
+    Frame_Channel second{executor, CHANNEL_FRAMES};
+    uint64_t consumed = 0;
+
+    executor.spawn(sink_stage(second, context, [&consumed](AVFrame *)
+    {
+        consumed++;
+        return STATUS_SUCCESS;
+    }));
+    executor.spawn(forward_stage(first, second, context));
+    executor.spawn(reference_source(frame, frames, first, context));
+    executor.wait_idle();
+
+    return consumed;
+}
+
+/* benchmark_coroutines() function
+ * @desc times the scheduling overhead of the coroutine pipeline: three stages passing references to one frame through
+ * @desc two channels, against the same references made and dropped by plain calls, on one executor thread and on three.
+ * @desc Then checks cancellation: an endless source is cancelled and every stage has to stop within CANCEL_LIMIT.
+ * @param min_seconds - how long to time each case at least
+ * @param cancellable - set to false if frames were lost or the pipeline did not stop in time once cancelled
+ * @return nanoseconds per frame for each case and the time the cancelled pipeline took to stop
+ */
+std::vector<Benchmark_Result> benchmark_coroutines(double min_seconds, bool &cancellable)
+{
+    const uint64_t FRAMES = 10000;
+    const std::chrono::milliseconds CANCEL_AFTER{10};
+    const std::chrono::milliseconds CANCEL_LIMIT{100};
+
+    std::vector<Benchmark_Result> results;
+    cancellable = false;
+
+    AVFrame *frame = make_test_frame(AV_SAMPLE_FMT_S16, 2, 1024, 48000);
+    if(!frame)
+    {
+        return results;
+    }
+
+    bool complete = true;
+
+    double direct = time_per_iteration([&]()
+    {
+        for(uint64_t i = 0; i < FRAMES; i++)
+        {
+            Frame_Handle reference = Frame_Handle::allocate();
+            if(!reference || av_frame_ref(reference.get(), frame) < 0)
+            {
+                complete = false;
+            }
+        }
+    }, min_seconds);
+
+    double one_thread = time_per_iteration([&]()
+    {
+        complete = complete && run_coroutine_pipeline(frame, FRAMES, 1) == FRAMES;
+    }, min_seconds);
+
+    double three_threads = time_per_iteration([&]()
+    {
+        complete = complete && run_coroutine_pipeline(frame, FRAMES, 3) == FRAMES;
+    }, min_seconds);
+
+    std::chrono::duration<double> stop_time{0};
+    {
+        Pipeline_Executor executor;
+        if(executor.start(3) != STATUS_SUCCESS)
+        {
+            av_frame_free(&frame);
+            return results;
+        }
+
+        Pipeline_Context context;
+        Frame_Channel first{executor, 4};
+        Frame_Channel second{executor, 4};
+
+        executor.spawn(sink_stage(second, context, [](AVFrame *)
+        {
+            return STATUS_SUCCESS;
+        }));
+        executor.spawn(forward_stage(first, second, context));
+        executor.spawn(reference_source(frame, UINT64_MAX, first, context));
+
+        std::this_thread::sleep_for(CANCEL_AFTER);
+
+        std::chrono::steady_clock::time_point cancelled = std::chrono::steady_clock::now();
+        context.cancel();
+        executor.wait_idle();
+        stop_time = std::chrono::steady_clock::now() - cancelled;
+    }
+
+    av_frame_free(&frame);
+
+    cancellable = complete && stop_time < CANCEL_LIMIT;
+
+    results.push_back(Benchmark_Result{"coroutines/3-stages/direct-calls", direct * 1e9 / FRAMES, "ns/frame"});
+    results.push_back(Benchmark_Result{"coroutines/3-stages/1-thread", one_thread * 1e9 / FRAMES, "ns/frame"});
+    results.push_back(Benchmark_Result{"coroutines/3-stages/3-threads", three_threads * 1e9 / FRAMES, "ns/frame"});
+    results.push_back(Benchmark_Result{"coroutines/cancel-to-idle", stop_time.count() * 1000, "ms"});
+
+    return results;
+}
+
+/* load_baseline() function
+ * @desc reads a baseline written by write_baseline(), lines of "<name> <value> <unit>", lines starting with # are comments
+ * @param path - the file to read
+ * @param baseline - filled with the value of every metric by name
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the file could not be read
+ */
+Return_Status load_baseline(const std::string &path, std::map<std::string, double> &baseline)
+{
+    std::ifstream file{path};
+    if(!file)
+    {
+        return STATUS_FAILURE;
+    }
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream fields{line};
+        std::string name;
+        double value = 0;
+
+        if(fields >> name >> value)
+        {
+            baseline[name] = value;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* write_baseline() function
+ * @desc writes the results as the new baseline, overwriting the file
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status write_baseline(const std::string &path, const std::vector<Benchmark_Result> &results)
+{
+    std::ofstream file{path};
+    if(!file)
+    {
+        return STATUS_FAILURE;
+    }
+
+    file << "# Benchmark baseline, compared against by \"make check\" and rewritten by \"make baseline\".\n"
+         << "# The ratio/ metrics divide a time by the time of what it replaces and hold on any machine, the other numbers\n"
+         << "# depend on the machine, record them again on the machine the checks run on. \"make check\" fails without the\n"
+         << "# decode_frame/, resample_frame/ and play_frame/ metrics and allows the ratio/ metrics at most 5% over.\n"
+         << "# <name> <value> <unit>, lower is better\n";
+
+    for(const Benchmark_Result &result : results)
+    {
+        file << result.name << ' ' << std::fixed << std::setprecision(3) << result.value << ' ' << result.unit << '\n';
+    }
+
+    return file ? STATUS_SUCCESS : STATUS_FAILURE;
+}
+
+/* ratio_results() function
+ * @desc works out machine independent metrics from the results, each a time divided by the time of what it replaces or
+ * @desc is compared with, EX: "ratio/convert/fltp->s16/2ch/specialized-vs-swresample", so their baseline holds on any machine
+ * @param results - the measured results
+ * @return the ratios in "x", lower is better, a ratio is left out if either of its results is missing
+ */
+std::vector<Benchmark_Result> ratio_results(const std::vector<Benchmark_Result> &results)
+{
+    const std::string SPECIALIZED = "/specialized";
+
+    // the result, the one it is divided by and the name of the ratio
+    std::vector<std::vector<std::string>> ratios = {
+        {"silence/s16/simd", "silence/s16/scalar", "ratio/silence/s16/simd-vs-scalar"},
+        {"silence/flt/simd", "silence/flt/scalar", "ratio/silence/flt/simd-vs-scalar"},
+        {"burst/flac/burst/wakeups", "burst/flac/per-frame/wakeups", "ratio/burst/flac/wakeups/burst-vs-per-frame"},
+        {"trace/decode/flac/resample-48k-s16/traced", "trace/decode/flac/resample-48k-s16/untraced", "ratio/trace/decode/flac/traced-vs-untraced"},
+    };
+
+    std::map<std::string, double> values;
+    for(const Benchmark_Result &result : results)
+    {
+        values[result.name] = result.value;
+
+        // swresample copies an unchanged format as well, there is nothing to compare the specialized copy with
+        std::size_t arrow = result.name.find("->");
+        std::size_t slash = result.name.find('/', arrow);
+        bool converted = arrow != std::string::npos && slash != std::string::npos &&
+                         result.name.compare(8, arrow - 8, result.name, arrow + 2, slash - arrow - 2) != 0;
+
+        if(result.name.compare(0, 8, "convert/") == 0 && converted && result.name.size() > SPECIALIZED.size() &&
+           result.name.compare(result.name.size() - SPECIALIZED.size(), SPECIALIZED.size(), SPECIALIZED) == 0)
+        {
+            std::string stem = result.name.substr(0, result.name.size() - SPECIALIZED.size());
+            ratios.push_back({result.name, stem + "/swresample", "ratio/" + stem + "/specialized-vs-swresample"});
+        }
+    }
+
+    std::vector<Benchmark_Result> derived;
+    for(const std::vector<std::string> &ratio : ratios)
+    {
+        std::map<std::string, double>::const_iterator value = values.find(ratio[0]);
+        std::map<std::string, double>::const_iterator reference = values.find(ratio[1]);
+        if(value != values.end() && reference != values.end() && reference->second > 0)
+        {
+            derived.push_back(Benchmark_Result{ratio[2], value->second / reference->second, "x"});
+        }
+    }
+
+    return derived;
+}
+
+/* compare_results() function
+ * @desc prints every result next to its baseline and flags the ones that got slower by more than the tolerance
+ * @param tolerance - allowed slowdown as a fraction, EX: 0.25 allows 25% slower, at most RATIO_TOLERANCE for the ratio/ metrics
+ * @param unchecked - set to the number of results without a baseline plus the baseline entries no result matched
+ * @return the number of regressed metrics
+ */
+int compare_results(const std::vector<Benchmark_Result> &results, const std::map<std::string, double> &baseline, double tolerance,
+                    int &unchecked)
+{
+    int regressions = 0;
+    std::size_t matched = 0;
+    unchecked = 0;
+
+    for(const Benchmark_Result &result : results)
+    {
+        std::cout << std::left << std::setw(52) << result.name
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(3) << result.value << ' ' << result.unit;
+
+        std::map<std::string, double>::const_iterator found = baseline.find(result.name);
+        if(found == baseline.end() || found->second <= 0)
+        {
+            std::cout << "  NO BASELINE\n";
+            unchecked++;
+            continue;
+        }
+        matched++;
+
+        double change = result.value / found->second - 1;
+        std::cout << "  " << std::showpos << std::setprecision(1) << change * 100 << '%' << std::noshowpos;
+
+        double allowed = result.name.compare(0, 6, "ratio/") == 0 ? std::min(tolerance, RATIO_TOLERANCE) : tolerance;
+        if(change > allowed)
+        {
+            std::cout << "  REGRESSION (baseline " << std::setprecision(3) << found->second << ")";
+            regressions++;
+        }
+        std::cout << '\n';
+    }
+
+    // a renamed or dropped metric would otherwise pass unnoticed
+    if(matched < baseline.size())
+    {
+        for(const std::pair<const std::string, double> &entry : baseline)
+        {
+            bool produced = std::any_of(results.begin(), results.end(), [&entry](const Benchmark_Result &result)
+            {
+                return result.name == entry.first;
+            });
+
+            if(!produced)
+            {
+                std::cout << std::left << std::setw(52) << entry.first << std::right << "  NOT MEASURED\n";
+                unchecked++;
+            }
+        }
+    }
+
+    return regressions;
+}
+
+void print_results(const std::vector<Benchmark_Result> &results)
+{
+    for(const Benchmark_Result &result : results)
+    {
+        std::cout << std::left << std::setw(52) << result.name
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(3) << result.value
+                  << ' ' << result.unit << '\n';
+    }
+}
+
+void print_usage(const char *program)
+{
+    std::cerr << "Valid Usage: " << program << " [--quick] [--baseline <file> [--tolerance <percent>]] [--update-baseline <file>]\n";
+}
+
+int main(int argc, char **argv)
+{
+    double min_seconds = 0.2;
+    double tolerance = 0.25;
+    std::string baseline_path;
+    std::string update_path;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string argument{argv[i]};
+
+        if(argument == "--quick")
+        {
+            min_seconds = 0.02;
+        }
+
+        else if(argument == "--baseline" && i + 1 < argc)
+        {
+            baseline_path = argv[++i];
+        }
+
+        else if(argument == "--update-baseline" && i + 1 < argc)
+        {
+            update_path = argv[++i];
+        }
+
+        else if(argument == "--tolerance" && i + 1 < argc)
+        {
+            char *end = nullptr;
+            tolerance = std::strtod(argv[++i], &end) / 100;
+            if(*end != '\0' || tolerance < 0)
+            {
+                std::cerr << "Invalid tolerance: " << argv[i] << '\n';
+                return 1;
+            }
+        }
+
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if(!baseline_path.empty() && load_baseline(baseline_path, baseline) != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to read baseline " << baseline_path << '\n';
+        return 1;
+    }
+
+    char directory[] = "/tmp/benchmark-XXXXXX";
+    if(!mkdtemp(directory))
+    {
+        std::cerr << "Failed to create a temporary directory\n";
+        return 1;
+    }
+
+    bool memory_flat = false;
+    bool chapters_accurate = false;
+    bool pipe_complete = false;
+    bool daemon_responsive = false;
+    bool clock_accurate = false;
+    bool fanout_isolated = false;
+    bool pipeline_bounded = false;
+    bool coroutines_cancellable = false;
+    bool channel_mapping_matches = false;
+    bool burst_fewer_wakeups = false;
+    bool silence_trimmed = false;
+    bool metadata_consistent = false;
+    bool library_incremental = false;
+    bool trace_complete = false;
+    bool sink_deterministic = false;
+    bool output_allocation_free = false;
+    bool mixer_faded_in = false;
+
+    std::vector<Benchmark_Result> results = benchmark_conversion(min_seconds);
+    for(std::vector<Benchmark_Result> more : {benchmark_decode_frame(directory, min_seconds),
+                                              benchmark_resample_frame(min_seconds),
+                                              benchmark_channel_mapping(min_seconds, channel_mapping_matches),
+                                              benchmark_resample_quality(min_seconds),
+                                              benchmark_play_frame(min_seconds),
+                                              benchmark_decode(directory, min_seconds * 5),
+                                              benchmark_streaming_memory(directory, memory_flat),
+                                              benchmark_chapter_jump(directory, chapters_accurate),
+                                              benchmark_pipe_input(directory, pipe_complete),
+                                              benchmark_daemon(directory, daemon_responsive),
+                                              benchmark_clock(directory, min_seconds, clock_accurate),
+                                              benchmark_fanout(directory, min_seconds, fanout_isolated),
+                                              benchmark_pipeline(directory, min_seconds * 5, pipeline_bounded),
+                                              benchmark_burst(directory, burst_fewer_wakeups),
+                                              benchmark_silence_kernels(min_seconds),
+                                              benchmark_silence_trim(directory, silence_trimmed),
+                                              benchmark_metadata(directory, metadata_consistent),
+                                              benchmark_library(directory, library_incremental),
+                                              benchmark_trace(directory, min_seconds, trace_complete),
+                                              benchmark_simulated_sink(directory, sink_deterministic),
+                                              benchmark_output_thread(output_allocation_free),
+                                              benchmark_mixer(directory, mixer_faded_in),
+                                              benchmark_coroutines(min_seconds, coroutines_cancellable)})
+    {
+        results.insert(results.end(), more.begin(), more.end());
+    }
+
+    rmdir(directory);
+
+    std::vector<Benchmark_Result> ratios = ratio_results(results);
+    results.insert(results.end(), ratios.begin(), ratios.end());
+
+    if(!update_path.empty())
+    {
+        if(write_baseline(update_path, results) != STATUS_SUCCESS)
+        {
+            std::cerr << "Failed to write baseline " << update_path << '\n';
+            return 1;
+        }
+    }
+
+    int regressions = 0;
+    if(baseline_path.empty())
+    {
+        print_results(results);
+    }
+
+    else
+    {
+        int unchecked = 0;
+        regressions = compare_results(results, baseline, tolerance, unchecked);
+        if(regressions > 0)
+        {
+            std::cerr << regressions << " metric(s) regressed by more than " << tolerance * 100 << "%\n";
+        }
+
+        if(unchecked > 0)
+        {
+            std::cerr << "WARNING: " << unchecked << " metric(s) were not checked, they are missing from " << baseline_path
+                      << " or no longer measured, record them with \"make baseline\"\n";
+        }
+
+        // a baseline that matches nothing checks nothing
+        bool compared = std::any_of(results.begin(), results.end(), [&baseline](const Benchmark_Result &result)
+        {
+            return baseline.count(result.name) > 0;
+        });
+
+        if(!compared)
+        {
+            std::cerr << "No metric was compared with " << baseline_path << '\n';
+            regressions++;
+        }
+
+        // the per class timings depend on the machine, a baseline without them has not been recorded where the checks run
+        int missing = std::count_if(results.begin(), results.end(), [&baseline](const Benchmark_Result &result)
+        {
+            return baseline.count(result.name) == 0 && std::any_of(REQUIRED_PREFIXES.begin(), REQUIRED_PREFIXES.end(),
+                                                                   [&result](const std::string &prefix)
+            {
+                return result.name.compare(0, prefix.size(), prefix) == 0;
+            });
+        });
+
+        if(missing > 0)
+        {
+            std::cerr << missing << " per class decode_frame/, resample_frame/ or play_frame/ metric(s) are missing from " << baseline_path
+                      << ", record them with \"make baseline\" on this machine\n";
+            regressions++;
+        }
+    }
+
+    if(!memory_flat)
+    {
+        std::cerr << "Memory use was not flat while streaming a 10 hour file\n";
+    }
+
+    if(!chapters_accurate)
+    {
+        std::cerr << "Chapter jumps did not land exactly on the chapter starts\n";
+    }
+
+    if(!pipe_complete)
+    {
+        std::cerr << "The piped file was not decoded to the end\n";
+    }
+
+    if(!daemon_responsive)
+    {
+        std::cerr << "The daemon did not carry out every command\n";
+    }
+
+    if(!clock_accurate)
+    {
+        std::cerr << "The playback clock did not follow the simulated sink\n";
+    }
+
+    if(!fanout_isolated)
+    {
+        std::cerr << "The fanout copied frames, lost frames or was held up by a stalled tap\n";
+    }
+
+    if(!pipeline_bounded)
+    {
+        std::cerr << "The decoding pipeline lost audio or had more frames in flight than its pool holds\n";
+    }
+
+    if(!coroutines_cancellable)
+    {
+        std::cerr << "The coroutine pipeline lost frames or did not stop promptly once cancelled\n";
+    }
+
+    if(!channel_mapping_matches)
+    {
+        std::cerr << "The channel mapper did not match swresample given the same matrix\n";
+    }
+
+    if(!burst_fewer_wakeups)
+    {
+        std::cerr << "Playing in bursts did not halve the wakeups of playing frame by frame\n";
+    }
+
+    if(!silence_trimmed)
+    {
+        std::cerr << "Trimming silence did not play just the signal between the leading and trailing silence\n";
+    }
+
+    if(!metadata_consistent)
+    {
+        std::cerr << "The metadata read from the synthetic library did not match the files\n";
+    }
+
+    if(!library_incremental)
+    {
+        std::cerr << "The library index read more than the changed files or its lookups missed files\n";
+    }
+
+    if(!trace_complete)
+    {
+        std::cerr << "The trace was missing events or had begin events without an end\n";
+    }
+
+    if(!sink_deterministic)
+    {
+        std::cerr << "The simulated sink did not repeat its runs or did not underrun exactly when its buffer ran out\n";
+    }
+
+    if(!output_allocation_free)
+    {
+        std::cerr << "The real time output thread allocated during steady state playback or lost periods\n";
+    }
+
+    if(!mixer_faded_in)
+    {
+        std::cerr << "The mixer did not fade in newly added sources\n";
+    }
+
+    return regressions > 0 || !memory_flat || !chapters_accurate || !pipe_complete || !daemon_responsive || !clock_accurate ||
+           !fanout_isolated || !pipeline_bounded || !coroutines_cancellable ||
+           !channel_mapping_matches || !burst_fewer_wakeups || !silence_trimmed || !metadata_consistent ||
+           !library_incremental || !trace_complete || !sink_deterministic ||
+           !output_allocation_free || !mixer_faded_in ? 1 : 0;
+}
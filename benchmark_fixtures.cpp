@@ -0,0 +1,440 @@
+#include "benchmark_fixtures.h"
+#include "sample_convert.h"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    /* Fixture_Writer Struct
+     * @desc the FFmpeg state used while writing a fixture, freed when it goes out of scope
+     */
+    struct Fixture_Writer
+    {
+        AVFormatContext *fmt_ctx = nullptr;
+        AVCodecContext *codec_ctx = nullptr;
+        AVFrame *frame = nullptr;
+        AVPacket *packet = nullptr;
+
+        ~Fixture_Writer()
+        {
+            if(fmt_ctx)
+            {
+                if(fmt_ctx->pb)
+                {
+                    avio_closep(&fmt_ctx->pb);
+                }
+                avformat_free_context(fmt_ctx);
+            }
+
+            avcodec_free_context(&codec_ctx);
+            av_frame_free(&frame);
+            av_packet_free(&packet);
+        }
+    };
+
+    std::string error_string(int error_code)
+    {
+        char buff[256];
+        if(av_strerror(error_code, buff, sizeof(buff)) < 0)
+        {
+            return "Unknown Error";
+        }
+
+        return std::string{buff};
+    }
+
+    /* add_chapters() function
+     * @desc adds count chapters of about equal length to the output, titled "Chapter 1", "Chapter 2" ...
+     * @desc every chapter but the first starts 37 ms past an even split, so chapter starts rarely fall on a frame boundary
+     * @return 0 on success, a negative FFmpeg error code on failure
+     */
+    int add_chapters(AVFormatContext *fmt_ctx, int count, double seconds)
+    {
+        const AVRational MILLISECONDS = {1, 1000};
+        const int64_t OFFSET = 37;
+
+        int64_t length = static_cast<int64_t>(seconds * 1000);
+
+        for(int i = 0; i < count; i++)
+        {
+            AVChapter *chapter = static_cast<AVChapter*>(av_mallocz(sizeof(AVChapter)));
+            if(!chapter)
+            {
+                return AVERROR(ENOMEM);
+            }
+
+            chapter->id = i + 1;
+            chapter->time_base = MILLISECONDS;
+            chapter->start = length * i / count + (i > 0 ? OFFSET : 0);
+            chapter->end = i + 1 < count ? length * (i + 1) / count + OFFSET : length;
+
+            std::string title = "Chapter " + std::to_string(i + 1);
+            av_dict_set(&chapter->metadata, "title", title.c_str(), 0);
+
+            // the format context owns its chapters and frees them with itself
+            int nb_chapters = static_cast<int>(fmt_ctx->nb_chapters);
+            int error = av_dynarray_add_nofree(&fmt_ctx->chapters, &nb_chapters, chapter);
+            if(error < 0)
+            {
+                av_dict_free(&chapter->metadata);
+                av_free(chapter);
+                return error;
+            }
+            fmt_ctx->nb_chapters = nb_chapters;
+        }
+
+        return 0;
+    }
+
+    /* write_packets() function
+     * @desc moves every packet the encoder has ready into the file
+     * @return 0 on success, a negative FFmpeg error code on failure
+     */
+    int write_packets(Fixture_Writer &writer, AVStream *stream)
+    {
+        while(1)
+        {
+            int error = avcodec_receive_packet(writer.codec_ctx, writer.packet);
+            if(error == AVERROR(EAGAIN) || error == AVERROR_EOF)
+            {
+                return 0;
+            }
+
+            else if(error < 0)
+            {
+                return error;
+            }
+
+            av_packet_rescale_ts(writer.packet, writer.codec_ctx->time_base, stream->time_base);
+            writer.packet->stream_index = stream->index;
+
+            error = av_interleaved_write_frame(writer.fmt_ctx, writer.packet);
+            if(error < 0)
+            {
+                return error;
+            }
+        }
+    }
+}
+
+
+
+
+/* write_fixture() function
+ * @desc encodes a test signal into a file: a slow logarithmic sine sweep from 40 Hz to 16 kHz with a little noise,
+ * @desc so codecs do realistic work and every band is covered, with exact zeros around it if the spec asks for silence
+ * @param spec - the file to write
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status write_fixture(const Fixture_Spec &spec, std::string &error)
+{
+    Fixture_Writer writer;
+    int result = 0;
+
+    result = avformat_alloc_output_context2(&writer.fmt_ctx, nullptr, nullptr, spec.path.c_str());
+    if(result < 0)
+    {
+        error = "Failed to find a container for " + spec.path + ": " + error_string(result);
+        return STATUS_FAILURE;
+    }
+
+    AVCodec *codec = avcodec_find_encoder(spec.codec);
+    if(!codec)
+    {
+        error = std::string{"Failed to find an encoder for "} + avcodec_get_name(spec.codec);
+        return STATUS_FAILURE;
+    }
+
+    AVStream *stream = avformat_new_stream(writer.fmt_ctx, nullptr);
+    writer.codec_ctx = avcodec_alloc_context3(codec);
+    writer.frame = av_frame_alloc();
+    writer.packet = av_packet_alloc();
+    if(!stream || !writer.codec_ctx || !writer.frame || !writer.packet)
+    {
+        error = "Failed to allocate encoder state";
+        return STATUS_FAILURE;
+    }
+
+    writer.codec_ctx->sample_fmt = codec->sample_fmts ? codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+    writer.codec_ctx->sample_rate = spec.sample_rate;
+    writer.codec_ctx->channel_layout = av_get_default_channel_layout(spec.channels);
+    writer.codec_ctx->channels = spec.channels;
+    writer.codec_ctx->time_base = AVRational{1, spec.sample_rate};
+
+    if(writer.fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+    {
+        writer.codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    Convert_Function convert = find_sample_converter(AV_SAMPLE_FMT_FLT, writer.codec_ctx->sample_fmt, spec.channels);
+    if(!convert)
+    {
+        error = std::string{"No converter to "} + av_get_sample_fmt_name(writer.codec_ctx->sample_fmt);
+        return STATUS_FAILURE;
+    }
+
+    result = avcodec_open2(writer.codec_ctx, codec, nullptr);
+    if(result >= 0)
+    {
+        result = avcodec_parameters_from_context(stream->codecpar, writer.codec_ctx);
+    }
+    if(result < 0)
+    {
+        error = "Failed to open encoder: " + error_string(result);
+        return STATUS_FAILURE;
+    }
+
+    stream->time_base = writer.codec_ctx->time_base;
+
+    result = add_chapters(writer.fmt_ctx, spec.chapters, spec.silence_before + spec.seconds + spec.silence_after);
+    if(result < 0)
+    {
+        error = "Failed to add chapters: " + error_string(result);
+        return STATUS_FAILURE;
+    }
+
+    for(const std::pair<const std::string, std::string> &tag : spec.tags)
+    {
+        av_dict_set(&writer.fmt_ctx->metadata, tag.first.c_str(), tag.second.c_str(), 0);
+    }
+
+    result = avio_open(&writer.fmt_ctx->pb, spec.path.c_str(), AVIO_FLAG_WRITE);
+    if(result >= 0)
+    {
+        result = avformat_write_header(writer.fmt_ctx, nullptr);
+    }
+    if(result < 0)
+    {
+        error = "Failed to start writing " + spec.path + ": " + error_string(result);
+        return STATUS_FAILURE;
+    }
+
+    const double PI = 3.14159265358979323846;
+    const double START_HZ = 40.0;
+    const double END_HZ = 16000.0;
+
+    int frame_size = writer.codec_ctx->frame_size > 0 ? writer.codec_ctx->frame_size : 1024;
+    int64_t signal_start = static_cast<int64_t>(spec.silence_before * spec.sample_rate);
+    int64_t signal_samples = static_cast<int64_t>(spec.seconds * spec.sample_rate);
+    int64_t total_samples = signal_start + signal_samples + static_cast<int64_t>(spec.silence_after * spec.sample_rate);
+    double sweep_rate = std::log(END_HZ / START_HZ) / signal_samples;
+
+    std::vector<float> samples(static_cast<std::size_t>(frame_size) * spec.channels);
+    double phase = 0;
+    uint32_t noise = 1;
+
+    for(int64_t position = 0; position < total_samples; position += frame_size)
+    {
+        int nb_samples = static_cast<int>(std::min<int64_t>(frame_size, total_samples - position));
+
+        for(int i = 0; i < nb_samples; i++)
+        {
+            int64_t signal_position = position + i - signal_start;
+            if(signal_position < 0 || signal_position >= signal_samples)
+            {
+                std::fill_n(&samples[i * spec.channels], spec.channels, 0.0f);
+                continue;
+            }
+
+            double frequency = START_HZ * std::exp(sweep_rate * signal_position);
+            phase += 2 * PI * frequency / spec.sample_rate;
+
+            for(int channel = 0; channel < spec.channels; channel++)
+            {
+                noise = noise * 1664525u + 1013904223u;
+                float dither = static_cast<int32_t>(noise) / 2147483648.0f * 0.01f;
+                samples[i * spec.channels + channel] = 0.5f * static_cast<float>(std::sin(phase + channel)) + dither;
+            }
+        }
+
+        av_frame_unref(writer.frame);
+        writer.frame->format = writer.codec_ctx->sample_fmt;
+        writer.frame->channel_layout = writer.codec_ctx->channel_layout;
+        writer.frame->channels = spec.channels;
+        writer.frame->sample_rate = spec.sample_rate;
+        writer.frame->nb_samples = nb_samples;
+        writer.frame->pts = position;
+
+        result = av_frame_get_buffer(writer.frame, 0);
+        if(result < 0)
+        {
+            error = "Failed to allocate frame: " + error_string(result);
+            return STATUS_FAILURE;
+        }
+
+        const uint8_t *source[1] = {reinterpret_cast<const uint8_t *>(samples.data())};
+        convert(source, writer.frame->extended_data, nb_samples);
+
+        result = avcodec_send_frame(writer.codec_ctx, writer.frame);
+        if(result >= 0)
+        {
+            result = write_packets(writer, stream);
+        }
+        if(result < 0)
+        {
+            error = "Failed to encode: " + error_string(result);
+            return STATUS_FAILURE;
+        }
+    }
+
+    // flush the encoder
+    result = avcodec_send_frame(writer.codec_ctx, nullptr);
+    if(result >= 0)
+    {
+        result = write_packets(writer, stream);
+    }
+    if(result >= 0)
+    {
+        result = av_write_trailer(writer.fmt_ctx);
+    }
+    if(result < 0)
+    {
+        error = "Failed to finish " + spec.path + ": " + error_string(result);
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* write_silent_wav() function
+ * @desc writes a signed 16 bit WAV file of silence without writing the samples, the data is a hole in a sparse file,
+ * @desc so files hours long take no disk space and are written instantly
+ * @param path - where to write the file
+ * @param sample_rate - the sample rate of the file
+ * @param channels - the number of channels
+ * @param seconds - the length of the file, the data has to stay under 4 GiB
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status write_silent_wav(const std::string &path, int sample_rate, int channels, double seconds, std::string &error)
+{
+    const uint16_t BYTES_PER_SAMPLE = 2;
+
+    uint64_t data_size = static_cast<uint64_t>(seconds * sample_rate) * channels * BYTES_PER_SAMPLE;
+    if(data_size > UINT32_MAX - 36)
+    {
+        error = "WAV data too large";
+        return STATUS_FAILURE;
+    }
+
+    // the canonical 44 byte header, every field little endian
+    uint8_t header[44];
+    auto put_16 = [&header](int offset, uint32_t value)
+    {
+        header[offset] = value & 0xff;
+        header[offset + 1] = (value >> 8) & 0xff;
+    };
+    auto put_32 = [&put_16](int offset, uint32_t value)
+    {
+        put_16(offset, value & 0xffff);
+        put_16(offset + 2, value >> 16);
+    };
+
+    std::memcpy(header, "RIFF", 4);
+    put_32(4, static_cast<uint32_t>(36 + data_size));
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put_32(16, 16);                                                     // fmt chunk size
+    put_16(20, 1);                                                      // PCM
+    put_16(22, channels);
+    put_32(24, sample_rate);
+    put_32(28, sample_rate * channels * BYTES_PER_SAMPLE);              // byte rate
+    put_16(32, channels * BYTES_PER_SAMPLE);                            // block align
+    put_16(34, BYTES_PER_SAMPLE * 8);                                   // bits per sample
+    std::memcpy(header + 36, "data", 4);
+    put_32(40, static_cast<uint32_t>(data_size));
+
+    int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(file < 0)
+    {
+        error = "Failed to create " + path + ": " + std::strerror(errno);
+        return STATUS_FAILURE;
+    }
+
+    bool written = write(file, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)) &&
+                   ftruncate(file, static_cast<off_t>(sizeof(header) + data_size)) == 0;
+    if(!written)
+    {
+        error = "Failed to write " + path + ": " + std::strerror(errno);
+    }
+
+    close(file);
+    return written ? STATUS_SUCCESS : STATUS_FAILURE;
+}
+
+
+
+
+/* write_clicks_wav() function
+ * @desc writes a signed 16 bit WAV file of silence with a one sample click on every channel at every multiple of interval,
+ * @desc like write_silent_wav() the silence is a hole in a sparse file
+ * @param path - where to write the file
+ * @param sample_rate - the sample rate of the file
+ * @param channels - the number of channels
+ * @param seconds - the length of the file, the data has to stay under 4 GiB
+ * @param interval - the seconds between clicks, the first click is the first sample
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status write_clicks_wav(const std::string &path, int sample_rate, int channels, double seconds, double interval, std::string &error)
+{
+    const off_t HEADER_SIZE = 44;
+    const int16_t CLICK = 32767;
+
+    if(write_silent_wav(path, sample_rate, channels, seconds, error) != STATUS_SUCCESS)
+    {
+        return STATUS_FAILURE;
+    }
+
+    int file = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if(file < 0)
+    {
+        error = "Failed to open " + path + ": " + std::strerror(errno);
+        return STATUS_FAILURE;
+    }
+
+    // the file is little endian, so are the machines this runs on
+    std::vector<int16_t> click(channels, CLICK);
+    int64_t samples = static_cast<int64_t>(seconds * sample_rate);
+    bool written = true;
+
+    for(int64_t i = 0; written; i++)
+    {
+        int64_t sample = static_cast<int64_t>(std::llround(i * interval * sample_rate));
+        if(sample >= samples)
+        {
+            break;
+        }
+
+        off_t offset = HEADER_SIZE + static_cast<off_t>(sample) * channels * sizeof(int16_t);
+        written = pwrite(file, click.data(), click.size() * sizeof(int16_t), offset) == static_cast<ssize_t>(click.size() * sizeof(int16_t));
+    }
+
+    if(!written)
+    {
+        error = "Failed to write " + path + ": " + std::strerror(errno);
+    }
+
+    close(file);
+    return written ? STATUS_SUCCESS : STATUS_FAILURE;
+}
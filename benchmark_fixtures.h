@@ -0,0 +1,47 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include <map>
+#include <string>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Fixture_Spec Struct
+ * @desc describes a synthesized audio file for the benchmarks
+ * @member path - where to write the file, the container is chosen from the extension, EX: ".flac"
+ * @member codec - the codec to encode with, EX: AV_CODEC_ID_FLAC
+ * @member sample_rate - the sample rate of the file
+ * @member channels - the number of channels
+ * @member seconds - the length of the file
+ * @member chapters - the number of chapters to split the file into, 0 for none, the container has to support chapters, EX: ".mkv"
+ * @member silence_before - seconds of digital silence before the signal, not counted in seconds
+ * @member silence_after - seconds of digital silence after the signal, not counted in seconds
+ * @member tags - tags written to the container, EX: {"title", "Sweep"}, as far as the container supports them
+ */
+struct Fixture_Spec
+{
+    std::string path;
+    enum AVCodecID codec;
+    int sample_rate;
+    int channels;
+    double seconds;
+    int chapters = 0;
+    double silence_before = 0;
+    double silence_after = 0;
+    std::map<std::string, std::string> tags = {};
+};
+
+Return_Status write_fixture(const Fixture_Spec&, std::string&);
+Return_Status write_silent_wav(const std::string&, int, int, double, std::string&);
+Return_Status write_clicks_wav(const std::string&, int, int, double, double, std::string&);
@@ -0,0 +1,597 @@
+#include "channel_mapper.h"
+#include "mix_kernels.h"
+#include "sample_convert.h"
+
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+// the most error messages kept for Channel_Mapper::poll_error()
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+namespace
+{
+    const float MINUS_3DB = 0.70710678f;
+    const float MINUS_6DB = 0.5f;
+
+    /* load_planes() function
+     * @desc a Load_Function for one input format
+     */
+    template<enum AVSampleFormat Format>
+    void load_planes(const uint8_t *const *in, int channels, int offset, int count, float *planes)
+    {
+        typedef Sample_Traits<Format> Traits;
+        typedef typename Traits::type Type;
+
+        for(int channel = 0; channel < channels; channel++)
+        {
+            const Type *source = Traits::planar ? reinterpret_cast<const Type *>(in[channel]) + offset
+                                                : reinterpret_cast<const Type *>(in[0]) + offset * channels + channel;
+            int stride = Traits::planar ? 1 : channels;
+            float *plane = planes + channel * Channel_Mapper::BLOCK_FRAMES;
+
+            for(int i = 0; i < count; i++)
+            {
+                plane[i] = Traits::to_float(source[i * stride]);
+            }
+        }
+    }
+
+    /* store_planes() function
+     * @desc a Store_Function for one output format
+     */
+    template<enum AVSampleFormat Format>
+    void store_planes(const float *planes, int channels, int offset, int count, uint8_t *const *out)
+    {
+        typedef Sample_Traits<Format> Traits;
+        typedef typename Traits::type Type;
+
+        int start = 0;
+
+#if defined(__SSE2__)
+        if constexpr(Format == AV_SAMPLE_FMT_S16)
+        {
+            // stereo s16, the usual output, four sample frames at a time: scale, clip, round, then interleave left and right
+            if(channels == 2)
+            {
+                const float *left = planes;
+                const float *right = planes + Channel_Mapper::BLOCK_FRAMES;
+                int16_t *destination = reinterpret_cast<int16_t *>(out[0]) + offset * 2;
+
+                __m128 scale = _mm_set1_ps(32768.0f);
+                __m128 low = _mm_set1_ps(-32768.0f);
+                __m128 high = _mm_set1_ps(32767.0f);
+
+                for(; start + 4 <= count; start += 4)
+                {
+                    __m128i left_samples = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(left + start), scale), low), high));
+                    __m128i right_samples = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(right + start), scale), low), high));
+                    __m128i interleaved = _mm_unpacklo_epi16(_mm_packs_epi32(left_samples, left_samples),
+                                                             _mm_packs_epi32(right_samples, right_samples));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + start * 2), interleaved);
+                }
+            }
+        }
+#endif
+
+        for(int channel = 0; channel < channels; channel++)
+        {
+            Type *destination = Traits::planar ? reinterpret_cast<Type *>(out[channel]) + offset
+                                               : reinterpret_cast<Type *>(out[0]) + offset * channels + channel;
+            int stride = Traits::planar ? 1 : channels;
+            const float *plane = planes + channel * Channel_Mapper::BLOCK_FRAMES;
+
+            for(int i = start; i < count; i++)
+            {
+                destination[i * stride] = Traits::from_float(plane[i]);
+            }
+        }
+    }
+
+    #define FORMAT_CASE(FUNCTION, FORMAT) case FORMAT: return &FUNCTION<FORMAT>;
+
+    #define FORMAT_CASES(FUNCTION) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_U8) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_S16) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_S32) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_FLT) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_DBL) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_U8P) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_S16P) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_S32P) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_FLTP) \
+        FORMAT_CASE(FUNCTION, AV_SAMPLE_FMT_DBLP)
+
+    Load_Function find_load_function(enum AVSampleFormat format)
+    {
+        switch(format)
+        {
+            FORMAT_CASES(load_planes)
+            default:
+                return nullptr;
+        }
+    }
+
+    Store_Function find_store_function(enum AVSampleFormat format)
+    {
+        switch(format)
+        {
+            FORMAT_CASES(store_planes)
+            default:
+                return nullptr;
+        }
+    }
+
+    #undef FORMAT_CASES
+    #undef FORMAT_CASE
+
+    /* route() function
+     * @desc adds gain from an input channel to an output channel of a matrix, if the output layout has that channel
+     * @return true if the output layout has the channel
+     */
+    bool route(std::vector<float> &matrix, int64_t out_layout, int in_channels, int in_index, uint64_t out_channel, float gain)
+    {
+        if(!(out_layout & out_channel))
+        {
+            return false;
+        }
+
+        int out_index = av_get_channel_layout_channel_index(out_layout, out_channel);
+        matrix[out_index * in_channels + in_index] += gain;
+        return true;
+    }
+
+    /* route_pair() function
+     * @desc adds gain from an input channel to both channels of a pair, if the output layout has both
+     * @return true if the output layout has both channels
+     */
+    bool route_pair(std::vector<float> &matrix, int64_t out_layout, int in_channels, int in_index, uint64_t left, uint64_t right, float gain)
+    {
+        if((out_layout & left) != left || (out_layout & right) != right)
+        {
+            return false;
+        }
+
+        route(matrix, out_layout, in_channels, in_index, left, gain);
+        route(matrix, out_layout, in_channels, in_index, right, gain);
+        return true;
+    }
+}
+
+
+
+
+/* Channel_Mapper constructor
+ * @desc creates a mapper with no matrix, set one with Channel_Mapper::set_downmix(), Channel_Mapper::set_matrix() or
+ * @desc Channel_Mapper::set_reorder(), and the formats with Channel_Mapper::set_formats()
+ */
+Channel_Mapper::Channel_Mapper()
+{
+    m_in_layout = 0;
+    m_out_layout = 0;
+    m_in_channels = 0;
+    m_out_channels = 0;
+
+    m_in_format = AV_SAMPLE_FMT_NONE;
+    m_out_format = AV_SAMPLE_FMT_NONE;
+
+    m_load = nullptr;
+    m_store = nullptr;
+}
+
+
+
+
+/* Channel_Mapper::set_downmix() function
+ * @desc works out the matrix between two layouts the way ITU-R BS.775 downmixes: channels both layouts have are passed
+ * @desc through, the center goes to left and right at -3 dB, surrounds go to the other surround pair if there is one or
+ * @desc to the front at -3 dB, and the LFE is dropped. Mono sources are upmixed to the front pair at -3 dB.
+ * @param in_layout - the input channel layout, EX: AV_CH_LAYOUT_5POINT1
+ * @param out_layout - the output channel layout, EX: AV_CH_LAYOUT_STEREO
+ * @param normalize - scale the matrix down so no output channel can clip, the way swresample does by default
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if a layout is empty
+ */
+Return_Status Channel_Mapper::set_downmix(int64_t in_layout, int64_t out_layout, bool normalize)
+{
+    if(set_layouts(in_layout, out_layout) == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
+    m_matrix.assign(m_out_channels * m_in_channels, 0.0f);
+
+    for(int in_index = 0; in_index < m_in_channels; in_index++)
+    {
+        uint64_t channel = av_channel_layout_extract_channel(m_in_layout, in_index);
+
+        if(route(m_matrix, m_out_layout, m_in_channels, in_index, channel, 1.0f))
+        {
+            continue;
+        }
+
+        switch(channel)
+        {
+            case AV_CH_FRONT_CENTER:
+                route_pair(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_LEFT, AV_CH_FRONT_RIGHT, MINUS_3DB);
+                break;
+
+            case AV_CH_FRONT_LEFT:
+            case AV_CH_FRONT_RIGHT:
+                route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_CENTER, MINUS_3DB);
+                break;
+
+            case AV_CH_FRONT_LEFT_OF_CENTER:
+                if(!route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_LEFT, 1.0f))
+                {
+                    route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_CENTER, MINUS_3DB);
+                }
+                break;
+
+            case AV_CH_FRONT_RIGHT_OF_CENTER:
+                if(!route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_RIGHT, 1.0f))
+                {
+                    route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_CENTER, MINUS_3DB);
+                }
+                break;
+
+            case AV_CH_SIDE_LEFT:
+            case AV_CH_BACK_LEFT:
+                // 5.1 side and 5.1 back surrounds are the same speakers named differently
+                if(!route(m_matrix, m_out_layout, m_in_channels, in_index, channel == AV_CH_SIDE_LEFT ? AV_CH_BACK_LEFT : AV_CH_SIDE_LEFT, 1.0f) &&
+                   !route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_LEFT, MINUS_3DB))
+                {
+                    route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_CENTER, MINUS_6DB);
+                }
+                break;
+
+            case AV_CH_SIDE_RIGHT:
+            case AV_CH_BACK_RIGHT:
+                if(!route(m_matrix, m_out_layout, m_in_channels, in_index, channel == AV_CH_SIDE_RIGHT ? AV_CH_BACK_RIGHT : AV_CH_SIDE_RIGHT, 1.0f) &&
+                   !route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_RIGHT, MINUS_3DB))
+                {
+                    route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_CENTER, MINUS_6DB);
+                }
+                break;
+
+            case AV_CH_BACK_CENTER:
+                if(!route_pair(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_BACK_LEFT, AV_CH_BACK_RIGHT, MINUS_3DB) &&
+                   !route_pair(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_SIDE_LEFT, AV_CH_SIDE_RIGHT, MINUS_3DB) &&
+                   !route_pair(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_LEFT, AV_CH_FRONT_RIGHT, MINUS_6DB))
+                {
+                    route(m_matrix, m_out_layout, m_in_channels, in_index, AV_CH_FRONT_CENTER, MINUS_6DB);
+                }
+                break;
+
+            default:
+                // the LFE and channels without a rule are dropped
+                break;
+        }
+    }
+
+    if(normalize)
+    {
+        float loudest = 0.0f;
+        for(int out_index = 0; out_index < m_out_channels; out_index++)
+        {
+            float sum = 0.0f;
+            for(int in_index = 0; in_index < m_in_channels; in_index++)
+            {
+                sum += std::fabs(m_matrix[out_index * m_in_channels + in_index]);
+            }
+            loudest = std::max(loudest, sum);
+        }
+
+        if(loudest > 1.0f)
+        {
+            for(float &gain : m_matrix)
+            {
+                gain /= loudest;
+            }
+        }
+    }
+
+    build_terms();
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Channel_Mapper::set_matrix() function
+ * @desc sets a custom matrix
+ * @param in_layout - the input channel layout
+ * @param out_layout - the output channel layout
+ * @param matrix - one row per output channel of one gain per input channel, in the order of the layouts' channels
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if a layout is empty or the matrix has the wrong size
+ */
+Return_Status Channel_Mapper::set_matrix(int64_t in_layout, int64_t out_layout, const std::vector<float> &matrix)
+{
+    if(set_layouts(in_layout, out_layout) == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
+    if(matrix.size() != static_cast<std::size_t>(m_out_channels * m_in_channels))
+    {
+        enqueue_error("Channel matrix has " + std::to_string(matrix.size()) + " coefficients, " +
+                      std::to_string(m_out_channels) + " x " + std::to_string(m_in_channels) + " expected");
+        return STATUS_FAILURE;
+    }
+
+    m_matrix = matrix;
+
+    build_terms();
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Channel_Mapper::set_reorder() function
+ * @desc sets a matrix copying input channels to output channels, to reorder channels or pick some of them
+ * @param in_layout - the input channel layout
+ * @param out_layout - the output channel layout
+ * @param sources - for every output channel the index of the input channel copied to it, -1 for silence
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if a layout is empty or a source is out of range
+ */
+Return_Status Channel_Mapper::set_reorder(int64_t in_layout, int64_t out_layout, const std::vector<int> &sources)
+{
+    if(set_layouts(in_layout, out_layout) == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
+    if(sources.size() != static_cast<std::size_t>(m_out_channels))
+    {
+        enqueue_error("Channel reorder has " + std::to_string(sources.size()) + " sources, " + std::to_string(m_out_channels) + " expected");
+        return STATUS_FAILURE;
+    }
+
+    m_matrix.assign(m_out_channels * m_in_channels, 0.0f);
+
+    for(int out_index = 0; out_index < m_out_channels; out_index++)
+    {
+        if(sources[out_index] < -1 || sources[out_index] >= m_in_channels)
+        {
+            enqueue_error("Channel reorder source " + std::to_string(sources[out_index]) + " is out of range");
+            return STATUS_FAILURE;
+        }
+
+        if(sources[out_index] >= 0)
+        {
+            m_matrix[out_index * m_in_channels + sources[out_index]] = 1.0f;
+        }
+    }
+
+    build_terms();
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Channel_Mapper::set_formats() function
+ * @desc sets the sample formats, picking the functions converting them once instead of per block
+ * @param in_format - the input sample format
+ * @param out_format - the output sample format
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if a format is not supported
+ */
+Return_Status Channel_Mapper::set_formats(enum AVSampleFormat in_format, enum AVSampleFormat out_format)
+{
+    m_in_format = in_format;
+    m_out_format = out_format;
+
+    m_load = find_load_function(in_format);
+    m_store = find_store_function(out_format);
+
+    if(!m_load)
+    {
+        enqueue_error("Channel mapping does not support the input sample format");
+        return STATUS_FAILURE;
+    }
+
+    if(!m_store)
+    {
+        enqueue_error("Channel mapping does not support the output sample format");
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Channel_Mapper::is_ready() function
+ * @return true once a matrix and supported formats are set, Channel_Mapper::map() must not be called before
+ */
+bool Channel_Mapper::is_ready()
+{
+    return m_load && m_store && !m_matrix.empty();
+}
+
+
+
+
+/* Channel_Mapper::map() function
+ * @desc maps and converts nb_samples sample frames
+ * @param in - the input planes, one per channel if the input format is planar, only in[0] otherwise
+ * @param out - the output planes, one per channel if the output format is planar, only out[0] otherwise
+ * @param nb_samples - the number of sample frames
+ * @note does not allocate, the block buffers are sized when the layouts are set
+ */
+void Channel_Mapper::map(const uint8_t *const *in, uint8_t *const *out, int nb_samples)
+{
+    for(int offset = 0; offset < nb_samples; offset += BLOCK_FRAMES)
+    {
+        int count = std::min(BLOCK_FRAMES, nb_samples - offset);
+
+        m_load(in, m_in_channels, offset, count, m_in_planes.data());
+
+        std::fill(m_out_planes.begin(), m_out_planes.end(), 0.0f);
+        for(const Map_Term &term : m_terms)
+        {
+            mix_add(m_out_planes.data() + term.out * BLOCK_FRAMES, m_in_planes.data() + term.in * BLOCK_FRAMES, count, term.gain);
+        }
+
+        m_store(m_out_planes.data(), m_out_channels, offset, count, out);
+    }
+}
+
+
+
+
+/* Channel_Mapper::get_matrix() function
+ * @return the matrix, m_out_channels rows of m_in_channels coefficients, empty before one was set
+ */
+const std::vector<float> &Channel_Mapper::get_matrix()
+{
+    return m_matrix;
+}
+
+
+
+
+/* Channel_Mapper::get_in_layout() function
+ * @return the input channel layout
+ */
+int64_t Channel_Mapper::get_in_layout()
+{
+    return m_in_layout;
+}
+
+
+
+
+/* Channel_Mapper::get_out_layout() function
+ * @return the output channel layout
+ */
+int64_t Channel_Mapper::get_out_layout()
+{
+    return m_out_layout;
+}
+
+
+
+
+/* Channel_Mapper::get_in_channels() function
+ * @return the number of input channels
+ */
+int Channel_Mapper::get_in_channels()
+{
+    return m_in_channels;
+}
+
+
+
+
+/* Channel_Mapper::get_out_channels() function
+ * @return the number of output channels
+ */
+int Channel_Mapper::get_out_channels()
+{
+    return m_out_channels;
+}
+
+
+
+
+/* Channel_Mapper::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Channel_Mapper::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Channel_Mapper::set_layouts() function
+ * @desc sets the layouts and sizes the block buffers, the matrix is left empty for the caller to fill in
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if a layout is empty
+ * @note this function is under the private specifier
+ */
+Return_Status Channel_Mapper::set_layouts(int64_t in_layout, int64_t out_layout)
+{
+    m_matrix.clear();
+    m_terms.clear();
+
+    if(in_layout == 0 || out_layout == 0)
+    {
+        enqueue_error("Channel mapping needs both channel layouts");
+        return STATUS_FAILURE;
+    }
+
+    m_in_layout = in_layout;
+    m_out_layout = out_layout;
+    m_in_channels = av_get_channel_layout_nb_channels(in_layout);
+    m_out_channels = av_get_channel_layout_nb_channels(out_layout);
+
+    m_in_planes.assign(m_in_channels * BLOCK_FRAMES, 0.0f);
+    m_out_planes.assign(m_out_channels * BLOCK_FRAMES, 0.0f);
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Channel_Mapper::build_terms() function
+ * @desc collects the non zero coefficients of m_matrix into m_terms, so a sparse downmix only costs its terms
+ * @note this function is under the private specifier
+ */
+void Channel_Mapper::build_terms()
+{
+    m_terms.clear();
+
+    for(int out_index = 0; out_index < m_out_channels; out_index++)
+    {
+        for(int in_index = 0; in_index < m_in_channels; in_index++)
+        {
+            float gain = m_matrix[out_index * m_in_channels + in_index];
+            if(gain != 0.0f)
+            {
+                m_terms.push_back(Map_Term{out_index, in_index, gain});
+            }
+        }
+    }
+}
+
+
+
+
+/* Channel_Mapper::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, the oldest are dropped past MAX_QUEUED_ERRORS
+ * @param error - std::string error message
+ * @note this function is under the private specifier
+ */
+void Channel_Mapper::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Map_Term Struct
+ * @desc one non zero coefficient of a channel matrix, output channel out gets input channel in times gain
+ */
+struct Map_Term
+{
+    int out;
+    int in;
+    float gain;
+};
+
+/* Load_Function
+ * @desc converts count sample frames starting at sample frame offset into one float plane per channel
+ * @param in - the input planes, one per channel if the input is planar, only in[0] otherwise
+ * @param channels - the number of input channels
+ * @param offset - the first sample frame to convert
+ * @param count - the number of sample frames to convert
+ * @param planes - channels planes of Channel_Mapper::BLOCK_FRAMES floats each
+ */
+typedef void (*Load_Function)(const uint8_t *const *in, int channels, int offset, int count, float *planes);
+
+/* Store_Function
+ * @desc converts count sample frames from one float plane per channel into the output, starting at sample frame offset
+ * @param planes - channels planes of Channel_Mapper::BLOCK_FRAMES floats each
+ * @param channels - the number of output channels
+ * @param offset - the first sample frame to write
+ * @param count - the number of sample frames to write
+ * @param out - the output planes, one per channel if the output is planar, only out[0] otherwise
+ */
+typedef void (*Store_Function)(const float *planes, int channels, int offset, int count, uint8_t *const *out);
+
+/* Channel_Mapper Class
+ * @desc Maps the channels of one layout onto another with a precomputed matrix, converting the sample format in the same pass.
+ * @desc The matrix is an ITU-R BS.775 style downmix (or plain upmix) worked out from the two layouts, a custom matrix, or a
+ * @desc reorder / selection of input channels. Only the non zero coefficients are kept, as a list of terms, when it is set.
+ * @desc Samples are processed in blocks of BLOCK_FRAMES sample frames: the block is converted to float planes, each output
+ * @desc plane is accumulated from its terms with the SIMD mix_add() kernel and the result converted to the output format
+ * @desc while it is still in the cache, so there is no per frame setup and no full size intermediate buffer.
+ * @member m_in_layout, m_out_layout - the input and output channel layouts
+ * @member m_in_channels, m_out_channels - the number of input and output channels
+ * @member m_in_format, m_out_format - the input and output sample formats
+ * @member m_matrix - the matrix, m_out_channels rows of m_in_channels coefficients
+ * @member m_terms - the non zero coefficients of m_matrix, sorted by output channel
+ * @member m_load - converts the input format to float planes, nullptr if the format is not supported
+ * @member m_store - converts float planes to the output format, nullptr if the format is not supported
+ * @member m_in_planes - BLOCK_FRAMES floats for every input channel
+ * @member m_out_planes - BLOCK_FRAMES floats for every output channel
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see channel_mapper.cpp for comments on functions
+ */
+class Channel_Mapper
+{
+    int64_t m_in_layout;
+    int64_t m_out_layout;
+    int m_in_channels;
+    int m_out_channels;
+
+    enum AVSampleFormat m_in_format;
+    enum AVSampleFormat m_out_format;
+
+    std::vector<float> m_matrix;
+    std::vector<Map_Term> m_terms;
+
+    Load_Function m_load;
+    Store_Function m_store;
+
+    std::vector<float> m_in_planes;
+    std::vector<float> m_out_planes;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    static constexpr int BLOCK_FRAMES = 256;
+
+    Channel_Mapper();
+
+    Return_Status set_downmix(int64_t, int64_t, bool);
+    Return_Status set_matrix(int64_t, int64_t, const std::vector<float>&);
+    Return_Status set_reorder(int64_t, int64_t, const std::vector<int>&);
+    Return_Status set_formats(enum AVSampleFormat, enum AVSampleFormat);
+
+    bool is_ready();
+    void map(const uint8_t *const *, uint8_t *const *, int);
+
+    const std::vector<float> &get_matrix();
+    int64_t get_in_layout();
+    int64_t get_out_layout();
+    int get_in_channels();
+    int get_out_channels();
+
+    std::string poll_error();
+
+    private:
+
+    Return_Status set_layouts(int64_t, int64_t);
+    void build_terms();
+    void enqueue_error(const std::string &error);
+};
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Builds each given build profile of the makefile, runs the benchmark with it and prints
+# the CPU time per second of audio of every profile side by side.
+# Usage: ./compare_profiles.sh [profile...], EX: ./compare_profiles.sh release pgo
+
+if [ $# -eq 0 ]; then
+    set -- debug release native pgo
+fi
+
+results=$(mktemp -d) || exit 1
+trap 'rm -rf "$results"' EXIT
+
+for profile in "$@"; do
+    echo "Building $profile" >&2
+    if ! make -s "$profile" > "$results/$profile.build" 2>&1; then
+        echo "Failed to build $profile, see the output below" >&2
+        cat "$results/$profile.build" >&2
+        exit 1
+    fi
+
+    ./Benchmark | grep 'ms/audio-s' > "$results/$profile" || exit 1
+done
+
+# one row per metric, one column per profile, followed by the speedup of the last profile over the first
+cd "$results" || exit 1
+awk -v profiles="$*" '
+BEGIN {
+    count = split(profiles, names, " ")
+}
+{
+    value[FILENAME, $1] = $2
+    if(!($1 in seen)) {
+        seen[$1] = 1
+        order[++metrics] = $1
+    }
+}
+END {
+    printf "%-36s", "ms CPU per audio second"
+    for(i = 1; i <= count; i++) {
+        printf "%10s", names[i]
+    }
+    printf "%10s\n", "speedup"
+
+    for(m = 1; m <= metrics; m++) {
+        printf "%-36s", order[m]
+        for(i = 1; i <= count; i++) {
+            printf "%10.3f", value[names[i], order[m]]
+        }
+        last = value[names[count], order[m]]
+        printf "%9.2fx\n", (last > 0 ? value[names[1], order[m]] / last : 0)
+    }
+}' "$@"
@@ -0,0 +1,839 @@
+#include "coroutine_pipeline.h"
+#include "event_trace.h"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <system_error>
+#include <utility>
+
+// the most error messages kept for Pipeline_Context::poll_error()
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+
+
+
+/* Pipeline_Task::Final_Awaiter::await_ready() function
+ * @return false, the task is always handed back to its executor when it returns
+ */
+bool Pipeline_Task::Final_Awaiter::await_ready() noexcept
+{
+    return false;
+}
+
+
+
+
+/* Pipeline_Task::Final_Awaiter::await_suspend() function
+ * @desc frees the returned coroutine and tells its executor, which may be waiting for the last task to return
+ * @param handle - the coroutine that returned
+ */
+void Pipeline_Task::Final_Awaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+{
+    Pipeline_Executor *executor = handle.promise().executor;
+    handle.destroy();
+    executor->task_finished();
+}
+
+
+
+
+/* Pipeline_Task::Final_Awaiter::await_resume() function
+ * @desc never called, the coroutine is freed while suspended
+ */
+void Pipeline_Task::Final_Awaiter::await_resume() noexcept
+{
+
+}
+
+
+
+
+/* Pipeline_Task::promise_type::get_return_object() function
+ * @return the Pipeline_Task handed to the caller of the coroutine
+ */
+Pipeline_Task Pipeline_Task::promise_type::get_return_object()
+{
+    return Pipeline_Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+}
+
+
+
+
+/* Pipeline_Task::promise_type::initial_suspend() function
+ * @return std::suspend_always, the coroutine waits for Pipeline_Executor::spawn()
+ */
+std::suspend_always Pipeline_Task::promise_type::initial_suspend() noexcept
+{
+    return std::suspend_always{};
+}
+
+
+
+
+/* Pipeline_Task::promise_type::final_suspend() function
+ * @return a Final_Awaiter, which frees the coroutine
+ */
+Pipeline_Task::Final_Awaiter Pipeline_Task::promise_type::final_suspend() noexcept
+{
+    return Final_Awaiter{};
+}
+
+
+
+
+/* Pipeline_Task::promise_type::return_void() function
+ * @desc stages report failures through their Pipeline_Context, there is nothing to return
+ */
+void Pipeline_Task::promise_type::return_void()
+{
+
+}
+
+
+
+
+/* Pipeline_Task::promise_type::unhandled_exception() function
+ * @desc stages don't throw, if one does anyway the pipeline can't be left half running
+ */
+void Pipeline_Task::promise_type::unhandled_exception()
+{
+    std::terminate();
+}
+
+
+
+
+/* Pipeline_Task constructor
+ * @param handle - the suspended coroutine
+ * @note this function is under the private specifier
+ */
+Pipeline_Task::Pipeline_Task(std::coroutine_handle<promise_type> handle) : m_handle{handle}
+{
+
+}
+
+
+
+
+/* Pipeline_Task move constructor
+ * @desc takes the coroutine of another task, which is left empty
+ */
+Pipeline_Task::Pipeline_Task(Pipeline_Task &&other) : m_handle{std::exchange(other.m_handle, nullptr)}
+{
+
+}
+
+
+
+
+/* Pipeline_Task destructor
+ * @desc frees the coroutine if it was never spawned
+ */
+Pipeline_Task::~Pipeline_Task()
+{
+    if(m_handle)
+    {
+        m_handle.destroy();
+    }
+}
+
+
+
+
+/* Pipeline_Executor constructor
+ * @desc creates an executor without threads, see Pipeline_Executor::start()
+ */
+Pipeline_Executor::Pipeline_Executor() : m_resumes{0}
+{
+    m_active_tasks = 0;
+    m_stopping = false;
+}
+
+
+
+
+/* Pipeline_Executor destructor
+ * @desc stops the worker threads once the coroutines ready have run
+ * @note call Pipeline_Executor::wait_idle() first, tasks still suspended in a channel are never freed
+ */
+Pipeline_Executor::~Pipeline_Executor()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for(std::thread &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+
+
+
+/* Pipeline_Executor::start() function
+ * @desc starts the worker threads
+ * @param threads - the number of worker threads, at least 1
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if no thread could be started
+ */
+Return_Status Pipeline_Executor::start(std::size_t threads)
+{
+    for(std::size_t i = 0; i < std::max<std::size_t>(threads, 1); i++)
+    {
+        try
+        {
+            m_threads.emplace_back(&Pipeline_Executor::run, this);
+        }
+        catch(const std::system_error &error)
+        {
+            enqueue_error("Failed to start executor thread: " + std::string{error.what()});
+            break;
+        }
+    }
+
+    return m_threads.empty() ? STATUS_FAILURE : STATUS_SUCCESS;
+}
+
+
+
+
+/* Pipeline_Executor::spawn() function
+ * @desc starts running a task on one of the worker threads
+ * @param task - the task, EX: decode_stage(decoder, std::move(first_frame), pool, channel, context)
+ */
+void Pipeline_Executor::spawn(Pipeline_Task task)
+{
+    std::coroutine_handle<Pipeline_Task::promise_type> handle = std::exchange(task.m_handle, nullptr);
+    handle.promise().executor = this;
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_active_tasks++;
+    }
+
+    post(handle);
+}
+
+
+
+
+/* Pipeline_Executor::post() function
+ * @desc queues a suspended coroutine to be resumed by a worker thread
+ * @param handle - the coroutine
+ * @note may be called from any thread, EX: by a Frame_Channel when a frame arrived for a waiting stage
+ */
+void Pipeline_Executor::post(std::coroutine_handle<> handle)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_ready.push_back(handle);
+    }
+    m_wake.notify_one();
+}
+
+
+
+
+/* Pipeline_Executor::wait_idle() function
+ * @desc waits until every spawned task has returned
+ */
+void Pipeline_Executor::wait_idle()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_idle.wait(lock, [this]()
+    {
+        return m_active_tasks == 0;
+    });
+}
+
+
+
+
+/* Pipeline_Executor::get_resumes() function
+ * @return the number of times a coroutine was resumed, a frame passing a channel costs one or two
+ */
+uint64_t Pipeline_Executor::get_resumes()
+{
+    return m_resumes.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* Pipeline_Executor::get_thread_count() function
+ * @return the number of worker threads running
+ */
+std::size_t Pipeline_Executor::get_thread_count()
+{
+    return m_threads.size();
+}
+
+
+
+
+/* Pipeline_Executor::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Pipeline_Executor::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Pipeline_Executor::run() function
+ * @desc the body of a worker thread, resumes ready coroutines until the executor is destroyed
+ * @note this function is under the private specifier
+ */
+void Pipeline_Executor::run()
+{
+    trace_name_thread("executor");
+
+    while(1)
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_wake.wait(lock, [this]()
+        {
+            return !m_ready.empty() || m_stopping;
+        });
+
+        if(m_ready.empty())
+        {
+            break;
+        }
+
+        std::coroutine_handle<> handle = m_ready.front();
+        m_ready.pop_front();
+        lock.unlock();
+
+        m_resumes.fetch_add(1, std::memory_order_relaxed);
+
+        Trace_Scope scope{"resume"};
+        handle.resume();
+    }
+}
+
+
+
+
+/* Pipeline_Executor::task_finished() function
+ * @desc counts a returned task, waking Pipeline_Executor::wait_idle() after the last one
+ * @note this function is under the private specifier
+ */
+void Pipeline_Executor::task_finished()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_active_tasks--;
+    if(m_active_tasks == 0)
+    {
+        m_idle.notify_all();
+    }
+}
+
+
+
+
+/* Pipeline_Executor::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @param error - std::string error message
+ * @note this function is under the private specifier
+ */
+void Pipeline_Executor::enqueue_error(const std::string &error)
+{
+    m_errors.push(error);
+}
+
+
+
+
+/* Frame_Channel constructor
+ * @param executor - the executor running the stages on both ends
+ * @param capacity - the most frames queued, at least 1
+ */
+Frame_Channel::Frame_Channel(Pipeline_Executor &executor, std::size_t capacity) :
+    m_executor{executor}, m_capacity{std::max<std::size_t>(capacity, 1)}
+{
+    m_sender = nullptr;
+    m_receiver = nullptr;
+    m_closed = false;
+    m_frames_sent = 0;
+    m_send_waits = 0;
+    m_receive_waits = 0;
+}
+
+
+
+
+/* Frame_Channel::send() function
+ * @desc sends a frame, use as co_await channel.send(std::move(frame))
+ * @param frame - the frame, moved into the channel
+ * @return an awaiter, co_await gives true if the channel took the frame, false if it was closed
+ */
+Frame_Channel::Send_Awaiter Frame_Channel::send(Frame_Handle frame)
+{
+    return Send_Awaiter{*this, std::move(frame)};
+}
+
+
+
+
+/* Frame_Channel::receive() function
+ * @desc receives the next frame, use as Frame_Handle frame = co_await channel.receive()
+ * @return an awaiter, co_await gives the frame, an empty handle once the channel is closed and empty
+ */
+Frame_Channel::Receive_Awaiter Frame_Channel::receive()
+{
+    return Receive_Awaiter{*this};
+}
+
+
+
+
+/* Frame_Channel::close() function
+ * @desc closes the channel, a waiting receiver gets the frames left then an empty handle, a waiting sender gets false
+ * @note called by either stage when it stops, closing twice does nothing
+ */
+void Frame_Channel::close()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_closed = true;
+
+    if(m_sender)
+    {
+        m_sender->m_taken = false;
+        m_executor.post(m_sender->m_handle);
+        m_sender = nullptr;
+    }
+
+    if(m_receiver && m_frames.empty())
+    {
+        m_executor.post(m_receiver->m_handle);
+        m_receiver = nullptr;
+    }
+}
+
+
+
+
+/* Frame_Channel::get_frames_sent() function
+ * @return the number of frames the channel took
+ */
+uint64_t Frame_Channel::get_frames_sent()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_frames_sent;
+}
+
+
+
+
+/* Frame_Channel::get_send_waits() function
+ * @return the number of times the sender waited for room, EX: because the stage after it is the slow one
+ */
+uint64_t Frame_Channel::get_send_waits()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_send_waits;
+}
+
+
+
+
+/* Frame_Channel::get_receive_waits() function
+ * @return the number of times the receiver waited for a frame, EX: because the stage before it is the slow one
+ */
+uint64_t Frame_Channel::get_receive_waits()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_receive_waits;
+}
+
+
+
+
+/* Frame_Channel::Send_Awaiter constructor
+ * @param channel - the channel
+ * @param frame - the frame to send
+ */
+Frame_Channel::Send_Awaiter::Send_Awaiter(Frame_Channel &channel, Frame_Handle frame) :
+    m_channel{channel}, m_frame{std::move(frame)}
+{
+    m_taken = false;
+}
+
+
+
+
+/* Frame_Channel::Send_Awaiter::await_ready() function
+ * @return false, the channel is only looked at under its lock in Send_Awaiter::await_suspend()
+ */
+bool Frame_Channel::Send_Awaiter::await_ready()
+{
+    return false;
+}
+
+
+
+
+/* Frame_Channel::Send_Awaiter::await_suspend() function
+ * @desc hands the frame to a waiting receiver or queues it, if the channel is full the sender is suspended
+ * @param handle - the sending coroutine
+ * @return true if the sender has to wait, false to carry on right away
+ */
+bool Frame_Channel::Send_Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> lock{m_channel.m_mutex};
+
+    if(m_channel.m_closed)
+    {
+        m_taken = false;
+        return false;
+    }
+
+    if(m_channel.m_frames.size() >= m_channel.m_capacity)
+    {
+        // Receive_Awaiter::await_suspend() moves the frame in once there is room
+        m_handle = handle;
+        m_channel.m_sender = this;
+        m_channel.m_send_waits++;
+        return true;
+    }
+
+    m_taken = true;
+    m_channel.m_frames_sent++;
+
+    if(m_channel.m_receiver)
+    {
+        // the channel is empty, so the frame goes straight to the waiting receiver
+        m_channel.m_receiver->m_frame = std::move(m_frame);
+        m_channel.m_executor.post(m_channel.m_receiver->m_handle);
+        m_channel.m_receiver = nullptr;
+        return false;
+    }
+
+    m_channel.m_frames.push_back(std::move(m_frame));
+    return false;
+}
+
+
+
+
+/* Frame_Channel::Send_Awaiter::await_resume() function
+ * @return true if the channel took the frame, false if it was closed, the frame is then released with the awaiter
+ */
+bool Frame_Channel::Send_Awaiter::await_resume()
+{
+    return m_taken;
+}
+
+
+
+
+/* Frame_Channel::Receive_Awaiter constructor
+ * @param channel - the channel
+ */
+Frame_Channel::Receive_Awaiter::Receive_Awaiter(Frame_Channel &channel) : m_channel{channel}
+{
+
+}
+
+
+
+
+/* Frame_Channel::Receive_Awaiter::await_ready() function
+ * @return false, the channel is only looked at under its lock in Receive_Awaiter::await_suspend()
+ */
+bool Frame_Channel::Receive_Awaiter::await_ready()
+{
+    return false;
+}
+
+
+
+
+/* Frame_Channel::Receive_Awaiter::await_suspend() function
+ * @desc takes the oldest frame, letting a waiting sender queue its frame, if the channel is empty the receiver is suspended
+ * @param handle - the receiving coroutine
+ * @return true if the receiver has to wait, false to carry on right away
+ */
+bool Frame_Channel::Receive_Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> lock{m_channel.m_mutex};
+
+    if(!m_channel.m_frames.empty())
+    {
+        m_frame = std::move(m_channel.m_frames.front());
+        m_channel.m_frames.pop_front();
+
+        if(m_channel.m_sender)
+        {
+            Send_Awaiter *sender = m_channel.m_sender;
+            m_channel.m_frames.push_back(std::move(sender->m_frame));
+            m_channel.m_frames_sent++;
+            sender->m_taken = true;
+            m_channel.m_executor.post(sender->m_handle);
+            m_channel.m_sender = nullptr;
+        }
+
+        return false;
+    }
+
+    if(m_channel.m_closed)
+    {
+        return false;
+    }
+
+    m_handle = handle;
+    m_channel.m_receiver = this;
+    m_channel.m_receive_waits++;
+    return true;
+}
+
+
+
+
+/* Frame_Channel::Receive_Awaiter::await_resume() function
+ * @return the frame received, empty if the channel was closed and empty
+ */
+Frame_Handle Frame_Channel::Receive_Awaiter::await_resume()
+{
+    return std::move(m_frame);
+}
+
+
+
+
+/* Pipeline_Context constructor
+ */
+Pipeline_Context::Pipeline_Context() : m_cancelled{false}
+{
+
+}
+
+
+
+
+/* Pipeline_Context::cancel() function
+ * @desc asks every stage to stop at its next frame, they close their channels so the stages waiting on them stop too
+ * @note a single lock free store, safe to call from a signal handler
+ */
+void Pipeline_Context::cancel()
+{
+    m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+
+
+
+/* Pipeline_Context::is_cancelled() function
+ * @return true once Pipeline_Context::cancel() or Pipeline_Context::fail() was called
+ */
+bool Pipeline_Context::is_cancelled()
+{
+    return m_cancelled.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* Pipeline_Context::fail() function
+ * @desc records why a stage failed and cancels the pipeline
+ * @param error - the error message, the oldest are dropped past MAX_QUEUED_ERRORS
+ */
+void Pipeline_Context::fail(const std::string &error)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if(m_errors.size() >= MAX_QUEUED_ERRORS)
+        {
+            m_errors.pop();
+        }
+
+        m_errors.push(error);
+    }
+
+    cancel();
+}
+
+
+
+
+/* Pipeline_Context::poll_error() function
+ * @desc used to get std::string errors recorded by Pipeline_Context::fail()
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Pipeline_Context::poll_error()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* decode_stage() function
+ * @desc a stage decoding frames into its output channel until the end of the file, moving each out of the decoder
+ * @param decoder - an initialized decoder, only used by this stage while it runs
+ * @param first - a frame decoded already, EX: by the startup that set up the sink, sent first, empty if none
+ * @param pool - where the frames decoded into come from, holding at least 2 more than the output channel,
+ * @param pool - so this stage never waits for one, one for the frame the next stage works on and one spare
+ * @param out - where the frames go, closed when the stage stops
+ * @param context - the pipeline's context, decoding errors fail it
+ * @return the stage, see Pipeline_Executor::spawn()
+ */
+Pipeline_Task decode_stage(FFmpeg_Decoder &decoder, Frame_Handle first, Frame_Pool &pool, Frame_Channel &out, Pipeline_Context &context)
+{
+    Frame_Handle frame = std::move(first);
+
+    while(!context.is_cancelled())
+    {
+        if(!frame)
+        {
+            frame = pool.acquire();
+            if(!frame)
+            {
+                context.fail("Frame pool closed");
+                break;
+            }
+
+            if(decoder.decode_frame(frame) != STATUS_SUCCESS)
+            {
+                if(!decoder.end_of_file_reached())
+                {
+                    for(std::string error = decoder.poll_error(); !error.empty(); error = decoder.poll_error())
+                    {
+                        context.fail(error);
+                    }
+                    context.fail("Failed to decode " + decoder.get_filename());
+                }
+                break;
+            }
+        }
+
+        if(!co_await out.send(std::move(frame)))
+        {
+            // the stages after this one stopped
+            break;
+        }
+    }
+
+    out.close();
+}
+
+
+
+
+/* resample_stage() function
+ * @desc a stage resampling the frames of its input channel into its output channel, once the input ends it sends
+ * @desc the samples the resampler still holds back, EX: its filter delay when the sample rate changes
+ * @param resampler - an initialized resampler, only used by this stage while it runs
+ * @param pool - where the frames resampled into come from, holding at least 2 more than the output channel, see decode_stage()
+ * @param in - where the decoded frames come from, closed when the stage stops so the stage before it stops too
+ * @param out - where the resampled frames go, closed when the stage stops
+ * @param context - the pipeline's context, resampling errors fail it
+ * @return the stage, see Pipeline_Executor::spawn()
+ */
+Pipeline_Task resample_stage(FFmpeg_Frame_Resampler &resampler, Frame_Pool &pool, Frame_Channel &in, Frame_Channel &out,
+                             Pipeline_Context &context)
+{
+    while(!context.is_cancelled())
+    {
+        Frame_Handle frame = co_await in.receive();
+
+        Frame_Handle resampled = pool.acquire();
+        if(!resampled)
+        {
+            context.fail("Frame pool closed");
+            break;
+        }
+
+        if(!frame)
+        {
+            // the decoder reached the end of the file, unless the pipeline was stopped
+            if(!context.is_cancelled() && resampler.flush(resampled) == STATUS_SUCCESS && resampled->nb_samples > 0)
+            {
+                co_await out.send(std::move(resampled));
+            }
+
+            for(std::string error = resampler.poll_error(); !error.empty(); error = resampler.poll_error())
+            {
+                context.fail(error);
+            }
+            break;
+        }
+
+        if(resampler.resample_frame(frame.get(), resampled) != STATUS_SUCCESS)
+        {
+            for(std::string error = resampler.poll_error(); !error.empty(); error = resampler.poll_error())
+            {
+                context.fail(error);
+            }
+            break;
+        }
+
+        if(!co_await out.send(std::move(resampled)))
+        {
+            break;
+        }
+    }
+
+    in.close();
+    out.close();
+}
+
+
+
+
+/* sink_stage() function
+ * @desc a stage handing every frame of its input channel to a function, EX: one playing it with Audio_Player::play_frame()
+ * @param in - where the frames come from, closed when the stage stops so the stages before it stop too
+ * @param context - the pipeline's context, cancelled when consume fails
+ * @param consume - called with every frame on one of the executor's threads, records its errors with Pipeline_Context::fail()
+ * @return the stage, see Pipeline_Executor::spawn()
+ */
+Pipeline_Task sink_stage(Frame_Channel &in, Pipeline_Context &context, std::function<Return_Status(AVFrame*)> consume)
+{
+    while(!context.is_cancelled())
+    {
+        Frame_Handle frame = co_await in.receive();
+        if(!frame)
+        {
+            break;
+        }
+
+        if(consume(frame.get()) != STATUS_SUCCESS)
+        {
+            context.cancel();
+            break;
+        }
+    }
+
+    in.close();
+}
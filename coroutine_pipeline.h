@@ -0,0 +1,244 @@
+#pragma once
+
+#include "ffmpeg_decoder.h"
+#include "ffmpeg_resampler.h"
+#include "frame_handle.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+class Pipeline_Executor;
+
+/* Pipeline_Task Class
+ * @desc A pipeline stage written as a coroutine, EX: a function returning Pipeline_Task that loops over co_await
+ * @desc Frame_Channel::receive() and co_await Frame_Channel::send(). The coroutine starts suspended and runs once it
+ * @desc is given to Pipeline_Executor::spawn(), its frame is freed when it returns.
+ * @member m_handle - the suspended coroutine, empty once it was spawned
+ * @note see coroutine_pipeline.cpp for comments on functions
+ */
+class Pipeline_Task
+{
+    public:
+
+    struct promise_type;
+
+    struct Final_Awaiter
+    {
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<promise_type>) noexcept;
+        void await_resume() noexcept;
+    };
+
+    struct promise_type
+    {
+        Pipeline_Executor *executor = nullptr;
+
+        Pipeline_Task get_return_object();
+        std::suspend_always initial_suspend() noexcept;
+        Final_Awaiter final_suspend() noexcept;
+        void return_void();
+        void unhandled_exception();
+    };
+
+    Pipeline_Task(Pipeline_Task&&);
+    ~Pipeline_Task();
+
+    Pipeline_Task(const Pipeline_Task&) = delete;
+    Pipeline_Task &operator=(const Pipeline_Task&) = delete;
+    Pipeline_Task &operator=(Pipeline_Task&&) = delete;
+
+    private:
+
+    std::coroutine_handle<promise_type> m_handle;
+
+    explicit Pipeline_Task(std::coroutine_handle<promise_type>);
+
+    friend class Pipeline_Executor;
+};
+
+/* Pipeline_Executor Class
+ * @desc Runs Pipeline_Tasks on a few threads. A task runs until it waits on a Frame_Channel, then its thread runs
+ * @desc whatever task is ready next, so stages overlap without a thread of their own.
+ * @desc A stage that blocks, EX: writing to the audio server, holds its thread while it does, so there should be
+ * @desc a thread for every stage that blocks plus one.
+ * @member m_threads - the worker threads
+ * @member m_ready - coroutines ready to be resumed, guarded by m_mutex
+ * @member m_active_tasks - spawned tasks that have not returned yet, guarded by m_mutex
+ * @member m_stopping - set by the destructor to make the workers exit, guarded by m_mutex
+ * @member m_resumes - the number of times a coroutine was resumed, for the scheduling overhead
+ * @member m_mutex - guards the members above
+ * @member m_wake - signalled when a coroutine is ready or the workers should exit
+ * @member m_idle - signalled when the last task returned
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see coroutine_pipeline.cpp for comments on functions
+ */
+class Pipeline_Executor
+{
+    std::vector<std::thread> m_threads;
+    std::deque<std::coroutine_handle<>> m_ready;
+    std::size_t m_active_tasks;
+    bool m_stopping;
+    std::atomic<uint64_t> m_resumes;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Pipeline_Executor();
+    ~Pipeline_Executor();
+
+    Return_Status start(std::size_t);
+    void spawn(Pipeline_Task);
+    void post(std::coroutine_handle<>);
+    void wait_idle();
+
+    uint64_t get_resumes();
+    std::size_t get_thread_count();
+
+    std::string poll_error();
+
+    private:
+
+    void run();
+    void task_finished();
+    void enqueue_error(const std::string &error);
+
+    friend struct Pipeline_Task::Final_Awaiter;
+};
+
+/* Frame_Channel Class
+ * @desc A bounded queue of frames between two pipeline stages, one sending and one receiving.
+ * @desc A sender finding the channel full, or a receiver finding it empty, is suspended and resumed on the executor
+ * @desc once the other side made room or sent a frame, so a slow stage holds the stages before it back.
+ * @desc Either side may close the channel: the receiver then gets the frames left and an empty handle, a sender is
+ * @desc told its frame was not taken, EX: the sink stopped, so the stages before it stop too.
+ * @member m_executor - where suspended stages are resumed
+ * @member m_capacity - the most frames queued
+ * @member m_frames - the queued frames, guarded by m_mutex
+ * @member m_sender - the suspended sender, nullptr if none, guarded by m_mutex
+ * @member m_receiver - the suspended receiver, nullptr if none, guarded by m_mutex
+ * @member m_closed - true once either side closed the channel, guarded by m_mutex
+ * @member m_frames_sent - the number of frames taken by the channel, guarded by m_mutex
+ * @member m_send_waits - the number of times the sender was suspended because the channel was full, guarded by m_mutex
+ * @member m_receive_waits - the number of times the receiver was suspended because the channel was empty, guarded by m_mutex
+ * @member m_mutex - guards the members above
+ * @note see coroutine_pipeline.cpp for comments on functions
+ */
+class Frame_Channel
+{
+    public:
+
+    class Send_Awaiter
+    {
+        Frame_Channel &m_channel;
+        Frame_Handle m_frame;
+        std::coroutine_handle<> m_handle;
+        bool m_taken;
+
+        friend class Frame_Channel;
+
+        public:
+
+        Send_Awaiter(Frame_Channel&, Frame_Handle);
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<>);
+        bool await_resume();
+    };
+
+    class Receive_Awaiter
+    {
+        Frame_Channel &m_channel;
+        Frame_Handle m_frame;
+        std::coroutine_handle<> m_handle;
+
+        friend class Frame_Channel;
+
+        public:
+
+        explicit Receive_Awaiter(Frame_Channel&);
+
+        bool await_ready();
+        bool await_suspend(std::coroutine_handle<>);
+        Frame_Handle await_resume();
+    };
+
+    Frame_Channel(Pipeline_Executor&, std::size_t);
+
+    Send_Awaiter send(Frame_Handle);
+    Receive_Awaiter receive();
+    void close();
+
+    uint64_t get_frames_sent();
+    uint64_t get_send_waits();
+    uint64_t get_receive_waits();
+
+    private:
+
+    Pipeline_Executor &m_executor;
+    std::size_t m_capacity;
+
+    std::deque<Frame_Handle> m_frames;
+    Send_Awaiter *m_sender;
+    Receive_Awaiter *m_receiver;
+    bool m_closed;
+
+    uint64_t m_frames_sent;
+    uint64_t m_send_waits;
+    uint64_t m_receive_waits;
+
+    std::mutex m_mutex;
+};
+
+/* Pipeline_Context Class
+ * @desc What the stages of one pipeline share: a cancellation flag every stage checks between frames, and the errors.
+ * @desc A stage that fails records why and cancels the others, the caller reads the errors once the executor is idle.
+ * @member m_cancelled - set by Pipeline_Context::cancel(), lock free so it may be set from a signal handler
+ * @member m_mutex - guards m_errors, stages on different threads may fail at once
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see coroutine_pipeline.cpp for comments on functions
+ */
+class Pipeline_Context
+{
+    std::atomic<bool> m_cancelled;
+
+    std::mutex m_mutex;
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Pipeline_Context();
+
+    void cancel();
+    bool is_cancelled();
+    void fail(const std::string&);
+
+    std::string poll_error();
+};
+
+Pipeline_Task decode_stage(FFmpeg_Decoder&, Frame_Handle, Frame_Pool&, Frame_Channel&, Pipeline_Context&);
+Pipeline_Task resample_stage(FFmpeg_Frame_Resampler&, Frame_Pool&, Frame_Channel&, Frame_Channel&, Pipeline_Context&);
+Pipeline_Task sink_stage(Frame_Channel&, Pipeline_Context&, std::function<Return_Status(AVFrame*)>);
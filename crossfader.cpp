@@ -0,0 +1,319 @@
+#include "crossfader.h"
+#include "mix_kernels.h"
+#include "event_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+
+
+
+/* Crossfader constructor
+ * @desc sets variables and computes the crossfade curves, does not open any file
+ * @param playlist - the files to play, in order
+ * @param sample_rate - the output sample rate
+ * @param channels - the number of output channels
+ * @param fade_seconds - the length of the crossfade between two tracks, 0 plays the tracks back to back
+ */
+Crossfader::Crossfader(const std::vector<std::string> &playlist, int sample_rate, int channels, double fade_seconds) :
+    m_playlist{playlist}, m_sample_rate{sample_rate}, m_channels{channels}
+{
+    m_next_track = 0;
+    m_quality = RESAMPLE_DEFAULT;
+    m_fade_samples = static_cast<int>(fade_seconds * sample_rate);
+    m_fade_position = 0;
+    m_fade_length = m_fade_samples;
+    m_preroll_waits = 0;
+
+    m_fade_out.resize(m_fade_samples);
+    m_fade_in.resize(m_fade_samples);
+    equal_power_curves(m_fade_out.data(), m_fade_in.data(), m_fade_samples);
+}
+
+
+
+
+/* Crossfader::reset_quality() function
+ * @desc sets the quality tier the tracks are resampled with, see Resample_Quality
+ * @param quality - the tier
+ * @note call it before Crossfader::start(), the tracks are opened ahead on another thread
+ */
+void Crossfader::reset_quality(enum Resample_Quality quality)
+{
+    m_quality = quality;
+}
+
+
+
+
+/* Crossfader::start() function
+ * @desc opens the first track and starts decoding the second one ahead
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the first track can't be opened
+ */
+Return_Status Crossfader::start()
+{
+    start_preroll();
+    if(!m_preroll.valid())
+    {
+        enqueue_error("Nothing to play");
+        return STATUS_FAILURE;
+    }
+
+    Preroll_Result first = m_preroll.get();
+    if(first.status == STATUS_FAILURE)
+    {
+        take_errors(*first.source);
+        return STATUS_FAILURE;
+    }
+
+    m_current = std::move(first.source);
+    start_preroll();
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Crossfader::read() function
+ * @desc produces the next block of the playlist, crossfading between tracks where they meet
+ * @param destination - room for nb_samples * channels floats, interleaved
+ * @param nb_samples - the number of sample frames wanted
+ * @return the number of sample frames produced, less than nb_samples only at the end of the playlist, -1 on failure
+ * @note a track that can't be opened is skipped, its errors are enqueued
+ */
+int Crossfader::read(float *destination, int nb_samples)
+{
+    int produced = 0;
+
+    std::size_t block_size = static_cast<std::size_t>(nb_samples) * m_channels;
+    if(m_outgoing_buffer.size() < block_size)
+    {
+        m_outgoing_buffer.resize(block_size);
+        m_incoming_buffer.resize(block_size);
+    }
+
+    while(produced < nb_samples && m_current)
+    {
+        float *output = destination + static_cast<std::size_t>(produced) * m_channels;
+        int wanted = nb_samples - produced;
+
+        if(m_incoming)
+        {
+            int frames = std::min(wanted, m_fade_length - m_fade_position);
+
+            if(m_incoming->fill(frames) == STATUS_FAILURE)
+            {
+                // drop the incoming track, the rest of the current one crossfades into the track after it
+                take_errors(*m_incoming);
+                m_incoming.reset();
+                start_preroll();
+                continue;
+            }
+
+            // the outgoing samples were decoded ahead, they are all buffered
+            int outgoing = m_current->read(m_outgoing_buffer.data(), frames);
+            int incoming = m_incoming->read(m_incoming_buffer.data(), frames);
+
+            std::fill(m_outgoing_buffer.begin() + static_cast<std::size_t>(outgoing) * m_channels,
+                      m_outgoing_buffer.begin() + static_cast<std::size_t>(frames) * m_channels, 0.0f);
+            std::fill(m_incoming_buffer.begin() + static_cast<std::size_t>(incoming) * m_channels,
+                      m_incoming_buffer.begin() + static_cast<std::size_t>(frames) * m_channels, 0.0f);
+
+            mix_crossfade(output, m_outgoing_buffer.data(), m_incoming_buffer.data(), frames, m_channels,
+                          m_fade_out.data() + m_fade_position, m_fade_in.data() + m_fade_position);
+
+            m_fade_position += frames;
+            produced += frames;
+
+            if(m_fade_position == m_fade_length)
+            {
+                m_current = std::move(m_incoming);
+                start_preroll();
+            }
+
+            continue;
+        }
+
+        // keep a crossfade length decoded ahead, so the end of the track is seen before it has to be played
+        int lookahead = m_preroll.valid() ? m_fade_samples : 0;
+        if(m_current->fill(wanted + lookahead) == STATUS_FAILURE)
+        {
+            take_errors(*m_current);
+            return -1;
+        }
+
+        int buffered = m_current->get_buffered_samples();
+
+        if(m_current->decoding_finished() && m_preroll.valid())
+        {
+            if(buffered <= m_fade_samples)
+            {
+                begin_crossfade(buffered);
+                continue;
+            }
+
+            // stop exactly where the crossfade has to start
+            wanted = std::min(wanted, buffered - m_fade_samples);
+        }
+
+        produced += m_current->read(output, wanted);
+
+        if(m_current->finished())
+        {
+            m_current.reset();
+        }
+    }
+
+    return produced;
+}
+
+
+
+
+/* Crossfader::get_preroll_waits() function
+ * @return the number of crossfades that had to wait for the next track to finish opening
+ */
+uint64_t Crossfader::get_preroll_waits()
+{
+    return m_preroll_waits;
+}
+
+
+
+
+/* Crossfader::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Crossfader::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error = m_errors.front();
+        m_errors.pop();
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Crossfader::start_preroll() function
+ * @desc opens the next track of the playlist and decodes a crossfade length of it on another thread
+ * @note leaves m_preroll invalid if the playlist has no more tracks
+ * @note this function is under the private specifier
+ */
+void Crossfader::start_preroll()
+{
+    if(m_next_track >= m_playlist.size())
+    {
+        m_preroll = std::future<Preroll_Result>{};
+        return;
+    }
+
+    std::string filename = m_playlist[m_next_track++];
+    int sample_rate = m_sample_rate;
+    int channels = m_channels;
+    int fade_samples = m_fade_samples;
+    enum Resample_Quality quality = m_quality;
+
+    m_preroll = std::async(std::launch::async, [filename, sample_rate, channels, fade_samples, quality]()
+    {
+        trace_name_thread("preroll");
+        Trace_Scope scope{"preroll"};
+
+        Preroll_Result result{std::unique_ptr<Audio_Source>{new Audio_Source{filename, sample_rate, channels}}, STATUS_SUCCESS};
+
+        if(result.source->reset_quality(quality) == STATUS_FAILURE || result.source->open() == STATUS_FAILURE ||
+           result.source->fill(fade_samples) == STATUS_FAILURE)
+        {
+            result.status = STATUS_FAILURE;
+        }
+
+        return result;
+    });
+}
+
+
+
+
+/* Crossfader::begin_crossfade() function
+ * @desc takes the prerolled track as the incoming one and starts blending it in
+ * @param length - the crossfade length in sample frames, what is left of the current track
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the next track failed to open,
+ * @return in which case it is skipped and the one after it is prerolled
+ * @note this function is under the private specifier
+ */
+Return_Status Crossfader::begin_crossfade(int length)
+{
+    if(m_preroll.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+    {
+        m_preroll_waits++;
+    }
+
+    Preroll_Result next = m_preroll.get();
+    if(next.status == STATUS_FAILURE)
+    {
+        take_errors(*next.source);
+        enqueue_error("Skipping " + next.source->get_filename());
+        start_preroll();
+        return STATUS_FAILURE;
+    }
+
+    if(length == 0)
+    {
+        m_current = std::move(next.source);
+        start_preroll();
+        return STATUS_SUCCESS;
+    }
+
+    m_incoming = std::move(next.source);
+    m_fade_position = 0;
+
+    if(length != m_fade_length)
+    {
+        // only a track shorter than the crossfade gets a shorter curve
+        m_fade_length = length;
+        m_fade_out.resize(length);
+        m_fade_in.resize(length);
+        equal_power_curves(m_fade_out.data(), m_fade_in.data(), length);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Crossfader::take_errors() function
+ * @desc moves all errors enqueued by a track onto m_errors
+ * @note this function is under the private specifier
+ */
+void Crossfader::take_errors(Audio_Source &source)
+{
+    for(std::string error = source.poll_error(); !error.empty(); error = source.poll_error())
+    {
+        enqueue_error(error);
+    }
+}
+
+
+
+
+/* Crossfader::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @note this function is under the private specifier
+ */
+void Crossfader::enqueue_error(const std::string &error)
+{
+    m_errors.push(error);
+}
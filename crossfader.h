@@ -0,0 +1,93 @@
+#pragma once
+
+#include "audio_source.h"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Crossfader Class
+ * @desc Plays a list of files back to back as one interleaved float stream, blending the end of each track
+ * @desc into the start of the next with an equal power crossfade.
+ * @desc The next track is opened and decoded ahead on its own thread as soon as the current one starts,
+ * @desc and the current track is decoded a crossfade length ahead, so the end of a track is known before it is reached.
+ * @member m_playlist - the files to play, in order
+ * @member m_next_track - index in m_playlist of the track after the current one
+ * @member m_sample_rate - the output sample rate
+ * @member m_channels - the number of output channels
+ * @member m_quality - the resampling quality tier of the tracks
+ * @member m_fade_samples - the crossfade length in sample frames
+ * @member m_current - the track playing, or fading out during a crossfade
+ * @member m_incoming - the track fading in, only set during a crossfade
+ * @member m_preroll - the next track being opened and decoded ahead
+ * @member m_fade_position - sample frames of the crossfade done so far
+ * @member m_fade_length - length of the current crossfade, shorter than m_fade_samples if a track is shorter than that
+ * @member m_fade_out - gain curve for m_current during the crossfade
+ * @member m_fade_in - gain curve for m_incoming during the crossfade
+ * @member m_outgoing_buffer - one block of m_current's samples during the crossfade
+ * @member m_incoming_buffer - one block of m_incoming's samples during the crossfade
+ * @member m_preroll_waits - times a crossfade had to wait for the next track to be ready
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see crossfader.cpp for comments on functions
+ */
+class Crossfader
+{
+    struct Preroll_Result
+    {
+        std::unique_ptr<Audio_Source> source;
+        Return_Status status;
+    };
+
+    std::vector<std::string> m_playlist;
+    std::size_t m_next_track;
+
+    int m_sample_rate;
+    int m_channels;
+    enum Resample_Quality m_quality;
+    int m_fade_samples;
+
+    std::unique_ptr<Audio_Source> m_current;
+    std::unique_ptr<Audio_Source> m_incoming;
+    std::future<Preroll_Result> m_preroll;
+
+    int m_fade_position;
+    int m_fade_length;
+    std::vector<float> m_fade_out;
+    std::vector<float> m_fade_in;
+    std::vector<float> m_outgoing_buffer;
+    std::vector<float> m_incoming_buffer;
+
+    uint64_t m_preroll_waits;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Crossfader(const std::vector<std::string>&, int, int, double);
+
+    void reset_quality(enum Resample_Quality);
+    Return_Status start();
+    int read(float *, int);
+
+    uint64_t get_preroll_waits();
+    std::string poll_error();
+
+    private:
+
+    void start_preroll();
+    Return_Status begin_crossfade(int);
+    void take_errors(Audio_Source &source);
+    void enqueue_error(const std::string &error);
+};
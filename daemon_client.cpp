@@ -0,0 +1,189 @@
+#include "daemon_client.h"
+
+extern "C"
+{
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <queue>
+
+
+
+
+/* Daemon_Client constructor
+ * @desc does not connect, see Daemon_Client::connect()
+ */
+Daemon_Client::Daemon_Client()
+{
+    m_socket = -1;
+}
+
+
+
+
+/* Daemon_Client destructor
+ * @desc closes the connection if there is one
+ */
+Daemon_Client::~Daemon_Client()
+{
+    disconnect();
+}
+
+
+
+
+/* Daemon_Client::connect() function
+ * @desc connects to the socket of a running daemon, closing any previous connection
+ * @param socket_path - the path the daemon listens on
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Daemon_Client::connect(const std::string &socket_path)
+{
+    disconnect();
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(socket_path.empty() || socket_path.size() >= sizeof(address.sun_path))
+    {
+        enqueue_error("Invalid socket path: " + socket_path);
+        return STATUS_FAILURE;
+    }
+
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(m_socket < 0)
+    {
+        enqueue_error("Failed to create socket: " + std::string{std::strerror(errno)});
+        return STATUS_FAILURE;
+    }
+
+    if(::connect(m_socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        enqueue_error("Failed to connect to " + socket_path + ": " + std::string{std::strerror(errno)});
+        disconnect();
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Daemon_Client::send_command() function
+ * @desc sends one command and waits for its reply
+ * @param command - the command line without the newline, EX: "PLAY /music/song.flac"
+ * @param reply - set to the reply line without the newline, it starts with "OK" or "ERR"
+ * @return Return_Status::STATUS_SUCCESS if a reply was received, Return_Status::STATUS_FAILURE if the connection failed
+ * @note an "ERR" reply is still a success, the daemon understood the command but could not carry it out
+ */
+Return_Status Daemon_Client::send_command(const std::string &command, std::string &reply)
+{
+    if(m_socket < 0)
+    {
+        enqueue_error("Not connected");
+        return STATUS_FAILURE;
+    }
+
+    std::string line = command + '\n';
+    for(std::size_t sent = 0; sent < line.size();)
+    {
+        ssize_t result = send(m_socket, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if(result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(result < 0)
+        {
+            enqueue_error("Failed to send command: " + std::string{std::strerror(errno)});
+            return STATUS_FAILURE;
+        }
+
+        sent += static_cast<std::size_t>(result);
+    }
+
+    std::size_t end = m_input.find('\n');
+    while(end == std::string::npos)
+    {
+        char buffer[1024];
+        ssize_t received = recv(m_socket, buffer, sizeof(buffer), 0);
+        if(received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(received <= 0)
+        {
+            enqueue_error(received == 0 ? std::string{"The daemon closed the connection"} :
+                                          "Failed to read reply: " + std::string{std::strerror(errno)});
+            return STATUS_FAILURE;
+        }
+
+        m_input.append(buffer, static_cast<std::size_t>(received));
+        end = m_input.find('\n');
+    }
+
+    reply = m_input.substr(0, end);
+    m_input.erase(0, end + 1);
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Daemon_Client::disconnect() function
+ * @desc closes the connection, does nothing if not connected
+ */
+void Daemon_Client::disconnect()
+{
+    if(m_socket >= 0)
+    {
+        close(m_socket);
+        m_socket = -1;
+    }
+
+    m_input.clear();
+}
+
+
+
+
+/* Daemon_Client::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Daemon_Client::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Daemon_Client::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @note this function is under the private specifier
+ */
+void Daemon_Client::enqueue_error(const std::string &error)
+{
+    m_errors.push(error);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <queue>
+#include <string>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Daemon_Client Class
+ * @desc Sends commands to a Player_Daemon over its Unix domain socket and reads the replies, see player_daemon.h
+ * @member m_socket - the connected socket, -1 if not connected
+ * @member m_input - received bytes not yet ending in a newline
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see daemon_client.cpp for comments on functions
+ */
+class Daemon_Client
+{
+    int m_socket;
+    std::string m_input;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Daemon_Client();
+    ~Daemon_Client();
+
+    Return_Status connect(const std::string&);
+    Return_Status send_command(const std::string&, std::string&);
+    void disconnect();
+
+    std::string poll_error();
+
+    private:
+
+    void enqueue_error(const std::string &error);
+};
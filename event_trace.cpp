@@ -0,0 +1,373 @@
+#include "event_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    /* Trace_Event Struct
+     * @desc one recorded event
+     * @member name - the name of the event, a string literal
+     * @member timestamp - when it happened, steady clock nanoseconds
+     * @member phase - 'B' for a begin event, 'E' for an end event, as in the Chrome trace format
+     */
+    struct Trace_Event
+    {
+        const char *name;
+        int64_t timestamp;
+        char phase;
+    };
+
+    /* Trace_Buffer Struct
+     * @desc the events of one thread, only that thread writes them, trace_write() reads up to count
+     * @member events - capacity events, the first count are recorded
+     * @member capacity - the most events the buffer holds
+     * @member count - the number of events recorded, stored with release after each event is written
+     * @member dropped - the number of events dropped as the buffer was full
+     * @member thread_id - the kernel thread id, as tools like perf show it
+     * @member name - the name of the thread, guarded by names_mutex
+     * @member next - the buffer registered before this one
+     */
+    struct Trace_Buffer
+    {
+        std::unique_ptr<Trace_Event[]> events;
+        std::size_t capacity;
+        std::atomic<std::size_t> count{0};
+        std::atomic<uint64_t> dropped{0};
+        long thread_id;
+        std::string name;
+        Trace_Buffer *next;
+    };
+
+    std::atomic<bool> enabled{false};
+    std::atomic<std::size_t> buffer_capacity{0};
+    std::atomic<int64_t> origin{0};
+
+    // buffers are pushed onto this list and never freed, a thread may still record while the process exits
+    std::atomic<Trace_Buffer *> buffers{nullptr};
+    std::mutex names_mutex;
+
+    thread_local Trace_Buffer *thread_buffer = nullptr;
+
+    /* now() function
+     * @return the steady clock in nanoseconds
+     */
+    int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /* get_thread_buffer() function
+     * @desc allocates and registers the buffer of the calling thread the first time it is called on it
+     * @return the buffer, nullptr if it could not be allocated
+     */
+    Trace_Buffer *get_thread_buffer()
+    {
+        if(thread_buffer)
+        {
+            return thread_buffer;
+        }
+
+        std::size_t capacity = buffer_capacity.load(std::memory_order_acquire);
+
+        // the events are left uninitialized, their pages are only touched as they are recorded
+        Trace_Buffer *buffer = new (std::nothrow) Trace_Buffer;
+        Trace_Event *events = buffer ? new (std::nothrow) Trace_Event[capacity] : nullptr;
+        if(!events)
+        {
+            delete buffer;
+            return nullptr;
+        }
+
+        buffer->events.reset(events);
+        buffer->capacity = capacity;
+        buffer->thread_id = syscall(SYS_gettid);
+        buffer->name = "thread " + std::to_string(buffer->thread_id);
+
+        buffer->next = buffers.load(std::memory_order_relaxed);
+        while(!buffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+
+        thread_buffer = buffer;
+        return buffer;
+    }
+
+    /* record() function
+     * @desc appends an event to the buffer of the calling thread, or counts it as dropped if the buffer is full
+     */
+    void record(const char *name, char phase)
+    {
+        Trace_Buffer *buffer = get_thread_buffer();
+        if(!buffer)
+        {
+            return;
+        }
+
+        std::size_t count = buffer->count.load(std::memory_order_relaxed);
+        if(count >= buffer->capacity)
+        {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buffer->events[count] = Trace_Event{name, now(), phase};
+        buffer->count.store(count + 1, std::memory_order_release);
+    }
+
+    /* write_json_string() function
+     * @desc writes text as a quoted JSON string
+     */
+    void write_json_string(std::ostream &out, const std::string &text)
+    {
+        out << '"';
+        for(unsigned char c : text)
+        {
+            if(c == '"' || c == '\\')
+            {
+                out << '\\' << c;
+            }
+            else if(c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            }
+            else
+            {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+}
+
+
+
+
+/* trace_start() function
+ * @desc turns tracing on, the timestamps of the trace count from the first call
+ * @param events_per_thread - the most events a thread records, 24 bytes each, set by the first call only
+ */
+void trace_start(std::size_t events_per_thread)
+{
+    std::size_t unset = 0;
+    if(buffer_capacity.compare_exchange_strong(unset, events_per_thread, std::memory_order_acq_rel))
+    {
+        origin.store(now(), std::memory_order_relaxed);
+    }
+
+    enabled.store(true, std::memory_order_release);
+}
+
+
+
+
+/* trace_stop() function
+ * @desc turns tracing off, what was recorded is kept for trace_write()
+ */
+void trace_stop()
+{
+    enabled.store(false, std::memory_order_release);
+}
+
+
+
+
+/* trace_enabled() function
+ * @return true between trace_start() and trace_stop()
+ */
+bool trace_enabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* trace_name_thread() function
+ * @desc names the calling thread in the trace, EX: "output", threads not named are shown with their thread id
+ * @param name - the name
+ * @note it allocates the buffer of the thread if tracing is on, call it where a thread starts rather than in a real time loop
+ */
+void trace_name_thread(const std::string &name)
+{
+    if(!enabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    Trace_Buffer *buffer = get_thread_buffer();
+    if(buffer)
+    {
+        std::lock_guard<std::mutex> lock{names_mutex};
+        buffer->name = name;
+    }
+}
+
+
+
+
+/* trace_begin() function
+ * @desc records that something began on the calling thread, end it with trace_end() on the same thread
+ * @param name - the name of the event, a string literal
+ */
+void trace_begin(const char *name)
+{
+    if(enabled.load(std::memory_order_relaxed))
+    {
+        record(name, 'B');
+    }
+}
+
+
+
+
+/* trace_end() function
+ * @desc records the end of what the last trace_begin() on the calling thread began
+ * @param name - the name of the event, the same as given to trace_begin()
+ */
+void trace_end(const char *name)
+{
+    if(enabled.load(std::memory_order_relaxed))
+    {
+        record(name, 'E');
+    }
+}
+
+
+
+
+/* trace_recorded_events() function
+ * @return the number of events recorded on all threads
+ */
+uint64_t trace_recorded_events()
+{
+    uint64_t events = 0;
+    for(Trace_Buffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+    {
+        events += buffer->count.load(std::memory_order_acquire);
+    }
+
+    return events;
+}
+
+
+
+
+/* trace_dropped_events() function
+ * @return the number of events dropped on all threads as their buffers were full
+ */
+uint64_t trace_dropped_events()
+{
+    uint64_t events = 0;
+    for(Trace_Buffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+    {
+        events += buffer->dropped.load(std::memory_order_relaxed);
+    }
+
+    return events;
+}
+
+
+
+
+/* trace_write() function
+ * @desc writes the events recorded so far to a Chrome trace file, a JSON object with a "traceEvents" array,
+ * @desc EX: {"name":"av_read_frame","ph":"B","ts":1520.250,"pid":4242,"tid":4243}, timestamps are in microseconds
+ * @param path - the file to write
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the file could not be written
+ * @note threads may go on recording while it runs, their events after the ones it read are left out
+ */
+Return_Status trace_write(const std::string &path, std::string &error)
+{
+    std::ofstream out{path};
+    if(!out)
+    {
+        error = "Failed to create " + path;
+        return STATUS_FAILURE;
+    }
+
+    long process_id = static_cast<long>(getpid());
+    int64_t start = origin.load(std::memory_order_relaxed);
+    bool first = true;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << std::fixed << std::setprecision(3);
+
+    for(Trace_Buffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next)
+    {
+        std::size_t count = buffer->count.load(std::memory_order_acquire);
+
+        out << (first ? "\n" : ",\n");
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << process_id << ",\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":";
+        {
+            std::lock_guard<std::mutex> lock{names_mutex};
+            write_json_string(out, buffer->name);
+        }
+        out << "}}";
+        first = false;
+
+        for(std::size_t i = 0; i < count; i++)
+        {
+            const Trace_Event &event = buffer->events[i];
+
+            out << ",\n{\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"ph\":\"" << event.phase << "\",\"ts\":" << (event.timestamp - start) / 1000.0 << ",\"pid\":" << process_id
+                << ",\"tid\":" << buffer->thread_id << '}';
+        }
+    }
+
+    out << "\n]}\n";
+
+    if(!out.flush())
+    {
+        error = "Failed to write " + path;
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Trace_Scope constructor
+ * @desc records the begin event if tracing is on
+ * @param name - the name of the event, a string literal
+ */
+Trace_Scope::Trace_Scope(const char *name) :
+    m_name{name}
+{
+    m_active = enabled.load(std::memory_order_relaxed);
+    if(m_active)
+    {
+        record(m_name, 'B');
+    }
+}
+
+
+
+
+/* Trace_Scope destructor
+ * @desc records the end event if the begin event was recorded
+ */
+Trace_Scope::~Trace_Scope()
+{
+    if(m_active)
+    {
+        record(m_name, 'E');
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+// Timeline tracing of the playback pipeline, written out as a Chrome / Perfetto trace.
+//
+// trace_start() turns tracing on. Every thread then records begin and end events into a buffer of its own, allocated the first
+// time the thread records or names itself. Recording an event is a clock read and a store into that buffer, no lock is taken and
+// nothing is allocated, so the real time output thread can record too. A full buffer drops the events that follow, they are
+// counted by trace_dropped_events(). While tracing is off every call is a single relaxed atomic load.
+// trace_write() writes the events recorded so far as JSON that chrome://tracing and ui.perfetto.dev open.
+// Event names are kept by pointer and must outlive the trace, use string literals.
+
+void trace_start(std::size_t);
+void trace_stop();
+bool trace_enabled();
+
+void trace_name_thread(const std::string&);
+void trace_begin(const char *);
+void trace_end(const char *);
+
+uint64_t trace_recorded_events();
+uint64_t trace_dropped_events();
+Return_Status trace_write(const std::string&, std::string&);
+
+/* Trace_Scope Class
+ * @desc Records a begin event when created and the matching end event when destroyed, EX: Trace_Scope scope{"av_read_frame"};
+ * @desc A scope created while tracing is off records nothing, also not its end if tracing is turned on meanwhile.
+ * @member m_name - the name of the event, a string literal
+ * @member m_active - true if the begin event was recorded
+ * @note see event_trace.cpp for comments on functions
+ */
+class Trace_Scope
+{
+    const char *m_name;
+    bool m_active;
+
+    public:
+
+    explicit Trace_Scope(const char *);
+    ~Trace_Scope();
+
+    Trace_Scope(const Trace_Scope&) = delete;
+    Trace_Scope &operator=(const Trace_Scope&) = delete;
+};
@@ -1,5 +1,6 @@
 
 #include "ffmpeg_decoder.h"
+#include "event_trace.h"
 
 extern "C"
 {
@@ -7,9 +8,15 @@ extern "C"
 #include <libavutil/avutil.h>
 #include <libavcodec/avcodec.h>
 }
+#include <cstring>
 #include <string>
 #include <queue>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 
 // A LITTLE NOTE //
 //
@@ -22,6 +29,25 @@ extern "C"
 // NOTE END //
 
 
+// Limits used in streaming mode, see FFmpeg_Decoder::set_streaming()
+const int STREAMING_PROBE_SIZE = 256 * 1024;                   // bytes read to detect the format and stream parameters
+const int64_t STREAMING_ANALYZE_DURATION = AV_TIME_BASE;       // microseconds of packets analyzed for stream parameters
+const int STREAMING_IO_BUFFER_SIZE = 32 * 1024;                // bytes buffered between the file and the demuxer
+const unsigned int STREAMING_MAX_INDEX_SIZE = 1024 * 1024;     // bytes of seek index kept per stream by generic demuxers
+
+// Limits used when reading from a caller provided AVIOContext, EX: a pipe, see FFmpeg_Decoder::set_input()
+// Non seekable input can't be rewound, so probing reads as little as it can get away with
+const int INPUT_PROBE_SIZE = 32 * 1024;
+const int64_t INPUT_ANALYZE_DURATION = AV_TIME_BASE / 2;
+
+// How far before the target FFmpeg_Decoder::seek() starts decoding, in AV_TIME_BASE units. Codecs with overlapping
+// transforms (AAC, Vorbis, Opus) only decode correctly once they have seen the previous frame, this covers a few frames of each
+const int64_t SEEK_PREROLL = AV_TIME_BASE / 10;
+
+// Errors past this many are dropped oldest first, so a long run of broken packets can't grow the queue without bound
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+
 
 /* FFmpeg_Decoder Class constructor
  * @param filename, the file to be opened
@@ -33,8 +59,16 @@ FFmpeg_Decoder::FFmpeg_Decoder(const std::string& filename, enum AVMediaType med
 {
     m_fmt_ctx = nullptr;
     m_codec_ctx = nullptr;
+    m_codec_params = nullptr;
     m_packet = nullptr;
     m_frame = nullptr;
+    m_stream_number = -1;
+    m_end_of_file = false;
+    m_seek_target = AV_NOPTS_VALUE;
+    m_streaming = false;
+    m_io_ctx = nullptr;
+    m_file_descriptor = -1;
+    m_input_io_ctx = nullptr;
 }
 
 
@@ -65,6 +99,8 @@ FFmpeg_Decoder::~FFmpeg_Decoder()
 
 /* FFmpeg_Decoder::open_file function
  * @desc Opens the file passed to the constructor, m_filename, and initializes m_format_ctx
+ * @desc In streaming mode the file is read through a fixed size buffer and probing is capped, see FFmpeg_Decoder::set_streaming()
+ * @desc If an input was set with FFmpeg_Decoder::set_input() it is read instead of the file, with minimal probing
  * @return Return_Status::STATUS_SUCCESS on successful execution, and Return_Status::STATUS_FAILURE on failure
  */
 Return_Status FFmpeg_Decoder::open_file()
@@ -79,6 +115,33 @@ Return_Status FFmpeg_Decoder::open_file()
         return STATUS_FAILURE;
     }
 
+    if(m_input_io_ctx)
+    {
+        m_fmt_ctx->pb = m_input_io_ctx;
+        m_fmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+        m_fmt_ctx->probesize = INPUT_PROBE_SIZE;
+        m_fmt_ctx->format_probesize = INPUT_PROBE_SIZE;
+        m_fmt_ctx->max_analyze_duration = INPUT_ANALYZE_DURATION;
+    }
+
+    else if(m_streaming)
+    {
+        if(open_streaming_io() == STATUS_FAILURE)
+        {
+            return STATUS_FAILURE;
+        }
+
+        m_fmt_ctx->pb = m_io_ctx;
+        m_fmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+        // the packets read while probing are queued for decoding, so capping the probe also caps that queue
+        m_fmt_ctx->probesize = STREAMING_PROBE_SIZE;
+        m_fmt_ctx->format_probesize = STREAMING_PROBE_SIZE;
+        m_fmt_ctx->max_analyze_duration = STREAMING_ANALYZE_DURATION;
+        m_fmt_ctx->max_index_size = STREAMING_MAX_INDEX_SIZE;
+    }
+
     error = avformat_open_input(&m_fmt_ctx, m_filename.c_str(), nullptr, nullptr);
     if(error < 0)
     {
@@ -88,13 +151,18 @@ Return_Status FFmpeg_Decoder::open_file()
         return STATUS_FAILURE;
     }
 
-    error = avformat_find_stream_info(m_fmt_ctx, nullptr);
-    if(error < 0)
+    // formats with a header describing the stream, like wav and flac, need no packets analyzed,
+    // which spares a slow producer on the other end of a pipe
+    if(!m_input_io_ctx || !stream_parameters_known())
     {
-        // failed to read stream info
-        enqueue_error("Failed to read stream info");
-        enqueue_error(error);
-        return STATUS_FAILURE;
+        error = avformat_find_stream_info(m_fmt_ctx, nullptr);
+        if(error < 0)
+        {
+            // failed to read stream info
+            enqueue_error("Failed to read stream info");
+            enqueue_error(error);
+            return STATUS_FAILURE;
+        }
     }
 
     error = av_find_best_stream(m_fmt_ctx, m_media_type, -1, -1, nullptr, 0);
@@ -108,6 +176,34 @@ Return_Status FFmpeg_Decoder::open_file()
 
     m_stream_number = error;
 
+    // FFmpeg_Decoder::init() works from a copy, a packet read on another thread may update the stream's own parameters
+    m_codec_params = avcodec_parameters_alloc();
+    if(!m_codec_params)
+    {
+        // failed to allocate codec parameters
+        enqueue_error("Failed to allocate AVCodecParameters");
+        return STATUS_FAILURE;
+    }
+
+    error = avcodec_parameters_copy(m_codec_params, m_fmt_ctx->streams[m_stream_number]->codecpar);
+    if(error < 0)
+    {
+        // failed to copy the codec parameters
+        enqueue_error("Failed to copy the AVStream codec parameters");
+        enqueue_error(error);
+        return STATUS_FAILURE;
+    }
+
+    // the packet is allocated here rather than in FFmpeg_Decoder::init() so that
+    // FFmpeg_Decoder::prefetch_packet() can run while the codec is being initialized
+    m_packet = av_packet_alloc();
+    if(!m_packet)
+    {
+        // failed to allocate packet
+        enqueue_error("Failed to allocate packet");
+        return STATUS_FAILURE;
+    }
+
     return STATUS_SUCCESS;
 }
 
@@ -118,14 +214,31 @@ Return_Status FFmpeg_Decoder::open_file()
  * @note This function must only be called after FFmpeg_Decoder::open_file() has been called.
  * @desc This function allocates, and initializes m_codec_ctx for decoding.
  * @return Return_Status::STATUS_SUCCESS on successful execution, and Return_Status::STATUS_FAILURE on failure
+ * @note It only reads m_codec_params, not the format context, so FFmpeg_Decoder::prefetch_packet() may run meanwhile.
+ * @note A codec context kept by FFmpeg_Decoder::reset_file() is flushed and reused if the new stream has the same codec and parameters.
  */
 Return_Status FFmpeg_Decoder::init()
 {
     int error = 0;
-    
-    AVStream *stream = m_fmt_ctx->streams[m_stream_number];
 
-    AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if(!m_codec_params)
+    {
+        enqueue_error("No stream opened");
+        return STATUS_FAILURE;
+    }
+
+    if(m_codec_ctx)
+    {
+        if(codec_matches())
+        {
+            avcodec_flush_buffers(m_codec_ctx);
+            return STATUS_SUCCESS;
+        }
+
+        avcodec_free_context(&m_codec_ctx);
+    }
+
+    AVCodec *codec = avcodec_find_decoder(m_codec_params->codec_id);
     if(!codec)
     {
         // failed to find a codec
@@ -141,7 +254,7 @@ Return_Status FFmpeg_Decoder::init()
         return STATUS_FAILURE;
     }
 
-    error = avcodec_parameters_to_context(m_codec_ctx, stream->codecpar);
+    error = avcodec_parameters_to_context(m_codec_ctx, m_codec_params);
     if(error < 0)
     {
         // failed to fill codec context with extra paramters, potentially needed for future operations
@@ -159,15 +272,11 @@ Return_Status FFmpeg_Decoder::init()
         return STATUS_FAILURE;
     }
 
-    m_packet = av_packet_alloc();
-    if(!m_packet)
+    if(!m_frame)
     {
-        // failed to allocate packet
-        enqueue_error("Failed to allocate packet");
-        return STATUS_FAILURE;
+        m_frame = av_frame_alloc();
     }
 
-    m_frame = av_frame_alloc();
     if(!m_frame)
     {
         // failed to allocate frame
@@ -181,6 +290,43 @@ Return_Status FFmpeg_Decoder::init()
 
 
 
+/* FFmpeg_Decoder::prefetch_packet() function, reads the first packet of the decoded stream
+ * @desc Reads packets until one belonging to the decoded stream is found and keeps it for FFmpeg_Decoder::decode_frame()
+ * @return Return_Status::STATUS_SUCCESS if a packet is held, Return_Status::STATUS_FAILURE otherwise
+ * @note This function must only be called after FFmpeg_Decoder::open_file() and before the first FFmpeg_Decoder::decode_frame().
+ * @note It does not touch the codec context or m_codec_params, so it may run on another thread while FFmpeg_Decoder::init() runs.
+ * @note Nothing else may use the format context until it returns, EX: FFmpeg_Decoder::get_stream().
+ * @note It does not enqueue errors, on failure the read is simply retried by FFmpeg_Decoder::decode_frame() which reports it.
+ */
+Return_Status FFmpeg_Decoder::prefetch_packet()
+{
+    if(!m_fmt_ctx || !m_packet)
+    {
+        return STATUS_FAILURE;
+    }
+
+    while(!m_packet->data)
+    {
+        trace_begin("av_read_frame");
+        int error = av_read_frame(m_fmt_ctx, m_packet);
+        trace_end("av_read_frame");
+        if(error < 0)
+        {
+            return STATUS_FAILURE;
+        }
+
+        if(m_packet->stream_index != m_stream_number)
+        {
+            av_packet_unref(m_packet);
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
 /* FFmpeg_Decoder::drain() function, drains the decoder
  * @return Return_Status::STATUS_SUCCESS on successful drain and
  * @return Return_Status::STATUS_FAILURE on an unsuccessful drain.
@@ -229,6 +375,32 @@ Return_Status FFmpeg_Decoder::drain()
  * @note FFmpeg_Decoder::init() must be called again before the decoder is used.
  */
 void FFmpeg_Decoder::reset(const std::string &filename, enum AVMediaType media_type)
+{
+    reset_file(filename);
+
+    if(m_frame)
+    {
+        av_frame_free(&m_frame);
+    }
+
+    if(m_codec_ctx)
+    {
+        avcodec_free_context(&m_codec_ctx);
+    }
+
+    m_media_type = media_type;
+}
+
+
+
+
+/* FFmpeg_Decoder::reset_file() function
+ * @desc closes the opened file like FFmpeg_Decoder::reset() but keeps the codec context and the frame, EX: for a player
+ * @desc going from track to track, a next file with the same codec and parameters then decodes without opening a codec
+ * @param filename, the file to be opened next, the media type stays
+ * @note FFmpeg_Decoder::open_file() and FFmpeg_Decoder::init() must be called again before the decoder is used.
+ */
+void FFmpeg_Decoder::reset_file(const std::string &filename)
 {
     if(m_fmt_ctx)
     {
@@ -240,29 +412,185 @@ void FFmpeg_Decoder::reset(const std::string &filename, enum AVMediaType media_t
     {
         av_packet_unref(m_packet);
         av_packet_free(&m_packet);
-        av_frame_unref(m_frame);
     }
-    
+
     if(m_frame)
     {
         av_frame_unref(m_frame);
-        av_frame_free(&m_frame);
     }
 
-    if(m_codec_ctx)
+    if(m_codec_params)
     {
-        avcodec_free_context(&m_codec_ctx);
+        avcodec_parameters_free(&m_codec_params);
+    }
+
+    if(m_io_ctx)
+    {
+        // the demuxer may have replaced the buffer while probing, so free the one the context holds now
+        av_freep(&m_io_ctx->buffer);
+        avio_context_free(&m_io_ctx);
+    }
+
+    if(m_file_descriptor >= 0)
+    {
+        close(m_file_descriptor);
+        m_file_descriptor = -1;
     }
 
     m_filename = filename;
-    m_media_type = media_type;
 
+    m_input_io_ctx = nullptr;
     m_fmt_ctx = nullptr;
-    m_codec_ctx = nullptr;
     m_packet = nullptr;
-    m_frame = nullptr;
     m_stream_number = -1;
     m_end_of_file = false;
+    m_seek_target = AV_NOPTS_VALUE;
+}
+
+
+
+
+/* FFmpeg_Decoder::codec_matches() function
+ * @return true if m_codec_ctx was opened for a stream with the codec and parameters in m_codec_params
+ * @note this function is under the private specifier
+ */
+bool FFmpeg_Decoder::codec_matches()
+{
+    return m_codec_ctx->codec_id == m_codec_params->codec_id &&
+           m_codec_ctx->sample_rate == m_codec_params->sample_rate &&
+           m_codec_ctx->channels == m_codec_params->channels &&
+           m_codec_ctx->channel_layout == m_codec_params->channel_layout &&
+           m_codec_ctx->block_align == m_codec_params->block_align &&
+           m_codec_ctx->bits_per_coded_sample == m_codec_params->bits_per_coded_sample &&
+           m_codec_ctx->extradata_size == m_codec_params->extradata_size &&
+           (m_codec_ctx->extradata_size == 0 ||
+            std::memcmp(m_codec_ctx->extradata, m_codec_params->extradata, m_codec_ctx->extradata_size) == 0);
+}
+
+
+
+
+/* FFmpeg_Decoder::set_streaming() function
+ * @desc enables or disables streaming mode, for very long files like multi hour audiobooks where memory use has to stay predictable
+ * @desc In streaming mode the file is read through a single 32 KiB buffer, probing stops after 256 KiB or 1 second of packets,
+ * @desc which also bounds the packets queued while probing, and generic demuxers keep at most 1 MiB of seek index per stream
+ * @param streaming - true to enable streaming mode
+ * @note This must be called before FFmpeg_Decoder::open_file(), it stays set across FFmpeg_Decoder::reset()
+ * @note Formats that need a complete sample table, like m4b and mp4, still load it when the file is opened,
+ * @note its size grows with the length of the file but it does not grow during playback
+ */
+void FFmpeg_Decoder::set_streaming(bool streaming)
+{
+    m_streaming = streaming;
+}
+
+
+
+
+/* FFmpeg_Decoder::set_input() function
+ * @desc reads from the given AVIOContext instead of opening m_filename, m_filename is then only used as a name,
+ * @desc EX: the AVIOContext of a Pipe_Input to decode from stdin
+ * @param io_ctx - the input, owned by the caller, it must outlive the decoder or the next FFmpeg_Decoder::reset()
+ * @note This must be called before FFmpeg_Decoder::open_file(), FFmpeg_Decoder::reset() clears it
+ * @note If the format's header describes the stream no packets are analyzed before decoding starts
+ */
+void FFmpeg_Decoder::set_input(AVIOContext *io_ctx)
+{
+    m_input_io_ctx = io_ctx;
+}
+
+
+
+
+/* FFmpeg_Decoder::seek() function, seeks to a timestamp
+ * @desc Uses the demuxer's index to jump to a point shortly before the timestamp, then decodes from there and discards
+ * @desc the samples before it, so the next frame returned by FFmpeg_Decoder::decode_frame() starts exactly at the timestamp
+ * @param timestamp, the position to seek to in AV_TIME_BASE units (microseconds) on the file's timeline, EX: Chapter::start
+ * @return Return_Status::STATUS_SUCCESS on success and Return_Status::STATUS_FAILURE on failure
+ * @note This function must only be called after FFmpeg_Decoder::init()
+ */
+Return_Status FFmpeg_Decoder::seek(int64_t timestamp)
+{
+    if(!m_fmt_ctx || !m_codec_ctx)
+    {
+        enqueue_error("Decoder not initialized");
+        return STATUS_FAILURE;
+    }
+
+    AVStream *stream = m_fmt_ctx->streams[m_stream_number];
+    int64_t target = av_rescale_q(timestamp, AVRational{1, AV_TIME_BASE}, stream->time_base);
+    int64_t position = av_rescale_q(timestamp - SEEK_PREROLL, AVRational{1, AV_TIME_BASE}, stream->time_base);
+
+    if(stream->start_time != AV_NOPTS_VALUE && position < stream->start_time)
+    {
+        position = stream->start_time;
+    }
+
+    // land on the last index entry at or before position
+    int error = avformat_seek_file(m_fmt_ctx, m_stream_number, INT64_MIN, position, position, 0);
+    if(error < 0)
+    {
+        enqueue_error("Failed to seek");
+        enqueue_error(error);
+        return STATUS_FAILURE;
+    }
+
+    av_packet_unref(m_packet);
+    avcodec_flush_buffers(m_codec_ctx);
+
+    m_seek_target = target;
+    m_end_of_file = false;
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Decoder::seek_chapter() function, seeks to the start of a chapter
+ * @param chapter, the index of the chapter in the list returned by FFmpeg_Decoder::get_chapters()
+ * @return Return_Status::STATUS_SUCCESS on success and Return_Status::STATUS_FAILURE on failure
+ * @note This function must only be called after FFmpeg_Decoder::init()
+ */
+Return_Status FFmpeg_Decoder::seek_chapter(int chapter)
+{
+    if(!m_fmt_ctx || chapter < 0 || static_cast<unsigned int>(chapter) >= m_fmt_ctx->nb_chapters)
+    {
+        enqueue_error("No such chapter: " + std::to_string(chapter));
+        return STATUS_FAILURE;
+    }
+
+    AVChapter *found = m_fmt_ctx->chapters[chapter];
+    return seek(av_rescale_q(found->start, found->time_base, AVRational{1, AV_TIME_BASE}));
+}
+
+
+
+
+/* FFmpeg_Decoder::get_chapters() function
+ * @return the chapters of the opened file in file order, empty if it has none
+ * @note this function will return an empty list if FFmpeg_Decoder::open_file() hasn't been called.
+ */
+std::vector<Chapter> FFmpeg_Decoder::get_chapters()
+{
+    std::vector<Chapter> chapters;
+    if(!m_fmt_ctx)
+    {
+        return chapters;
+    }
+
+    for(unsigned int i = 0; i < m_fmt_ctx->nb_chapters; i++)
+    {
+        AVChapter *chapter = m_fmt_ctx->chapters[i];
+        AVDictionaryEntry *title = av_dict_get(chapter->metadata, "title", nullptr, 0);
+
+        chapters.push_back(Chapter{static_cast<int>(i),
+                                   av_rescale_q(chapter->start, chapter->time_base, AVRational{1, AV_TIME_BASE}),
+                                   av_rescale_q(chapter->end, chapter->time_base, AVRational{1, AV_TIME_BASE}),
+                                   title ? std::string{title->value} : std::string{}});
+    }
+
+    return chapters;
 }
 
 
@@ -278,42 +606,88 @@ void FFmpeg_Decoder::reset(const std::string &filename, enum AVMediaType media_t
  */
 AVFrame *FFmpeg_Decoder::decode_frame()
 {
-    Return_Status status = decoder_fill();
-    if(status == STATUS_FAILURE)
+    while(1)
     {
-        // failed to fill decoder with data
-        enqueue_error("Failed to fill decoder");
-        return nullptr;
-    }
+        Return_Status status = decoder_fill();
+        if(status == STATUS_FAILURE)
+        {
+            // failed to fill decoder with data
+            enqueue_error("Failed to fill decoder");
+            return nullptr;
+        }
 
-    int error = 0;
+        int error = 0;
 
-    av_frame_unref(m_frame);
+        av_frame_unref(m_frame);
 
-    error = avcodec_receive_frame(m_codec_ctx, m_frame);
-    if(error == AVERROR(EAGAIN))
-    {
-        // decoder needs more data
-        return nullptr;
+        trace_begin("avcodec_receive_frame");
+        error = avcodec_receive_frame(m_codec_ctx, m_frame);
+        trace_end("avcodec_receive_frame");
+        if(error == AVERROR(EAGAIN))
+        {
+            // decoder needs more data
+            return nullptr;
+        }
+
+        else if(error < 0)
+        {
+            // some error occurred
+            enqueue_error("Failed to receive frame from decoder");
+            enqueue_error(error);
+            return nullptr;
+        }
+
+        if(m_seek_target != AV_NOPTS_VALUE && !trim_to_seek_target())
+        {
+            // the whole frame is before the seek target, decode the next one
+            continue;
+        }
+
+        // check if frame channel layout is 0
+        // if it is we have to set it apropriately
+        // or there will be problems hard to decipher down the line
+        if(m_frame->channel_layout == 0)
+        {
+            m_frame->channel_layout = av_get_default_channel_layout(m_frame->channels);
+        }
+
+        return m_frame;
     }
+}
+
+
+
 
-    else if(error < 0)
+/* FFmpeg_Decoder::decode_frame() function, decodes a frame and moves it out of the decoder
+ * @desc Decodes like FFmpeg_Decoder::decode_frame(), then hands the frame's buffers over to the caller's frame with
+ * @desc av_frame_move_ref(), nothing is copied. The frame stays valid after later calls, so it can be queued or passed
+ * @desc to another thread, its buffers return to the decoder's buffer pool when it is released.
+ * @param frame - receives the frame, what it held is released first, an empty handle gets a newly allocated frame,
+ * @param frame - EX: a handle from Frame_Pool::acquire() to bound the frames in flight
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure or end of file
+ * @note TO CHECK if the end of the file has been reached call FFmepg_Decoder::end_of_file_reached()
+ */
+Return_Status FFmpeg_Decoder::decode_frame(Frame_Handle &frame)
+{
+    if(!frame)
     {
-        // some error occurred
-        enqueue_error("Failed to receive frame from decoder");
-        enqueue_error(error);
-        return nullptr;
+        frame = Frame_Handle::allocate();
+        if(!frame)
+        {
+            enqueue_error("Failed to allocate frame");
+            return STATUS_FAILURE;
+        }
     }
 
-    // check if frame channel layout is 0
-    // if it is we have to set it apropriately
-    // or there will be problems hard to decipher down the line
-    if(m_frame->channel_layout == 0)
+    av_frame_unref(frame.get());
+
+    if(!decode_frame())
     {
-        m_frame->channel_layout = av_get_default_channel_layout(m_frame->channels);
+        return STATUS_FAILURE;
     }
 
-    return m_frame;
+    av_frame_move_ref(frame.get(), m_frame);
+    return STATUS_SUCCESS;
 }
 
 
@@ -363,6 +737,25 @@ AVCodecContext *FFmpeg_Decoder::get_codec_context()
 
 
 
+/* FFmpeg_Decoder::get_stream() function
+ * @return the AVStream* being decoded
+ * @note this function will return nullptr if FFmpeg_Decoder::open_file() hasn't been called.
+ * @note The stream's codec parameters are known after FFmpeg_Decoder::open_file(),
+ * @note so they can be used to set up the output before the codec is initialized.
+ */
+AVStream *FFmpeg_Decoder::get_stream()
+{
+    if(!m_fmt_ctx || m_stream_number < 0)
+    {
+        return nullptr;
+    }
+
+    return m_fmt_ctx->streams[m_stream_number];
+}
+
+
+
+
 /* FFmpeg_Decoder::get_media_type() function
  * @return m_media_type, a enum AVMediaType
  */
@@ -396,6 +789,17 @@ bool FFmpeg_Decoder::end_of_file_reached()
 
 
 
+/* FFmpeg_Decoder::is_streaming() function
+ * @return m_streaming, true if streaming mode is enabled
+ */
+bool FFmpeg_Decoder::is_streaming()
+{
+    return m_streaming;
+}
+
+
+
+
 /* FFmpeg_Decoder::decoder_fill() function
  * @desc Fills the decoder with data, called in FFmpeg_Decoder::decode_frame()
  * @return Return_Status::STATUS_SUCCESS on success and Return_Status::STATUS_FAILURE on failure
@@ -404,6 +808,7 @@ bool FFmpeg_Decoder::end_of_file_reached()
  */
 Return_Status FFmpeg_Decoder::decoder_fill()
 {
+    Trace_Scope scope{"decoder_fill"};
     int error = 0;
 
 
@@ -412,7 +817,9 @@ Return_Status FFmpeg_Decoder::decoder_fill()
         if(!m_packet->data)
         {
             // packet is not referencing any data, so read some
+            trace_begin("av_read_frame");
             error = av_read_frame(m_fmt_ctx, m_packet);
+            trace_end("av_read_frame");
             if(error == AVERROR_EOF)
             {
                 // end of file reached
@@ -456,6 +863,204 @@ Return_Status FFmpeg_Decoder::decoder_fill()
 
 
 
+/* FFmpeg_Decoder::trim_to_seek_target() function
+ * @desc Drops the samples of m_frame that are before m_seek_target, clearing m_seek_target once it is reached
+ * @return false if the whole frame is before the target and has to be skipped, true if m_frame should be returned
+ * @note The samples are dropped by moving the data pointers forward, the buffers themselves are not touched
+ * @note NON public function
+ */
+bool FFmpeg_Decoder::trim_to_seek_target()
+{
+    AVRational time_base = m_fmt_ctx->streams[m_stream_number]->time_base;
+    int64_t pts = m_frame->best_effort_timestamp;
+
+    if(pts == AV_NOPTS_VALUE)
+    {
+        // nothing to measure against, settle for the frame the seek landed on
+        m_seek_target = AV_NOPTS_VALUE;
+        return true;
+    }
+
+    int64_t skip = av_rescale_q(m_seek_target - pts, time_base, AVRational{1, m_frame->sample_rate});
+    if(skip >= m_frame->nb_samples)
+    {
+        return false;
+    }
+
+    m_seek_target = AV_NOPTS_VALUE;
+
+    if(skip <= 0)
+    {
+        return true;
+    }
+
+    int planar = av_sample_fmt_is_planar(static_cast<enum AVSampleFormat>(m_frame->format));
+    int planes = planar ? m_frame->channels : 1;
+    int offset = static_cast<int>(skip) * av_get_bytes_per_sample(static_cast<enum AVSampleFormat>(m_frame->format)) * (planar ? 1 : m_frame->channels);
+
+    for(int i = 0; i < planes; i++)
+    {
+        m_frame->extended_data[i] += offset;
+    }
+
+    // extended_data points at data unless there are more planes than data has room for
+    if(m_frame->extended_data != m_frame->data)
+    {
+        for(int i = 0; i < planes && i < AV_NUM_DATA_POINTERS; i++)
+        {
+            m_frame->data[i] += offset;
+        }
+    }
+
+    m_frame->nb_samples -= static_cast<int>(skip);
+    m_frame->pts = pts + av_rescale_q(skip, AVRational{1, m_frame->sample_rate}, time_base);
+    m_frame->best_effort_timestamp = m_frame->pts;
+
+    return true;
+}
+
+
+
+
+/* FFmpeg_Decoder::stream_parameters_known() function
+ * @desc checks if the format header alone described the streams well enough to decode, without analyzing packets
+ * @return true if every stream has a codec and, for audio, a sample rate and channel count, the sample format is left to the codec
+ * @note NON public function
+ */
+bool FFmpeg_Decoder::stream_parameters_known()
+{
+    if(m_fmt_ctx->nb_streams == 0 || (m_fmt_ctx->ctx_flags & AVFMTCTX_NOHEADER))
+    {
+        return false;
+    }
+
+    for(unsigned int i = 0; i < m_fmt_ctx->nb_streams; i++)
+    {
+        AVCodecParameters *parameters = m_fmt_ctx->streams[i]->codecpar;
+
+        if(parameters->codec_id == AV_CODEC_ID_NONE)
+        {
+            return false;
+        }
+
+        if(parameters->codec_type == AVMEDIA_TYPE_AUDIO &&
+           (parameters->sample_rate <= 0 || parameters->channels <= 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+
+/* FFmpeg_Decoder::open_streaming_io() function
+ * @desc opens m_filename and creates m_io_ctx, an AVIOContext reading it through a buffer of STREAMING_IO_BUFFER_SIZE bytes
+ * @return Return_Status::STATUS_SUCCESS on success and Return_Status::STATUS_FAILURE on failure
+ * @note the file is read with read() rather than stdio so there is no second buffer behind the AVIOContext
+ * @note NON public function
+ */
+Return_Status FFmpeg_Decoder::open_streaming_io()
+{
+    m_file_descriptor = open(m_filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(m_file_descriptor < 0)
+    {
+        enqueue_error("Failed to open file");
+        enqueue_error(AVERROR(errno));
+        return STATUS_FAILURE;
+    }
+
+    uint8_t *buffer = static_cast<uint8_t*>(av_malloc(STREAMING_IO_BUFFER_SIZE));
+    if(!buffer)
+    {
+        enqueue_error("Failed to allocate IO buffer");
+        return STATUS_FAILURE;
+    }
+
+    m_io_ctx = avio_alloc_context(buffer, STREAMING_IO_BUFFER_SIZE, 0, this, &FFmpeg_Decoder::read_file, nullptr, &FFmpeg_Decoder::seek_file);
+    if(!m_io_ctx)
+    {
+        av_free(buffer);
+        enqueue_error("Failed to allocate AVIOContext");
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Decoder::read_file() function, AVIOContext read callback used in streaming mode
+ * @param opaque, the FFmpeg_Decoder
+ * @param buffer, where to put the data
+ * @param size, the most bytes to read
+ * @return the number of bytes read, AVERROR_EOF at the end of the file or a negative error code
+ * @note NON public function
+ */
+int FFmpeg_Decoder::read_file(void *opaque, uint8_t *buffer, int size)
+{
+    FFmpeg_Decoder *decoder = static_cast<FFmpeg_Decoder*>(opaque);
+
+    ssize_t result = 0;
+    do
+    {
+        result = read(decoder->m_file_descriptor, buffer, size);
+    }
+    while(result < 0 && errno == EINTR);
+
+    if(result < 0)
+    {
+        return AVERROR(errno);
+    }
+
+    else if(result == 0)
+    {
+        return AVERROR_EOF;
+    }
+
+    return static_cast<int>(result);
+}
+
+
+
+
+/* FFmpeg_Decoder::seek_file() function, AVIOContext seek callback used in streaming mode
+ * @param opaque, the FFmpeg_Decoder
+ * @param offset, the offset to seek to, interpreted according to whence
+ * @param whence, SEEK_SET, SEEK_CUR, SEEK_END or AVSEEK_SIZE to ask for the file size
+ * @return the new position, or the file size for AVSEEK_SIZE, a negative error code on failure
+ * @note NON public function
+ */
+int64_t FFmpeg_Decoder::seek_file(void *opaque, int64_t offset, int whence)
+{
+    FFmpeg_Decoder *decoder = static_cast<FFmpeg_Decoder*>(opaque);
+
+    if(whence == AVSEEK_SIZE)
+    {
+        struct stat file_status;
+        if(fstat(decoder->m_file_descriptor, &file_status) < 0)
+        {
+            return AVERROR(errno);
+        }
+
+        return file_status.st_size;
+    }
+
+    off_t position = lseek(decoder->m_file_descriptor, offset, whence & ~AVSEEK_FORCE);
+    if(position < 0)
+    {
+        return AVERROR(errno);
+    }
+
+    return position;
+}
+
+
+
+
 /* FFmpeg_Decoder::enqueue_error() function, enqueue an ffmpeg error message given an error code
  * @desc This function takes the passed error code and translates it into an FFmpeg error message
  * @desc which then gets pushed onto the m_errors queue.
@@ -485,6 +1090,11 @@ void FFmpeg_Decoder::enqueue_error(int error_code)
  */
 void FFmpeg_Decoder::enqueue_error(const std::string &message)
 {
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
     m_errors.push(message);
     return;
 }
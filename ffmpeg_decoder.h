@@ -6,8 +6,10 @@ extern "C"
 #include <libavutil/avutil.h>
 #include <libavcodec/avcodec.h>
 }
+#include "frame_handle.h"
 #include <string>
 #include <queue>
+#include <vector>
 
 
 #ifndef RETURN_STATUS
@@ -21,16 +23,37 @@ enum Return_Status
 
 // SEE "ffmpeg_decoder.cpp" for comments on functions //
 
+/* Chapter Struct
+ * @desc a chapter of the opened file, EX: a chapter of an m4b audiobook
+ * @member index - the position in the chapter list, as passed to FFmpeg_Decoder::seek_chapter()
+ * @member start - the start of the chapter in AV_TIME_BASE units (microseconds) on the file's timeline
+ * @member end - the end of the chapter in AV_TIME_BASE units
+ * @member title - the title of the chapter, empty if the file has none
+ */
+struct Chapter
+{
+    int index;
+    int64_t start;
+    int64_t end;
+    std::string title;
+};
+
 /* FFmpeg_Decoder Class
  * @member m_fmt_ctx, AVFormatContext* holds information about the opened file
  * @member m_codec_ctx, AVCodecContext* holds codec information for the decoder
  * @member m_stream_number, the stream number in AVFormatContext::streams[] that is being decoded
+ * @member m_codec_params, AVCodecParameters* a copy of the decoded stream's parameters taken by FFmpeg_Decoder::open_file()
  * @member m_packet, AVPacket* holds encoded data read from the opened file
  * @member m_frame, AVFrame* holds decoded data and information about it
  * @member m_media_type, enum AVMediaType to tell the program what media type is to be decoded
  * @member m_end_of_file, a boolean that keeps note if the end of the file was reached.
+ * @member m_seek_target, after a seek the pts in stream time base the next frame must start at, AV_NOPTS_VALUE otherwise
+ * @member m_streaming, if true the file is opened with bounded probing and IO buffering, see FFmpeg_Decoder::set_streaming()
+ * @member m_io_ctx, AVIOContext* reading m_file_descriptor in streaming mode, nullptr otherwise
+ * @member m_file_descriptor, the file read by m_io_ctx, -1 if not open
+ * @member m_input_io_ctx, AVIOContext* to read instead of m_filename, EX: a pipe, owned by the caller, see FFmpeg_Decoder::set_input()
  * @member m_filename, std::string that holds the filename
- * @member m_errors, std::queue<std::string>, a queue of std::strings holding error messages
+ * @member m_errors, std::queue<std::string>, a queue of std::strings holding error messages, the oldest are dropped past a limit
  * @note For information on class functions see "ffmpeg_decoder.cpp"
  */
 class FFmpeg_Decoder
@@ -38,11 +61,17 @@ class FFmpeg_Decoder
     AVFormatContext *m_fmt_ctx;
     AVCodecContext *m_codec_ctx;
     int m_stream_number;
+    AVCodecParameters *m_codec_params;
     AVPacket *m_packet;
     AVFrame *m_frame;
     enum AVMediaType m_media_type;
     bool m_end_of_file;
-    
+    int64_t m_seek_target;
+
+    bool m_streaming;
+    AVIOContext *m_io_ctx;
+    int m_file_descriptor;
+    AVIOContext *m_input_io_ctx;
 
     std::string m_filename;
     std::queue<std::string> m_errors;
@@ -55,22 +84,39 @@ class FFmpeg_Decoder
     
     Return_Status open_file();
     Return_Status init();
+    Return_Status prefetch_packet();
     Return_Status drain();
     void reset(const std::string&, enum AVMediaType);
+    void reset_file(const std::string&);
+    void set_streaming(bool);
+    void set_input(AVIOContext*);
+
+    Return_Status seek(int64_t);
+    Return_Status seek_chapter(int);
+    std::vector<Chapter> get_chapters();
 
     AVFrame *decode_frame();
+    Return_Status decode_frame(Frame_Handle&);
 
     std::string poll_error();
 
     AVFormatContext *get_format_context();
     AVCodecContext *get_codec_context();
+    AVStream *get_stream();
     enum AVMediaType get_media_type();
     std::string get_filename();
     bool end_of_file_reached();
+    bool is_streaming();
 
     private:
 
     Return_Status decoder_fill();
+    bool trim_to_seek_target();
+    bool stream_parameters_known();
+    bool codec_matches();
+    Return_Status open_streaming_io();
+    static int read_file(void*, uint8_t*, int);
+    static int64_t seek_file(void*, int64_t, int);
     void enqueue_error(int error_code);
     void enqueue_error(const std::string &message);
 };
@@ -1,15 +1,98 @@
 #include "ffmpeg_resampler.h"
+#include "event_trace.h"
 
 extern "C"
 {
 #include <libswresample/swresample.h>
 #include <libavutil/opt.h>
 #include <libavutil/avutil.h>
+#include <libavutil/buffer.h>
+#include <libavutil/samplefmt.h>
 }
 
 #include <string>
 #include <queue>
 
+// errors past this many are dropped oldest first
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+namespace
+{
+    /* Quality_Tier Struct
+     * @desc the swresample options of one Resample_Quality, every tier sets all of them so switching tiers leaves nothing behind
+     * @member engine - SWR_ENGINE_SWR or SWR_ENGINE_SOXR
+     * @member filter_size - the length of the filter for each phase
+     * @member phase_shift - log2 of the number of filter phases
+     * @member cutoff - the cutoff as a fraction of the Nyquist frequency, 0 leaves it to the engine
+     * @member precision - bits of precision, only used by soxr
+     */
+    struct Quality_Tier
+    {
+        enum Resample_Quality quality;
+        const char *name;
+        int64_t engine;
+        int64_t filter_size;
+        int64_t phase_shift;
+        double cutoff;
+        double precision;
+    };
+
+    // the default tier repeats swresample's defaults
+    const Quality_Tier QUALITY_TIERS[] =
+    {
+        {RESAMPLE_FAST, "fast", SWR_ENGINE_SWR, 8, 6, 0.85, 20},
+        {RESAMPLE_DEFAULT, "default", SWR_ENGINE_SWR, 32, 10, 0, 20},
+        {RESAMPLE_HIGH, "high", SWR_ENGINE_SWR, 64, 12, 0.985, 20},
+        {RESAMPLE_SOXR, "soxr", SWR_ENGINE_SOXR, 32, 10, 0, 28},
+    };
+}
+
+
+
+
+/* get_quality_name() function
+ * @param quality - a Resample_Quality
+ * @return the tier's name, EX: "high"
+ */
+const char *get_quality_name(enum Resample_Quality quality)
+{
+    for(const Quality_Tier &tier : QUALITY_TIERS)
+    {
+        if(tier.quality == quality)
+        {
+            return tier.name;
+        }
+    }
+
+    return "unknown";
+}
+
+
+
+
+/* find_resample_quality() function
+ * @desc looks up a tier by name, EX: for a command line option
+ * @param name - the tier's name, one of "fast", "default", "high" and "soxr"
+ * @param quality - set to the tier if it was found
+ * @return true if a tier has that name
+ */
+bool find_resample_quality(const std::string &name, enum Resample_Quality &quality)
+{
+    for(const Quality_Tier &tier : QUALITY_TIERS)
+    {
+        if(name == tier.name)
+        {
+            quality = tier.quality;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+
 /* FFmpeg_Frame_Resampler Constructror
  * @param out_channel_layout, the output channel layout
  * @param out_sample_format, the output sample format
@@ -34,15 +117,21 @@ FFmpeg_Frame_Resampler::FFmpeg_Frame_Resampler(int64_t out_channel_layout,
     m_in_sample_format{in_sample_format},
     m_in_sample_rate{in_sample_rate}
 {
+    m_quality = RESAMPLE_DEFAULT;
     m_swr_ctx = nullptr;
     m_frame = nullptr;
+    m_converter = nullptr;
+    m_channel_mapping = false;
+    m_mapped = false;
+    m_buffer_pool = nullptr;
+    m_pool_samples = 0;
 }
 
 
 
 
 /* FFmpeg_Frame_Resampler Destructor
- * @desc Frees m_swr_ctx if allocated, and unreferences and frees m_frame if allocated
+ * @desc Frees m_swr_ctx if allocated, unreferences and frees m_frame if allocated, and releases m_buffer_pool
  */
 FFmpeg_Frame_Resampler::~FFmpeg_Frame_Resampler()
 {
@@ -56,6 +145,9 @@ FFmpeg_Frame_Resampler::~FFmpeg_Frame_Resampler()
         av_frame_unref(m_frame);
         av_frame_free(&m_frame);
     }
+
+    // frames still holding a buffer keep the pool alive until they release it
+    av_buffer_pool_uninit(&m_buffer_pool);
 }
 
 
@@ -85,6 +177,11 @@ Return_Status FFmpeg_Frame_Resampler::init()
         return STATUS_FAILURE;
     }
 
+    if(apply_quality() == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
     error = swr_init(m_swr_ctx);
     if(error < 0)
     {
@@ -101,6 +198,8 @@ Return_Status FFmpeg_Frame_Resampler::init()
         return STATUS_FAILURE;
     }
 
+    select_converter();
+
     return STATUS_SUCCESS;
 }
 
@@ -192,6 +291,8 @@ Return_Status FFmpeg_Frame_Resampler::reset_options(int64_t out_channel_layout,
             enqueue_error(error);
             return STATUS_FAILURE;
         }
+
+        select_converter();
     }
     return STATUS_SUCCESS;
 }
@@ -250,6 +351,8 @@ Return_Status FFmpeg_Frame_Resampler::reset_channel_layout(bool out, int64_t new
             enqueue_error(error);
             return STATUS_FAILURE;
         }
+
+        select_converter();
     }
 
     return STATUS_SUCCESS;
@@ -309,6 +412,8 @@ Return_Status FFmpeg_Frame_Resampler::reset_sample_format(bool out, enum AVSampl
             enqueue_error(error);
             return STATUS_FAILURE;
         }
+
+        select_converter();
     }
 
     return STATUS_SUCCESS;
@@ -368,6 +473,73 @@ Return_Status FFmpeg_Frame_Resampler::reset_sample_rate(bool out, int new_sample
             enqueue_error(error);
             return STATUS_FAILURE;
         }
+
+        select_converter();
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::reset_channel_mapping() function
+ * @desc maps channels with a precomputed Channel_Mapper matrix instead of swresample's, the format is converted in the same pass
+ * @param enable, true to map with the Channel_Mapper, false to leave it to swresample again
+ * @param matrix, a custom matrix, one row per output channel of one gain per input channel, or empty for the ITU style
+ * @param matrix, downmix worked out from the in and out layouts, see Channel_Mapper::set_downmix()
+ * @note If called after FFmpeg_Frame_Resampler::init() it is not needed to reinitilze as the function does so automatically.
+ * @note The mapper is only used while the in and out sample rates match, a changing rate goes through swresample with its own matrix.
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the mapper could not be set up for the current options
+ */
+Return_Status FFmpeg_Frame_Resampler::reset_channel_mapping(bool enable, const std::vector<float> &matrix)
+{
+    m_channel_mapping = enable;
+    m_channel_matrix = matrix;
+
+    if(m_swr_ctx)
+    {
+        select_converter();
+
+        if(m_channel_mapping && !m_mapped && m_in_sample_rate == m_out_sample_rate && m_in_channel_layout != 0)
+        {
+            return STATUS_FAILURE;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::reset_quality() function
+ * @desc sets the resampling quality tier, see Resample_Quality
+ * @param quality, the tier
+ * @note If called after FFmpeg_Frame_Resampler::init() it is not needed to reinitilze as the function does so automatically.
+ * @note The tier only matters when the sample rate changes, converting formats or channels costs the same in every tier.
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, EX: soxr is not available
+ */
+Return_Status FFmpeg_Frame_Resampler::reset_quality(enum Resample_Quality quality)
+{
+    m_quality = quality;
+
+    if(m_swr_ctx)
+    {
+        if(apply_quality() == STATUS_FAILURE)
+        {
+            return STATUS_FAILURE;
+        }
+
+        int error = swr_init(m_swr_ctx);
+        if(error < 0)
+        {
+            enqueue_error("Failed to reinitialize SwrContext / Resampling context for " + std::string{get_quality_name(m_quality)} + " quality");
+            enqueue_error(error);
+            return STATUS_FAILURE;
+        }
+
+        select_converter();
     }
 
     return STATUS_SUCCESS;
@@ -376,12 +548,36 @@ Return_Status FFmpeg_Frame_Resampler::reset_sample_rate(bool out, int new_sample
 
 
 
+/* FFmpeg_Frame_Resampler::get_quality() function
+ * @return the resampling quality tier
+ */
+enum Resample_Quality FFmpeg_Frame_Resampler::get_quality()
+{
+    return m_quality;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::is_channel_mapped() function
+ * @return true if frames in the current input format are mapped by the Channel_Mapper rather than swresample
+ */
+bool FFmpeg_Frame_Resampler::is_channel_mapped()
+{
+    return m_mapped;
+}
+
+
+
+
 /* FFmepg_Frame_Resampler::resample_frame() function
  * @desc resamples a decoded audio frame to the set output options
  * @param source_frame, AVFrame* that holds decoded audio data
  * @return valid AVFrame* on success, nullptr on failure
  * @note the returned AVFrame* points to the same data as m_frame, and when this function is called again,
  * @note the previously returned pointer will be invalid.
+ * @note the frame must be in the input format of the options set, when the decoded format changes reset them first,
+ * @note EX: with FFmpeg_Frame_Resampler::reset_sample_format(false, format)
  */
 AVFrame *FFmpeg_Frame_Resampler::resample_frame(AVFrame *source_frame)
 {
@@ -391,6 +587,12 @@ AVFrame *FFmpeg_Frame_Resampler::resample_frame(AVFrame *source_frame)
         return nullptr;
     }
 
+    // select_converter() decided for the input options, frames in another format must reset them first
+    if((m_converter || m_mapped) && source_frame)
+    {
+        return convert_frame(source_frame);
+    }
+
     int error = 0;
 
     av_frame_unref(m_frame);
@@ -399,7 +601,16 @@ AVFrame *FFmpeg_Frame_Resampler::resample_frame(AVFrame *source_frame)
     m_frame->format = m_out_sample_format;
     m_frame->sample_rate = m_out_sample_rate;
 
+    // swresample writes into the buffer given, up to its nb_samples, instead of allocating one
+    int out_samples = swr_get_out_samples(m_swr_ctx, source_frame ? source_frame->nb_samples : 0);
+    if(out_samples > 0 && get_output_buffer(out_samples) == STATUS_FAILURE)
+    {
+        return nullptr;
+    }
+
+    trace_begin("swr_convert_frame");
     error = swr_convert_frame(m_swr_ctx, m_frame, source_frame);
+    trace_end("swr_convert_frame");
     if(error < 0)
     {
         enqueue_error("Failed to convert frame");
@@ -413,6 +624,342 @@ AVFrame *FFmpeg_Frame_Resampler::resample_frame(AVFrame *source_frame)
 
 
 
+/* FFmepg_Frame_Resampler::resample_frame() function
+ * @desc resamples like FFmpeg_Frame_Resampler::resample_frame(AVFrame*), then hands the resampled frame's buffers over
+ * @desc to the caller's frame with av_frame_move_ref(), nothing is copied and the frame stays valid after later calls
+ * @param source_frame, AVFrame* that holds decoded audio data
+ * @param frame, receives the resampled frame, what it held is released first, an empty handle gets a newly allocated frame
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status FFmpeg_Frame_Resampler::resample_frame(AVFrame *source_frame, Frame_Handle &frame)
+{
+    if(!frame)
+    {
+        frame = Frame_Handle::allocate();
+        if(!frame)
+        {
+            enqueue_error("Failed to allocate frame");
+            return STATUS_FAILURE;
+        }
+    }
+
+    av_frame_unref(frame.get());
+
+    if(!resample_frame(source_frame))
+    {
+        return STATUS_FAILURE;
+    }
+
+    av_frame_move_ref(frame.get(), m_frame);
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::flush() function
+ * @desc takes the samples swresample still holds back at the end of a stream, EX: the last filter delay when resampling
+ * @return valid AVFrame* on success, with 0 samples if nothing was held, nullptr on failure,
+ * @return with the same lifetime as FFmpeg_Frame_Resampler::resample_frame()
+ * @note the specialized converters and the channel mapper hold nothing back
+ */
+AVFrame *FFmpeg_Frame_Resampler::flush()
+{
+    if(!m_frame || !m_swr_ctx)
+    {
+        enqueue_error("Resampler not initialized");
+        return nullptr;
+    }
+
+    av_frame_unref(m_frame);
+
+    m_frame->channel_layout = m_out_channel_layout;
+    m_frame->format = m_out_sample_format;
+    m_frame->sample_rate = m_out_sample_rate;
+
+    int error = swr_convert_frame(m_swr_ctx, m_frame, nullptr);
+    if(error < 0)
+    {
+        enqueue_error("Failed to flush the resampler");
+        enqueue_error(error);
+        return nullptr;
+    }
+
+    return m_frame;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::flush() function
+ * @desc flushes like FFmpeg_Frame_Resampler::flush(), then hands the frame's buffers over to the caller's frame
+ * @desc with av_frame_move_ref(), see FFmpeg_Frame_Resampler::resample_frame(AVFrame*, Frame_Handle&)
+ * @param frame, receives the samples held back, with 0 samples if nothing was held, an empty handle gets a newly allocated frame
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status FFmpeg_Frame_Resampler::flush(Frame_Handle &frame)
+{
+    if(!frame)
+    {
+        frame = Frame_Handle::allocate();
+        if(!frame)
+        {
+            enqueue_error("Failed to allocate frame");
+            return STATUS_FAILURE;
+        }
+    }
+
+    av_frame_unref(frame.get());
+
+    if(!flush())
+    {
+        return STATUS_FAILURE;
+    }
+
+    av_frame_move_ref(frame.get(), m_frame);
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::clear() function
+ * @desc drops the samples swresample holds back, EX: after a seek, so they are not played before the new position
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note the options are kept, swr_init() only starts the context over
+ */
+Return_Status FFmpeg_Frame_Resampler::clear()
+{
+    if(!m_swr_ctx)
+    {
+        enqueue_error("Resampler not initialized");
+        return STATUS_FAILURE;
+    }
+
+    int error = swr_init(m_swr_ctx);
+    if(error < 0)
+    {
+        enqueue_error("Failed to reinitialize SwrContext / Resampling context");
+        enqueue_error(error);
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::apply_quality() function
+ * @desc sets the options of the m_quality tier on m_swr_ctx, they take effect at the next swr_init()
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note this function is under the private modifier
+ */
+Return_Status FFmpeg_Frame_Resampler::apply_quality()
+{
+    const Quality_Tier *tier = nullptr;
+    for(const Quality_Tier &candidate : QUALITY_TIERS)
+    {
+        if(candidate.quality == m_quality)
+        {
+            tier = &candidate;
+        }
+    }
+
+    if(!tier)
+    {
+        enqueue_error("Unknown resampling quality");
+        return STATUS_FAILURE;
+    }
+
+    int error = 0;
+    if((error = av_opt_set_int(m_swr_ctx, "resampler", tier->engine, 0)) < 0 ||
+       (error = av_opt_set_int(m_swr_ctx, "filter_size", tier->filter_size, 0)) < 0 ||
+       (error = av_opt_set_int(m_swr_ctx, "phase_shift", tier->phase_shift, 0)) < 0 ||
+       (error = av_opt_set_double(m_swr_ctx, "cutoff", tier->cutoff, 0)) < 0 ||
+       (error = av_opt_set_double(m_swr_ctx, "precision", tier->precision, 0)) < 0)
+    {
+        enqueue_error("Failed to set " + std::string{tier->name} + " resampling quality");
+        enqueue_error(error);
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::select_converter() function
+ * @desc picks the Channel_Mapper if channel mapping is enabled, or a specialized converter if the input and output only
+ * @desc differ in sample format, both only while the sample rate doesn't change
+ * @note called whenever the options change, so FFmpeg_Frame_Resampler::resample_frame() doesn't check the format of every frame
+ * @note if the mapper can't be set up its errors are queued and swresample is used
+ * @note this function is under the private modifier
+ */
+void FFmpeg_Frame_Resampler::select_converter()
+{
+    m_converter = nullptr;
+    m_mapped = false;
+
+    // the output format may have changed, the next frame makes a pool for it
+    av_buffer_pool_uninit(&m_buffer_pool);
+    m_pool_samples = 0;
+
+    if(m_in_sample_rate != m_out_sample_rate)
+    {
+        return;
+    }
+
+    // the matrix is worked out from the layouts, a stream without one is left to swresample
+    if(m_channel_mapping && m_in_channel_layout != 0 && m_out_channel_layout != 0)
+    {
+        Return_Status status = m_channel_matrix.empty() ? m_mapper.set_downmix(m_in_channel_layout, m_out_channel_layout, true)
+                                                        : m_mapper.set_matrix(m_in_channel_layout, m_out_channel_layout, m_channel_matrix);
+        if(status == STATUS_SUCCESS)
+        {
+            status = m_mapper.set_formats(m_in_sample_format, m_out_sample_format);
+        }
+
+        if(status == STATUS_SUCCESS)
+        {
+            m_mapped = true;
+            return;
+        }
+
+        for(std::string error = m_mapper.poll_error(); !error.empty(); error = m_mapper.poll_error())
+        {
+            enqueue_error(error);
+        }
+    }
+
+    if(m_in_channel_layout != m_out_channel_layout)
+    {
+        return;
+    }
+
+    m_converter = find_sample_converter(m_in_sample_format, m_out_sample_format,
+                                        av_get_channel_layout_nb_channels(m_out_channel_layout));
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::get_output_buffer() function
+ * @desc gives m_frame a buffer from m_buffer_pool for a number of samples in the output format, the pool is only made
+ * @desc again when a frame needs more samples than its buffers hold, so converting allocates nothing once it runs
+ * @param nb_samples, the number of samples, m_frame->nb_samples is set to it
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note m_frame must be unreferenced with its output format set, a frame with more planes than AVFrame::data holds
+ * @note gets its buffers from av_frame_get_buffer() instead
+ * @note this function is under the private modifier
+ */
+Return_Status FFmpeg_Frame_Resampler::get_output_buffer(int nb_samples)
+{
+    int channels = av_get_channel_layout_nb_channels(m_out_channel_layout);
+    int planes = av_sample_fmt_is_planar(m_out_sample_format) ? channels : 1;
+    int error = 0;
+
+    m_frame->nb_samples = nb_samples;
+
+    // an empty frame converts to an empty frame
+    if(nb_samples <= 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    if(planes > AV_NUM_DATA_POINTERS)
+    {
+        error = av_frame_get_buffer(m_frame, 0);
+        if(error < 0)
+        {
+            enqueue_error("Failed to allocate converted frame");
+            enqueue_error(error);
+            return STATUS_FAILURE;
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+    if(!m_buffer_pool || nb_samples > m_pool_samples)
+    {
+        av_buffer_pool_uninit(&m_buffer_pool);
+        m_pool_samples = 0;
+
+        int size = av_samples_get_buffer_size(nullptr, channels, nb_samples, m_out_sample_format, 0);
+        if(size < 0)
+        {
+            enqueue_error("Failed to size converted frame");
+            enqueue_error(size);
+            return STATUS_FAILURE;
+        }
+
+        m_buffer_pool = av_buffer_pool_init(size, nullptr);
+        if(!m_buffer_pool)
+        {
+            enqueue_error("Failed to allocate buffer pool");
+            return STATUS_FAILURE;
+        }
+        m_pool_samples = nb_samples;
+    }
+
+    m_frame->buf[0] = av_buffer_pool_get(m_buffer_pool);
+    if(!m_frame->buf[0])
+    {
+        enqueue_error("Failed to allocate converted frame");
+        return STATUS_FAILURE;
+    }
+
+    error = av_samples_fill_arrays(m_frame->data, m_frame->linesize, m_frame->buf[0]->data, channels, nb_samples, m_out_sample_format, 0);
+    if(error < 0)
+    {
+        enqueue_error("Failed to set up converted frame");
+        enqueue_error(error);
+        return STATUS_FAILURE;
+    }
+    m_frame->extended_data = m_frame->data;
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* FFmpeg_Frame_Resampler::convert_frame() function
+ * @desc converts a frame with m_mapper or m_converter instead of m_swr_ctx
+ * @param source_frame, AVFrame* in the input format the converter was selected for
+ * @return valid AVFrame* on success, nullptr on failure, with the same lifetime as FFmpeg_Frame_Resampler::resample_frame()
+ * @note this function is under the private modifier
+ */
+AVFrame *FFmpeg_Frame_Resampler::convert_frame(AVFrame *source_frame)
+{
+    av_frame_unref(m_frame);
+
+    m_frame->channel_layout = m_out_channel_layout;
+    m_frame->format = m_out_sample_format;
+    m_frame->sample_rate = m_out_sample_rate;
+
+    if(get_output_buffer(source_frame->nb_samples) == STATUS_FAILURE)
+    {
+        return nullptr;
+    }
+
+    if(m_mapped)
+    {
+        m_mapper.map(source_frame->extended_data, m_frame->extended_data, source_frame->nb_samples);
+    }
+    else
+    {
+        m_converter(source_frame->extended_data, m_frame->extended_data, source_frame->nb_samples);
+    }
+    m_frame->pts = source_frame->pts;
+
+    return m_frame;
+}
+
+
+
+
 /* FFmpeg_Frame_Resampler::poll_error() function
  * @desc polls an error message from m_errors and returns it
  * @return std::string error message, the string will be empty if there are no messages.
@@ -439,6 +986,12 @@ std::string FFmpeg_Frame_Resampler::poll_error()
  */
 void FFmpeg_Frame_Resampler::enqueue_error(const std::string &error)
 {
+    // drop the oldest error so a long run of failures can't grow the queue without bound
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
     m_errors.push(error);
 }
 
@@ -457,11 +1010,11 @@ void FFmpeg_Frame_Resampler::enqueue_error(int error_code)
 
     if(error < 0)
     {
-        m_errors.push("Unknown Error");
+        enqueue_error("Unknown Error");
     }
 
     else
     {
-        m_errors.push(std::string{buff});
+        enqueue_error(std::string{buff});
     }
 }
@@ -5,10 +5,16 @@ extern "C"
 #include <libswresample/swresample.h>
 #include <libavutil/opt.h>
 #include <libavutil/avutil.h>
+#include <libavutil/buffer.h>
 }
 
+#include "channel_mapper.h"
+#include "frame_handle.h"
+#include "sample_convert.h"
+
 #include <string>
 #include <queue>
+#include <vector>
 
 #ifndef RETURN_STATUS
 #define RETURN_STATUS
@@ -19,6 +25,24 @@ enum Return_Status
 };
 #endif
 
+/* Resample_Quality Enum
+ * @desc the resampling quality tiers, each trades filter length and cutoff for CPU, see FFmpeg_Frame_Resampler::reset_quality()
+ * @member RESAMPLE_FAST - a short filter with a lower cutoff, the least CPU, some aliasing and top octave loss
+ * @member RESAMPLE_DEFAULT - swresample's own defaults
+ * @member RESAMPLE_HIGH - a long Kaiser filter with a cutoff close to Nyquist, about twice the CPU of the default
+ * @member RESAMPLE_SOXR - the SoX resampler at very high precision, only if FFmpeg was built with libsoxr
+ */
+enum Resample_Quality
+{
+    RESAMPLE_FAST,
+    RESAMPLE_DEFAULT,
+    RESAMPLE_HIGH,
+    RESAMPLE_SOXR,
+};
+
+const char *get_quality_name(enum Resample_Quality);
+bool find_resample_quality(const std::string&, enum Resample_Quality&);
+
 /* FFmpeg_Frame_Resampler Class, resamples AVFrames into a given format
  * @note This Class only works with audio
  * @member m_swr_ctx, struct SwrContext* that is used for libswresample resampling functions
@@ -29,6 +53,14 @@ enum Return_Status
  * @member m_in_channel_layout, the input channel layout
  * @member m_in_sample_format, the input sample format
  * @member m_in_sample_rate the input sample rate
+ * @member m_quality, the resampling quality tier, applied to m_swr_ctx every time it is initialized
+ * @member m_converter, specialized converter used instead of m_swr_ctx when only the sample format changes, nullptr otherwise
+ * @member m_channel_mapping, true to map channels with m_mapper instead of swresample's matrix, see reset_channel_mapping()
+ * @member m_channel_matrix, the custom matrix for m_mapper, empty for the downmix worked out from the layouts
+ * @member m_mapper, precomputed channel matrix and format conversion used instead of m_swr_ctx when the sample rate doesn't change
+ * @member m_mapped, true if m_mapper is set up for the current options and used instead of m_swr_ctx
+ * @member m_buffer_pool, the buffers of the frames m_converter, m_mapper and m_swr_ctx write into, nullptr until the first frame
+ * @member m_pool_samples, the number of output samples a buffer of m_buffer_pool holds
  * @member m_errors, a std::queue<std::string> that holds error messages
  */
 class FFmpeg_Frame_Resampler
@@ -44,6 +76,18 @@ class FFmpeg_Frame_Resampler
     enum AVSampleFormat     m_in_sample_format;
     int                     m_in_sample_rate;
 
+    enum Resample_Quality   m_quality;
+
+    Convert_Function        m_converter;
+
+    bool                    m_channel_mapping;
+    std::vector<float>      m_channel_matrix;
+    Channel_Mapper          m_mapper;
+    bool                    m_mapped;
+
+    AVBufferPool            *m_buffer_pool;
+    int                     m_pool_samples;
+
     std::queue<std::string> m_errors;
 
     public:
@@ -55,15 +99,29 @@ class FFmpeg_Frame_Resampler
     Return_Status reset_options(int64_t, enum AVSampleFormat, int, int64_t, enum AVSampleFormat, int);
 
     AVFrame *resample_frame(AVFrame*);
+    Return_Status resample_frame(AVFrame*, Frame_Handle&);
+    AVFrame *flush();
+    Return_Status flush(Frame_Handle&);
+    Return_Status clear();
 
     Return_Status reset_channel_layout(bool, int64_t);
     Return_Status reset_sample_format(bool, enum AVSampleFormat);
     Return_Status reset_sample_rate(bool, int);
-    
+    Return_Status reset_channel_mapping(bool, const std::vector<float>&);
+    Return_Status reset_quality(enum Resample_Quality);
+
+    enum Resample_Quality get_quality();
+
+    bool is_channel_mapped();
+
     std::string poll_error();
 
     private:
 
+    Return_Status apply_quality();
+    void select_converter();
+    Return_Status get_output_buffer(int);
+    AVFrame *convert_frame(AVFrame*);
     void enqueue_error(const std::string &error);
     void enqueue_error(int error_code);
 };
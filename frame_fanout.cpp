@@ -0,0 +1,502 @@
+#include "frame_fanout.h"
+#include "event_trace.h"
+
+extern "C"
+{
+#include <libavutil/error.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <utility>
+
+// the most error messages kept for Frame_Fanout::poll_error()
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+namespace
+{
+    /* steady_nanoseconds() function
+     * @return the steady clock time in nanoseconds
+     */
+    int64_t steady_nanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+
+
+
+/* Frame_Sink::finish() function
+ * @desc called on the sink's thread after its last frame, EX: to drain a player or complete a file header
+ * @return Return_Status::STATUS_SUCCESS, sinks with nothing to finish keep this
+ */
+Return_Status Frame_Sink::finish()
+{
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Frame_Fanout constructor
+ * @desc creates a fanout without sinks, see Frame_Fanout::add_sink()
+ */
+Frame_Fanout::Frame_Fanout()
+{
+    m_started = false;
+    m_frames_pushed = 0;
+    m_frames_copied = 0;
+}
+
+
+
+
+/* Frame_Fanout destructor
+ * @desc finishes the sinks if Frame_Fanout::finish() was not called, and frees the frames left
+ */
+Frame_Fanout::~Frame_Fanout()
+{
+    finish();
+
+    for(std::unique_ptr<Sink_Slot> &slot : m_sinks)
+    {
+        free_queue(*slot);
+    }
+}
+
+
+
+
+/* Frame_Fanout::add_sink() function
+ * @desc adds a sink with its own queue, the frames holding the queued references are allocated here
+ * @param sink - the sink, owned by the fanout from now on
+ * @param policy - what to do when the queue is full, see Fanout_Policy
+ * @param capacity - the most frames queued for the sink, at least 1
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note must be called before Frame_Fanout::start()
+ */
+Return_Status Frame_Fanout::add_sink(std::unique_ptr<Frame_Sink> sink, Fanout_Policy policy, std::size_t capacity)
+{
+    if(m_started)
+    {
+        enqueue_error("Sinks can't be added to a started fanout");
+        return STATUS_FAILURE;
+    }
+
+    capacity = std::max<std::size_t>(capacity, 1);
+
+    std::unique_ptr<Sink_Slot> slot{new Sink_Slot};
+    slot->sink = std::move(sink);
+    slot->policy = policy;
+    slot->queue.resize(capacity);
+    slot->head = 0;
+    slot->count = 0;
+    slot->closing = false;
+    slot->failed = false;
+    slot->frames_consumed = 0;
+    slot->frames_dropped = 0;
+    slot->max_queued = 0;
+    slot->lag_total = 0;
+    slot->lag_max = 0;
+
+    // one for every queue entry and one for the frame the sink is consuming
+    for(std::size_t i = 0; i <= capacity; i++)
+    {
+        AVFrame *frame = av_frame_alloc();
+        if(!frame)
+        {
+            free_queue(*slot);
+            enqueue_error("Failed to allocate AVFrame");
+            return STATUS_FAILURE;
+        }
+        slot->spare.push_back(frame);
+    }
+
+    m_sinks.push_back(std::move(slot));
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Frame_Fanout::start() function
+ * @desc starts one thread per sink
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure, the threads started are stopped again
+ */
+Return_Status Frame_Fanout::start()
+{
+    if(m_started)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    m_started = true;
+
+    for(std::unique_ptr<Sink_Slot> &slot : m_sinks)
+    {
+        try
+        {
+            Sink_Slot &started = *slot;
+            slot->thread = std::thread{[this, &started]()
+            {
+                run(started);
+            }};
+        }
+        catch(const std::system_error &error)
+        {
+            enqueue_error("Failed to start the thread of sink " + slot->sink->get_name() + ": " + error.what());
+            finish();
+            return STATUS_FAILURE;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Frame_Fanout::push() function
+ * @desc queues a new reference to the frame for every sink, the caller keeps its own reference and may reuse the frame
+ * @desc right away, EX: the frame returned by FFmpeg_Frame_Resampler::resample_frame()
+ * @param frame - the frame to share
+ * @return Return_Status::STATUS_FAILURE if a FANOUT_BLOCK sink has failed or a reference couldn't be made,
+ * Return_Status::STATUS_SUCCESS otherwise, a failed FANOUT_DROP sink is only reported through Frame_Fanout::poll_error()
+ * @note waits while the queue of a FANOUT_BLOCK sink is full
+ */
+Return_Status Frame_Fanout::push(AVFrame *frame)
+{
+    Return_Status status = STATUS_SUCCESS;
+
+    // av_frame_ref() copies the data of frames that are not refcounted
+    if(!frame->buf[0])
+    {
+        m_frames_copied++;
+    }
+    m_frames_pushed++;
+
+    for(std::unique_ptr<Sink_Slot> &slot : m_sinks)
+    {
+        std::unique_lock<std::mutex> lock{slot->mutex};
+
+        std::size_t capacity = slot->queue.size();
+        if(slot->policy == FANOUT_BLOCK)
+        {
+            slot->not_full.wait(lock, [&slot, capacity]()
+            {
+                return slot->count < capacity || slot->failed;
+            });
+        }
+
+        if(slot->failed)
+        {
+            if(slot->policy == FANOUT_BLOCK)
+            {
+                status = STATUS_FAILURE;
+            }
+            continue;
+        }
+
+        if(slot->count == capacity)
+        {
+            // only with FANOUT_DROP, the oldest frame is the least interesting to a sink that is behind
+            Queued_Frame &oldest = slot->queue[slot->head];
+            av_frame_unref(oldest.frame);
+            slot->spare.push_back(oldest.frame);
+            slot->head = (slot->head + 1) % capacity;
+            slot->count--;
+            slot->frames_dropped++;
+        }
+
+        AVFrame *reference = slot->spare.back();
+        int error = av_frame_ref(reference, frame);
+        if(error < 0)
+        {
+            lock.unlock();
+
+            char error_message[AV_ERROR_MAX_STRING_SIZE];
+            av_strerror(error, error_message, sizeof(error_message));
+            enqueue_error("Failed to reference the frame for sink " + slot->sink->get_name() + ": " + error_message);
+
+            status = STATUS_FAILURE;
+            continue;
+        }
+        slot->spare.pop_back();
+
+        slot->queue[(slot->head + slot->count) % capacity] = Queued_Frame{reference, steady_nanoseconds()};
+        slot->count++;
+        slot->max_queued = std::max(slot->max_queued, slot->count);
+
+        lock.unlock();
+        slot->not_empty.notify_one();
+    }
+
+    return status;
+}
+
+
+
+
+/* Frame_Fanout::finish() function
+ * @desc lets every sink consume what is queued for it, finishes it and stops its thread
+ * @return Return_Status::STATUS_SUCCESS if no sink failed, Return_Status::STATUS_FAILURE otherwise
+ */
+Return_Status Frame_Fanout::finish()
+{
+    if(!m_started)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    for(std::unique_ptr<Sink_Slot> &slot : m_sinks)
+    {
+        {
+            std::lock_guard<std::mutex> lock{slot->mutex};
+            slot->closing = true;
+        }
+        slot->not_empty.notify_one();
+    }
+
+    Return_Status status = STATUS_SUCCESS;
+    for(std::unique_ptr<Sink_Slot> &slot : m_sinks)
+    {
+        if(slot->thread.joinable())
+        {
+            slot->thread.join();
+        }
+
+        if(slot->failed)
+        {
+            status = STATUS_FAILURE;
+        }
+    }
+
+    m_started = false;
+    return status;
+}
+
+
+
+
+/* Frame_Fanout::get_sink_count() function
+ * @return the number of sinks added
+ */
+std::size_t Frame_Fanout::get_sink_count()
+{
+    return m_sinks.size();
+}
+
+
+
+
+/* Frame_Fanout::get_stats() function
+ * @return the statistics of every sink in the order they were added, may be called while the sinks run
+ */
+std::vector<Fanout_Sink_Stats> Frame_Fanout::get_stats()
+{
+    std::vector<Fanout_Sink_Stats> stats;
+
+    for(std::unique_ptr<Sink_Slot> &slot : m_sinks)
+    {
+        std::lock_guard<std::mutex> lock{slot->mutex};
+
+        Fanout_Sink_Stats sink_stats;
+        sink_stats.name = slot->sink->get_name();
+        sink_stats.policy = slot->policy;
+        sink_stats.frames_consumed = slot->frames_consumed;
+        sink_stats.frames_dropped = slot->frames_dropped;
+        sink_stats.queued = slot->count;
+        sink_stats.max_queued = slot->max_queued;
+        sink_stats.lag_avg_ms = slot->frames_consumed > 0 ? slot->lag_total / 1e6 / slot->frames_consumed : 0;
+        sink_stats.lag_max_ms = slot->lag_max / 1e6;
+        sink_stats.failed = slot->failed;
+
+        stats.push_back(sink_stats);
+    }
+
+    return stats;
+}
+
+
+
+
+/* Frame_Fanout::get_frames_pushed() function
+ * @return the number of frames pushed
+ */
+uint64_t Frame_Fanout::get_frames_pushed()
+{
+    return m_frames_pushed;
+}
+
+
+
+
+/* Frame_Fanout::get_frames_copied() function
+ * @return the number of pushed frames that had no refcounted buffers, their data was copied once per sink
+ */
+uint64_t Frame_Fanout::get_frames_copied()
+{
+    return m_frames_copied;
+}
+
+
+
+
+/* Frame_Fanout::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors, the errors of the sinks are prefixed with their names
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Frame_Fanout::poll_error()
+{
+    std::lock_guard<std::mutex> lock{m_error_mutex};
+
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Frame_Fanout::run() function
+ * @desc the body of a sink's thread, hands it the queued frames in order until the fanout is finished
+ * @param slot - the sink with its queue
+ * @note after a failure the thread keeps emptying the queue so a FANOUT_BLOCK push never waits on a dead sink
+ * @note this function is under the private specifier
+ */
+void Frame_Fanout::run(Sink_Slot &slot)
+{
+    std::size_t capacity = slot.queue.size();
+
+    trace_name_thread("sink " + slot.sink->get_name());
+
+    while(1)
+    {
+        std::unique_lock<std::mutex> lock{slot.mutex};
+        slot.not_empty.wait(lock, [&slot]()
+        {
+            return slot.count > 0 || slot.closing;
+        });
+
+        if(slot.count == 0)
+        {
+            break;
+        }
+
+        Queued_Frame queued = slot.queue[slot.head];
+        slot.head = (slot.head + 1) % capacity;
+        slot.count--;
+        bool failed = slot.failed;
+
+        lock.unlock();
+        slot.not_full.notify_one();
+
+        int64_t lag = steady_nanoseconds() - queued.pushed_at;
+
+        Return_Status status = STATUS_SUCCESS;
+        if(!failed)
+        {
+            Trace_Scope scope{"consume"};
+            status = slot.sink->consume(queued.frame);
+        }
+
+        // drops this sink's reference, the data is freed once every sink and the pushing side are done with it
+        av_frame_unref(queued.frame);
+
+        lock.lock();
+        slot.spare.push_back(queued.frame);
+        if(!failed)
+        {
+            slot.frames_consumed++;
+            slot.lag_total += lag;
+            slot.lag_max = std::max(slot.lag_max, lag);
+        }
+        if(status == STATUS_FAILURE)
+        {
+            slot.failed = true;
+        }
+        lock.unlock();
+
+        if(status == STATUS_FAILURE)
+        {
+            take_errors(*slot.sink);
+            slot.not_full.notify_one();
+        }
+    }
+
+    if(!slot.failed && slot.sink->finish() == STATUS_FAILURE)
+    {
+        std::lock_guard<std::mutex> lock{slot.mutex};
+        slot.failed = true;
+    }
+    take_errors(*slot.sink);
+}
+
+
+
+
+/* Frame_Fanout::free_queue() function
+ * @desc frees the frames of a sink's queue, the queued references are released
+ * @param slot - the sink, its thread must have stopped
+ * @note this function is under the private specifier
+ */
+void Frame_Fanout::free_queue(Sink_Slot &slot)
+{
+    for(; slot.count > 0; slot.count--)
+    {
+        av_frame_free(&slot.queue[slot.head].frame);
+        slot.head = (slot.head + 1) % slot.queue.size();
+    }
+
+    for(AVFrame *frame : slot.spare)
+    {
+        av_frame_free(&frame);
+    }
+    slot.spare.clear();
+}
+
+
+
+
+/* Frame_Fanout::take_errors() function
+ * @desc moves the errors of a sink onto m_errors, prefixed with the sink's name
+ * @param sink - the sink, only called from its own thread
+ * @note this function is under the private specifier
+ */
+void Frame_Fanout::take_errors(Frame_Sink &sink)
+{
+    for(std::string error = sink.poll_error(); !error.empty(); error = sink.poll_error())
+    {
+        enqueue_error(sink.get_name() + ": " + error);
+    }
+}
+
+
+
+
+/* Frame_Fanout::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, dropping the oldest past MAX_QUEUED_ERRORS
+ * @param error - std::string error message
+ * @note this function is under the private specifier
+ */
+void Frame_Fanout::enqueue_error(const std::string &error)
+{
+    std::lock_guard<std::mutex> lock{m_error_mutex};
+
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Frame_Sink Class
+ * @desc A destination for the frames of a Frame_Fanout, EX: an Audio_Player, a WAV file or a level meter, see frame_sinks.h.
+ * @desc Every sink runs on its own thread, so a sink only has to be safe to use from the one thread calling it.
+ * @note the frames handed to Frame_Sink::consume() share their data with the other sinks, it must not be written
+ */
+class Frame_Sink
+{
+    public:
+
+    virtual ~Frame_Sink() = default;
+
+    virtual std::string get_name() = 0;
+    virtual Return_Status consume(AVFrame *) = 0;
+    virtual Return_Status finish();
+    virtual std::string poll_error() = 0;
+};
+
+/* Fanout_Policy Enum
+ * @desc what a Frame_Fanout does when a sink's queue is full
+ * @member FANOUT_BLOCK - Frame_Fanout::push() waits for the sink, for the sink that paces the stream, EX: the audio player
+ * @member FANOUT_DROP - the oldest queued frame is dropped, so a slow sink, EX: a meter, never holds up the others
+ */
+enum Fanout_Policy
+{
+    FANOUT_BLOCK,
+    FANOUT_DROP,
+};
+
+/* Fanout_Sink_Stats Struct
+ * @desc how well one sink of a Frame_Fanout keeps up, see Frame_Fanout::get_stats()
+ * @member name - the sink's name, see Frame_Sink::get_name()
+ * @member policy - see Fanout_Policy
+ * @member frames_consumed - frames handed to the sink
+ * @member frames_dropped - frames dropped because the sink's queue was full, only with FANOUT_DROP
+ * @member queued - frames waiting for the sink now
+ * @member max_queued - the most frames that waited for the sink at once
+ * @member lag_avg_ms - the average time from Frame_Fanout::push() to the sink taking the frame
+ * @member lag_max_ms - the longest time from Frame_Fanout::push() to the sink taking the frame
+ * @member failed - true once the sink returned a failure, it gets no frames after that
+ */
+struct Fanout_Sink_Stats
+{
+    std::string name;
+    Fanout_Policy policy;
+    uint64_t frames_consumed;
+    uint64_t frames_dropped;
+    std::size_t queued;
+    std::size_t max_queued;
+    double lag_avg_ms;
+    double lag_max_ms;
+    bool failed;
+};
+
+/* Frame_Fanout Class
+ * @desc Hands every frame pushed to it to several Frame_Sinks, each on its own thread with its own bounded queue.
+ * @desc Frames are shared, not copied: each queue entry is a new reference (av_frame_ref()) to the same refcounted
+ * @desc buffers, released once its sink is done, so the data is freed when the last sink is done with it.
+ * @desc The AVFrame structs holding the references are allocated when a sink is added and reused, the steady state
+ * @desc only allocates the small AVBufferRefs. Frames without refcounted buffers have to be copied, they are counted.
+ * @member m_sinks - the sinks with their queues and threads
+ * @member m_started - true between Frame_Fanout::start() and Frame_Fanout::finish()
+ * @member m_frames_pushed - the number of frames pushed
+ * @member m_frames_copied - the number of pushed frames that had no refcounted buffers and were copied for each sink
+ * @member m_error_mutex - guards m_errors, the sink threads add to it
+ * @member m_errors - a std::queue<std::string> of error messages, the oldest are dropped past a limit
+ * @note see frame_fanout.cpp for comments on functions
+ */
+class Frame_Fanout
+{
+    struct Queued_Frame
+    {
+        AVFrame *frame;
+        int64_t pushed_at;
+    };
+
+    struct Sink_Slot
+    {
+        std::unique_ptr<Frame_Sink> sink;
+        Fanout_Policy policy;
+
+        // a ring of capacity entries, guarded by mutex
+        std::vector<Queued_Frame> queue;
+        std::size_t head;
+        std::size_t count;
+        std::vector<AVFrame*> spare;
+
+        std::mutex mutex;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        std::thread thread;
+        bool closing;
+        bool failed;
+
+        uint64_t frames_consumed;
+        uint64_t frames_dropped;
+        std::size_t max_queued;
+        int64_t lag_total;
+        int64_t lag_max;
+    };
+
+    std::vector<std::unique_ptr<Sink_Slot>> m_sinks;
+    bool m_started;
+
+    uint64_t m_frames_pushed;
+    uint64_t m_frames_copied;
+
+    std::mutex m_error_mutex;
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Frame_Fanout();
+    ~Frame_Fanout();
+
+    Return_Status add_sink(std::unique_ptr<Frame_Sink>, Fanout_Policy, std::size_t);
+    Return_Status start();
+    Return_Status push(AVFrame *);
+    Return_Status finish();
+
+    std::size_t get_sink_count();
+    std::vector<Fanout_Sink_Stats> get_stats();
+    uint64_t get_frames_pushed();
+    uint64_t get_frames_copied();
+
+    std::string poll_error();
+
+    private:
+
+    void run(Sink_Slot &);
+    void free_queue(Sink_Slot &);
+    void take_errors(Frame_Sink &);
+    void enqueue_error(const std::string &error);
+};
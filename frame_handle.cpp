@@ -0,0 +1,364 @@
+#include "frame_handle.h"
+
+#include <algorithm>
+#include <mutex>
+
+
+
+
+/* Frame_Handle constructor
+ * @desc creates an empty handle
+ */
+Frame_Handle::Frame_Handle()
+{
+    m_frame = nullptr;
+    m_pool = nullptr;
+}
+
+
+
+
+/* Frame_Handle constructor
+ * @desc takes ownership of a frame, it is freed with the handle
+ * @param frame - a frame from av_frame_alloc(), or nullptr for an empty handle
+ */
+Frame_Handle::Frame_Handle(AVFrame *frame)
+{
+    m_frame = frame;
+    m_pool = nullptr;
+}
+
+
+
+
+/* Frame_Handle constructor
+ * @desc takes ownership of a frame of a pool, it is given back with the handle
+ * @param frame - the frame
+ * @param pool - the pool it belongs to
+ * @note this function is under the private specifier
+ */
+Frame_Handle::Frame_Handle(AVFrame *frame, Frame_Pool *pool)
+{
+    m_frame = frame;
+    m_pool = pool;
+}
+
+
+
+
+/* Frame_Handle move constructor
+ * @desc takes the frame of another handle, which is left empty
+ */
+Frame_Handle::Frame_Handle(Frame_Handle &&other)
+{
+    m_frame = other.m_frame;
+    m_pool = other.m_pool;
+    other.m_frame = nullptr;
+    other.m_pool = nullptr;
+}
+
+
+
+
+/* Frame_Handle move assignment operator
+ * @desc releases the frame held, then takes the frame of another handle, which is left empty
+ */
+Frame_Handle &Frame_Handle::operator=(Frame_Handle &&other)
+{
+    if(this != &other)
+    {
+        reset();
+
+        m_frame = other.m_frame;
+        m_pool = other.m_pool;
+        other.m_frame = nullptr;
+        other.m_pool = nullptr;
+    }
+
+    return *this;
+}
+
+
+
+
+/* Frame_Handle destructor
+ * @desc releases the frame held, see Frame_Handle::reset()
+ */
+Frame_Handle::~Frame_Handle()
+{
+    reset();
+}
+
+
+
+
+/* Frame_Handle::allocate() function
+ * @desc allocates a new frame owned by the returned handle
+ * @return the handle, empty if the allocation failed
+ */
+Frame_Handle Frame_Handle::allocate()
+{
+    return Frame_Handle{av_frame_alloc()};
+}
+
+
+
+
+/* Frame_Handle::get() function
+ * @return the frame held, nullptr for an empty handle, it stays owned by the handle
+ */
+AVFrame *Frame_Handle::get() const
+{
+    return m_frame;
+}
+
+
+
+
+/* Frame_Handle::operator->() function
+ * @return the frame held, to reach its fields through the handle, EX: handle->nb_samples
+ */
+AVFrame *Frame_Handle::operator->() const
+{
+    return m_frame;
+}
+
+
+
+
+/* Frame_Handle::operator bool() function
+ * @return true if the handle holds a frame
+ */
+Frame_Handle::operator bool() const
+{
+    return m_frame != nullptr;
+}
+
+
+
+
+/* Frame_Handle::release() function
+ * @desc gives up ownership of the frame without releasing it
+ * @return the frame, the caller frees it with av_frame_free(), nullptr for an empty handle
+ * @note a frame of a pool is copied by reference into a new frame, so the pool gets its own frame back
+ */
+AVFrame *Frame_Handle::release()
+{
+    AVFrame *frame = m_frame;
+
+    if(m_pool && frame)
+    {
+        frame = av_frame_alloc();
+        if(frame)
+        {
+            av_frame_move_ref(frame, m_frame);
+        }
+        reset();
+    }
+
+    m_frame = nullptr;
+    m_pool = nullptr;
+    return frame;
+}
+
+
+
+
+/* Frame_Handle::reset() function
+ * @desc releases the frame held and its buffers, a frame of a pool is given back to it, the handle is left empty
+ */
+void Frame_Handle::reset()
+{
+    if(m_pool)
+    {
+        m_pool->give_back(m_frame);
+    }
+    else
+    {
+        av_frame_free(&m_frame);
+    }
+
+    m_frame = nullptr;
+    m_pool = nullptr;
+}
+
+
+
+
+/* Frame_Pool constructor
+ * @desc allocates the frames, their buffers are allocated by whoever fills them
+ * @param capacity - the number of frames, fewer if an allocation failed, see Frame_Pool::get_capacity()
+ */
+Frame_Pool::Frame_Pool(std::size_t capacity)
+{
+    m_closed = false;
+    m_max_in_use = 0;
+    m_waits = 0;
+
+    for(std::size_t i = 0; i < capacity; i++)
+    {
+        AVFrame *frame = av_frame_alloc();
+        if(!frame)
+        {
+            break;
+        }
+        m_frames.push_back(frame);
+    }
+
+    m_free = m_frames;
+}
+
+
+
+
+/* Frame_Pool destructor
+ * @desc frees the frames, every handle taken from the pool must have been released
+ */
+Frame_Pool::~Frame_Pool()
+{
+    for(AVFrame *frame : m_frames)
+    {
+        av_frame_free(&frame);
+    }
+}
+
+
+
+
+/* Frame_Pool::acquire() function
+ * @desc takes a frame from the pool, waiting for one to be given back if all are handed out
+ * @return a handle to an empty frame, empty once the pool is closed
+ */
+Frame_Handle Frame_Pool::acquire()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+
+    if(m_free.empty() && !m_closed)
+    {
+        m_waits++;
+        m_available.wait(lock, [this]()
+        {
+            return !m_free.empty() || m_closed;
+        });
+    }
+
+    return take_frame();
+}
+
+
+
+
+/* Frame_Pool::try_acquire() function
+ * @desc takes a frame from the pool if one is free
+ * @return a handle to an empty frame, empty if none is free or the pool is closed
+ */
+Frame_Handle Frame_Pool::try_acquire()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return take_frame();
+}
+
+
+
+
+/* Frame_Pool::close() function
+ * @desc makes Frame_Pool::acquire() return empty handles from now on, waking the stages waiting in it, EX: to stop a pipeline
+ * @note frames handed out can still be given back
+ */
+void Frame_Pool::close()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_closed = true;
+    }
+    m_available.notify_all();
+}
+
+
+
+
+/* Frame_Pool::get_capacity() function
+ * @return the number of frames of the pool
+ */
+std::size_t Frame_Pool::get_capacity()
+{
+    return m_frames.size();
+}
+
+
+
+
+/* Frame_Pool::get_available() function
+ * @return the number of frames not handed out
+ */
+std::size_t Frame_Pool::get_available()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_free.size();
+}
+
+
+
+
+/* Frame_Pool::get_max_in_use() function
+ * @return the most frames handed out at once
+ */
+std::size_t Frame_Pool::get_max_in_use()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_max_in_use;
+}
+
+
+
+
+/* Frame_Pool::get_waits() function
+ * @return the number of times Frame_Pool::acquire() had to wait for a frame
+ */
+uint64_t Frame_Pool::get_waits()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_waits;
+}
+
+
+
+
+/* Frame_Pool::take_frame() function
+ * @desc hands out a free frame, m_mutex must be held
+ * @return a handle to the frame, empty if none is free or the pool is closed
+ * @note this function is under the private specifier
+ */
+Frame_Handle Frame_Pool::take_frame()
+{
+    if(m_free.empty() || m_closed)
+    {
+        return Frame_Handle{};
+    }
+
+    AVFrame *frame = m_free.back();
+    m_free.pop_back();
+    m_max_in_use = std::max(m_max_in_use, m_frames.size() - m_free.size());
+
+    return Frame_Handle{frame, this};
+}
+
+
+
+
+/* Frame_Pool::give_back() function
+ * @desc unreferences a frame handed out and makes it free again, called by Frame_Handle::reset()
+ * @param frame - the frame
+ * @note this function is under the private specifier
+ */
+void Frame_Pool::give_back(AVFrame *frame)
+{
+    // the buffers are released outside the lock, freeing them can take a while
+    av_frame_unref(frame);
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_free.push_back(frame);
+    }
+    m_available.notify_one();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class Frame_Pool;
+
+/* Frame_Handle Class
+ * @desc Owns one AVFrame, the frame and the buffers it references are released when the handle goes out of scope.
+ * @desc Handles can be moved but not copied, so a frame has exactly one owner as it travels between stages and threads,
+ * @desc EX: from FFmpeg_Decoder::decode_frame(Frame_Handle&) through a queue to another thread's resampler.
+ * @desc A handle taken from a Frame_Pool gives its frame back to the pool instead of freeing it.
+ * @member m_frame - the owned frame, nullptr for an empty handle
+ * @member m_pool - the pool m_frame goes back to, nullptr if it is freed
+ * @note see frame_handle.cpp for comments on functions
+ */
+class Frame_Handle
+{
+    AVFrame *m_frame;
+    Frame_Pool *m_pool;
+
+    friend class Frame_Pool;
+
+    public:
+
+    Frame_Handle();
+    explicit Frame_Handle(AVFrame *);
+    Frame_Handle(Frame_Handle&&);
+    Frame_Handle &operator=(Frame_Handle&&);
+    ~Frame_Handle();
+
+    Frame_Handle(const Frame_Handle&) = delete;
+    Frame_Handle &operator=(const Frame_Handle&) = delete;
+
+    static Frame_Handle allocate();
+
+    AVFrame *get() const;
+    AVFrame *operator->() const;
+    explicit operator bool() const;
+
+    AVFrame *release();
+    void reset();
+
+    private:
+
+    Frame_Handle(AVFrame *, Frame_Pool *);
+};
+
+/* Frame_Pool Class
+ * @desc A fixed number of AVFrames handed out as Frame_Handles, which bounds how many frames a pipeline has in flight:
+ * @desc a stage taking a frame from an empty pool waits until a later stage is done with one.
+ * @desc A frame given back is unreferenced, its buffers go back to whoever allocated them, EX: the decoder's buffer pool.
+ * @desc Any thread may take and give back frames.
+ * @member m_frames - every frame of the pool, freed by the destructor
+ * @member m_free - the frames not handed out, guarded by m_mutex
+ * @member m_closed - set by Frame_Pool::close(), makes waiting takers return empty handles, guarded by m_mutex
+ * @member m_max_in_use - the most frames handed out at once, guarded by m_mutex
+ * @member m_waits - the number of times a taker had to wait for a frame, guarded by m_mutex
+ * @member m_mutex - guards the members above
+ * @member m_available - signalled when a frame is given back or the pool is closed
+ * @note the pool must outlive every handle taken from it
+ * @note see frame_handle.cpp for comments on functions
+ */
+class Frame_Pool
+{
+    std::vector<AVFrame*> m_frames;
+    std::vector<AVFrame*> m_free;
+    bool m_closed;
+    std::size_t m_max_in_use;
+    uint64_t m_waits;
+
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+
+    friend class Frame_Handle;
+
+    public:
+
+    explicit Frame_Pool(std::size_t);
+    ~Frame_Pool();
+
+    Frame_Pool(const Frame_Pool&) = delete;
+    Frame_Pool &operator=(const Frame_Pool&) = delete;
+
+    Frame_Handle acquire();
+    Frame_Handle try_acquire();
+    void close();
+
+    std::size_t get_capacity();
+    std::size_t get_available();
+    std::size_t get_max_in_use();
+    uint64_t get_waits();
+
+    private:
+
+    Frame_Handle take_frame();
+    void give_back(AVFrame *);
+};
@@ -0,0 +1,588 @@
+#include "frame_sinks.h"
+
+extern "C"
+{
+#include <libavutil/samplefmt.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// the most error messages kept by a sink
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+// the size of the canonical WAV header written by Wav_Sink
+const std::size_t WAV_HEADER_SIZE = 44;
+
+
+
+
+/* Player_Sink constructor
+ * @param player - the player, initialized for the format of the frames, it must outlive the fanout's threads
+ */
+Player_Sink::Player_Sink(Audio_Player &player) : m_player{player}
+{
+
+}
+
+
+
+
+/* Player_Sink::get_name() function
+ * @return "player"
+ */
+std::string Player_Sink::get_name()
+{
+    return "player";
+}
+
+
+
+
+/* Player_Sink::consume() function
+ * @desc plays the frame, see Audio_Player::play_frame()
+ * @param frame - the frame
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Player_Sink::consume(AVFrame *frame)
+{
+    return m_player.play_frame(frame);
+}
+
+
+
+
+/* Player_Sink::finish() function
+ * @desc lets the audio written play out, see Audio_Player::drain()
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Player_Sink::finish()
+{
+    return m_player.drain();
+}
+
+
+
+
+/* Player_Sink::poll_error() function
+ * @return the player's next error message, see Audio_Player::poll_error()
+ */
+std::string Player_Sink::poll_error()
+{
+    return m_player.poll_error();
+}
+
+
+
+
+/* Wav_Sink constructor
+ * @param path - the file to write, it is created or truncated when the first frame arrives
+ */
+Wav_Sink::Wav_Sink(const std::string &path) : m_path{path}
+{
+    m_file = -1;
+    m_format = AV_SAMPLE_FMT_NONE;
+    m_channels = 0;
+    m_sample_rate = 0;
+    m_data_bytes = 0;
+}
+
+
+
+
+/* Wav_Sink destructor
+ * @desc completes the file if Wav_Sink::finish() was not called
+ */
+Wav_Sink::~Wav_Sink()
+{
+    finish();
+}
+
+
+
+
+/* Wav_Sink::get_name() function
+ * @return "wav <path>"
+ */
+std::string Wav_Sink::get_name()
+{
+    return "wav " + m_path;
+}
+
+
+
+
+/* Wav_Sink::consume() function
+ * @desc appends the samples of the frame to the file, the first frame creates it
+ * @param frame - the frame, in the format of the first frame
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Wav_Sink::consume(AVFrame *frame)
+{
+    if(m_file < 0 && open_file(frame) == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
+    if(frame->format != m_format || frame->channels != m_channels || frame->sample_rate != m_sample_rate)
+    {
+        enqueue_error("The format changed while writing " + m_path);
+        return STATUS_FAILURE;
+    }
+
+    std::size_t size = static_cast<std::size_t>(frame->nb_samples) * m_channels * av_get_bytes_per_sample(m_format);
+    const uint8_t *data = frame->extended_data[0];
+
+    while(size > 0)
+    {
+        ssize_t written = write(m_file, data, size);
+        if(written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(written <= 0)
+        {
+            enqueue_error("Failed to write " + m_path + ": " + std::strerror(errno));
+            return STATUS_FAILURE;
+        }
+
+        data += written;
+        size -= written;
+        m_data_bytes += written;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Wav_Sink::finish() function
+ * @desc fills in the sizes in the header and closes the file
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Wav_Sink::finish()
+{
+    if(m_file < 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    Return_Status status = write_header();
+
+    if(close(m_file) != 0 && status == STATUS_SUCCESS)
+    {
+        enqueue_error("Failed to close " + m_path + ": " + std::strerror(errno));
+        status = STATUS_FAILURE;
+    }
+    m_file = -1;
+
+    return status;
+}
+
+
+
+
+/* Wav_Sink::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Wav_Sink::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Wav_Sink::get_data_bytes() function
+ * @return the number of bytes of samples written so far
+ */
+uint64_t Wav_Sink::get_data_bytes()
+{
+    return m_data_bytes;
+}
+
+
+
+
+/* Wav_Sink::open_file() function
+ * @desc takes the format from the first frame, creates the file and writes a header without sizes
+ * @param frame - the first frame
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note this function is under the private specifier
+ */
+Return_Status Wav_Sink::open_file(const AVFrame *frame)
+{
+    enum AVSampleFormat format = static_cast<enum AVSampleFormat>(frame->format);
+    if(format != AV_SAMPLE_FMT_S16 && format != AV_SAMPLE_FMT_S32 && format != AV_SAMPLE_FMT_FLT)
+    {
+        const char *name = av_get_sample_fmt_name(format);
+        enqueue_error("WAV files can't hold " + std::string{name ? name : "unknown"} + " samples");
+        return STATUS_FAILURE;
+    }
+
+    m_format = format;
+    m_channels = frame->channels;
+    m_sample_rate = frame->sample_rate;
+
+    m_file = open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(m_file < 0)
+    {
+        enqueue_error("Failed to create " + m_path + ": " + std::strerror(errno));
+        return STATUS_FAILURE;
+    }
+
+    return write_header();
+}
+
+
+
+
+/* Wav_Sink::write_header() function
+ * @desc writes the header at the start of the file with the sizes of the samples written so far
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note sizes past 4 GiB don't fit, they are written as the largest size there is, which most readers take as "to the end"
+ * @note this function is under the private specifier
+ */
+Return_Status Wav_Sink::write_header()
+{
+    const uint16_t FORMAT_PCM = 1;
+    const uint16_t FORMAT_FLOAT = 3;
+
+    int bytes_per_sample = av_get_bytes_per_sample(m_format);
+    uint32_t data_size = static_cast<uint32_t>(std::min<uint64_t>(m_data_bytes, UINT32_MAX - 36));
+
+    uint8_t header[WAV_HEADER_SIZE];
+    auto put_16 = [&header](int offset, uint32_t value)
+    {
+        header[offset] = value & 0xff;
+        header[offset + 1] = (value >> 8) & 0xff;
+    };
+    auto put_32 = [&put_16](int offset, uint32_t value)
+    {
+        put_16(offset, value & 0xffff);
+        put_16(offset + 2, value >> 16);
+    };
+
+    std::memcpy(header, "RIFF", 4);
+    put_32(4, 36 + data_size);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put_32(16, 16);                                                     // fmt chunk size
+    put_16(20, m_format == AV_SAMPLE_FMT_FLT ? FORMAT_FLOAT : FORMAT_PCM);
+    put_16(22, m_channels);
+    put_32(24, m_sample_rate);
+    put_32(28, m_sample_rate * m_channels * bytes_per_sample);         // byte rate
+    put_16(32, m_channels * bytes_per_sample);                         // block align
+    put_16(34, bytes_per_sample * 8);                                   // bits per sample
+    std::memcpy(header + 36, "data", 4);
+    put_32(40, data_size);
+
+    if(pwrite(m_file, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+    {
+        enqueue_error("Failed to write the header of " + m_path + ": " + std::strerror(errno));
+        return STATUS_FAILURE;
+    }
+
+    // the header is written with pwrite, the samples follow it
+    if(lseek(m_file, static_cast<off_t>(WAV_HEADER_SIZE + m_data_bytes), SEEK_SET) < 0)
+    {
+        enqueue_error("Failed to seek in " + m_path + ": " + std::strerror(errno));
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Wav_Sink::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, dropping the oldest past MAX_QUEUED_ERRORS
+ * @param error - std::string error message
+ * @note this function is under the private specifier
+ */
+void Wav_Sink::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
+
+
+
+
+/* Meter_Sink constructor
+ * @param out - where the level of each interval is printed, nullptr to only measure
+ * @param interval - the length of an interval in seconds
+ */
+Meter_Sink::Meter_Sink(std::ostream *out, double interval) : m_out{out}, m_interval{interval}
+{
+    m_interval_samples = 0;
+    m_samples = 0;
+    m_intervals = 0;
+}
+
+
+
+
+/* Meter_Sink::get_name() function
+ * @return "meter"
+ */
+std::string Meter_Sink::get_name()
+{
+    return "meter";
+}
+
+
+
+
+/* Meter_Sink::consume() function
+ * @desc measures the samples of the frame, printing the level of every interval completed
+ * @param frame - the frame, the number of channels has to stay the same
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Meter_Sink::consume(AVFrame *frame)
+{
+    if(m_peak.empty())
+    {
+        m_peak.assign(frame->channels, 0);
+        m_square.assign(frame->channels, 0);
+        m_interval_peak.assign(frame->channels, 0);
+        m_interval_square.assign(frame->channels, 0);
+    }
+
+    if(static_cast<std::size_t>(frame->channels) != m_peak.size())
+    {
+        enqueue_error("The number of channels changed while metering");
+        return STATUS_FAILURE;
+    }
+
+    enum AVSampleFormat format = static_cast<enum AVSampleFormat>(frame->format);
+    bool planar = av_sample_fmt_is_planar(format);
+
+    switch(av_get_packed_sample_fmt(format))
+    {
+        case AV_SAMPLE_FMT_S16:
+            measure<int16_t>(frame, 1.0 / 32768, planar);
+            break;
+        case AV_SAMPLE_FMT_S32:
+            measure<int32_t>(frame, 1.0 / 2147483648.0, planar);
+            break;
+        case AV_SAMPLE_FMT_FLT:
+            measure<float>(frame, 1.0, planar);
+            break;
+        case AV_SAMPLE_FMT_DBL:
+            measure<double>(frame, 1.0, planar);
+            break;
+        default:
+        {
+            const char *name = av_get_sample_fmt_name(format);
+            enqueue_error("Can't meter " + std::string{name ? name : "unknown"} + " samples");
+            return STATUS_FAILURE;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Meter_Sink::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Meter_Sink::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Meter_Sink::get_channels() function
+ * @return the number of channels metered, 0 before the first frame
+ */
+int Meter_Sink::get_channels()
+{
+    return static_cast<int>(m_peak.size());
+}
+
+
+
+
+/* Meter_Sink::get_peak_db() function
+ * @param channel - the channel, counting from 0
+ * @return the highest sample of the channel so far in dB relative to full scale, -infinity for silence
+ * @note not synchronized, call it once the fanout has finished
+ */
+double Meter_Sink::get_peak_db(int channel)
+{
+    return 20 * std::log10(std::max(m_peak[channel], m_interval_peak[channel]));
+}
+
+
+
+
+/* Meter_Sink::get_rms_db() function
+ * @param channel - the channel, counting from 0
+ * @return the RMS level of the channel so far in dB relative to full scale, -infinity for silence
+ * @note not synchronized, call it once the fanout has finished
+ */
+double Meter_Sink::get_rms_db(int channel)
+{
+    int64_t samples = m_samples + m_interval_samples;
+    if(samples == 0)
+    {
+        return -INFINITY;
+    }
+
+    return 10 * std::log10((m_square[channel] + m_interval_square[channel]) / samples);
+}
+
+
+
+
+/* Meter_Sink::get_intervals() function
+ * @return the number of intervals completed
+ */
+uint64_t Meter_Sink::get_intervals()
+{
+    return m_intervals;
+}
+
+
+
+
+/* Meter_Sink::measure() function
+ * @desc adds the samples of a frame to the current interval, completing intervals as their length is reached
+ * @param frame - the frame
+ * @param scale - what a sample is multiplied by to get to the range -1 to 1
+ * @param planar - true if every channel has its own plane
+ * @note this function is under the private specifier
+ */
+template<typename T>
+void Meter_Sink::measure(const AVFrame *frame, double scale, bool planar)
+{
+    int channels = frame->channels;
+    int64_t interval_length = std::max<int64_t>(std::llround(m_interval * frame->sample_rate), 1);
+
+    int done = 0;
+    while(done < frame->nb_samples)
+    {
+        int run = static_cast<int>(std::min<int64_t>(frame->nb_samples - done, interval_length - m_interval_samples));
+
+        for(int channel = 0; channel < channels; channel++)
+        {
+            const T *samples = reinterpret_cast<const T*>(frame->extended_data[planar ? channel : 0]);
+            int stride = planar ? 1 : channels;
+            samples += planar ? done : done * channels + channel;
+
+            double peak = m_interval_peak[channel];
+            double square = m_interval_square[channel];
+            for(int i = 0; i < run; i++)
+            {
+                double value = samples[i * stride] * scale;
+                peak = std::max(peak, std::fabs(value));
+                square += value * value;
+            }
+            m_interval_peak[channel] = peak;
+            m_interval_square[channel] = square;
+        }
+
+        done += run;
+        m_interval_samples += run;
+
+        if(m_interval_samples == interval_length)
+        {
+            print_interval();
+
+            for(int channel = 0; channel < channels; channel++)
+            {
+                m_peak[channel] = std::max(m_peak[channel], m_interval_peak[channel]);
+                m_square[channel] += m_interval_square[channel];
+                m_interval_peak[channel] = 0;
+                m_interval_square[channel] = 0;
+            }
+            m_samples += m_interval_samples;
+            m_interval_samples = 0;
+            m_intervals++;
+        }
+    }
+}
+
+
+
+
+/* Meter_Sink::print_interval() function
+ * @desc prints the peak and RMS level of every channel in the interval just completed to m_out, if set
+ * @note this function is under the private specifier
+ */
+void Meter_Sink::print_interval()
+{
+    if(!m_out)
+    {
+        return;
+    }
+
+    // one write per line, other threads print to the same stream
+    std::ostringstream line;
+    line << "Level:" << std::fixed << std::setprecision(1);
+    for(std::size_t channel = 0; channel < m_interval_peak.size(); channel++)
+    {
+        line << "  " << 20 * std::log10(m_interval_peak[channel]) << " dB peak "
+             << 10 * std::log10(m_interval_square[channel] / m_interval_samples) << " dB RMS";
+    }
+    line << '\n';
+
+    *m_out << line.str() << std::flush;
+}
+
+
+
+
+/* Meter_Sink::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, dropping the oldest past MAX_QUEUED_ERRORS
+ * @param error - std::string error message
+ * @note this function is under the private specifier
+ */
+void Meter_Sink::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "audio_player.h"
+#include "frame_fanout.h"
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include <cstdint>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Player_Sink Class
+ * @desc A Frame_Sink playing the frames through an Audio_Player, which must be initialized for their format.
+ * @member m_player - the player, not owned, only used by the sink's thread while the fanout runs
+ * @note see frame_sinks.cpp for comments on functions
+ */
+class Player_Sink : public Frame_Sink
+{
+    Audio_Player &m_player;
+
+    public:
+
+    explicit Player_Sink(Audio_Player&);
+
+    std::string get_name() override;
+    Return_Status consume(AVFrame *) override;
+    Return_Status finish() override;
+    std::string poll_error() override;
+};
+
+/* Wav_Sink Class
+ * @desc A Frame_Sink writing the frames to a WAV file, EX: to archive what is played.
+ * @desc The format is taken from the first frame, interleaved 16 or 32 bit integer or 32 bit float samples are supported.
+ * @desc The sizes in the header are filled in by Wav_Sink::finish(), a file cut off before that has them as 0.
+ * @member m_path - the file to write
+ * @member m_file - the open file, -1 before the first frame
+ * @member m_format - the sample format of the file, taken from the first frame
+ * @member m_channels - the number of channels of the file
+ * @member m_sample_rate - the sample rate of the file
+ * @member m_data_bytes - the number of bytes of samples written
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see frame_sinks.cpp for comments on functions
+ */
+class Wav_Sink : public Frame_Sink
+{
+    std::string m_path;
+    int m_file;
+
+    enum AVSampleFormat m_format;
+    int m_channels;
+    int m_sample_rate;
+    uint64_t m_data_bytes;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    explicit Wav_Sink(const std::string&);
+    ~Wav_Sink();
+
+    std::string get_name() override;
+    Return_Status consume(AVFrame *) override;
+    Return_Status finish() override;
+    std::string poll_error() override;
+
+    uint64_t get_data_bytes();
+
+    private:
+
+    Return_Status open_file(const AVFrame *);
+    Return_Status write_header();
+    void enqueue_error(const std::string &error);
+};
+
+/* Meter_Sink Class
+ * @desc A Frame_Sink measuring the peak and RMS level of every channel, over the whole stream and over intervals that
+ * @desc can be printed as they complete, EX: to monitor the levels while playing.
+ * @desc 16 and 32 bit integer, float and double samples are supported, interleaved or planar.
+ * @member m_out - where the level of each interval is printed, nullptr to only measure
+ * @member m_interval - the length of an interval in seconds
+ * @member m_interval_samples - the samples per channel measured in the current interval
+ * @member m_interval_peak, m_interval_square - peak and sum of squares of each channel in the current interval
+ * @member m_peak, m_square - peak and sum of squares of each channel over the whole stream
+ * @member m_samples - the samples per channel measured over the whole stream
+ * @member m_intervals - the number of intervals completed
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see frame_sinks.cpp for comments on functions
+ */
+class Meter_Sink : public Frame_Sink
+{
+    std::ostream *m_out;
+    double m_interval;
+
+    int64_t m_interval_samples;
+    std::vector<double> m_interval_peak;
+    std::vector<double> m_interval_square;
+
+    std::vector<double> m_peak;
+    std::vector<double> m_square;
+    int64_t m_samples;
+    uint64_t m_intervals;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Meter_Sink(std::ostream *, double);
+
+    std::string get_name() override;
+    Return_Status consume(AVFrame *) override;
+    std::string poll_error() override;
+
+    int get_channels();
+    double get_peak_db(int);
+    double get_rms_db(int);
+    uint64_t get_intervals();
+
+    private:
+
+    template<typename T>
+    void measure(const AVFrame *, double, bool);
+    void print_interval();
+    void enqueue_error(const std::string &error);
+};
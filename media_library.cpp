@@ -0,0 +1,869 @@
+#include "media_library.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// errors past this many are dropped oldest first
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+// what a watch reports, a file is read once it was written and closed, never while it is being copied in
+const uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE;
+
+namespace
+{
+    // the tags looked up through m_tags by Media_Library::find_by_tag(), others are searched entry by entry
+    const char *const INDEXED_TAGS[] = {"title", "artist", "album", "album_artist", "composer", "genre", "date"};
+
+    const char INDEX_MAGIC[4] = {'M', 'L', 'I', 'B'};
+
+    /* to_lower() function
+     * @return text in lower case, for case insensitive tag lookups
+     */
+    std::string to_lower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    }
+
+    /* put() function
+     * @desc appends a value to an index being saved, in the byte order of the machine, an index is not meant to be moved
+     */
+    template<typename T>
+    void put(std::string &out, T value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /* put_string() function
+     * @desc appends a string to an index being saved, its length first
+     */
+    void put_string(std::string &out, const std::string &text)
+    {
+        put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    /* Index_Reader Struct
+     * @desc reads back what put() and put_string() wrote, every read fails once the data runs out
+     * @member position - the next byte to read
+     * @member end - one past the last byte
+     */
+    struct Index_Reader
+    {
+        const char *position;
+        const char *end;
+
+        template<typename T>
+        bool get(T &value)
+        {
+            if(static_cast<std::size_t>(end - position) < sizeof(value))
+            {
+                return false;
+            }
+
+            std::memcpy(&value, position, sizeof(value));
+            position += sizeof(value);
+            return true;
+        }
+
+        bool get_string(std::string &text)
+        {
+            uint32_t size = 0;
+            if(!get(size) || static_cast<std::size_t>(end - position) < size)
+            {
+                return false;
+            }
+
+            text.assign(position, size);
+            position += size;
+            return true;
+        }
+    };
+
+    /* stat_files() function
+     * @desc reads the size and modification time of many files in parallel, the way scan_metadata() reads them
+     * @param entries - set to one entry per path with the size and modification time, a file_size of -1 if it is gone
+     */
+    void stat_files(const std::vector<std::string> &paths, std::size_t threads, std::vector<Library_Entry> &entries)
+    {
+        entries.assign(paths.size(), Library_Entry{});
+
+        std::atomic<std::size_t> next{0};
+        auto stat_range = [&]()
+        {
+            for(std::size_t i = next.fetch_add(1, std::memory_order_relaxed); i < paths.size(); i = next.fetch_add(1, std::memory_order_relaxed))
+            {
+                struct stat file_status;
+                if(stat(paths[i].c_str(), &file_status) < 0 || !S_ISREG(file_status.st_mode))
+                {
+                    entries[i].file_size = -1;
+                    continue;
+                }
+
+                entries[i].file_size = file_status.st_size;
+                entries[i].file_mtime = static_cast<int64_t>(file_status.st_mtim.tv_sec) * 1000000000 + file_status.st_mtim.tv_nsec;
+            }
+        };
+
+        threads = std::max<std::size_t>(1, std::min(threads, paths.size()));
+
+        std::vector<std::thread> workers;
+        for(std::size_t i = 1; i < threads; i++)
+        {
+            workers.emplace_back(stat_range);
+        }
+
+        stat_range();
+
+        for(std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+
+
+
+/* Media_Library constructor
+ * @desc sets up an empty library, call Media_Library::load() to read a saved one
+ * @param index_path - the file the index is saved to and loaded from, EX: "~/.cache/player/library.index"
+ */
+Media_Library::Media_Library(const std::string &index_path) :
+    m_index_path{index_path}
+{
+    m_inotify = -1;
+}
+
+
+
+
+/* Media_Library destructor
+ * @desc stops watching, the index is not saved, see Media_Library::save()
+ */
+Media_Library::~Media_Library()
+{
+    if(m_inotify >= 0)
+    {
+        close(m_inotify);
+    }
+}
+
+
+
+
+/* Media_Library::load() function
+ * @desc replaces the library with the one saved to the index file
+ * @return Return_Status::STATUS_SUCCESS on success or if there is no index file yet, then the library is empty,
+ * @return Return_Status::STATUS_FAILURE if the index can't be read or was saved by another version, the library is empty
+ */
+Return_Status Media_Library::load()
+{
+    m_root.clear();
+    m_entries.clear();
+    rebuild_index();
+
+    std::ifstream in{m_index_path, std::ios::binary};
+    if(!in)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    std::string data{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    Index_Reader reader{data.data(), data.data() + data.size()};
+
+    char magic[sizeof(INDEX_MAGIC)] = {};
+    uint32_t version = 0;
+    uint64_t count = 0;
+
+    if(!reader.get(magic) || std::memcmp(magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || !reader.get(version))
+    {
+        enqueue_error(m_index_path + " is not a library index");
+        return STATUS_FAILURE;
+    }
+
+    if(version != INDEX_VERSION)
+    {
+        enqueue_error(m_index_path + " is version " + std::to_string(version) + ", expected " + std::to_string(INDEX_VERSION));
+        return STATUS_FAILURE;
+    }
+
+    std::string root;
+    bool valid = reader.get_string(root) && reader.get(count);
+
+    // a count larger than the data is a damaged index, don't reserve for it
+    std::vector<Library_Entry> entries;
+    entries.reserve(valid ? std::min<uint64_t>(count, data.size()) : 0);
+
+    for(uint64_t i = 0; valid && i < count; i++)
+    {
+        Library_Entry entry;
+        Media_Metadata &metadata = entry.metadata;
+        uint8_t flags = 0;
+        uint32_t tag_count = 0;
+
+        valid = reader.get(entry.file_size) && reader.get(entry.file_mtime) && reader.get_string(metadata.path) &&
+                reader.get_string(metadata.container) && reader.get_string(metadata.codec) && reader.get(flags) &&
+                reader.get(metadata.sample_rate) && reader.get(metadata.channels) && reader.get(metadata.channel_layout) &&
+                reader.get(metadata.bits_per_sample) && reader.get(metadata.bit_rate) && reader.get(metadata.duration) &&
+                reader.get_string(metadata.error) && reader.get(tag_count);
+
+        for(uint32_t j = 0; valid && j < tag_count; j++)
+        {
+            std::string key;
+            std::string value;
+            valid = reader.get_string(key) && reader.get_string(value);
+            metadata.tags.emplace(std::move(key), std::move(value));
+        }
+
+        metadata.playable = flags & 1;
+        metadata.duration_estimated = flags & 2;
+        metadata.probed = flags & 4;
+        metadata.has_cover_art = flags & 8;
+
+        entries.push_back(std::move(entry));
+    }
+
+    if(!valid || reader.position != reader.end)
+    {
+        enqueue_error(m_index_path + " is damaged");
+        return STATUS_FAILURE;
+    }
+
+    m_root = std::move(root);
+    m_entries = std::move(entries);
+    rebuild_index();
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Media_Library::save() function
+ * @desc writes the library to the index file, see Media_Library::load()
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note the index is written to a temporary file first and renamed, a reader never sees half of it
+ */
+Return_Status Media_Library::save()
+{
+    std::string data;
+    data.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    put<uint32_t>(data, INDEX_VERSION);
+    put_string(data, m_root);
+    put<uint64_t>(data, m_entries.size());
+
+    for(const Library_Entry &entry : m_entries)
+    {
+        const Media_Metadata &metadata = entry.metadata;
+        uint8_t flags = (metadata.playable ? 1 : 0) | (metadata.duration_estimated ? 2 : 0) | (metadata.probed ? 4 : 0) |
+                        (metadata.has_cover_art ? 8 : 0);
+
+        put(data, entry.file_size);
+        put(data, entry.file_mtime);
+        put_string(data, metadata.path);
+        put_string(data, metadata.container);
+        put_string(data, metadata.codec);
+        put(data, flags);
+        put(data, metadata.sample_rate);
+        put(data, metadata.channels);
+        put(data, metadata.channel_layout);
+        put(data, metadata.bits_per_sample);
+        put(data, metadata.bit_rate);
+        put(data, metadata.duration);
+        put_string(data, metadata.error);
+        put<uint32_t>(data, static_cast<uint32_t>(metadata.tags.size()));
+
+        for(const auto &tag : metadata.tags)
+        {
+            put_string(data, tag.first);
+            put_string(data, tag.second);
+        }
+    }
+
+    std::string temporary = m_index_path + ".tmp";
+
+    {
+        std::ofstream out{temporary, std::ios::binary};
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+        if(!out.flush())
+        {
+            enqueue_error("Failed to write " + temporary);
+            std::remove(temporary.c_str());
+            return STATUS_FAILURE;
+        }
+    }
+
+    if(std::rename(temporary.c_str(), m_index_path.c_str()) != 0)
+    {
+        enqueue_error("Failed to rename " + temporary + " to " + m_index_path);
+        std::remove(temporary.c_str());
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Media_Library::update() function
+ * @desc brings the library up to date with a directory, only new files and files whose size or modification time
+ * @desc changed are read, files that are gone are dropped
+ * @param root - the directory, a library built from another directory starts over
+ * @param threads - the number of threads to read on, EX: std::thread::hardware_concurrency(), at least one is used
+ * @param stats - set to what changed, see Library_Update_Stats
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if root could not be read,
+ * @return the library is left as it was
+ */
+Return_Status Media_Library::update(const std::string &root, std::size_t threads, Library_Update_Stats &stats)
+{
+    stats = Library_Update_Stats{};
+
+    std::string directory = root;
+    while(directory.size() > 1 && directory.back() == '/')
+    {
+        directory.pop_back();
+    }
+
+    std::vector<std::string> paths;
+    std::string error;
+    if(list_media_files(directory, paths, error) == STATUS_FAILURE)
+    {
+        enqueue_error(error);
+        return STATUS_FAILURE;
+    }
+
+    if(directory != m_root)
+    {
+        m_root = directory;
+        m_entries.clear();
+        rebuild_index();
+    }
+
+    std::vector<Library_Entry> found;
+    stat_files(paths, threads, found);
+
+    std::vector<Library_Entry> pending;
+    std::vector<std::size_t> pending_positions;
+    std::size_t kept = 0;
+
+    for(std::size_t i = 0; i < paths.size(); i++)
+    {
+        // gone since it was listed
+        if(found[i].file_size < 0)
+        {
+            continue;
+        }
+
+        auto known = m_paths.find(paths[i]);
+        if(known != m_paths.end())
+        {
+            kept++;
+
+            Library_Entry &entry = m_entries[known->second];
+            if(entry.file_size == found[i].file_size && entry.file_mtime == found[i].file_mtime)
+            {
+                found[i].metadata = std::move(entry.metadata);
+                stats.unchanged++;
+                continue;
+            }
+        }
+
+        (known != m_paths.end() ? stats.changed : stats.added)++;
+
+        found[i].metadata.path = paths[i];
+        pending.push_back(std::move(found[i]));
+        pending_positions.push_back(i);
+    }
+
+    stats.removed = m_entries.size() - kept;
+
+    read_files(pending, threads, stats);
+
+    for(std::size_t i = 0; i < pending.size(); i++)
+    {
+        found[pending_positions[i]] = std::move(pending[i]);
+    }
+
+    found.erase(std::remove_if(found.begin(), found.end(), [](const Library_Entry &entry) { return entry.file_size < 0; }), found.end());
+
+    m_entries = std::move(found);
+    rebuild_index();
+
+    stats.files = m_entries.size();
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Media_Library::watch() function
+ * @desc starts watching the directory of the library and every directory below it with inotify,
+ * @desc see Media_Library::process_events()
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the library has no directory yet or
+ * @return inotify could not be set up, directories that can't be watched are skipped with an error queued
+ */
+Return_Status Media_Library::watch()
+{
+    if(m_root.empty())
+    {
+        enqueue_error("The library has no directory to watch, update it first");
+        return STATUS_FAILURE;
+    }
+
+    if(m_inotify < 0)
+    {
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(m_inotify < 0)
+        {
+            enqueue_error("Failed to set up inotify: " + std::string{std::strerror(errno)});
+            return STATUS_FAILURE;
+        }
+    }
+
+    add_watches(m_root);
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Media_Library::get_watch_descriptor() function
+ * @return the inotify descriptor to poll for reading, -1 before Media_Library::watch()
+ */
+int Media_Library::get_watch_descriptor()
+{
+    return m_inotify;
+}
+
+
+
+
+/* Media_Library::process_events() function
+ * @desc brings the library up to date with what inotify reported since the last call, only the files reported are read,
+ * @desc a directory created, moved or removed, or events lost to an overflow, take a Media_Library::update() instead
+ * @param threads - the number of threads to read on
+ * @param stats - set to what changed, nothing changed if no events were waiting
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the library is not watched or
+ * @return the events could not be read
+ * @note it does not block, call it when the descriptor of Media_Library::get_watch_descriptor() is readable
+ */
+Return_Status Media_Library::process_events(std::size_t threads, Library_Update_Stats &stats)
+{
+    stats = Library_Update_Stats{};
+    stats.files = m_entries.size();
+
+    if(m_inotify < 0)
+    {
+        enqueue_error("The library is not watched");
+        return STATUS_FAILURE;
+    }
+
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    std::set<std::string> touched;
+    bool rescan = false;
+
+    for(;;)
+    {
+        ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+        if(length < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+
+        if(length <= 0)
+        {
+            enqueue_error("Failed to read inotify events: " + std::string{std::strerror(errno)});
+            return STATUS_FAILURE;
+        }
+
+        for(char *position = buffer; position < buffer + length;)
+        {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(position);
+            position += sizeof(struct inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW)
+            {
+                rescan = true;
+                continue;
+            }
+
+            if(event->mask & IN_IGNORED)
+            {
+                m_watches.erase(event->wd);
+                continue;
+            }
+
+            auto watched = m_watches.find(event->wd);
+            if(watched == m_watches.end() || event->len == 0)
+            {
+                continue;
+            }
+
+            std::string path = watched->second + '/' + event->name;
+
+            // a directory brings or takes everything in it, and a new one needs watches
+            if(event->mask & IN_ISDIR)
+            {
+                rescan = true;
+            }
+
+            // a created file is read once it was written, on IN_CLOSE_WRITE
+            else if(!(event->mask & IN_CREATE) && is_media_file(path))
+            {
+                touched.insert(path);
+            }
+        }
+    }
+
+    if(rescan)
+    {
+        if(update(m_root, threads, stats) == STATUS_FAILURE)
+        {
+            return STATUS_FAILURE;
+        }
+
+        add_watches(m_root);
+        return STATUS_SUCCESS;
+    }
+
+    std::vector<Library_Entry> pending;
+    std::set<std::string> gone;
+
+    for(const std::string &path : touched)
+    {
+        auto known = m_paths.find(path);
+
+        struct stat file_status;
+        if(stat(path.c_str(), &file_status) < 0 || !S_ISREG(file_status.st_mode))
+        {
+            if(known != m_paths.end())
+            {
+                gone.insert(path);
+            }
+            continue;
+        }
+
+        Library_Entry entry;
+        entry.file_size = file_status.st_size;
+        entry.file_mtime = static_cast<int64_t>(file_status.st_mtim.tv_sec) * 1000000000 + file_status.st_mtim.tv_nsec;
+
+        if(known != m_paths.end() && m_entries[known->second].file_size == entry.file_size &&
+           m_entries[known->second].file_mtime == entry.file_mtime)
+        {
+            stats.unchanged++;
+            continue;
+        }
+
+        (known != m_paths.end() ? stats.changed : stats.added)++;
+
+        entry.metadata.path = path;
+        pending.push_back(std::move(entry));
+    }
+
+    if(pending.empty() && gone.empty())
+    {
+        return STATUS_SUCCESS;
+    }
+
+    read_files(pending, threads, stats);
+
+    for(Library_Entry &entry : pending)
+    {
+        auto known = m_paths.find(entry.metadata.path);
+        if(known != m_paths.end())
+        {
+            m_entries[known->second] = std::move(entry);
+        }
+        else
+        {
+            m_entries.push_back(std::move(entry));
+        }
+    }
+
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [&gone](const Library_Entry &entry) { return gone.count(entry.metadata.path) > 0; }),
+                    m_entries.end());
+
+    std::sort(m_entries.begin(), m_entries.end(),
+              [](const Library_Entry &a, const Library_Entry &b) { return a.metadata.path < b.metadata.path; });
+
+    rebuild_index();
+
+    stats.removed = gone.size();
+    stats.files = m_entries.size();
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Media_Library::find() function
+ * @param path - a file, as listed below the directory of the library, EX: "<root>/Artist/Album/01.flac"
+ * @return the entry of the file, nullptr if it is not in the library
+ */
+const Library_Entry *Media_Library::find(const std::string &path)
+{
+    auto known = m_paths.find(path);
+    return known == m_paths.end() ? nullptr : &m_entries[known->second];
+}
+
+
+
+
+/* Media_Library::find_by_tag() function
+ * @param key - the tag, EX: "artist", case insensitive
+ * @param value - the value of the tag, case insensitive, EX: "the beatles" finds "The Beatles"
+ * @return the entries of the files whose tag has that value, sorted by path
+ */
+std::vector<const Library_Entry*> Media_Library::find_by_tag(const std::string &key, const std::string &value)
+{
+    std::string tag = to_lower(key);
+    std::string wanted = to_lower(value);
+    std::vector<const Library_Entry*> found;
+
+    bool indexed = std::find_if(std::begin(INDEXED_TAGS), std::end(INDEXED_TAGS),
+                                [&tag](const char *indexed_tag) { return tag == indexed_tag; }) != std::end(INDEXED_TAGS);
+
+    if(indexed)
+    {
+        auto matches = m_tags.find(tag + '\0' + wanted);
+        if(matches != m_tags.end())
+        {
+            for(std::size_t position : matches->second)
+            {
+                found.push_back(&m_entries[position]);
+            }
+        }
+
+        return found;
+    }
+
+    for(const Library_Entry &entry : m_entries)
+    {
+        auto match = entry.metadata.tags.find(tag);
+        if(match != entry.metadata.tags.end() && to_lower(match->second) == wanted)
+        {
+            found.push_back(&entry);
+        }
+    }
+
+    return found;
+}
+
+
+
+
+/* Media_Library::get_entries() function
+ * @return the files of the library, sorted by path
+ */
+const std::vector<Library_Entry> &Media_Library::get_entries()
+{
+    return m_entries;
+}
+
+
+
+
+/* Media_Library::get_root() function
+ * @return the directory the library was built from, empty before the first update
+ */
+const std::string &Media_Library::get_root()
+{
+    return m_root;
+}
+
+
+
+
+/* Media_Library::get_index_path() function
+ * @return the file the index is saved to and loaded from
+ */
+const std::string &Media_Library::get_index_path()
+{
+    return m_index_path;
+}
+
+
+
+
+/* Media_Library::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Media_Library::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Media_Library::read_files() function
+ * @desc reads the metadata of entries in parallel with scan_metadata(), their path, size and modification time are set
+ * @param stats - failed is counted
+ * @note this function is under the private specifier
+ */
+void Media_Library::read_files(std::vector<Library_Entry> &entries, std::size_t threads, Library_Update_Stats &stats)
+{
+    if(entries.empty())
+    {
+        return;
+    }
+
+    std::vector<std::string> paths;
+    paths.reserve(entries.size());
+    for(const Library_Entry &entry : entries)
+    {
+        paths.push_back(entry.metadata.path);
+    }
+
+    std::vector<Media_Metadata> metadata;
+    scan_metadata(paths, threads, metadata);
+
+    for(std::size_t i = 0; i < entries.size(); i++)
+    {
+        if(!metadata[i].error.empty())
+        {
+            stats.failed++;
+        }
+
+        entries[i].metadata = std::move(metadata[i]);
+    }
+}
+
+
+
+
+/* Media_Library::rebuild_index() function
+ * @desc fills m_paths and m_tags from m_entries, after m_entries changed
+ * @note this function is under the private specifier
+ */
+void Media_Library::rebuild_index()
+{
+    m_paths.clear();
+    m_tags.clear();
+    m_paths.reserve(m_entries.size());
+
+    for(std::size_t i = 0; i < m_entries.size(); i++)
+    {
+        const Media_Metadata &metadata = m_entries[i].metadata;
+        m_paths.emplace(metadata.path, i);
+
+        for(const char *tag : INDEXED_TAGS)
+        {
+            auto value = metadata.tags.find(tag);
+            if(value != metadata.tags.end())
+            {
+                m_tags[tag + std::string(1, '\0') + to_lower(value->second)].push_back(i);
+            }
+        }
+    }
+}
+
+
+
+
+/* Media_Library::add_watches() function
+ * @desc watches a directory and every directory below it, directories already watched keep their watch
+ * @note this function is under the private specifier
+ */
+void Media_Library::add_watches(const std::string &directory)
+{
+    std::vector<std::string> pending{directory};
+
+    while(!pending.empty())
+    {
+        std::string current = pending.back();
+        pending.pop_back();
+
+        int watch_descriptor = inotify_add_watch(m_inotify, current.c_str(), WATCH_EVENTS | IN_ONLYDIR);
+        if(watch_descriptor < 0)
+        {
+            // ENOSPC is the per user limit, fs.inotify.max_user_watches
+            enqueue_error("Failed to watch " + current + ": " + std::strerror(errno));
+            continue;
+        }
+
+        m_watches[watch_descriptor] = current;
+
+        DIR *dir = opendir(current.c_str());
+        if(!dir)
+        {
+            continue;
+        }
+
+        for(struct dirent *entry = readdir(dir); entry; entry = readdir(dir))
+        {
+            if(std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+            {
+                continue;
+            }
+
+            std::string path = current + '/' + entry->d_name;
+            bool is_directory = entry->d_type == DT_DIR;
+
+            // some file systems don't fill in the type
+            if(entry->d_type == DT_UNKNOWN)
+            {
+                struct stat file_status;
+                is_directory = stat(path.c_str(), &file_status) == 0 && S_ISDIR(file_status.st_mode);
+            }
+
+            if(is_directory)
+            {
+                pending.push_back(path);
+            }
+        }
+
+        closedir(dir);
+    }
+}
+
+
+
+
+/* Media_Library::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, the oldest is dropped once MAX_QUEUED_ERRORS are queued
+ * @note this function is under the private specifier
+ */
+void Media_Library::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
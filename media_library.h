@@ -0,0 +1,119 @@
+#pragma once
+
+#include "metadata_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Library_Entry Struct
+ * @desc a file of a Media_Library
+ * @member file_size - the size of the file when it was read, in bytes
+ * @member file_mtime - the modification time of the file when it was read, in nanoseconds
+ * @member metadata - what was read, metadata.error is set for a file that could not be read, it is kept so it is not read again
+ */
+struct Library_Entry
+{
+    int64_t file_size = 0;
+    int64_t file_mtime = 0;
+    Media_Metadata metadata;
+};
+
+/* Library_Update_Stats Struct
+ * @desc what a Media_Library::update() or Media_Library::process_events() did
+ * @member files - the number of files in the library afterwards
+ * @member unchanged - the files kept without being read, their size and modification time matched
+ * @member added - the new files read
+ * @member changed - the files read again as their size or modification time changed
+ * @member removed - the files dropped as they are gone
+ * @member failed - the files read that could not be, they are included in added or changed
+ */
+struct Library_Update_Stats
+{
+    std::size_t files = 0;
+    std::size_t unchanged = 0;
+    std::size_t added = 0;
+    std::size_t changed = 0;
+    std::size_t removed = 0;
+    std::size_t failed = 0;
+};
+
+/* Media_Library Class
+ * @desc A persistent index of the media files below a directory, with their codec, sample rate, channels, duration and tags.
+ * @desc Media_Library::update() lists the directory and only reads the files that are new or whose size or modification
+ * @desc time changed, in parallel with scan_metadata(), so rescanning an unchanged library costs a directory walk and a
+ * @desc stat() per file. Media_Library::save() and Media_Library::load() keep the index in a binary file between runs.
+ * @desc A long running process, EX: Player_Daemon, can call Media_Library::watch() and poll the descriptor from
+ * @desc Media_Library::get_watch_descriptor(), Media_Library::process_events() then reads only the files inotify reported.
+ * @desc Lookups by path and by the common tags, EX: artist, album, title, genre, go through hash maps, other tags are
+ * @desc searched entry by entry.
+ * @member m_index_path - the file the index is saved to and loaded from
+ * @member m_root - the directory the library was built from, empty before the first update
+ * @member m_entries - the files, sorted by path
+ * @member m_paths - the position in m_entries of every path
+ * @member m_tags - the positions in m_entries of the files with a tag value, keyed by the tag, a '\0' and the lower case value
+ * @member m_inotify - the inotify descriptor, -1 before Media_Library::watch()
+ * @member m_watches - the directory of every inotify watch
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note the pointers returned by the lookups are valid until the library is next updated or loaded
+ * @note see media_library.cpp for comments on functions
+ */
+class Media_Library
+{
+    std::string m_index_path;
+    std::string m_root;
+
+    std::vector<Library_Entry> m_entries;
+    std::unordered_map<std::string, std::size_t> m_paths;
+    std::unordered_map<std::string, std::vector<std::size_t>> m_tags;
+
+    int m_inotify;
+    std::unordered_map<int, std::string> m_watches;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    static constexpr uint32_t INDEX_VERSION = 1;
+
+    Media_Library(const std::string&);
+    ~Media_Library();
+
+    Media_Library(const Media_Library&) = delete;
+    Media_Library &operator=(const Media_Library&) = delete;
+
+    Return_Status load();
+    Return_Status save();
+    Return_Status update(const std::string&, std::size_t, Library_Update_Stats&);
+
+    Return_Status watch();
+    int get_watch_descriptor();
+    Return_Status process_events(std::size_t, Library_Update_Stats&);
+
+    const Library_Entry *find(const std::string&);
+    std::vector<const Library_Entry*> find_by_tag(const std::string&, const std::string&);
+    const std::vector<Library_Entry> &get_entries();
+    const std::string &get_root();
+    const std::string &get_index_path();
+
+    std::string poll_error();
+
+    private:
+
+    void read_files(std::vector<Library_Entry>&, std::size_t, Library_Update_Stats&);
+    void rebuild_index();
+    void add_watches(const std::string&);
+    void enqueue_error(const std::string &error);
+};
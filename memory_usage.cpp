@@ -0,0 +1,46 @@
+#include "memory_usage.h"
+
+#include <cstdio>
+
+
+
+
+/* read_memory_usage() function
+ * @desc reads the current and peak resident set size of the process from /proc/self/status
+ * @param usage - filled with the memory use on success
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if /proc could not be read
+ * @note this opens a file, so don't call it from a real time thread
+ */
+Return_Status read_memory_usage(Memory_Usage &usage)
+{
+    std::FILE *status = std::fopen("/proc/self/status", "r");
+    if(!status)
+    {
+        return STATUS_FAILURE;
+    }
+
+    bool found_resident = false;
+    bool found_peak = false;
+    char line[256];
+
+    while(std::fgets(line, sizeof(line), status))
+    {
+        unsigned long kilobytes = 0;
+
+        if(std::sscanf(line, "VmRSS: %lu kB", &kilobytes) == 1)
+        {
+            usage.resident_kb = kilobytes;
+            found_resident = true;
+        }
+
+        else if(std::sscanf(line, "VmHWM: %lu kB", &kilobytes) == 1)
+        {
+            usage.peak_resident_kb = kilobytes;
+            found_peak = true;
+        }
+    }
+
+    std::fclose(status);
+
+    return found_resident && found_peak ? STATUS_SUCCESS : STATUS_FAILURE;
+}
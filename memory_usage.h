@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Memory_Usage Struct
+ * @desc the memory use of the process as reported by the kernel
+ * @member resident_kb - the resident set size, memory currently in RAM, in KiB
+ * @member peak_resident_kb - the highest resident set size so far, in KiB
+ */
+struct Memory_Usage
+{
+    std::size_t resident_kb;
+    std::size_t peak_resident_kb;
+};
+
+Return_Status read_memory_usage(Memory_Usage&);
@@ -0,0 +1,392 @@
+#include "metadata_reader.h"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+// errors past this many are dropped oldest first
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+// the extensions list_media_files() picks up, the formats of the README's Supported Formats section
+const char *const MEDIA_EXTENSIONS[] = {"m4a", "mp3", "aac", "flac", "m4b", "ogg", "oga", "opus", "ra", "rm", "tta", "webm",
+                                        "au", "wav", "mkv", "avi"};
+
+
+
+
+/* Metadata_Reader constructor
+ * @desc only sets up the error queue, files are opened by Metadata_Reader::read()
+ */
+Metadata_Reader::Metadata_Reader()
+{}
+
+
+
+
+/* Metadata_Reader::read() function
+ * @desc opens a file's container header and reads its tags, duration and audio codec parameters, no codec is opened
+ * @param path - the file to read
+ * @param metadata - set to what was found, see Media_Metadata
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the file could not be opened or has no
+ * @return audio stream
+ */
+Return_Status Metadata_Reader::read(const std::string &path, Media_Metadata &metadata)
+{
+    metadata = Media_Metadata{};
+    metadata.path = path;
+
+    AVFormatContext *fmt_ctx = avformat_alloc_context();
+    if(!fmt_ctx)
+    {
+        enqueue_error("Failed to allocate AVFormatContext");
+        return STATUS_FAILURE;
+    }
+
+    // the header is all that is read, a small probe is enough to detect the format
+    fmt_ctx->probesize = PROBE_SIZE;
+    fmt_ctx->format_probesize = PROBE_SIZE;
+    fmt_ctx->max_analyze_duration = MAX_ANALYZE_DURATION;
+
+    // frees fmt_ctx on failure
+    int error = avformat_open_input(&fmt_ctx, path.c_str(), nullptr, nullptr);
+    if(error < 0)
+    {
+        enqueue_error("Failed to open " + path);
+        enqueue_error(error);
+        return STATUS_FAILURE;
+    }
+
+    int stream_number = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+
+    // formats without a stream header, EX: raw aac or an mp3 without a Xing header, only tell once packets are analyzed
+    if(stream_number < 0 || fmt_ctx->streams[stream_number]->codecpar->sample_rate <= 0 ||
+       fmt_ctx->streams[stream_number]->codecpar->channels <= 0)
+    {
+        metadata.probed = true;
+
+        error = avformat_find_stream_info(fmt_ctx, nullptr);
+        if(error < 0)
+        {
+            enqueue_error("Failed to read stream info of " + path);
+            enqueue_error(error);
+            avformat_close_input(&fmt_ctx);
+            return STATUS_FAILURE;
+        }
+
+        stream_number = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    }
+
+    if(stream_number < 0)
+    {
+        enqueue_error(path + " has no audio stream");
+        enqueue_error(stream_number);
+        avformat_close_input(&fmt_ctx);
+        return STATUS_FAILURE;
+    }
+
+    AVStream *stream = fmt_ctx->streams[stream_number];
+    AVCodecParameters *codecpar = stream->codecpar;
+
+    metadata.container = fmt_ctx->iformat->name;
+    metadata.codec = avcodec_get_name(codecpar->codec_id);
+    metadata.playable = avcodec_find_decoder(codecpar->codec_id) != nullptr;
+    metadata.sample_rate = codecpar->sample_rate;
+    metadata.channels = codecpar->channels;
+    metadata.channel_layout = static_cast<int64_t>(codecpar->channel_layout);
+    metadata.bits_per_sample = codecpar->bits_per_raw_sample > 0 ? codecpar->bits_per_raw_sample : av_get_bits_per_sample(codecpar->codec_id);
+    metadata.bit_rate = codecpar->bit_rate > 0 ? codecpar->bit_rate : fmt_ctx->bit_rate;
+    metadata.duration = find_duration(fmt_ctx, stream, metadata.duration_estimated);
+
+    // the container's tags win over the stream's, ogg and opus keep theirs on the stream
+    read_tags(fmt_ctx->metadata, metadata);
+    read_tags(stream->metadata, metadata);
+
+    for(unsigned int i = 0; i < fmt_ctx->nb_streams && !metadata.has_cover_art; i++)
+    {
+        AVStream *other = fmt_ctx->streams[i];
+        AVDictionaryEntry *mimetype = av_dict_get(other->metadata, "mimetype", nullptr, 0);
+
+        metadata.has_cover_art = (other->disposition & AV_DISPOSITION_ATTACHED_PIC) ||
+                                 (other->codecpar->codec_type == AVMEDIA_TYPE_ATTACHMENT && mimetype &&
+                                  std::strncmp(mimetype->value, "image/", 6) == 0);
+    }
+
+    // a vorbis comment picture that was not turned into a stream
+    if(metadata.tags.count("metadata_block_picture"))
+    {
+        metadata.has_cover_art = true;
+        metadata.tags.erase("metadata_block_picture");
+    }
+
+    avformat_close_input(&fmt_ctx);
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Metadata_Reader::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Metadata_Reader::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Metadata_Reader::read_tags() function
+ * @desc adds the entries of a dictionary to the tags of metadata with lower case keys, a key already there is kept
+ * @note this function is under the private specifier
+ */
+void Metadata_Reader::read_tags(AVDictionary *dictionary, Media_Metadata &metadata)
+{
+    AVDictionaryEntry *entry = nullptr;
+    while((entry = av_dict_get(dictionary, "", entry, AV_DICT_IGNORE_SUFFIX)))
+    {
+        std::string key{entry->key};
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        metadata.tags.emplace(key, entry->value);
+    }
+}
+
+
+
+
+/* Metadata_Reader::find_duration() function
+ * @desc works out the length of a file from what its header says, or from its size and bit rate if it says nothing
+ * @param estimated - set to true if the length came from the bit rate
+ * @return the length in AV_TIME_BASE units, AV_NOPTS_VALUE if unknown
+ * @note this function is under the private specifier
+ */
+int64_t Metadata_Reader::find_duration(AVFormatContext *fmt_ctx, AVStream *stream, bool &estimated)
+{
+    estimated = false;
+
+    if(fmt_ctx->duration != AV_NOPTS_VALUE && fmt_ctx->duration > 0)
+    {
+        estimated = fmt_ctx->duration_estimation_method == AVFMT_DURATION_FROM_BITRATE;
+        return fmt_ctx->duration;
+    }
+
+    if(stream->duration != AV_NOPTS_VALUE && stream->duration > 0)
+    {
+        return av_rescale_q(stream->duration, stream->time_base, AVRational{1, AV_TIME_BASE});
+    }
+
+    int64_t bit_rate = stream->codecpar->bit_rate > 0 ? stream->codecpar->bit_rate : fmt_ctx->bit_rate;
+    int64_t size = fmt_ctx->pb ? avio_size(fmt_ctx->pb) : -1;
+    if(bit_rate > 0 && size > 0)
+    {
+        estimated = true;
+        return av_rescale(size * 8, AV_TIME_BASE, bit_rate);
+    }
+
+    return AV_NOPTS_VALUE;
+}
+
+
+
+
+/* Metadata_Reader::enqueue_error() function
+ * @desc enqueues the description of an FFmpeg error code onto m_errors
+ * @note this function is under the private specifier
+ */
+void Metadata_Reader::enqueue_error(int error_code)
+{
+    char buff[256];
+    if(av_strerror(error_code, buff, sizeof(buff)) < 0)
+    {
+        enqueue_error("Error code not found");
+    }
+    else
+    {
+        enqueue_error(std::string{buff});
+    }
+}
+
+
+
+
+/* Metadata_Reader::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, the oldest is dropped once MAX_QUEUED_ERRORS are queued
+ * @note this function is under the private specifier
+ */
+void Metadata_Reader::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
+
+
+
+
+/* is_media_file() function
+ * @param path - a file name
+ * @return true if the extension is one of the supported formats, in any case, EX: "song.FLAC"
+ */
+bool is_media_file(const std::string &path)
+{
+    std::size_t dot = path.rfind('.');
+    if(dot == std::string::npos || path.find('/', dot) != std::string::npos)
+    {
+        return false;
+    }
+
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    for(const char *media_extension : MEDIA_EXTENSIONS)
+    {
+        if(extension == media_extension)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+
+/* list_media_files() function
+ * @desc finds the media files in a directory and all directories below it, see is_media_file()
+ * @param directory - the directory to search
+ * @param paths - the files found are added to it, sorted
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if directory could not be read,
+ * @return directories below it that can't be read are skipped
+ */
+Return_Status list_media_files(const std::string &directory, std::vector<std::string> &paths, std::string &error)
+{
+    std::vector<std::string> pending{directory};
+    std::size_t first = paths.size();
+
+    while(!pending.empty())
+    {
+        std::string current = pending.back();
+        pending.pop_back();
+
+        DIR *dir = opendir(current.c_str());
+        if(!dir)
+        {
+            if(current == directory)
+            {
+                error = "Failed to read directory " + directory;
+                return STATUS_FAILURE;
+            }
+            continue;
+        }
+
+        for(struct dirent *entry = readdir(dir); entry; entry = readdir(dir))
+        {
+            if(std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+            {
+                continue;
+            }
+
+            std::string path = current + '/' + entry->d_name;
+            bool is_directory = entry->d_type == DT_DIR;
+
+            // some file systems don't fill in the type
+            if(entry->d_type == DT_UNKNOWN)
+            {
+                struct stat file_status;
+                is_directory = stat(path.c_str(), &file_status) == 0 && S_ISDIR(file_status.st_mode);
+            }
+
+            if(is_directory)
+            {
+                pending.push_back(path);
+            }
+            else if(is_media_file(path))
+            {
+                paths.push_back(path);
+            }
+        }
+
+        closedir(dir);
+    }
+
+    std::sort(paths.begin() + first, paths.end());
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* scan_metadata() function
+ * @desc reads the metadata of many files in parallel, every thread with its own Metadata_Reader taking the next file not read yet
+ * @param paths - the files to read
+ * @param threads - the number of threads to read on, EX: std::thread::hardware_concurrency(), at least one is used
+ * @param metadata - set to one entry per path in the same order, an entry's error is set if its file could not be read
+ */
+void scan_metadata(const std::vector<std::string> &paths, std::size_t threads, std::vector<Media_Metadata> &metadata)
+{
+    metadata.assign(paths.size(), Media_Metadata{});
+
+    std::atomic<std::size_t> next{0};
+    auto read_files = [&]()
+    {
+        Metadata_Reader reader;
+
+        for(std::size_t i = next.fetch_add(1, std::memory_order_relaxed); i < paths.size(); i = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            if(reader.read(paths[i], metadata[i]) == STATUS_FAILURE)
+            {
+                metadata[i].error = reader.poll_error();
+                for(std::string error = reader.poll_error(); !error.empty(); error = reader.poll_error())
+                {
+                    metadata[i].error += ": " + error;
+                }
+            }
+        }
+    };
+
+    threads = std::max<std::size_t>(1, std::min(threads, paths.size()));
+
+    std::vector<std::thread> workers;
+    for(std::size_t i = 1; i < threads; i++)
+    {
+        workers.emplace_back(read_files);
+    }
+
+    // the calling thread reads too
+    read_files();
+
+    for(std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
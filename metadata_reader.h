@@ -0,0 +1,101 @@
+#pragma once
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Media_Metadata Struct
+ * @desc what Metadata_Reader::read() finds out about a file without decoding it
+ * @member path - the file
+ * @member container - the short name of the container format, EX: "flac", "mov,mp4,m4a,3gp,3g2,mj2"
+ * @member codec - the short name of the audio codec, EX: "aac"
+ * @member playable - true if FFmpeg has a decoder for the codec, the decoder is looked up but not opened
+ * @member sample_rate - the sample rate of the audio stream, 0 if unknown
+ * @member channels - the number of channels of the audio stream, 0 if unknown
+ * @member channel_layout - the channel layout of the audio stream, 0 if unknown
+ * @member bits_per_sample - the bits per sample stored or decoded, 0 for lossy codecs and if unknown
+ * @member bit_rate - the bit rate of the audio stream, or of the whole file, in bits per second, 0 if unknown
+ * @member duration - the length in AV_TIME_BASE units (microseconds), AV_NOPTS_VALUE if unknown
+ * @member duration_estimated - true if duration was worked out from the file size and bit rate, EX: an mp3 without a Xing header
+ * @member probed - true if the header did not describe the stream and packets had to be analyzed
+ * @member has_cover_art - true if the file carries a picture, EX: an attached picture in an mp3 or m4a, an image attachment in a mkv
+ * @member tags - the tags of the file and of its audio stream, with lower case keys, EX: "title", "artist", "album"
+ * @member error - empty on success, what went wrong when set by scan_metadata()
+ */
+struct Media_Metadata
+{
+    std::string path;
+    std::string container;
+    std::string codec;
+    bool playable = false;
+
+    int sample_rate = 0;
+    int channels = 0;
+    int64_t channel_layout = 0;
+    int bits_per_sample = 0;
+    int64_t bit_rate = 0;
+
+    int64_t duration = AV_NOPTS_VALUE;
+    bool duration_estimated = false;
+    bool probed = false;
+
+    bool has_cover_art = false;
+    std::map<std::string, std::string> tags;
+
+    std::string error;
+};
+
+/* Metadata_Reader Class
+ * @desc Reads the tags, duration and codec parameters of a file from its container header, without opening a codec.
+ * @desc FFmpeg_Decoder::open_file() analyzes packets with avformat_find_stream_info() and FFmpeg_Decoder::init() opens the
+ * @desc codec, neither is needed to list a file: formats that describe the stream in their header, EX: flac, wav, mp4, mkv,
+ * @desc ogg, are read with a 32 KiB probe and nothing else. Only when the header leaves the sample rate or channels unknown
+ * @desc are packets analyzed, and then at most MAX_ANALYZE_DURATION of them.
+ * @desc A reader holds no state between files, one reader per thread can read files in parallel, see scan_metadata().
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see metadata_reader.cpp for comments on functions
+ */
+class Metadata_Reader
+{
+    std::queue<std::string> m_errors;
+
+    public:
+
+    static constexpr int PROBE_SIZE = 32 * 1024;
+    static constexpr int64_t MAX_ANALYZE_DURATION = AV_TIME_BASE / 2;
+
+    Metadata_Reader();
+
+    Return_Status read(const std::string&, Media_Metadata&);
+
+    std::string poll_error();
+
+    private:
+
+    void read_tags(AVDictionary *, Media_Metadata&);
+    int64_t find_duration(AVFormatContext *, AVStream *, bool&);
+    void enqueue_error(int error_code);
+    void enqueue_error(const std::string &error);
+};
+
+bool is_media_file(const std::string&);
+Return_Status list_media_files(const std::string&, std::vector<std::string>&, std::string&);
+void scan_metadata(const std::vector<std::string>&, std::size_t, std::vector<Media_Metadata>&);
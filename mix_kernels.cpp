@@ -0,0 +1,179 @@
+#include "mix_kernels.h"
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+#include <cmath>
+#include <cstddef>
+
+
+
+
+/* mix_add() function
+ * @desc adds gain * source onto destination, destination[i] += source[i] * gain
+ * @param destination - the mix buffer
+ * @param source - the samples to add
+ * @param count - the number of samples, channels * sample frames
+ * @param gain - linear gain applied to source
+ */
+void mix_add(float *destination, const float *source, std::size_t count, float gain)
+{
+    std::size_t i = 0;
+
+#if defined(__AVX__)
+    __m256 gain_vector = _mm256_set1_ps(gain);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_mul_ps(_mm256_loadu_ps(source + i), gain_vector));
+        _mm256_storeu_ps(destination + i, mixed);
+    }
+#elif defined(__SSE__)
+    __m128 gain_vector = _mm_set1_ps(gain);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 mixed = _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), gain_vector));
+        _mm_storeu_ps(destination + i, mixed);
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        destination[i] += source[i] * gain;
+    }
+}
+
+
+
+
+/* mix_add_ramp() function
+ * @desc like mix_add() but the gain changes linearly from one sample frame to the next, used to fade sources in and out
+ * @param destination - the mix buffer
+ * @param source - the samples to add
+ * @param frames - the number of sample frames
+ * @param channels - the number of interleaved channels
+ * @param gain - the gain applied to the first sample frame
+ * @param gain_step - added to the gain after every sample frame
+ */
+void mix_add_ramp(float *destination, const float *source, std::size_t frames, int channels, float gain, float gain_step)
+{
+    std::size_t frame = 0;
+
+#if defined(__AVX__)
+    if(channels == 1 || channels == 2)
+    {
+        // 8 mono or 4 stereo frames per vector, each lane gets the gain of its frame, worked out like the loop below does
+        const std::size_t vector_frames = 8 / channels;
+        __m256 offsets = channels == 1 ? _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0) : _mm256_set_ps(3, 3, 2, 2, 1, 1, 0, 0);
+        __m256 gain_vector = _mm256_set1_ps(gain);
+        __m256 step_vector = _mm256_set1_ps(gain_step);
+
+        for(; frame + vector_frames <= frames; frame += vector_frames)
+        {
+            __m256 frame_numbers = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(frame)), offsets);
+            __m256 gains = _mm256_add_ps(gain_vector, _mm256_mul_ps(step_vector, frame_numbers));
+
+            std::size_t i = frame * channels;
+            __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_mul_ps(_mm256_loadu_ps(source + i), gains));
+            _mm256_storeu_ps(destination + i, mixed);
+        }
+    }
+#elif defined(__SSE__)
+    if(channels == 1 || channels == 2)
+    {
+        // 4 mono or 2 stereo frames per vector, each lane gets the gain of its frame, worked out like the loop below does
+        const std::size_t vector_frames = 4 / channels;
+        __m128 offsets = channels == 1 ? _mm_set_ps(3, 2, 1, 0) : _mm_set_ps(1, 1, 0, 0);
+        __m128 gain_vector = _mm_set1_ps(gain);
+        __m128 step_vector = _mm_set1_ps(gain_step);
+
+        for(; frame + vector_frames <= frames; frame += vector_frames)
+        {
+            __m128 frame_numbers = _mm_add_ps(_mm_set1_ps(static_cast<float>(frame)), offsets);
+            __m128 gains = _mm_add_ps(gain_vector, _mm_mul_ps(step_vector, frame_numbers));
+
+            std::size_t i = frame * channels;
+            __m128 mixed = _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), gains));
+            _mm_storeu_ps(destination + i, mixed);
+        }
+    }
+#endif
+
+    for(; frame < frames; frame++)
+    {
+        float frame_gain = gain + gain_step * frame;
+
+        for(int channel = 0; channel < channels; channel++)
+        {
+            std::size_t i = frame * channels + channel;
+            destination[i] += source[i] * frame_gain;
+        }
+    }
+}
+
+
+
+
+/* mix_crossfade() function
+ * @desc blends two sources with a per sample frame gain each, destination = outgoing * fade_out + incoming * fade_in
+ * @param destination - where the blended samples are written, may not alias the sources
+ * @param outgoing - the samples of the source fading out
+ * @param incoming - the samples of the source fading in
+ * @param frames - the number of sample frames
+ * @param channels - the number of interleaved channels
+ * @param fade_out - one gain per sample frame for outgoing
+ * @param fade_in - one gain per sample frame for incoming
+ */
+void mix_crossfade(float *destination, const float *outgoing, const float *incoming, std::size_t frames, int channels,
+                   const float *fade_out, const float *fade_in)
+{
+    std::size_t frame = 0;
+
+#if defined(__SSE__)
+    if(channels == 2)
+    {
+        // two stereo frames per vector, the gains are duplicated for left and right
+        for(; frame + 2 <= frames; frame += 2)
+        {
+            __m128 out_gains = _mm_castpd_ps(_mm_load1_pd(reinterpret_cast<const double *>(fade_out + frame)));
+            __m128 in_gains = _mm_castpd_ps(_mm_load1_pd(reinterpret_cast<const double *>(fade_in + frame)));
+            out_gains = _mm_unpacklo_ps(out_gains, out_gains);
+            in_gains = _mm_unpacklo_ps(in_gains, in_gains);
+
+            __m128 blended = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(outgoing + frame * 2), out_gains),
+                                        _mm_mul_ps(_mm_loadu_ps(incoming + frame * 2), in_gains));
+            _mm_storeu_ps(destination + frame * 2, blended);
+        }
+    }
+#endif
+
+    for(; frame < frames; frame++)
+    {
+        for(int channel = 0; channel < channels; channel++)
+        {
+            std::size_t i = frame * channels + channel;
+            destination[i] = outgoing[i] * fade_out[frame] + incoming[i] * fade_in[frame];
+        }
+    }
+}
+
+
+
+
+/* equal_power_curves() function
+ * @desc fills the gain curves of an equal power crossfade, fade_out[i]^2 + fade_in[i]^2 == 1 so the loudness stays constant
+ * @param fade_out - room for length gains, goes from 1 to 0
+ * @param fade_in - room for length gains, goes from 0 to 1
+ * @param length - the length of the crossfade in sample frames
+ */
+void equal_power_curves(float *fade_out, float *fade_in, std::size_t length)
+{
+    const double HALF_PI = 1.57079632679489661923;
+
+    for(std::size_t i = 0; i < length; i++)
+    {
+        double position = (i + 0.5) / length;
+        fade_out[i] = static_cast<float>(std::cos(position * HALF_PI));
+        fade_in[i] = static_cast<float>(std::sin(position * HALF_PI));
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Sample kernels used by the Mixer, they work on interleaved 32 bit float samples.
+// SSE / AVX versions are used when the compiler targets them, EX: with -march=native,
+// otherwise plain loops are used. See mix_kernels.cpp for comments on functions.
+
+void mix_add(float *, const float *, std::size_t, float);
+void mix_add_ramp(float *, const float *, std::size_t, int, float, float);
+void mix_crossfade(float *, const float *, const float *, std::size_t, int, const float *, const float *);
+void equal_power_curves(float *, float *, std::size_t);
@@ -0,0 +1,362 @@
+#include "mixer.h"
+#include "mix_kernels.h"
+
+extern "C"
+{
+#include <time.h>
+}
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace
+{
+    double thread_cpu_seconds()
+    {
+        struct timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return time.tv_sec + time.tv_nsec / 1e9;
+    }
+}
+
+
+
+
+/* Mixer constructor
+ * @param sample_rate - the output sample rate
+ * @param channels - the number of output channels
+ */
+Mixer::Mixer(int sample_rate, int channels) :
+    m_sample_rate{sample_rate}, m_channels{channels}
+{
+    m_quality = RESAMPLE_DEFAULT;
+    m_next_id = 0;
+}
+
+
+
+
+/* Mixer::add_source() function
+ * @desc opens a file and adds it to the mix, it starts playing with the next Mixer::mix() call, faded in over that block
+ * @param filename - the file to play
+ * @param gain - linear gain, 1.0 plays the file at its own level
+ * @return the id of the new source, or -1 if the file could not be opened
+ * @note the file is opened on the calling thread, not the mixing thread
+ */
+int Mixer::add_source(const std::string &filename, float gain)
+{
+    std::unique_ptr<Audio_Source> source{new Audio_Source{filename, m_sample_rate, m_channels}};
+
+    if(source->reset_quality(m_quality) == STATUS_FAILURE || source->open() == STATUS_FAILURE)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for(std::string error = source->poll_error(); !error.empty(); error = source->poll_error())
+        {
+            enqueue_error(error);
+        }
+
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    int id = m_next_id++;
+    // starting at 0 ramps the source in like a gain change, it does not start with a click
+    m_pending_sources.push_back(Source{id, std::move(source), 0.0f, gain, false, Mixer_Source_Stats{id, filename, 0, 0.0, true}});
+
+    return id;
+}
+
+
+
+
+/* Mixer::set_gain() function
+ * @desc changes the gain of a source, the change is ramped over the next mix block
+ * @param id - the id returned by Mixer::add_source()
+ * @param gain - the new linear gain
+ */
+void Mixer::set_gain(int id, float gain)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_pending_gains.emplace_back(id, gain);
+}
+
+
+
+
+/* Mixer::remove_source() function
+ * @desc fades a source out over the next mix block and then drops it
+ * @param id - the id returned by Mixer::add_source()
+ */
+void Mixer::remove_source(int id)
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_pending_removals.push_back(id);
+}
+
+
+
+
+/* Mixer::reset_quality() function
+ * @desc sets the quality tier sources are resampled with, see Resample_Quality
+ * @param quality - the tier, used by the sources added from now on
+ * @note call it from the thread adding sources, the sources already mixed keep their tier
+ */
+void Mixer::reset_quality(enum Resample_Quality quality)
+{
+    m_quality = quality;
+}
+
+
+
+
+/* Mixer::mix() function
+ * @desc produces the next block of mixed audio
+ * @param destination - room for nb_samples * channels floats, interleaved
+ * @param nb_samples - the number of sample frames to produce
+ * @return the number of sources that were mixed into the block, the block is silent if 0
+ * @note sources that fail to decode are dropped and their errors enqueued
+ */
+int Mixer::mix(float *destination, int nb_samples)
+{
+    apply_pending();
+
+    std::size_t count = static_cast<std::size_t>(nb_samples) * m_channels;
+    std::fill(destination, destination + count, 0.0f);
+
+    if(m_mix_buffer.size() < count)
+    {
+        m_mix_buffer.resize(count);
+    }
+
+    int mixed = 0;
+
+    for(std::size_t i = 0; i < m_sources.size();)
+    {
+        Source &source = m_sources[i];
+        double cpu_start = thread_cpu_seconds();
+
+        if(source.source->fill(nb_samples) == STATUS_FAILURE)
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                for(std::string error = source.source->poll_error(); !error.empty(); error = source.source->poll_error())
+                {
+                    enqueue_error(error);
+                }
+                enqueue_error("Dropped source " + source.stats.filename);
+            }
+
+            retire_source(i);
+            continue;
+        }
+
+        int read = source.source->read(m_mix_buffer.data(), nb_samples);
+
+        if(source.gain == source.target_gain)
+        {
+            mix_add(destination, m_mix_buffer.data(), static_cast<std::size_t>(read) * m_channels, source.gain);
+        }
+        else
+        {
+            // ramp over the whole block, whatever was read of it
+            float step = (source.target_gain - source.gain) / nb_samples;
+            mix_add_ramp(destination, m_mix_buffer.data(), read, m_channels, source.gain, step);
+            source.gain = source.target_gain;
+        }
+
+        source.stats.samples_mixed += read;
+        source.stats.cpu_seconds += thread_cpu_seconds() - cpu_start;
+        mixed++;
+
+        if(source.source->finished() || (source.removing && source.gain == 0.0f))
+        {
+            retire_source(i);
+            continue;
+        }
+
+        i++;
+    }
+
+    publish_stats();
+
+    return mixed;
+}
+
+
+
+
+/* Mixer::get_source_count() function
+ * @return the number of sources being mixed as of the last Mixer::mix() call, not counting ones added since
+ * @note may be called from any thread
+ */
+std::size_t Mixer::get_source_count()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_active_stats.size();
+}
+
+
+
+
+/* Mixer::get_source_stats() function
+ * @desc returns the cost of every source mixed so far
+ * @return a Mixer_Source_Stats for every finished source, then for every active one as of the last Mixer::mix() call
+ * @note may be called from any thread, active sources are owned by the mixing thread, their stats are copied from m_active_stats
+ */
+std::vector<Mixer_Source_Stats> Mixer::get_source_stats()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    std::vector<Mixer_Source_Stats> stats = m_finished_stats;
+    stats.insert(stats.end(), m_active_stats.begin(), m_active_stats.end());
+
+    return stats;
+}
+
+
+
+
+/* Mixer::get_sample_rate() function
+ * @return the output sample rate
+ */
+int Mixer::get_sample_rate()
+{
+    return m_sample_rate;
+}
+
+
+
+
+/* Mixer::get_channels() function
+ * @return the number of output channels
+ */
+int Mixer::get_channels()
+{
+    return m_channels;
+}
+
+
+
+
+/* Mixer::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Mixer::poll_error()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    if(!m_errors.empty())
+    {
+        std::string error = m_errors.front();
+        m_errors.pop();
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Mixer::apply_pending() function
+ * @desc moves added sources, gain changes and removals requested by other threads into the mix
+ * @note this function is under the private specifier
+ */
+void Mixer::apply_pending()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    for(Source &source : m_pending_sources)
+    {
+        m_sources.push_back(std::move(source));
+    }
+    m_pending_sources.clear();
+
+    for(const std::pair<int, float> &gain : m_pending_gains)
+    {
+        for(Source &source : m_sources)
+        {
+            if(source.id == gain.first && !source.removing)
+            {
+                source.target_gain = gain.second;
+            }
+        }
+    }
+    m_pending_gains.clear();
+
+    for(int id : m_pending_removals)
+    {
+        for(Source &source : m_sources)
+        {
+            if(source.id == id)
+            {
+                source.target_gain = 0.0f;
+                source.removing = true;
+            }
+        }
+    }
+    m_pending_removals.clear();
+}
+
+
+
+
+/* Mixer::retire_source() function
+ * @desc drops the source at the given index of m_sources, keeping its stats
+ * @note this function is under the private specifier
+ */
+void Mixer::retire_source(std::size_t index)
+{
+    Mixer_Source_Stats stats = m_sources[index].stats;
+    stats.active = false;
+
+    m_sources.erase(m_sources.begin() + index);
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_finished_stats.push_back(stats);
+
+    // so no other thread sees the source as both finished and active before the next Mixer::publish_stats()
+    m_active_stats.erase(std::remove_if(m_active_stats.begin(), m_active_stats.end(), [&stats](const Mixer_Source_Stats &active)
+    {
+        return active.id == stats.id;
+    }), m_active_stats.end());
+}
+
+
+
+
+/* Mixer::publish_stats() function
+ * @desc copies the stats of m_sources to m_active_stats, where the other threads read them, see Mixer::get_source_stats()
+ * @note the copies reuse the strings of the last ones, so this only allocates when the sources change
+ * @note this function is under the private specifier
+ */
+void Mixer::publish_stats()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_active_stats.resize(m_sources.size());
+    for(std::size_t i = 0; i < m_sources.size(); i++)
+    {
+        m_active_stats[i] = m_sources[i].stats;
+    }
+}
+
+
+
+
+/* Mixer::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @note the caller must hold m_mutex
+ * @note this function is under the private specifier
+ */
+void Mixer::enqueue_error(const std::string &error)
+{
+    m_errors.push(error);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "audio_source.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Mixer_Source_Stats Struct
+ * @desc the cost of one mixer source, see Mixer::get_source_stats()
+ * @member id - the id returned by Mixer::add_source()
+ * @member filename - the file the source plays
+ * @member samples_mixed - sample frames mixed so far
+ * @member cpu_seconds - thread CPU time spent decoding, converting and mixing the source
+ * @member active - false once the source has finished or been removed
+ */
+struct Mixer_Source_Stats
+{
+    int id;
+    std::string filename;
+    uint64_t samples_mixed;
+    double cpu_seconds;
+    bool active;
+};
+
+/* Mixer Class
+ * @desc Mixes any number of Audio_Sources, each with its own gain, into one interleaved float stream for a single Audio_Player.
+ * @desc Sources are opened by the thread adding them and handed to the mixing thread, so adding a source never stalls the mix.
+ * @desc New sources, gain changes and removals are ramped over one mix block to avoid clicks.
+ * @member m_sample_rate - the output sample rate, all sources are converted to it
+ * @member m_channels - the number of output channels
+ * @member m_quality - the resampling quality tier of sources added from now on
+ * @member m_sources - the sources being mixed, only touched by the mixing thread
+ * @member m_mix_buffer - one block of one source's samples, reused for every source
+ * @member m_pending_sources - sources added since the last Mixer::mix() call, guarded by m_mutex
+ * @member m_pending_gains - gain changes since the last Mixer::mix() call, guarded by m_mutex
+ * @member m_pending_removals - removals since the last Mixer::mix() call, guarded by m_mutex
+ * @member m_finished_stats - stats of sources that have finished or been removed, guarded by m_mutex
+ * @member m_active_stats - stats of m_sources as of the last Mixer::mix() call, for the other threads, guarded by m_mutex
+ * @member m_next_id - the id given to the next added source, guarded by m_mutex
+ * @member m_mutex - guards the pending lists, the stats and m_errors, only held briefly by the mixing thread
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see mixer.cpp for comments on functions
+ */
+class Mixer
+{
+    struct Source
+    {
+        int id;
+        std::unique_ptr<Audio_Source> source;
+        float gain;
+        float target_gain;
+        bool removing;
+        Mixer_Source_Stats stats;
+    };
+
+    int m_sample_rate;
+    int m_channels;
+    enum Resample_Quality m_quality;
+
+    std::vector<Source> m_sources;
+    std::vector<float> m_mix_buffer;
+
+    std::vector<Source> m_pending_sources;
+    std::vector<std::pair<int, float>> m_pending_gains;
+    std::vector<int> m_pending_removals;
+    std::vector<Mixer_Source_Stats> m_finished_stats;
+    std::vector<Mixer_Source_Stats> m_active_stats;
+    int m_next_id;
+
+    std::mutex m_mutex;
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Mixer(int, int);
+
+    int add_source(const std::string&, float);
+    void set_gain(int, float);
+    void remove_source(int);
+    void reset_quality(enum Resample_Quality);
+
+    int mix(float *, int);
+
+    std::size_t get_source_count();
+    std::vector<Mixer_Source_Stats> get_source_stats();
+    int get_sample_rate();
+    int get_channels();
+
+    std::string poll_error();
+
+    private:
+
+    void apply_pending();
+    void retire_source(std::size_t);
+    void publish_stats();
+    void enqueue_error(const std::string &error);
+};
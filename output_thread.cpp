@@ -0,0 +1,474 @@
+#include "output_thread.h"
+#include "alloc_audit.h"
+#include "event_trace.h"
+
+extern "C"
+{
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <queue>
+
+
+
+
+/* Output_Thread constructor
+ * @desc allocates the ring buffer and the period buffer, does not start the thread
+ * @param player - the initialized Audio_Player to write to
+ * @param buffer_bytes - size of the ring buffer between the decoding thread and the output thread
+ * @param period_bytes - number of bytes written to the sink at once, should be a multiple of the sample frame size
+ */
+Output_Thread::Output_Thread(Audio_Player &player, std::size_t buffer_bytes, std::size_t period_bytes) :
+    m_player{player}, m_ring{buffer_bytes}, m_period(period_bytes), m_fill_target{buffer_bytes},
+    m_finishing{false}, m_failed{false}, m_producer_waiting{false}, m_drained{0}, m_producer_wakeups{0},
+    m_underruns{0}, m_periods_written{0}, m_audit_allocations{0}
+{
+    m_realtime = false;
+    m_clock = nullptr;
+    m_frame_size = 1;
+    m_low_watermark = 0;
+}
+
+
+
+
+/* Output_Thread destructor
+ * @desc stops the output thread if it is still running, any data still buffered is played first
+ */
+Output_Thread::~Output_Thread()
+{
+    if(m_thread.joinable())
+    {
+        m_finishing.store(true, std::memory_order_release);
+        m_thread.join();
+    }
+}
+
+
+
+
+/* Output_Thread::start() function
+ * @desc starts the output thread, optionally with real time scheduling
+ * @param realtime - if true all memory is locked and the thread is scheduled with SCHED_FIFO
+ * @param priority - the SCHED_FIFO priority, ignored if realtime is false
+ * @return Return_Status::STATUS_SUCCESS if the thread was started, Return_Status::STATUS_FAILURE otherwise
+ * @note failing to get real time scheduling or to lock memory is not fatal, the errors are enqueued and
+ * @note Output_Thread::is_realtime() returns false
+ */
+Return_Status Output_Thread::start(bool realtime, int priority)
+{
+    bool memory_locked = false;
+
+    if(realtime)
+    {
+        // lock before the thread is created so its stack is locked as well
+        if(mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+        {
+            memory_locked = true;
+        }
+        else
+        {
+            enqueue_error("Failed to lock memory: " + std::string{std::strerror(errno)});
+        }
+    }
+
+    try
+    {
+        m_thread = std::thread{&Output_Thread::run, this};
+    }
+    catch(const std::system_error &error)
+    {
+        enqueue_error("Failed to start output thread: " + std::string{error.what()});
+        return STATUS_FAILURE;
+    }
+
+    if(realtime)
+    {
+        struct sched_param parameters;
+        std::memset(&parameters, 0, sizeof(parameters));
+        parameters.sched_priority = priority;
+
+        int error = pthread_setschedparam(m_thread.native_handle(), SCHED_FIFO, &parameters);
+        if(error != 0)
+        {
+            enqueue_error("Failed to set SCHED_FIFO priority: " + std::string{std::strerror(error)});
+        }
+
+        m_realtime = memory_locked && error == 0;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Output_Thread::write() function
+ * @desc hands PCM over to the output thread, waits while the ring buffer holds the fill target or more,
+ * @desc in burst mode until the output thread drained it to the low watermark
+ * @param data - interleaved PCM in the format the Audio_Player was initialized with
+ * @param size - size of the data in bytes
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the output thread failed
+ * @note must only be called from one thread, the producer
+ */
+Return_Status Output_Thread::write(const uint8_t *data, std::size_t size)
+{
+    while(size > 0)
+    {
+        std::size_t buffered = m_ring.read_available();
+        std::size_t target = m_fill_target.load(std::memory_order_relaxed);
+        std::size_t allowed = buffered < target ? target - buffered : 0;
+
+        std::size_t written = m_ring.write(data, std::min(size, allowed));
+        data += written;
+        size -= written;
+
+        if(size == 0)
+        {
+            break;
+        }
+
+        if(m_failed.load(std::memory_order_acquire))
+        {
+            enqueue_error("Output thread stopped after a sink write failed");
+            return STATUS_FAILURE;
+        }
+
+        if(m_low_watermark > 0)
+        {
+            wait_for_drain();
+            continue;
+        }
+
+        // the buffer is filled to the target, wait for the output thread to make room
+        std::this_thread::sleep_for(std::chrono::milliseconds{2});
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Output_Thread::finish() function
+ * @desc tells the output thread no more data is coming and waits until everything buffered has been written
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the output thread failed
+ * @note errors from the sink write itself are enqueued on the Audio_Player
+ */
+Return_Status Output_Thread::finish()
+{
+    if(m_thread.joinable())
+    {
+        m_finishing.store(true, std::memory_order_release);
+        m_thread.join();
+    }
+
+    if(m_failed.load(std::memory_order_acquire))
+    {
+        enqueue_error("Output thread stopped after a sink write failed");
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Output_Thread::set_fill_target() function
+ * @desc sets how much PCM the producer keeps buffered ahead of the output thread, EX: raised after underruns
+ * @param bytes - the fill target, clamped between one period and the ring buffer capacity
+ * @note may be called while running, lowering it lets the buffer drain down to the new target
+ */
+void Output_Thread::set_fill_target(std::size_t bytes)
+{
+    bytes = std::min(std::max(bytes, m_period.size()), m_ring.capacity());
+    m_fill_target.store(bytes, std::memory_order_relaxed);
+}
+
+
+
+
+/* Output_Thread::set_clock() function
+ * @desc has the output thread keep a Playback_Clock: it counts the samples it writes and measures the sink latency
+ * @desc every LATENCY_PERIODS periods, the thread writing the sink is the only one that knows both
+ * @param clock - the clock, nullptr for none
+ * @param frame_size - the size of one sample frame in bytes
+ * @note must be called before Output_Thread::start()
+ */
+void Output_Thread::set_clock(Playback_Clock *clock, std::size_t frame_size)
+{
+    m_clock = clock;
+    m_frame_size = frame_size;
+}
+
+
+
+
+/* Output_Thread::set_burst() function
+ * @desc switches to burst mode: once the ring buffer is filled to the fill target Output_Thread::write() sleeps until
+ * @desc the output thread drained it to low_watermark, so the producer wakes once per burst instead of every few ms
+ * @param low_watermark - the fill level in bytes that wakes the producer, 0 to leave burst mode,
+ * @param low_watermark - should leave enough audio to cover decoding the next burst, it is kept a period below the fill target
+ * @note must be called before Output_Thread::start(), after Output_Thread::set_fill_target()
+ */
+void Output_Thread::set_burst(std::size_t low_watermark)
+{
+    std::size_t target = m_fill_target.load(std::memory_order_relaxed);
+    m_low_watermark = std::min(low_watermark, target - std::min(target, m_period.size()));
+}
+
+
+
+
+/* Output_Thread::get_fill_target() function
+ * @return the fill target in bytes
+ */
+std::size_t Output_Thread::get_fill_target()
+{
+    return m_fill_target.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* Output_Thread::is_realtime() function
+ * @return true if the thread runs with SCHED_FIFO and memory is locked
+ */
+bool Output_Thread::is_realtime()
+{
+    return m_realtime;
+}
+
+
+
+
+/* Output_Thread::get_underruns() function
+ * @return the number of times the output thread found the ring buffer empty while playing
+ */
+uint64_t Output_Thread::get_underruns()
+{
+    return m_underruns.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* Output_Thread::get_periods_written() function
+ * @return the number of periods written to the sink
+ */
+uint64_t Output_Thread::get_periods_written()
+{
+    return m_periods_written.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* Output_Thread::get_producer_wakeups() function
+ * @return the number of times the producer was woken in burst mode, about once per burst
+ */
+uint64_t Output_Thread::get_producer_wakeups()
+{
+    return m_producer_wakeups.load(std::memory_order_relaxed);
+}
+
+
+
+
+/* Output_Thread::get_audit_allocations() function
+ * @return the number of allocations the output thread made during steady state playback,
+ * @return always 0 unless built with the allocation audit, see alloc_audit.h
+ * @note only complete once Output_Thread::finish() has returned
+ */
+uint64_t Output_Thread::get_audit_allocations()
+{
+    return m_audit_allocations.load(std::memory_order_acquire);
+}
+
+
+
+
+/* Output_Thread::get_buffered_bytes() function
+ * @return the number of bytes waiting in the ring buffer
+ */
+std::size_t Output_Thread::get_buffered_bytes()
+{
+    return m_ring.read_available();
+}
+
+
+
+
+/* Output_Thread::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Output_Thread::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Output_Thread::run() function
+ * @desc the body of the output thread, moves periods from the ring buffer to the sink until finished
+ * @note after a few warm up periods the allocation audit is armed, nothing in the loop may allocate from then on
+ * @note this function is under the private specifier
+ */
+void Output_Thread::run()
+{
+    // the first periods may touch lazily initialized state in the sink, don't audit those
+    const uint64_t WARMUP_PERIODS = 8;
+
+    // the latency query is a server round trip, with 1024 sample periods this is about every 100 ms like the player's main loop,
+    // in real time mode as well, so the clock follows the latency as the sink's buffer fills, drains and drifts
+    const uint64_t LATENCY_PERIODS = 5;
+
+    uint64_t allocations_at_arm = 0;
+    bool armed = false;
+    bool starved = false;
+
+    // before the audit is armed, naming allocates the thread's trace buffer
+    trace_name_thread("output");
+
+    while(1)
+    {
+        std::size_t available = m_ring.read_available();
+
+        if(available < m_period.size() && !m_finishing.load(std::memory_order_acquire))
+        {
+            // count each time the buffer runs dry once, not every sleep while it is dry
+            if(!starved && m_periods_written.load(std::memory_order_relaxed) > 0)
+            {
+                m_underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            starved = true;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            continue;
+        }
+
+        if(available == 0)
+        {
+            // finishing and nothing left
+            break;
+        }
+
+        starved = false;
+        std::size_t size = m_ring.read(m_period.data(), std::min(available, m_period.size()));
+
+        // woken before the write, which blocks for most of a period, so decoding overlaps it
+        if(m_low_watermark > 0)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_ring.read_available() <= m_low_watermark && m_producer_waiting.load(std::memory_order_relaxed))
+            {
+                wake_producer();
+            }
+        }
+
+        if(m_player.play_buffer(m_period.data(), size) == STATUS_FAILURE)
+        {
+            m_failed.store(true, std::memory_order_release);
+            wake_producer();
+            break;
+        }
+
+        uint64_t periods = m_periods_written.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        if(m_clock)
+        {
+            m_clock->advance(size / m_frame_size);
+
+            pa_usec_t latency = 0;
+            if((periods == 1 || periods % LATENCY_PERIODS == 0) && m_player.get_latency(latency) == STATUS_SUCCESS)
+            {
+                m_clock->update_latency(latency);
+            }
+        }
+
+        if(periods == WARMUP_PERIODS)
+        {
+            allocations_at_arm = alloc_audit_count();
+            alloc_audit_arm();
+            armed = true;
+        }
+    }
+
+    if(armed)
+    {
+        alloc_audit_disarm();
+        m_audit_allocations.store(alloc_audit_count() - allocations_at_arm, std::memory_order_release);
+    }
+}
+
+
+
+
+/* Output_Thread::wait_for_drain() function
+ * @desc sleeps until the output thread drained the ring buffer to the low watermark or failed
+ * @note the producer publishes that it waits before it checks the fill level, the output thread reads the level before it
+ * @note checks for a waiting producer, with a full fence on both sides at least one of them sees the other
+ * @note this function is under the private specifier
+ */
+void Output_Thread::wait_for_drain()
+{
+    Trace_Scope scope{"wait_for_drain"};
+    uint32_t drained = m_drained.load(std::memory_order_acquire);
+
+    m_producer_waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(m_ring.read_available() > m_low_watermark && !m_failed.load(std::memory_order_acquire))
+    {
+        m_drained.wait(drained, std::memory_order_acquire);
+        m_producer_wakeups.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    m_producer_waiting.store(false, std::memory_order_relaxed);
+}
+
+
+
+
+/* Output_Thread::wake_producer() function
+ * @desc wakes the producer if it sleeps in Output_Thread::wait_for_drain(), a futex wake, it does not allocate or lock
+ * @note this function is under the private specifier
+ */
+void Output_Thread::wake_producer()
+{
+    m_drained.fetch_add(1, std::memory_order_release);
+    m_drained.notify_one();
+}
+
+
+
+
+/* Output_Thread::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @note this function is under the private specifier
+ */
+void Output_Thread::enqueue_error(const std::string &error)
+{
+    m_errors.push(error);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "audio_player.h"
+#include "playback_clock.h"
+#include "ring_buffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Output_Thread Class
+ * @desc Feeds an Audio_Player from its own thread, the decoding thread hands over PCM through a lock free Ring_Buffer.
+ * @desc In real time mode the thread runs with SCHED_FIFO and all memory is locked. Once running, the output thread
+ * @desc allocates nothing, takes no locks and makes no syscalls other than the sink write,
+ * @desc except for a short sleep when the ring buffer runs dry (an underrun, which is counted).
+ * @desc In burst mode the producer fills the ring buffer up to the fill target in one go and then sleeps until the output
+ * @desc thread drained it down to a low watermark and wakes it, instead of topping it up every few milliseconds.
+ * @desc With a buffer of tens of seconds and large periods both threads stay asleep most of the time.
+ * @member m_player - the Audio_Player written to, must be initialized before Output_Thread::start()
+ * @member m_ring - PCM handed over from the decoding thread
+ * @member m_period - preallocated buffer for one period, the amount written to the sink at once
+ * @member m_fill_target - how full the producer keeps the ring buffer, at most its capacity, see Output_Thread::set_fill_target()
+ * @member m_clock - the Playback_Clock advanced by the output thread, nullptr if none, see Output_Thread::set_clock()
+ * @member m_frame_size - the size of one sample frame in bytes, to count the samples written for m_clock
+ * @member m_low_watermark - in burst mode the producer sleeps until the ring buffer holds this many bytes or less, 0 if not in burst mode
+ * @member m_thread - the output thread
+ * @member m_realtime - true if the thread got SCHED_FIFO scheduling and memory was locked
+ * @member m_finishing - set by the producer when no more data will be written
+ * @member m_failed - set by the output thread when writing to the sink failed, the thread then exits
+ * @member m_producer_waiting - set by the producer while it sleeps in burst mode
+ * @member m_drained - bumped by the output thread to wake the producer, the producer waits for it to change
+ * @member m_producer_wakeups - number of times the producer was woken in burst mode, one per burst
+ * @member m_underruns - number of times the output thread found the ring buffer empty
+ * @member m_periods_written - number of periods written to the sink
+ * @member m_audit_allocations - allocations counted by the allocation audit during steady state playback
+ * @member m_errors - a std::queue<std::string> of error messages, only touched by the producer thread
+ * @note see output_thread.cpp for comments on functions
+ */
+class Output_Thread
+{
+    Audio_Player &m_player;
+    Ring_Buffer m_ring;
+    std::vector<uint8_t> m_period;
+    std::atomic<std::size_t> m_fill_target;
+    Playback_Clock *m_clock;
+    std::size_t m_frame_size;
+    std::size_t m_low_watermark;
+
+    std::thread m_thread;
+    bool m_realtime;
+
+    std::atomic<bool> m_finishing;
+    std::atomic<bool> m_failed;
+    std::atomic<bool> m_producer_waiting;
+    std::atomic<uint32_t> m_drained;
+    std::atomic<uint64_t> m_producer_wakeups;
+    std::atomic<uint64_t> m_underruns;
+    std::atomic<uint64_t> m_periods_written;
+    std::atomic<uint64_t> m_audit_allocations;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Output_Thread(Audio_Player&, std::size_t, std::size_t);
+    ~Output_Thread();
+
+    Return_Status start(bool, int);
+    Return_Status write(const uint8_t *, std::size_t);
+    Return_Status finish();
+
+    void set_fill_target(std::size_t);
+    void set_clock(Playback_Clock*, std::size_t);
+    void set_burst(std::size_t);
+    std::size_t get_fill_target();
+
+    bool is_realtime();
+
+    uint64_t get_underruns();
+    uint64_t get_periods_written();
+    uint64_t get_producer_wakeups();
+    uint64_t get_audit_allocations();
+    std::size_t get_buffered_bytes();
+
+    std::string poll_error();
+
+    private:
+
+    void run();
+    void wait_for_drain();
+    void wake_producer();
+    void enqueue_error(const std::string &error);
+};
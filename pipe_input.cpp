@@ -0,0 +1,353 @@
+#include "pipe_input.h"
+#include "event_trace.h"
+
+extern "C"
+{
+#include <libavformat/avio.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+#include <poll.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <queue>
+
+// size of the buffer between the jitter buffer and the demuxer, small since the jitter buffer does the buffering
+const int IO_BUFFER_SIZE = 4096;
+
+// the most read from the pipe at once
+const std::size_t CHUNK_SIZE = 64 * 1024;
+
+
+
+
+/* Pipe_Input constructor
+ * @desc allocates the jitter buffer, does not start reading
+ * @param file_descriptor - the pipe to read, EX: STDIN_FILENO, it is not closed by this class
+ * @param buffer_bytes - the size of the jitter buffer, the largest burst it can absorb
+ * @param prefill_bytes - how much is buffered before the decoder gets data, at the start and after an underrun
+ */
+Pipe_Input::Pipe_Input(int file_descriptor, std::size_t buffer_bytes, std::size_t prefill_bytes) :
+    m_file_descriptor{file_descriptor}, m_ring{buffer_bytes}, m_chunk(std::min(CHUNK_SIZE, buffer_bytes)),
+    m_prefill_bytes{std::min(prefill_bytes, buffer_bytes)},
+    m_stopping{false}, m_end_of_input{false}, m_read_failed{false}, m_read_error{0},
+    m_bytes_received{0}, m_underruns{0}, m_startup_microseconds{0}, m_stall_microseconds{0}, m_fill_min{buffer_bytes}, m_fill_max{0}
+{
+    m_io_ctx = nullptr;
+    m_buffering = true;
+    m_started_reading = false;
+}
+
+
+
+
+/* Pipe_Input destructor
+ * @desc stops the reader thread and frees the AVIOContext
+ * @note the decoder reading from Pipe_Input::get_io_context() must be reset or destroyed first
+ */
+Pipe_Input::~Pipe_Input()
+{
+    stop();
+
+    if(m_io_ctx)
+    {
+        // the demuxer may have replaced the buffer while probing, so free the one the context holds now
+        av_freep(&m_io_ctx->buffer);
+        avio_context_free(&m_io_ctx);
+    }
+}
+
+
+
+
+/* Pipe_Input::start() function
+ * @desc creates the AVIOContext and starts the reader thread
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Pipe_Input::start()
+{
+    uint8_t *buffer = static_cast<uint8_t*>(av_malloc(IO_BUFFER_SIZE));
+    if(!buffer)
+    {
+        enqueue_error("Failed to allocate IO buffer");
+        return STATUS_FAILURE;
+    }
+
+    m_io_ctx = avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, this, &Pipe_Input::read_packet, nullptr, nullptr);
+    if(!m_io_ctx)
+    {
+        av_free(buffer);
+        enqueue_error("Failed to allocate AVIOContext");
+        return STATUS_FAILURE;
+    }
+
+    // tells the demuxers not to try seeking, they fall back to reading straight through
+    m_io_ctx->seekable = 0;
+
+    try
+    {
+        m_thread = std::thread{&Pipe_Input::run, this};
+    }
+    catch(const std::system_error &error)
+    {
+        enqueue_error("Failed to start reader thread: " + std::string{error.what()});
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Pipe_Input::stop() function
+ * @desc stops the reader thread, the decoder then sees the end of the input once the buffer is empty
+ */
+void Pipe_Input::stop()
+{
+    if(m_thread.joinable())
+    {
+        m_stopping.store(true, std::memory_order_release);
+        m_thread.join();
+    }
+}
+
+
+
+
+/* Pipe_Input::get_io_context() function
+ * @return the AVIOContext to pass to FFmpeg_Decoder::set_input(), nullptr before Pipe_Input::start()
+ */
+AVIOContext *Pipe_Input::get_io_context()
+{
+    return m_io_ctx;
+}
+
+
+
+
+/* Pipe_Input::get_stats() function
+ * @return the jitter buffer statistics so far, may be called from any thread
+ */
+Pipe_Input_Stats Pipe_Input::get_stats()
+{
+    Pipe_Input_Stats stats;
+    stats.bytes_received = m_bytes_received.load(std::memory_order_relaxed);
+    stats.underruns = m_underruns.load(std::memory_order_relaxed);
+    stats.startup_ms = m_startup_microseconds.load(std::memory_order_relaxed) / 1000.0;
+    stats.stall_ms = m_stall_microseconds.load(std::memory_order_relaxed) / 1000.0;
+    stats.fill_max = m_fill_max.load(std::memory_order_relaxed);
+    stats.fill_min = std::min(m_fill_min.load(std::memory_order_relaxed), stats.fill_max);
+    stats.capacity = m_ring.capacity();
+
+    return stats;
+}
+
+
+
+
+/* Pipe_Input::get_buffered_bytes() function
+ * @return the number of bytes waiting in the jitter buffer
+ */
+std::size_t Pipe_Input::get_buffered_bytes()
+{
+    return m_ring.read_available();
+}
+
+
+
+
+/* Pipe_Input::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Pipe_Input::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Pipe_Input::run() function
+ * @desc the body of the reader thread, moves data from the pipe into the jitter buffer until the pipe is closed
+ * @note while the buffer is full the pipe is left alone, so the producer blocks instead of the buffer growing
+ * @note the pipe is polled with a timeout so Pipe_Input::stop() is noticed even if the producer is silent
+ * @note this function is under the private specifier
+ */
+void Pipe_Input::run()
+{
+    const int POLL_TIMEOUT_MS = 100;
+
+    trace_name_thread("pipe_input");
+
+    while(!m_stopping.load(std::memory_order_acquire))
+    {
+        std::size_t room = m_ring.write_available();
+        if(room == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            continue;
+        }
+
+        struct pollfd readable;
+        readable.fd = m_file_descriptor;
+        readable.events = POLLIN;
+        readable.revents = 0;
+
+        int ready = poll(&readable, 1, POLL_TIMEOUT_MS);
+        if(ready == 0 || (ready < 0 && errno == EINTR))
+        {
+            continue;
+        }
+
+        ssize_t result = -1;
+        if(ready > 0)
+        {
+            Trace_Scope scope{"pipe_read"};
+            result = read(m_file_descriptor, m_chunk.data(), std::min(room, m_chunk.size()));
+        }
+
+        if(result == 0)
+        {
+            // the producer closed the pipe
+            break;
+        }
+
+        else if(result < 0)
+        {
+            if(errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+
+            m_read_error.store(errno, std::memory_order_relaxed);
+            m_read_failed.store(true, std::memory_order_relaxed);
+            break;
+        }
+
+        m_ring.write(m_chunk.data(), static_cast<std::size_t>(result));
+        m_bytes_received.fetch_add(static_cast<uint64_t>(result), std::memory_order_relaxed);
+    }
+
+    m_end_of_input.store(true, std::memory_order_release);
+}
+
+
+
+
+/* Pipe_Input::read_input() function
+ * @desc hands buffered data to the demuxer, waiting for the prefill level at the start and after an underrun
+ * @param buffer - where to put the data
+ * @param size - the most bytes to hand over
+ * @return the number of bytes handed over, AVERROR_EOF at the end of the input or a negative error code
+ * @note called on the decoder thread through the AVIOContext
+ * @note this function is under the private specifier
+ */
+int Pipe_Input::read_input(uint8_t *buffer, int size)
+{
+    std::chrono::steady_clock::time_point wait_begin;
+    bool waited = false;
+
+    while(1)
+    {
+        // check for the end first, everything written before it was flagged is then visible
+        bool ended = m_end_of_input.load(std::memory_order_acquire);
+        std::size_t available = m_ring.read_available();
+
+        if(available == 0 && ended)
+        {
+            if(m_read_failed.load(std::memory_order_relaxed))
+            {
+                return AVERROR(m_read_error.load(std::memory_order_relaxed));
+            }
+
+            return AVERROR_EOF;
+        }
+
+        if(available == 0 && !m_buffering)
+        {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+            m_buffering = true;
+        }
+
+        if(m_buffering && available < m_prefill_bytes && !ended)
+        {
+            if(m_stopping.load(std::memory_order_acquire))
+            {
+                return AVERROR_EXIT;
+            }
+
+            if(!waited)
+            {
+                wait_begin = std::chrono::steady_clock::now();
+                waited = true;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            continue;
+        }
+
+        if(waited)
+        {
+            uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wait_begin).count();
+            (m_started_reading ? m_stall_microseconds : m_startup_microseconds).fetch_add(microseconds, std::memory_order_relaxed);
+        }
+
+        m_buffering = false;
+
+        if(m_started_reading && available < m_fill_min.load(std::memory_order_relaxed))
+        {
+            m_fill_min.store(available, std::memory_order_relaxed);
+        }
+
+        if(available > m_fill_max.load(std::memory_order_relaxed))
+        {
+            m_fill_max.store(available, std::memory_order_relaxed);
+        }
+
+        m_started_reading = true;
+        return static_cast<int>(m_ring.read(buffer, std::min(available, static_cast<std::size_t>(size))));
+    }
+}
+
+
+
+
+/* Pipe_Input::read_packet() function, AVIOContext read callback
+ * @param opaque - the Pipe_Input
+ * @note this function is under the private specifier
+ */
+int Pipe_Input::read_packet(void *opaque, uint8_t *buffer, int size)
+{
+    return static_cast<Pipe_Input*>(opaque)->read_input(buffer, size);
+}
+
+
+
+
+/* Pipe_Input::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @note this function is under the private specifier
+ */
+void Pipe_Input::enqueue_error(const std::string &error)
+{
+    m_errors.push(error);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ring_buffer.h"
+
+extern "C"
+{
+#include <libavformat/avio.h>
+}
+
+#include <atomic>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Pipe_Input_Stats Struct
+ * @desc how well the jitter buffer of a Pipe_Input kept up
+ * @member bytes_received - bytes read from the pipe so far
+ * @member underruns - times the decoder found the buffer empty before the input ended
+ * @member startup_ms - time the decoder waited for the buffer to fill before the first read
+ * @member stall_ms - time the decoder waited for the buffer to refill after underruns
+ * @member fill_min - the lowest number of buffered bytes seen by a decoder read, after startup
+ * @member fill_max - the highest number of buffered bytes seen by a decoder read
+ * @member capacity - the size of the buffer in bytes
+ */
+struct Pipe_Input_Stats
+{
+    uint64_t bytes_received;
+    uint64_t underruns;
+    double startup_ms;
+    double stall_ms;
+    std::size_t fill_min;
+    std::size_t fill_max;
+    std::size_t capacity;
+};
+
+/* Pipe_Input Class
+ * @desc Reads a pipe or stdin on its own thread into a bounded jitter buffer, which the decoder reads through an AVIOContext.
+ * @desc Bursty producers are absorbed by the buffer, while it is full the pipe is not read so a fast producer blocks.
+ * @desc At the start, and again after the buffer ran dry, the decoder waits until the prefill level is buffered.
+ * @member m_file_descriptor - the pipe being read, not closed by this class
+ * @member m_ring - the jitter buffer, written by the reader thread and read by the decoder
+ * @member m_chunk - preallocated buffer for one read from the pipe
+ * @member m_prefill_bytes - how much is buffered before the decoder is handed any data
+ * @member m_io_ctx - AVIOContext the decoder reads from, see FFmpeg_Decoder::set_input()
+ * @member m_thread - the reader thread
+ * @member m_stopping - set to make the reader thread exit early
+ * @member m_end_of_input - set by the reader thread when the pipe was closed or failed
+ * @member m_read_failed - set by the reader thread when reading the pipe failed
+ * @member m_read_error - the errno of the failed read
+ * @member m_buffering - true while the decoder waits for the prefill level, only touched by the decoder thread
+ * @member m_started_reading - true once the decoder got its first data, only touched by the decoder thread
+ * @member m_bytes_received, m_underruns, m_startup_microseconds, m_stall_microseconds, m_fill_min, m_fill_max - see Pipe_Input_Stats
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see pipe_input.cpp for comments on functions
+ */
+class Pipe_Input
+{
+    int m_file_descriptor;
+    Ring_Buffer m_ring;
+    std::vector<uint8_t> m_chunk;
+    std::size_t m_prefill_bytes;
+
+    AVIOContext *m_io_ctx;
+    std::thread m_thread;
+
+    std::atomic<bool> m_stopping;
+    std::atomic<bool> m_end_of_input;
+    std::atomic<bool> m_read_failed;
+    std::atomic<int> m_read_error;
+
+    bool m_buffering;
+    bool m_started_reading;
+
+    std::atomic<uint64_t> m_bytes_received;
+    std::atomic<uint64_t> m_underruns;
+    std::atomic<uint64_t> m_startup_microseconds;
+    std::atomic<uint64_t> m_stall_microseconds;
+    std::atomic<std::size_t> m_fill_min;
+    std::atomic<std::size_t> m_fill_max;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Pipe_Input(int, std::size_t, std::size_t);
+    ~Pipe_Input();
+
+    Return_Status start();
+    void stop();
+
+    AVIOContext *get_io_context();
+    Pipe_Input_Stats get_stats();
+    std::size_t get_buffered_bytes();
+
+    std::string poll_error();
+
+    private:
+
+    void run();
+    int read_input(uint8_t*, int);
+    static int read_packet(void*, uint8_t*, int);
+    void enqueue_error(const std::string &error);
+};
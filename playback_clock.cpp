@@ -0,0 +1,279 @@
+#include "playback_clock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+// how long a disagreement between the clock and a latency measurement takes to be slewed away,
+// long enough to smooth the jitter of single measurements out
+const double SLEW_SECONDS = 0.5;
+
+
+
+
+/* Playback_Clock constructor
+ * @param sample_rate - the sample rate of the audio written to the sink
+ * @note the clock stands at 0 until the first latency measurement
+ */
+Playback_Clock::Playback_Clock(int sample_rate) :
+    m_sample_rate{sample_rate}, m_sequence{0}, m_origin{0}, m_base_samples{0}, m_base_time{0}, m_rate{0}, m_written{0}
+{
+    m_measured = false;
+    m_updates = 0;
+    m_max_correction = 0;
+}
+
+
+
+
+/* Playback_Clock::reset() function
+ * @desc starts over at a new position, EX: when playback starts or after a seek, nothing is audible until the next measurement
+ * @param origin - the position of the next sample to be written in microseconds on the file's timeline, EX: the pts of the frame
+ * @note must only be called from the writing thread, the sink should have been flushed, the position may go backwards here
+ */
+void Playback_Clock::reset(int64_t origin)
+{
+    uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_origin.store(origin, std::memory_order_relaxed);
+    m_base_samples.store(0, std::memory_order_relaxed);
+    m_base_time.store(now(), std::memory_order_relaxed);
+    m_rate.store(0, std::memory_order_relaxed);
+    m_written.store(0, std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+
+    m_measured = false;
+}
+
+
+
+
+/* Playback_Clock::advance() function
+ * @desc records that samples were written to the sink
+ * @param samples - the number of samples per channel written
+ * @note must only be called from the writing thread, it is a single store so it is cheap enough for every write
+ */
+void Playback_Clock::advance(int64_t samples)
+{
+    m_written.store(m_written.load(std::memory_order_relaxed) + samples, std::memory_order_release);
+}
+
+
+
+
+/* Playback_Clock::update_latency() function
+ * @desc applies a latency measurement taken now, see Playback_Clock::apply_latency()
+ * @param latency - the sink latency in microseconds, EX: from Audio_Player::get_latency()
+ * @note must only be called from the writing thread
+ */
+void Playback_Clock::update_latency(uint64_t latency)
+{
+    apply_latency(latency, 0, true);
+}
+
+
+
+
+/* Playback_Clock::update_latency() function
+ * @desc applies a latency measurement taken at the given time, EX: in a simulation, see Playback_Clock::apply_latency()
+ * @param latency - the sink latency in microseconds
+ * @param time - the steady clock time of the measurement in nanoseconds, see Playback_Clock::now()
+ * @note must only be called from the writing thread
+ */
+void Playback_Clock::update_latency(uint64_t latency, int64_t time)
+{
+    apply_latency(latency, time, false);
+}
+
+
+
+
+/* Playback_Clock::get_samples() function
+ * @return the number of samples since the origin that have been heard by now
+ * @note may be called from any thread, it does not lock, allocate or make syscalls, it retries while the writer updates
+ */
+int64_t Playback_Clock::get_samples() const
+{
+    return read_samples(0, true);
+}
+
+
+
+
+/* Playback_Clock::get_samples_at() function
+ * @param time - a steady clock time in nanoseconds, see Playback_Clock::now()
+ * @return the number of samples since the origin that have been heard at that time, going by the current snapshot
+ * @note may be called from any thread
+ */
+int64_t Playback_Clock::get_samples_at(int64_t time) const
+{
+    return read_samples(time, false);
+}
+
+
+
+
+/* Playback_Clock::get_position() function
+ * @return the position of the sample heard right now in microseconds on the file's timeline
+ * @note may be called from any thread
+ */
+int64_t Playback_Clock::get_position() const
+{
+    return m_origin.load(std::memory_order_relaxed) + get_samples() * 1000000 / m_sample_rate;
+}
+
+
+
+
+/* Playback_Clock::get_written() function
+ * @return the number of samples written since the origin
+ */
+int64_t Playback_Clock::get_written() const
+{
+    return m_written.load(std::memory_order_acquire);
+}
+
+
+
+
+/* Playback_Clock::get_sample_rate() function
+ * @return the sample rate given to the constructor
+ */
+int Playback_Clock::get_sample_rate() const
+{
+    return m_sample_rate;
+}
+
+
+
+
+/* Playback_Clock::get_updates() function
+ * @return the number of latency measurements applied
+ * @note only meaningful on the writing thread, or after it stopped
+ */
+uint64_t Playback_Clock::get_updates() const
+{
+    return m_updates;
+}
+
+
+
+
+/* Playback_Clock::get_max_correction_ms() function
+ * @return the largest difference between the clock and a latency measurement in milliseconds, the first measurement not counted
+ * @note only meaningful on the writing thread, or after it stopped
+ */
+double Playback_Clock::get_max_correction_ms() const
+{
+    return m_max_correction * 1000 / m_sample_rate;
+}
+
+
+
+
+/* Playback_Clock::apply_latency() function
+ * @desc applies a latency measurement: the audible sample is the last one written minus the latency
+ * @desc the first measurement sets the clock, later ones set how fast it runs until the next, so it reaches the
+ * @desc measured position SLEW_SECONDS from now, running at most twice as fast as real time and never backwards
+ * @param latency - the sink latency in microseconds
+ * @param time - the time of the measurement in nanoseconds, ignored if use_now is set
+ * @param use_now - take the time once the snapshot is locked, so no reader can see the old snapshot at a later time
+ * @note this function is under the private specifier
+ */
+void Playback_Clock::apply_latency(uint64_t latency, int64_t time, bool use_now)
+{
+    uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if(use_now)
+    {
+        time = now();
+    }
+
+    double written = static_cast<double>(m_written.load(std::memory_order_relaxed));
+    double measured = std::max(written - static_cast<double>(latency) * m_sample_rate / 1000000, 0.0);
+
+    // what the readers saw up to now, the new snapshot starts from it so the position is continuous
+    double current = m_base_samples.load(std::memory_order_relaxed) +
+                     m_rate.load(std::memory_order_relaxed) * std::max<int64_t>(time - m_base_time.load(std::memory_order_relaxed), 0) / 1e9;
+    current = std::min(current, written);
+
+    double base = current;
+    double rate = m_sample_rate;
+
+    if(!m_measured || measured > current + SLEW_SECONDS * m_sample_rate)
+    {
+        // nothing to be continuous with yet, or far behind, EX: the sink only just started playing,
+        // jumping forward keeps the position monotonic
+        base = std::max(measured, current);
+    }
+    else
+    {
+        double error = measured - current;
+        m_max_correction = std::max(m_max_correction, std::fabs(error));
+        rate = std::min(std::max(m_sample_rate + error / SLEW_SECONDS, 0.0), 2.0 * m_sample_rate);
+    }
+
+    m_base_samples.store(base, std::memory_order_relaxed);
+    m_base_time.store(time, std::memory_order_relaxed);
+    m_rate.store(rate, std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+
+    m_measured = true;
+    m_updates++;
+}
+
+
+
+
+/* Playback_Clock::read_samples() function
+ * @desc reads the snapshot and runs it forward to the given time
+ * @param time - the time in nanoseconds, ignored if use_now is set
+ * @param use_now - take the time while reading the snapshot, so a snapshot replaced later is never run past its replacement
+ * @return the number of samples since the origin heard at the time, at most the number written
+ * @note this function is under the private specifier
+ */
+int64_t Playback_Clock::read_samples(int64_t time, bool use_now) const
+{
+    double base;
+    int64_t base_time;
+    double rate;
+    uint32_t sequence;
+
+    do
+    {
+        sequence = m_sequence.load(std::memory_order_acquire);
+
+        base = m_base_samples.load(std::memory_order_relaxed);
+        base_time = m_base_time.load(std::memory_order_relaxed);
+        rate = m_rate.load(std::memory_order_relaxed);
+
+        if(use_now)
+        {
+            time = now();
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    while((sequence & 1) || sequence != m_sequence.load(std::memory_order_relaxed));
+
+    double position = base + rate * std::max<int64_t>(time - base_time, 0) / 1e9;
+    return std::min(static_cast<int64_t>(position), m_written.load(std::memory_order_acquire));
+}
+
+
+
+
+/* Playback_Clock::now() function
+ * @return the steady clock time in nanoseconds, the time base of the clock
+ */
+int64_t Playback_Clock::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/* Playback_Clock Class
+ * @desc Tracks which sample is audible right now, from the samples written to the sink and the sink latency.
+ * @desc The thread writing the sink is the only writer, any number of threads may read at any rate without locking.
+ * @desc Between latency measurements the position runs on the steady clock. When a measurement disagrees, the clock
+ * @desc is not set back but slewed towards it over SLEW_SECONDS, so the position never goes backwards, and it never
+ * @desc passes the last sample written, EX: during an underrun it stops on it.
+ * @desc The snapshot read by readers is guarded by a sequence lock: the writer makes m_sequence odd while it changes
+ * @desc the snapshot, readers retry when they saw it odd or changed.
+ * @member m_sample_rate - the sample rate of the audio written to the sink
+ * @member m_sequence - the sequence lock, odd while the writer changes the snapshot
+ * @member m_origin - the position of the first sample written since Playback_Clock::reset(), in microseconds on the file's timeline
+ * @member m_base_samples - snapshot, the audible position at m_base_time, in samples since the origin
+ * @member m_base_time - snapshot, steady clock time of m_base_samples in nanoseconds
+ * @member m_rate - snapshot, how fast the position advances from m_base_time in samples per second, never negative
+ * @member m_written - the number of samples written since the origin, the position never passes it
+ * @member m_measured - true once a latency measurement was applied since the last reset, only touched by the writer
+ * @member m_updates - the number of latency measurements applied, only touched by the writer
+ * @member m_max_correction - the largest difference between the clock and a measurement in samples, only touched by the writer
+ * @note see playback_clock.cpp for comments on functions
+ */
+class Playback_Clock
+{
+    int m_sample_rate;
+
+    std::atomic<uint32_t> m_sequence;
+    std::atomic<int64_t> m_origin;
+    std::atomic<double> m_base_samples;
+    std::atomic<int64_t> m_base_time;
+    std::atomic<double> m_rate;
+    std::atomic<int64_t> m_written;
+
+    bool m_measured;
+    uint64_t m_updates;
+    double m_max_correction;
+
+    public:
+
+    explicit Playback_Clock(int);
+
+    void reset(int64_t);
+    void advance(int64_t);
+    void update_latency(uint64_t);
+    void update_latency(uint64_t, int64_t);
+
+    int64_t get_samples() const;
+    int64_t get_samples_at(int64_t) const;
+    int64_t get_position() const;
+    int64_t get_written() const;
+    int get_sample_rate() const;
+
+    uint64_t get_updates() const;
+    double get_max_correction_ms() const;
+
+    static int64_t now();
+
+    private:
+
+    void apply_latency(uint64_t, int64_t, bool);
+    int64_t read_samples(int64_t, bool) const;
+};
@@ -1,8 +1,43 @@
 #include "ffmpeg_decoder.h"
 #include "ffmpeg_resampler.h"
 #include "audio_player.h"
+#include "startup_profiler.h"
+#include "output_thread.h"
+#include "alloc_audit.h"
+#include "mixer.h"
+#include "crossfader.h"
+#include "memory_usage.h"
+#include "pipe_input.h"
+#include "adaptive_buffer.h"
+#include "player_daemon.h"
+#include "daemon_client.h"
+#include "playback_clock.h"
+#include "frame_fanout.h"
+#include "frame_sinks.h"
+#include "frame_handle.h"
+#include "coroutine_pipeline.h"
+#include "silence_detector.h"
+#include "metadata_reader.h"
+#include "media_library.h"
+#include "event_trace.h"
+#include "simulated_sink.h"
+#include <atomic>
 #include <iostream>
+#include <iomanip>
+#include <climits>
+#include <csignal>
 #include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 void poll_errors(FFmpeg_Decoder &decoder)
 {
@@ -38,6 +73,17 @@ void poll_errors(Audio_Player &audio_player)
     while(!error.empty());
 }
 
+void poll_errors(Output_Thread &output)
+{
+    std::string error = output.poll_error();
+    do
+    {
+        std::cerr << error << std::endl;
+        error = output.poll_error();
+    }
+    while(!error.empty());
+}
+
 void check_status(FFmpeg_Decoder &decoder, Return_Status status, bool exit)
 {
     if(status == STATUS_FAILURE)
@@ -77,103 +123,2292 @@ void check_status(Audio_Player &audio_player, Return_Status status, bool exit)
     }
 }
 
-void main_loop(FFmpeg_Decoder &decoder, FFmpeg_Frame_Resampler &resampler, Audio_Player &audio_player)
+/* Player_Options Struct
+ * @desc holds the options given on the command line
+ * @member filenames - the files to be played, more than one only with --mix or --crossfade
+ * @member gains - the linear gain for each file in filenames, set with --gain, only used with --mix
+ * @member startup_profile - print a report of the startup phases once the first sample has been written
+ * @member target_latency - requested output latency in microseconds, 0 leaves it to the server
+ * @member stats - print playback statistics when playback ends
+ * @member realtime - feed the player from a SCHED_FIFO output thread that does not allocate
+ * @member burst - decode tens of seconds ahead into the output thread in bursts and sleep in between, for fewer wakeups
+ * @member mix - play all files at the same time through a Mixer
+ * @member crossfade - crossfade length in seconds when playing files one after another, negative if not set
+ * @member streaming - open the file in the decoder's streaming mode, for very long files
+ * @member memory_report - print the resident and peak memory use when playback ends
+ * @member list_chapters - print the chapters of the file instead of playing it
+ * @member info - print the metadata of the files and of the media files in the directories given instead of playing
+ * @member chapter - the chapter to start playing from, counting from 1, 0 plays from the beginning
+ * @member adaptive - raise the output buffering after underruns and lower it again while playback is stable
+ * @member position - print the position being heard a few times a second, read from the Playback_Clock
+ * @member record_path - also write what is played to this WAV file, empty if not
+ * @member meter - also print the level of every channel once a second
+ * @member quality - the resampling quality tier, set with --quality, matters when files are resampled for --mix or --crossfade
+ * @member downmix - map the channels with the resampler's precomputed ITU matrix instead of swresample's, see channel_mapper.h
+ * @member pipeline - play through coroutine stages on an executor instead of main_loop(), see coroutine_pipeline.h
+ * @member trim_silence - skip the leading and trailing silence, with the file's silence map if it has one, see silence_detector.h
+ * @member scan_silence - write the silence map of every file given instead of playing
+ * @member silence_threshold - the loudest level in dBFS that counts as silence
+ * @member silence_seconds - the shortest leading or trailing silence that is skipped
+ * @member library_path - the index file of the media library, see media_library.h, empty if not used
+ * @member library_root - bring the library up to date with this directory, empty if not
+ * @member find_tag - print the files of the library with this tag, EX: "artist=Nina Simone", empty if not
+ * @member trace_path - record a timeline of the decoder, resampler, sink and threads to this Chrome trace file, empty if not
+ * @member simulate - play into a Simulated_Sink instead of PulseAudio, see simulated_sink.h
+ * @member simulation - the clock, jitter and stalls of the simulated sink, set with --simulate, --jitter and --stall
+ * @member daemon_socket - run as a daemon listening on this socket, empty if not
+ * @member send_socket - send command to the daemon listening on this socket, empty if not
+ * @member command - the command line to send with send_socket, EX: "PLAY song.flac"
+ */
+struct Player_Options
 {
-    AVFrame *decoded_frame;
-    AVFrame *resampled_frame;
+    std::vector<std::string> filenames;
+    std::vector<float> gains;
+    bool mix = false;
+    double crossfade = -1;
+    bool startup_profile = false;
+    pa_usec_t target_latency = 0;
+    bool stats = false;
+    bool realtime = false;
+    bool burst = false;
+    bool streaming = false;
+    bool memory_report = false;
+    bool list_chapters = false;
+    bool info = false;
+    int chapter = 0;
+    bool adaptive = false;
+    bool position = false;
+    std::string record_path;
+    bool meter = false;
+    enum Resample_Quality quality = RESAMPLE_DEFAULT;
+    bool downmix = false;
+    bool pipeline = false;
+    bool trim_silence = false;
+    bool scan_silence = false;
+    double silence_threshold = -60.0;
+    double silence_seconds = 2.0;
+    std::string library_path;
+    std::string library_root;
+    std::string find_tag;
+    std::string trace_path;
+    bool simulate = false;
+    Simulated_Sink_Config simulation;
+    std::string daemon_socket;
+    std::string send_socket;
+    std::string command;
+};
 
-    int i = 0;
-    while(1)
+/* Playback_Stats Struct
+ * @desc statistics gathered while playing, printed with --stats
+ * @member frames_played - number of frames written to the player
+ * @member samples_played - number of samples per channel written to the player
+ * @member latency_checks - number of latency measurements taken
+ * @member latency_min - smallest measured output latency in microseconds
+ * @member latency_max - largest measured output latency in microseconds
+ * @member latency_total - sum of all measured latencies, used for the average
+ * @member underruns - number of times the real time output thread ran dry
+ * @member audit_allocations - allocations made by the output thread in steady state, see alloc_audit.h
+ * @member producer_wakeups - number of bursts the decoder was woken for, in burst mode
+ * @member audio_seconds - the length of the audio played
+ * @member wall_seconds - how long playback took
+ * @member cpu_seconds - CPU time used by all threads during playback
+ * @member context_switches - voluntary context switches of all threads during playback, each one a wakeup
+ * @member trimmed_seconds - the leading and trailing silence skipped with --trim-silence
+ */
+struct Playback_Stats
+{
+    uint64_t frames_played = 0;
+    uint64_t samples_played = 0;
+
+    uint64_t latency_checks = 0;
+    pa_usec_t latency_min = 0;
+    pa_usec_t latency_max = 0;
+    pa_usec_t latency_total = 0;
+
+    uint64_t underruns = 0;
+    uint64_t audit_allocations = 0;
+    uint64_t producer_wakeups = 0;
+
+    double audio_seconds = 0;
+    double wall_seconds = 0;
+    double cpu_seconds = 0;
+    uint64_t context_switches = 0;
+
+    double trimmed_seconds = 0;
+};
+
+void print_usage(const char *program)
+{
+    std::cerr << "Valid Usage: " << program << " [options] <filename>\n";
+    std::cerr << "             " << program << " --crossfade <seconds> [options] <filename> [<filename> ...]\n";
+    std::cerr << "             " << program << " --mix [options] [--gain <gain>] <filename> [[--gain <gain>] <filename> ...]\n";
+    std::cerr << "             " << program << " --info <filename or directory> [<filename or directory> ...]\n";
+    std::cerr << "             " << program << " --scan-silence [--silence-threshold <dB>] [--silence-duration <secs>] <filename> [<filename> ...]\n";
+    std::cerr << "             " << program << " --library <index> [--update-library <directory>] [--find <tag>=<value>]\n";
+    std::cerr << "             " << program << " --daemon <socket> [--latency <mode>] [--library <index> [--update-library <directory>]]\n";
+    std::cerr << "             " << program << " --send <socket> <command> [argument]\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  --startup-profile    report the time spent in each startup phase\n";
+    std::cerr << "  --latency <mode>     output latency: low (20 ms), deep (2000 ms) or a number of milliseconds\n";
+    std::cerr << "  --stats              print playback statistics when playback ends\n";
+    std::cerr << "  --adaptive           adapt the output buffering to underruns\n";
+    std::cerr << "  --realtime           play from a real time (SCHED_FIFO) output thread\n";
+    std::cerr << "  --burst              decode 30 s ahead in bursts and sleep in between, for fewer CPU wakeups\n";
+    std::cerr << "  --position           print the position being heard four times a second\n";
+    std::cerr << "  --record <file>      also write what is played to a WAV file\n";
+    std::cerr << "  --meter              print the peak and RMS level of each channel once a second\n";
+    std::cerr << "  --quality <tier>     resampling quality: fast, default, high or soxr\n";
+    std::cerr << "  --downmix            map multichannel sources to stereo with a precomputed ITU matrix\n";
+    std::cerr << "  --pipeline           decode, resample and play as overlapping coroutine stages\n";
+    std::cerr << "  --trim-silence       skip leading and trailing silence, seeking past it if the file was scanned\n";
+    std::cerr << "  --scan-silence       decode the given files and write a .silence map next to each\n";
+    std::cerr << "  --silence-threshold <dB>\n";
+    std::cerr << "                       the loudest level counted as silence, -60 by default\n";
+    std::cerr << "  --silence-duration <secs>\n";
+    std::cerr << "                       the shortest silence skipped, 2 by default\n";
+    std::cerr << "  --stream             bounded memory streaming mode for very long files\n";
+    std::cerr << "  --memory-report      print the resident and peak memory use when playback ends\n";
+    std::cerr << "  --trace <file>       write a timeline of the decoder, resampler, sink and threads to a Chrome trace file\n";
+    std::cerr << "  --simulate <clock>   play into a simulated sink instead of PulseAudio, the clock is realtime, stepped\n";
+    std::cerr << "                       (as fast as possible, deterministic) or how many times faster than real time\n";
+    std::cerr << "  --jitter <ms>        with --simulate, take each device period up to this late\n";
+    std::cerr << "  --stall <secs>:<ms>  with --simulate, stall the sink this long at this time, may be given more than once\n";
+    std::cerr << "  --chapters           list the chapters of the file and exit\n";
+    std::cerr << "  --chapter <n>        start playing at chapter n, counting from 1\n";
+    std::cerr << "  --info               print the tags, length and format of the files and exit, directories are searched\n";
+    std::cerr << "  --mix                play all given files at the same time\n";
+    std::cerr << "  --gain <gain>        linear gain for the files that follow, with --mix\n";
+    std::cerr << "  --crossfade <secs>   play the given files in order, crossfading between them\n";
+    std::cerr << "  --library <index>    the index file of the media library, created if missing\n";
+    std::cerr << "  --update-library <directory>\n";
+    std::cerr << "                       index the media files below a directory, only new and changed files are read\n";
+    std::cerr << "  --find <tag>=<value> print the files of the library with a tag, EX: --find artist=\"Nina Simone\"\n";
+    std::cerr << "  --daemon <socket>    keep the sink open and play files on command from the socket,\n";
+    std::cerr << "                       with --library the library is kept up to date while nothing plays\n";
+    std::cerr << "  --send <socket>      send a command to a daemon and print the reply, the commands are\n";
+    std::cerr << "                       PLAY <file>, ENQUEUE <file>, PAUSE, RESUME, SEEK <seconds>, STOP, STATS, SHUTDOWN,\n";
+    std::cerr << "                       FIND <tag>=<value>\n";
+}
+
+bool parse_latency(const char *argument, pa_usec_t &latency)
+{
+    const pa_usec_t LOW_LATENCY = 20 * PA_USEC_PER_MSEC;
+    const pa_usec_t DEEP_LATENCY = 2000 * PA_USEC_PER_MSEC;
+
+    if(std::strcmp(argument, "low") == 0)
     {
-        Return_Status status;
-        std::cout << "Iteration: " << i++ << '\n';
+        latency = LOW_LATENCY;
+        return true;
+    }
 
-        decoded_frame = decoder.decode_frame();
+    if(std::strcmp(argument, "deep") == 0)
+    {
+        latency = DEEP_LATENCY;
+        return true;
+    }
 
-        if(!decoded_frame && decoder.end_of_file_reached())
+    char *end = nullptr;
+    long milliseconds = std::strtol(argument, &end, 10);
+    if(end == argument || *end != '\0' || milliseconds <= 0)
+    {
+        return false;
+    }
+
+    latency = milliseconds * PA_USEC_PER_MSEC;
+    return true;
+}
+
+/* parse_sink_clock() function
+ * @desc parses the clock given with --simulate, "realtime", "stepped" or a speed up, EX: "20" runs 20 times faster than real time
+ * @param argument - the clock
+ * @param simulation - its clock and speed are set
+ * @return false if the argument is not a clock
+ */
+bool parse_sink_clock(const char *argument, Simulated_Sink_Config &simulation)
+{
+    if(std::strcmp(argument, "realtime") == 0)
+    {
+        simulation.clock = SINK_CLOCK_REALTIME;
+        return true;
+    }
+
+    if(std::strcmp(argument, "stepped") == 0)
+    {
+        simulation.clock = SINK_CLOCK_STEPPED;
+        return true;
+    }
+
+    char *end = nullptr;
+    double speed = std::strtod(argument, &end);
+    if(end == argument || *end != '\0' || !(speed > 0))
+    {
+        return false;
+    }
+
+    simulation.clock = SINK_CLOCK_ACCELERATED;
+    simulation.speed = speed;
+    return true;
+}
+
+/* parse_stall() function
+ * @desc parses a stall given with --stall, "<seconds>:<milliseconds>", EX: "60:300" stalls the sink for 300 ms a minute in
+ * @param argument - the stall
+ * @param stalls - the stall is added to them
+ * @return false if the argument is not a stall
+ */
+bool parse_stall(const char *argument, std::vector<Sink_Stall> &stalls)
+{
+    char *end = nullptr;
+    double at = std::strtod(argument, &end);
+    if(end == argument || *end != ':' || at < 0)
+    {
+        return false;
+    }
+
+    const char *duration_argument = end + 1;
+    double duration = std::strtod(duration_argument, &end);
+    if(end == duration_argument || *end != '\0' || !(duration > 0))
+    {
+        return false;
+    }
+
+    stalls.push_back(Sink_Stall{static_cast<int64_t>(at * 1e9), static_cast<int64_t>(duration * 1e6)});
+    return true;
+}
+
+bool parse_options(int argc, char **argv, Player_Options &options)
+{
+    float gain = 1.0f;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--startup-profile") == 0)
         {
-            std::cout << "End of file reached\n";
-            break;
+            options.startup_profile = true;
         }
 
-        else if(!decoded_frame)
+        else if(std::strcmp(argv[i], "--stats") == 0)
         {
-            poll_errors(decoder);
-            std::exit(1);
+            options.stats = true;
+        }
+
+        else if(std::strcmp(argv[i], "--adaptive") == 0)
+        {
+            options.adaptive = true;
+        }
+
+        else if(std::strcmp(argv[i], "--realtime") == 0)
+        {
+            options.realtime = true;
         }
 
-        if(i == 1)
+        else if(std::strcmp(argv[i], "--burst") == 0)
         {
-            status = resampler.reset_channel_layout(false, decoded_frame->channel_layout);
-            check_status(resampler, status, true);
+            options.burst = true;
+        }
 
-            status = resampler.reset_sample_format(false, static_cast<enum AVSampleFormat>(decoded_frame->format));
-            check_status(resampler, status, true);
+        else if(std::strcmp(argv[i], "--position") == 0)
+        {
+            options.position = true;
+        }
 
-            status = resampler.reset_sample_rate(true, decoded_frame->sample_rate);
-            check_status(resampler, status, true);
+        else if(std::strcmp(argv[i], "--record") == 0)
+        {
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            options.record_path = argv[++i];
+        }
 
-            status = resampler.reset_sample_rate(false, decoded_frame->sample_rate);
-            check_status(resampler, status, true);
+        else if(std::strcmp(argv[i], "--meter") == 0)
+        {
+            options.meter = true;
+        }
 
-            status = resampler.init();
-            check_status(resampler, status, true);
+        else if(std::strcmp(argv[i], "--quality") == 0)
+        {
+            if(i + 1 >= argc || !find_resample_quality(argv[++i], options.quality))
+            {
+                return false;
+            }
+        }
 
-            audio_player.reset_sample_rate(decoded_frame->sample_rate);
+        else if(std::strcmp(argv[i], "--downmix") == 0)
+        {
+            options.downmix = true;
+        }
 
-            status = audio_player.init();
-            check_status(audio_player, status, true);
+        else if(std::strcmp(argv[i], "--pipeline") == 0)
+        {
+            options.pipeline = true;
+        }
 
+        else if(std::strcmp(argv[i], "--trim-silence") == 0)
+        {
+            options.trim_silence = true;
         }
 
-        resampled_frame = resampler.resample_frame(decoded_frame);
+        else if(std::strcmp(argv[i], "--scan-silence") == 0)
+        {
+            options.scan_silence = true;
+        }
 
-        if(!resampled_frame)
+        else if(std::strcmp(argv[i], "--silence-threshold") == 0)
         {
-            poll_errors(resampler);
-            std::exit(1);
+            char *end = nullptr;
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+
+            options.silence_threshold = std::strtod(argv[++i], &end);
+            if(end == argv[i] || *end != '\0' || options.silence_threshold > 0)
+            {
+                return false;
+            }
         }
 
-        status = audio_player.play_frame(resampled_frame); 
-        check_status(audio_player, status, true);
+        else if(std::strcmp(argv[i], "--silence-duration") == 0)
+        {
+            char *end = nullptr;
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+
+            options.silence_seconds = std::strtod(argv[++i], &end);
+            if(end == argv[i] || *end != '\0' || options.silence_seconds <= 0)
+            {
+                return false;
+            }
+        }
+
+        else if(std::strcmp(argv[i], "--stream") == 0)
+        {
+            options.streaming = true;
+        }
+
+        else if(std::strcmp(argv[i], "--memory-report") == 0)
+        {
+            options.memory_report = true;
+        }
+
+        else if(std::strcmp(argv[i], "--chapters") == 0)
+        {
+            options.list_chapters = true;
+        }
+
+        else if(std::strcmp(argv[i], "--info") == 0)
+        {
+            options.info = true;
+        }
+
+        else if(std::strcmp(argv[i], "--chapter") == 0)
+        {
+            char *end = nullptr;
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+
+            long chapter = std::strtol(argv[++i], &end, 10);
+            if(end == argv[i] || *end != '\0' || chapter < 1 || chapter > INT_MAX)
+            {
+                return false;
+            }
+            options.chapter = static_cast<int>(chapter);
+        }
+
+        else if(std::strcmp(argv[i], "--latency") == 0)
+        {
+            if(i + 1 >= argc || !parse_latency(argv[++i], options.target_latency))
+            {
+                return false;
+            }
+        }
+
+        else if(std::strcmp(argv[i], "--mix") == 0)
+        {
+            options.mix = true;
+        }
+
+        else if(std::strcmp(argv[i], "--crossfade") == 0)
+        {
+            char *end = nullptr;
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+
+            options.crossfade = std::strtod(argv[++i], &end);
+            if(end == argv[i] || *end != '\0' || options.crossfade < 0)
+            {
+                return false;
+            }
+        }
+
+        else if(std::strcmp(argv[i], "--trace") == 0)
+        {
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            options.trace_path = argv[++i];
+        }
+
+        else if(std::strcmp(argv[i], "--simulate") == 0)
+        {
+            if(i + 1 >= argc || !parse_sink_clock(argv[++i], options.simulation))
+            {
+                return false;
+            }
+            options.simulate = true;
+        }
+
+        else if(std::strcmp(argv[i], "--jitter") == 0)
+        {
+            char *end = nullptr;
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+
+            double jitter = std::strtod(argv[++i], &end);
+            if(end == argv[i] || *end != '\0' || jitter < 0)
+            {
+                return false;
+            }
+            options.simulation.jitter = static_cast<uint64_t>(jitter * 1000);
+        }
 
+        else if(std::strcmp(argv[i], "--stall") == 0)
+        {
+            if(i + 1 >= argc || !parse_stall(argv[++i], options.simulation.stalls))
+            {
+                return false;
+            }
+        }
+
+        else if(std::strcmp(argv[i], "--library") == 0)
+        {
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            options.library_path = argv[++i];
+        }
+
+        else if(std::strcmp(argv[i], "--update-library") == 0)
+        {
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            options.library_root = argv[++i];
+        }
+
+        else if(std::strcmp(argv[i], "--find") == 0)
+        {
+            if(i + 1 >= argc || std::strchr(argv[i + 1], '=') == nullptr)
+            {
+                return false;
+            }
+            options.find_tag = argv[++i];
+        }
+
+        else if(std::strcmp(argv[i], "--daemon") == 0)
+        {
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+            options.daemon_socket = argv[++i];
+        }
+
+        else if(std::strcmp(argv[i], "--send") == 0)
+        {
+            if(i + 2 >= argc)
+            {
+                return false;
+            }
+            options.send_socket = argv[++i];
 
+            // the rest of the line is the command, so file names starting with "--" need no escaping
+            options.command = argv[++i];
+            while(++i < argc)
+            {
+                options.command += ' ';
+                options.command += argv[i];
+            }
+        }
+
+        else if(std::strcmp(argv[i], "--gain") == 0)
+        {
+            char *end = nullptr;
+            if(i + 1 >= argc)
+            {
+                return false;
+            }
+
+            gain = std::strtof(argv[++i], &end);
+            if(end == argv[i] || *end != '\0' || gain < 0)
+            {
+                return false;
+            }
+        }
+
+        else if(std::strncmp(argv[i], "--", 2) == 0)
+        {
+            return false;
+        }
+
+        else
+        {
+            options.filenames.push_back(argv[i]);
+            options.gains.push_back(gain);
+        }
     }
-}
 
-int main(int argc, char **argv)
-{
-    const int NUMBER_CHANNELS = 2;
-    const enum AVSampleFormat SAMPLE_FORMAT = AV_SAMPLE_FMT_S16;
-    const pa_sample_format_t SAMPLE_FORMAT_PULSE = PA_SAMPLE_S16NE;
+    // the library options need the index, and the daemon takes no query
+    if((!options.library_root.empty() || !options.find_tag.empty()) && options.library_path.empty())
+    {
+        return false;
+    }
 
-    if(argc != 2)
+    // jitter and stalls are things the simulated sink does
+    if(!options.simulate && (options.simulation.jitter > 0 || !options.simulation.stalls.empty()))
     {
-        std::cerr << "Invalid usage\n";
-        std::cerr << "Valid Usage: " << argv[0] << " <filename>\n";
-        return 1;
+        return false;
     }
 
-    std::cout << "Decoding Audio\n";
-    FFmpeg_Decoder decoder{argv[1], AVMEDIA_TYPE_AUDIO};
+    if(!options.daemon_socket.empty() || !options.send_socket.empty())
+    {
+        return options.filenames.empty() && !options.simulate && (options.daemon_socket.empty() || options.send_socket.empty()) &&
+               options.find_tag.empty() && (options.send_socket.empty() || options.library_path.empty());
+    }
+
+    if(!options.library_path.empty())
+    {
+        return options.filenames.empty() && (!options.library_root.empty() || !options.find_tag.empty());
+    }
+
+    if(options.filenames.size() > 1 && !options.mix && options.crossfade < 0 && !options.scan_silence && !options.info)
+    {
+        return false;
+    }
+
+    if(options.mix && options.crossfade >= 0)
+    {
+        return false;
+    }
+
+    // the pipeline's sink stage writes to the player itself, there is no output thread or adaptive buffer to drive
+    if(options.pipeline && (options.realtime || options.adaptive))
+    {
+        return false;
+    }
+
+    // a burst fills the whole buffer, the adaptive buffer would keep moving the fill target under it
+    if(options.burst && (options.pipeline || options.adaptive))
+    {
+        return false;
+    }
+
+    // the adaptive buffer times the writes on the steady clock, only the realtime clock of the simulated sink follows it
+    if(options.adaptive && options.simulate && options.simulation.clock != SINK_CLOCK_REALTIME)
+    {
+        return false;
+    }
+
+    // the trimmer sits between the resampler and the sink in main_loop(), the pipeline has no place for it
+    if(options.trim_silence && (options.pipeline || options.mix || options.crossfade >= 0))
+    {
+        return false;
+    }
+
+    return !options.filenames.empty();
+}
+
+void init_resampler(FFmpeg_Frame_Resampler &resampler, AVFrame *decoded_frame)
+{
+    Return_Status status;
+
+    status = resampler.reset_channel_layout(false, decoded_frame->channel_layout);
+    check_status(resampler, status, true);
+
+    status = resampler.reset_sample_format(false, static_cast<enum AVSampleFormat>(decoded_frame->format));
+    check_status(resampler, status, true);
+
+    status = resampler.reset_sample_rate(true, decoded_frame->sample_rate);
+    check_status(resampler, status, true);
+
+    status = resampler.reset_sample_rate(false, decoded_frame->sample_rate);
+    check_status(resampler, status, true);
+
+    status = resampler.init();
+    check_status(resampler, status, true);
+}
+
+/* startup() function
+ * @desc brings the pipeline up to the point where the first frame can be played
+ * @desc the sink connection and the first packet read run on their own threads while the codec is initialized,
+ * @desc the sink is connected with the sample rate found when probing the file
+ * @return the first decoded frame, the player and resampler are initialized for it
+ */
+AVFrame *startup(FFmpeg_Decoder &decoder, FFmpeg_Frame_Resampler &resampler, Audio_Player &audio_player, Startup_Profiler &profiler)
+{
     Return_Status status;
+    std::chrono::steady_clock::time_point begin;
 
+    begin = profiler.now();
     status = decoder.open_file();
     check_status(decoder, status, true);
+    profiler.record("open_file + probe", "main", begin, profiler.now());
+
+    uint32_t probed_sample_rate = decoder.get_stream()->codecpar->sample_rate;
+    audio_player.reset_sample_rate(probed_sample_rate);
+
+    // the sink connection only needs the sample rate, so start it right away
+    std::future<Return_Status> sink_status = std::async(std::launch::async, [&audio_player, &profiler]()
+    {
+        trace_name_thread("sink");
+        std::chrono::steady_clock::time_point sink_begin = profiler.now();
+        Return_Status result = audio_player.init();
+        profiler.record("sink connect", "sink", sink_begin, profiler.now());
+        return result;
+    });
+
+    // the first packet read only touches the format context and the codec is opened from a copy of the stream's parameters,
+    // so they can overlap. The format context is not used again on this thread until the read is done
+    std::future<void> prefetch = std::async(std::launch::async, [&decoder, &profiler]()
+    {
+        trace_name_thread("reader");
+        std::chrono::steady_clock::time_point read_begin = profiler.now();
+        decoder.prefetch_packet();
+        profiler.record("first packet read", "reader", read_begin, profiler.now());
+    });
 
+    begin = profiler.now();
     status = decoder.init();
-    check_status(decoder, status, true);
+    profiler.record("codec init", "main", begin, profiler.now());
 
-    FFmpeg_Frame_Resampler resampler{
-        av_get_default_channel_layout(NUMBER_CHANNELS), // set out channel layout
-        SAMPLE_FORMAT,                                  // set out sample format
-        0,                                              // set temporary out sample rate, will be set when decoding starts
-        0,                                              // set in channel layout, unknown right now, will be set when decoding starts
-        AV_SAMPLE_FMT_NONE,                             // set in sample format, unkwonw right now, will be set when decoding starts
-        0};                                             // set in sample rate, unkown, will be set when decoding starts
+    prefetch.wait();
+
+    if(status == STATUS_FAILURE)
+    {
+        sink_status.wait();
+        check_status(decoder, status, true);
+    }
 
-    Audio_Player audio_player{SAMPLE_FORMAT_PULSE, NUMBER_CHANNELS, 0, "Simple Audio Player", std::string{argv[1]}};
-    main_loop(decoder, resampler, audio_player);
+    begin = profiler.now();
+    AVFrame *decoded_frame = decoder.decode_frame();
+    if(!decoded_frame)
+    {
+        sink_status.wait();
 
-    return 0;
+        if(decoder.end_of_file_reached())
+        {
+            std::cout << "End of file reached\n";
+            std::exit(0);
+        }
+
+        poll_errors(decoder);
+        std::exit(1);
+    }
+    profiler.record("first frame decode", "main", begin, profiler.now());
+
+    begin = profiler.now();
+    init_resampler(resampler, decoded_frame);
+    profiler.record("resampler init", "main", begin, profiler.now());
+
+    begin = profiler.now();
+    status = sink_status.get();
+    profiler.record("wait for sink", "main", begin, profiler.now());
+    check_status(audio_player, status, true);
+
+    if(static_cast<uint32_t>(decoded_frame->sample_rate) != probed_sample_rate)
+    {
+        // the container reported a different rate than the codec produces, reconnect with the real one
+        begin = profiler.now();
+        audio_player.reset_sample_rate(decoded_frame->sample_rate);
+        status = audio_player.init();
+        check_status(audio_player, status, true);
+        profiler.record("sink reconnect", "main", begin, profiler.now());
+    }
+
+    return decoded_frame;
+}
+
+void measure_latency(Audio_Player &audio_player, Playback_Stats &stats)
+{
+    pa_usec_t latency = 0;
+    Return_Status status = audio_player.get_latency(latency);
+    check_status(audio_player, status, false);
+
+    if(status == STATUS_FAILURE)
+    {
+        return;
+    }
+
+    if(stats.latency_checks == 0 || latency < stats.latency_min)
+    {
+        stats.latency_min = latency;
+    }
+
+    if(latency > stats.latency_max)
+    {
+        stats.latency_max = latency;
+    }
+
+    stats.latency_total += latency;
+    stats.latency_checks++;
+}
+
+/* read_usage() function
+ * @desc reads the CPU time and the voluntary context switches of the whole process so far
+ * @param cpu_seconds - set to the user and system CPU time of all threads
+ * @param context_switches - set to the number of times a thread gave up the CPU to sleep, EX: in a blocking write
+ */
+void read_usage(double &cpu_seconds, uint64_t &context_switches)
+{
+    struct rusage usage;
+    std::memset(&usage, 0, sizeof(usage));
+    getrusage(RUSAGE_SELF, &usage);
+
+    cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    context_switches = static_cast<uint64_t>(usage.ru_nvcsw);
+}
+
+/* apply_simulation() function
+ * @desc switches the player to the simulated backend with the sink given by --simulate, --jitter and --stall
+ * @note the player has to be initialized afterwards
+ */
+void apply_simulation(Audio_Player &audio_player, const Player_Options &options)
+{
+    if(options.simulate)
+    {
+        audio_player.reset_backend(BACKEND_SIMULATED);
+        audio_player.reset_simulation(options.simulation);
+    }
+}
+
+/* print_simulation_stats() function
+ * @desc prints what the simulated sink did, nothing if the player uses another backend
+ */
+void print_simulation_stats(Audio_Player &audio_player)
+{
+    if(audio_player.get_backend() != BACKEND_SIMULATED)
+    {
+        return;
+    }
+
+    Simulated_Sink &sink = audio_player.get_simulated_sink();
+    const Simulated_Sink_Stats &sink_stats = sink.get_stats();
+
+    std::cout << "Simulated sink\n";
+    std::cout << "  sink time: " << sink.get_time() / 1e9 << " s\n";
+    std::cout << "  underruns: " << sink_stats.underruns << ", " << sink_stats.silence / 1e6 << " ms of silence\n";
+    std::cout << "  writes that blocked: " << sink_stats.blocked_writes << '\n';
+    std::cout << "  stalls injected: " << sink_stats.stalls << '\n';
+    std::cout << "  largest latency: " << sink_stats.max_latency / 1000.0 << " ms\n";
+}
+
+void print_stats(Audio_Player &audio_player, const Playback_Stats &stats)
+{
+    std::cout << "Playback statistics\n";
+    std::cout << "  frames played:  " << stats.frames_played << '\n';
+    std::cout << "  samples played: " << stats.samples_played << '\n';
+
+    if(audio_player.get_target_latency() > 0)
+    {
+        std::cout << "  target latency: " << audio_player.get_target_latency() / 1000.0 << " ms\n";
+    }
+    else
+    {
+        std::cout << "  target latency: server default\n";
+    }
+
+    if(stats.latency_checks > 0)
+    {
+        std::cout << "  measured latency: min " << stats.latency_min / 1000.0
+                  << " ms, avg " << stats.latency_total / stats.latency_checks / 1000.0
+                  << " ms, max " << stats.latency_max / 1000.0
+                  << " ms (" << stats.latency_checks << " samples)\n";
+    }
+
+    std::cout << "  output thread underruns: " << stats.underruns << '\n';
+
+    if(stats.producer_wakeups > 0)
+    {
+        std::cout << "  decoder bursts: " << stats.producer_wakeups << '\n';
+    }
+
+    if(stats.trimmed_seconds > 0)
+    {
+        std::cout << "  silence skipped: " << stats.trimmed_seconds << " s\n";
+    }
+
+    // compare runs with and without --burst
+    if(stats.wall_seconds > 0 && stats.audio_seconds > 0)
+    {
+        std::cout << "  wakeups: " << stats.context_switches / stats.wall_seconds << " per second\n";
+        std::cout << "  CPU time: " << stats.cpu_seconds * 60 / stats.audio_seconds << " s per audio minute\n";
+    }
+
+    if(alloc_audit_enabled())
+    {
+        std::cout << "  steady state allocations on the output thread: " << stats.audit_allocations << '\n';
+    }
+
+    print_simulation_stats(audio_player);
+}
+
+void print_time(int64_t timestamp, std::ostream &out = std::cout)
+{
+    int64_t seconds = timestamp / AV_TIME_BASE;
+    out << seconds / 3600 << ':' << std::setfill('0') << std::setw(2) << seconds / 60 % 60
+        << ':' << std::setw(2) << seconds % 60 << std::setfill(' ');
+}
+
+void print_positions(const Playback_Clock &clock, const std::atomic<bool> &stop)
+{
+    const std::chrono::milliseconds INTERVAL{250};
+
+    while(!stop.load(std::memory_order_acquire))
+    {
+        int64_t position = clock.get_position();
+
+        // one write per line, the decoding thread prints to std::cout too
+        std::ostringstream line;
+        line << "Position: ";
+        print_time(position, line);
+        line << '.' << std::setfill('0') << std::setw(3) << position / 1000 % 1000 << '\n';
+        std::cout << line.str() << std::flush;
+
+        std::this_thread::sleep_for(INTERVAL);
+    }
+}
+
+void print_clock_stats(const Playback_Clock &clock)
+{
+    std::cout << "Playback clock:\n";
+    std::cout << "  latency measurements: " << clock.get_updates() << '\n';
+    std::cout << "  largest correction: " << clock.get_max_correction_ms() << " ms\n";
+    std::cout << "  position: ";
+    print_time(clock.get_position());
+    std::cout << '\n';
+}
+
+int list_chapters(const std::string &filename)
+{
+    FFmpeg_Decoder decoder{filename, AVMEDIA_TYPE_AUDIO};
+
+    Return_Status status = decoder.open_file();
+    check_status(decoder, status, true);
+
+    std::vector<Chapter> chapters = decoder.get_chapters();
+    if(chapters.empty())
+    {
+        std::cout << filename << " has no chapters\n";
+        return 0;
+    }
+
+    for(const Chapter &chapter : chapters)
+    {
+        std::cout << std::setw(4) << chapter.index + 1 << "  ";
+        print_time(chapter.start);
+        std::cout << " - ";
+        print_time(chapter.end);
+        std::cout << "  " << chapter.title << '\n';
+    }
+
+    return 0;
+}
+
+int print_info(const Player_Options &options)
+{
+    std::vector<std::string> paths;
+    for(const std::string &filename : options.filenames)
+    {
+        struct stat file_status;
+        if(stat(filename.c_str(), &file_status) == 0 && S_ISDIR(file_status.st_mode))
+        {
+            std::string error;
+            if(list_media_files(filename, paths, error) == STATUS_FAILURE)
+            {
+                std::cerr << error << '\n';
+                return 1;
+            }
+        }
+        else
+        {
+            paths.push_back(filename);
+        }
+    }
+
+    std::vector<Media_Metadata> metadata;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    scan_metadata(paths, std::thread::hardware_concurrency(), metadata);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    int exit_code = 0;
+    for(const Media_Metadata &entry : metadata)
+    {
+        if(!entry.error.empty())
+        {
+            std::cerr << entry.error << '\n';
+            exit_code = 1;
+            continue;
+        }
+
+        std::cout << entry.path << '\n';
+        std::cout << "  " << entry.codec << " in " << entry.container << ", " << entry.sample_rate << " Hz, " << entry.channels << " channels";
+        if(entry.bits_per_sample > 0)
+        {
+            std::cout << ", " << entry.bits_per_sample << " bit";
+        }
+        if(entry.bit_rate > 0)
+        {
+            std::cout << ", " << entry.bit_rate / 1000 << " kb/s";
+        }
+        if(entry.duration != AV_NOPTS_VALUE)
+        {
+            std::cout << (entry.duration_estimated ? ", about " : ", ");
+            print_time(entry.duration);
+        }
+        if(entry.has_cover_art)
+        {
+            std::cout << ", cover art";
+        }
+        std::cout << '\n';
+
+        for(const std::pair<const std::string, std::string> &tag : entry.tags)
+        {
+            std::cout << "  " << tag.first << ": " << tag.second << '\n';
+        }
+    }
+
+    // a directory scan is the case worth timing
+    if(metadata.size() > 1)
+    {
+        std::cout << metadata.size() << " files read in " << elapsed.count() << " s, "
+                  << metadata.size() / elapsed.count() << " files per second\n";
+    }
+
+    return exit_code;
+}
+
+int scan_silence(const Player_Options &options)
+{
+    int exit_code = 0;
+
+    for(const std::string &filename : options.filenames)
+    {
+        Silence_Map map;
+        std::string error;
+        if(scan_silence_map(filename, options.silence_threshold, options.silence_seconds, map, error) == STATUS_FAILURE ||
+           write_silence_map(filename, map, error) == STATUS_FAILURE)
+        {
+            std::cerr << error << '\n';
+            exit_code = 1;
+            continue;
+        }
+
+        std::cout << filename << ": " << map.ranges.size() << " silent stretches, written to " << get_silence_map_path(filename) << '\n';
+        for(const Silence_Range &range : map.ranges)
+        {
+            std::cout << "  ";
+            print_time(range.start);
+            std::cout << '.' << std::setfill('0') << std::setw(3) << range.start / 1000 % 1000 << " - ";
+            print_time(range.end);
+            std::cout << '.' << std::setw(3) << range.end / 1000 % 1000 << std::setfill(' ') << '\n';
+        }
+    }
+
+    return exit_code;
+}
+
+void poll_errors(Media_Library &library)
+{
+    for(std::string error = library.poll_error(); !error.empty(); error = library.poll_error())
+    {
+        std::cerr << error << '\n';
+    }
+}
+
+/* update_library() function
+ * @desc brings the library up to date with a directory, saves it and prints what changed
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status update_library(Media_Library &library, const std::string &root)
+{
+    Library_Update_Stats stats;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(library.update(root, std::thread::hardware_concurrency(), stats) == STATUS_FAILURE)
+    {
+        poll_errors(library);
+        return STATUS_FAILURE;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << library.get_root() << ": " << stats.files << " files, " << stats.unchanged << " unchanged, " << stats.added
+              << " added, " << stats.changed << " changed, " << stats.removed << " removed, " << stats.failed << " unreadable, in "
+              << elapsed.count() << " s\n";
+
+    if(library.save() == STATUS_FAILURE)
+    {
+        poll_errors(library);
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* run_library() function
+ * @desc updates the library given with --library from the directory given with --update-library, then prints the
+ * @desc files found with --find
+ * @return the exit code of the program
+ */
+int run_library(const Player_Options &options)
+{
+    Media_Library library{options.library_path};
+
+    // an index that can't be read is rebuilt by an update, a query has nothing to go on
+    if(library.load() == STATUS_FAILURE)
+    {
+        poll_errors(library);
+        if(options.library_root.empty())
+        {
+            return 1;
+        }
+    }
+
+    if(!options.library_root.empty() && update_library(library, options.library_root) == STATUS_FAILURE)
+    {
+        return 1;
+    }
+
+    if(options.find_tag.empty())
+    {
+        return 0;
+    }
+
+    std::size_t equals = options.find_tag.find('=');
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<const Library_Entry*> found = library.find_by_tag(options.find_tag.substr(0, equals), options.find_tag.substr(equals + 1));
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    for(const Library_Entry *entry : found)
+    {
+        std::cout << entry->metadata.path;
+        if(entry->metadata.duration != AV_NOPTS_VALUE)
+        {
+            std::cout << "  ";
+            print_time(entry->metadata.duration);
+        }
+        std::cout << '\n';
+    }
+
+    std::cout << found.size() << " of " << library.get_entries().size() << " files found in " << elapsed.count() << " us\n";
+    return found.empty() ? 1 : 0;
+}
+
+void print_memory_report()
+{
+    Memory_Usage usage;
+    if(read_memory_usage(usage) != STATUS_SUCCESS)
+    {
+        std::cerr << "Failed to read memory usage\n";
+        return;
+    }
+
+    std::cout << "Memory usage\n";
+    std::cout << "  resident: " << usage.resident_kb / 1024.0 << " MiB\n";
+    std::cout << "  peak resident: " << usage.peak_resident_kb / 1024.0 << " MiB\n";
+}
+
+void poll_errors(Pipe_Input &pipe_input)
+{
+    for(std::string error = pipe_input.poll_error(); !error.empty(); error = pipe_input.poll_error())
+    {
+        std::cerr << error << std::endl;
+    }
+}
+
+void check_status(Pipe_Input &pipe_input, Return_Status status, bool exit)
+{
+    if(status == STATUS_FAILURE)
+    {
+        poll_errors(pipe_input);
+
+        if(exit)
+        {
+            std::exit(1);
+        }
+    }
+}
+
+void print_pipe_stats(Pipe_Input &pipe_input)
+{
+    Pipe_Input_Stats stats = pipe_input.get_stats();
+
+    std::cout << "Input statistics\n";
+    std::cout << "  bytes received: " << stats.bytes_received << '\n';
+    std::cout << "  jitter buffer: " << stats.capacity / 1024 << " KiB, filled between " << stats.fill_min / 1024
+              << " and " << stats.fill_max / 1024 << " KiB\n";
+    std::cout << "  startup wait: " << stats.startup_ms << " ms\n";
+    std::cout << "  underruns: " << stats.underruns << " (" << stats.stall_ms << " ms waiting to refill)\n";
+}
+
+void print_adaptive_stats(const Adaptive_Buffer &adaptive)
+{
+    std::cout << "Adaptive buffering\n";
+    std::cout << "  buffer target: " << adaptive.get_target() / 1000.0 << " ms\n";
+    std::cout << "  underruns: " << adaptive.get_underruns() << ", target raised " << adaptive.get_raises()
+              << " times, lowered " << adaptive.get_lowers() << " times\n";
+
+    for(const Underrun_Event &event : adaptive.get_history())
+    {
+        std::cout << "  underrun at " << event.time << " s";
+        if(event.gap_ms > 0)
+        {
+            std::cout << ", " << event.gap_ms << " ms of silence";
+        }
+        std::cout << ", target now " << event.target / 1000.0 << " ms\n";
+    }
+}
+
+/* apply_buffer_target() function
+ * @desc applies the target of the Adaptive_Buffer, to the output thread's fill target in real time mode, otherwise to the sink
+ * @param bytes_per_second - the byte rate of the PCM handed to the output thread, to convert the target to a fill level
+ * @param drain - wait for the sink to play what it has before reconnecting, not needed right after an underrun as it is empty then
+ * @note the sink has to be reconnected to change its buffering, draining first leaves a gap of a few milliseconds,
+ * @note so main_loop() only lowers it at a natural break
+ */
+void apply_buffer_target(Audio_Player &audio_player, Output_Thread *output, Adaptive_Buffer &adaptive, uint64_t bytes_per_second, bool drain)
+{
+    if(output)
+    {
+        output->set_fill_target(adaptive.get_target() * bytes_per_second / 1000000);
+        return;
+    }
+
+    Return_Status status;
+    if(drain)
+    {
+        status = audio_player.drain();
+        check_status(audio_player, status, false);
+    }
+
+    audio_player.reset_target_latency(adaptive.get_target());
+    status = audio_player.init();
+    check_status(audio_player, status, true);
+
+    adaptive.reset_write();
+}
+
+void check_status(Output_Thread &output, Return_Status status, bool exit)
+{
+    if(status == STATUS_FAILURE)
+    {
+        poll_errors(output);
+
+        if(exit)
+        {
+            std::exit(1);
+        }
+    }
+}
+
+void poll_errors(Frame_Fanout &fanout)
+{
+    for(std::string error = fanout.poll_error(); !error.empty(); error = fanout.poll_error())
+    {
+        std::cerr << error << std::endl;
+    }
+}
+
+void check_status(Frame_Fanout &fanout, Return_Status status, bool exit)
+{
+    if(status == STATUS_FAILURE)
+    {
+        poll_errors(fanout);
+
+        if(exit)
+        {
+            std::exit(1);
+        }
+    }
+}
+
+void print_fanout_stats(Frame_Fanout &fanout)
+{
+    std::cout << "Taps:\n";
+    std::cout << "  frames shared: " << fanout.get_frames_pushed() << ", copied: " << fanout.get_frames_copied() << '\n';
+
+    for(const Fanout_Sink_Stats &sink : fanout.get_stats())
+    {
+        std::cout << "  " << sink.name << ": " << sink.frames_consumed << " frames, " << sink.frames_dropped << " dropped, lag avg "
+                  << sink.lag_avg_ms << " ms, max " << sink.lag_max_ms << " ms, at most " << sink.max_queued << " queued"
+                  << (sink.failed ? ", failed" : "") << '\n';
+    }
+}
+
+void print_levels(Meter_Sink &meter)
+{
+    std::cout << "Levels over the whole stream:\n" << std::fixed << std::setprecision(1);
+    for(int channel = 0; channel < meter.get_channels(); channel++)
+    {
+        std::cout << "  channel " << channel << ": " << meter.get_peak_db(channel) << " dB peak, "
+                  << meter.get_rms_db(channel) << " dB RMS\n";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+void poll_errors(Silence_Trimmer &trimmer)
+{
+    for(std::string error = trimmer.poll_error(); !error.empty(); error = trimmer.poll_error())
+    {
+        std::cerr << error << std::endl;
+    }
+}
+
+void main_loop(FFmpeg_Decoder &decoder, FFmpeg_Frame_Resampler &resampler, Audio_Player &audio_player, Output_Thread *output,
+               Adaptive_Buffer *adaptive, Playback_Clock &clock, Frame_Fanout *taps, Silence_Trimmer *trimmer, int64_t end_timestamp,
+               AVFrame *decoded_frame, Startup_Profiler &profiler, const Player_Options &options, Playback_Stats &stats)
+{
+    AVFrame *resampled_frame;
+
+    // the frames handed to the trimmer, it holds them back while they may be trailing silence
+    Frame_Handle trimmed_frame;
+
+    // the latency query is a server round trip, only measure about twice a second
+    uint64_t samples_since_latency_check = 0;
+
+    // the playback clock wants a measurement about ten times a second, the first one right away
+    uint64_t samples_since_clock_update = UINT64_MAX / 2;
+
+    // underruns of the output thread already handed to the adaptive buffer
+    uint64_t underruns_seen = 0;
+
+    // without the output thread a lower target drains the sink, in a file with chapters that gap is left for the next one
+    // instead of made mid stream, the adaptive buffer keeps its target until then
+    bool natural_break = false;
+    std::vector<Chapter> chapters;
+    std::size_t next_chapter = 0;
+    if(adaptive && !output)
+    {
+        chapters = decoder.get_chapters();
+    }
+
+    // the last latency measured without the output thread, 0 after the sink was reconnected
+    pa_usec_t sink_latency = 0;
+
+    auto play = [&](AVFrame *frame)
+    {
+        Return_Status status;
+
+        // the taps take references to the frame's buffers, they never hold up the sink
+        if(taps)
+        {
+            status = taps->push(frame);
+            check_status(*taps, status, false);
+        }
+
+        uint64_t bytes_per_second = static_cast<uint64_t>(frame->sample_rate) *
+                                    av_get_bytes_per_sample(static_cast<enum AVSampleFormat>(frame->format)) * frame->channels;
+
+        if(output)
+        {
+            std::size_t size = av_samples_get_buffer_size(nullptr, frame->channels, frame->nb_samples,
+                                                          static_cast<enum AVSampleFormat>(frame->format), 1);
+            status = output->write(frame->extended_data[0], size);
+            check_status(*output, status, true);
+
+            // the output thread counts its underruns, the adaptive buffer reacts to each new one
+            for(; adaptive && underruns_seen < output->get_underruns(); underruns_seen++)
+            {
+                if(adaptive->report_underrun() == ADAPT_RAISED)
+                {
+                    apply_buffer_target(audio_player, output, *adaptive, bytes_per_second, false);
+                }
+            }
+        }
+        else
+        {
+            // the sink is empty when an underrun is detected, so it can be reconnected with more buffering right away
+            if(adaptive && adaptive->begin_write() == ADAPT_RAISED)
+            {
+                apply_buffer_target(audio_player, output, *adaptive, bytes_per_second, false);
+                sink_latency = 0;
+            }
+            else if(adaptive && adaptive->lower_due() && (natural_break || chapters.empty()) && adaptive->update() == ADAPT_LOWERED)
+            {
+                apply_buffer_target(audio_player, output, *adaptive, bytes_per_second, true);
+                sink_latency = 0;
+            }
+            natural_break = false;
+
+            status = audio_player.play_frame(frame); 
+            check_status(audio_player, status, true);
+
+            // the output thread keeps the clock in real time mode
+            clock.advance(frame->nb_samples);
+
+            // one latency query serves the clock and the adaptive buffer. While the sink fills up after a reconnect it is made
+            // every frame, the writes start blocking once it is full and an older measurement would make them look like underruns
+            samples_since_clock_update += frame->nb_samples;
+            bool filling = adaptive && sink_latency < adaptive->get_target() / 2;
+            if(filling || samples_since_clock_update * 10 >= static_cast<uint64_t>(frame->sample_rate))
+            {
+                if(audio_player.get_latency(sink_latency) == STATUS_SUCCESS)
+                {
+                    clock.update_latency(sink_latency);
+                    if(adaptive)
+                    {
+                        adaptive->end_write(sink_latency);
+                    }
+                }
+                else if(adaptive)
+                {
+                    adaptive->end_write();
+                }
+                samples_since_clock_update = 0;
+            }
+            else if(adaptive)
+            {
+                adaptive->end_write();
+            }
+        }
+
+        // in real time mode this only moves the output thread's fill target, there is no gap
+        if(output && adaptive && adaptive->update() == ADAPT_LOWERED)
+        {
+            apply_buffer_target(audio_player, output, *adaptive, bytes_per_second, true);
+        }
+
+        stats.frames_played++;
+        stats.samples_played += frame->nb_samples;
+
+        samples_since_latency_check += frame->nb_samples;
+        // the output thread owns the sink in real time mode, leave it alone
+        if(options.stats && !output && samples_since_latency_check * 2 >= static_cast<uint64_t>(frame->sample_rate))
+        {
+            measure_latency(audio_player, stats);
+            samples_since_latency_check = 0;
+        }
+
+        if(stats.frames_played == 1 && profiler.enabled())
+        {
+            profiler.mark("first sample written", "main");
+            profiler.report(std::cout);
+        }
+    };
+
+    // where the clock was started, the first decoded frame
+    int64_t origin = 0;
+    if(decoded_frame && decoded_frame->best_effort_timestamp != AV_NOPTS_VALUE)
+    {
+        origin = av_rescale_q(decoded_frame->best_effort_timestamp, decoder.get_stream()->time_base, AVRational{1, AV_TIME_BASE});
+    }
+
+    // plays what the trimmer let through
+    auto play_trimmed = [&]()
+    {
+        for(Frame_Handle frame = trimmer->pop(); frame; frame = trimmer->pop())
+        {
+            // all of the leading silence is dropped before the first frame comes out, the clock starts after it.
+            // Nothing was written yet, so the output thread has not touched the clock either
+            if(stats.frames_played == 0 && trimmer->get_trimmed_leading() > 0)
+            {
+                clock.reset(origin + av_rescale(trimmer->get_trimmed_leading(), AV_TIME_BASE, trimmer->get_sample_rate()));
+            }
+
+            play(frame.get());
+        }
+    };
+
+    int i = 0;
+    while(1)
+    {
+        // a line for every frame keeps the terminal busy, burst mode is meant to let the CPU sleep
+        if(!options.burst)
+        {
+            std::cout << "Iteration: " << i << '\n';
+        }
+        i++;
+
+        if(i > 1)
+        {
+            decoded_frame = decoder.decode_frame();
+        }
+
+        // the silence map says the rest of the file is silent
+        if(decoded_frame && end_timestamp != AV_NOPTS_VALUE && decoded_frame->best_effort_timestamp != AV_NOPTS_VALUE &&
+           av_rescale_q(decoded_frame->best_effort_timestamp, decoder.get_stream()->time_base, AVRational{1, AV_TIME_BASE}) >= end_timestamp)
+        {
+            std::cout << "Trailing silence reached\n";
+            break;
+        }
+
+        if(!decoded_frame && decoder.end_of_file_reached())
+        {
+            // what the trimmer still holds is played unless it is the trailing silence
+            if(trimmer)
+            {
+                trimmer->finish();
+                play_trimmed();
+            }
+
+            std::cout << "End of file reached\n";
+            break;
+        }
+
+        else if(!decoded_frame)
+        {
+            poll_errors(decoder);
+            std::exit(1);
+        }
+
+        // a frame past the start of the next chapter, the first frame is where playback started and not a break
+        if(next_chapter < chapters.size() && decoded_frame->best_effort_timestamp != AV_NOPTS_VALUE)
+        {
+            int64_t timestamp = av_rescale_q(decoded_frame->best_effort_timestamp, decoder.get_stream()->time_base,
+                                             AVRational{1, AV_TIME_BASE});
+            bool crossed = false;
+            for(; next_chapter < chapters.size() && chapters[next_chapter].start <= timestamp; next_chapter++)
+            {
+                crossed = true;
+            }
+            natural_break = natural_break || (crossed && i > 1);
+        }
+
+        if(!trimmer)
+        {
+            resampled_frame = resampler.resample_frame(decoded_frame);
+
+            if(!resampled_frame)
+            {
+                poll_errors(resampler);
+                std::exit(1);
+            }
+
+            play(resampled_frame);
+            continue;
+        }
+
+        // the trimmer keeps frames, so they are taken out of the resampler
+        if(resampler.resample_frame(decoded_frame, trimmed_frame) == STATUS_FAILURE)
+        {
+            poll_errors(resampler);
+            std::exit(1);
+        }
+
+        if(trimmer->push(std::move(trimmed_frame)) == STATUS_FAILURE)
+        {
+            poll_errors(*trimmer);
+            std::exit(1);
+        }
+
+        play_trimmed();
+    }
+}
+
+// the pipeline run by --pipeline, set while it runs so SIGINT can cancel it
+Pipeline_Context *running_pipeline = nullptr;
+
+void cancel_pipeline(int)
+{
+    if(running_pipeline)
+    {
+        running_pipeline->cancel();
+    }
+}
+
+/* run_pipeline() function
+ * @desc plays the file like main_loop() does, but as coroutine stages on a small executor: decode, resample and output
+ * @desc overlap, a full channel holds the stages before it back and SIGINT stops every stage at its next frame
+ * @param interrupted - set to true if playback was stopped by SIGINT, the sink should then be flushed instead of drained
+ * @return Return_Status::STATUS_SUCCESS if the file played to the end or was interrupted, Return_Status::STATUS_FAILURE if a stage failed
+ */
+Return_Status run_pipeline(FFmpeg_Decoder &decoder, FFmpeg_Frame_Resampler &resampler, Audio_Player &audio_player, Playback_Clock &clock,
+                           Frame_Fanout *taps, AVFrame *decoded_frame, Startup_Profiler &profiler, const Player_Options &options,
+                           Playback_Stats &stats, bool &interrupted)
+{
+    // one thread for the sink, which blocks writing to the server, one for decode and resample, and one spare
+    const std::size_t PIPELINE_THREADS = 3;
+    const std::size_t CHANNEL_FRAMES = 4;
+
+    Pipeline_Executor executor;
+    if(executor.start(PIPELINE_THREADS) == STATUS_FAILURE)
+    {
+        for(std::string error = executor.poll_error(); !error.empty(); error = executor.poll_error())
+        {
+            std::cerr << error << std::endl;
+        }
+        return STATUS_FAILURE;
+    }
+
+    // declared before the channels, a pool must outlive the frames the channels hold, each has room for a full channel,
+    // the frame the next stage works on and the one being filled, so the stages never wait for a frame
+    Frame_Pool decoded_frames{CHANNEL_FRAMES + 2};
+    Frame_Pool resampled_frames{CHANNEL_FRAMES + 2};
+    if(decoded_frames.get_capacity() < CHANNEL_FRAMES + 2 || resampled_frames.get_capacity() < CHANNEL_FRAMES + 2)
+    {
+        std::cerr << "Failed to allocate frame" << std::endl;
+        return STATUS_FAILURE;
+    }
+
+    Pipeline_Context context;
+    Frame_Channel decoded{executor, CHANNEL_FRAMES};
+    Frame_Channel resampled{executor, CHANNEL_FRAMES};
+
+    // startup() decoded the first frame into the decoder's own frame, the decode stage sends it first
+    Frame_Handle first = Frame_Handle::allocate();
+    if(!first)
+    {
+        std::cerr << "Failed to allocate frame" << std::endl;
+        return STATUS_FAILURE;
+    }
+    av_frame_move_ref(first.get(), decoded_frame);
+
+    uint64_t samples_since_latency_check = 0;
+    uint64_t samples_since_clock_update = UINT64_MAX / 2;
+
+    // only ever called by the sink stage, one frame after another, so it needs no locking of its own
+    auto play = [&](AVFrame *frame)
+    {
+        if(audio_player.play_frame(frame) == STATUS_FAILURE)
+        {
+            for(std::string error = audio_player.poll_error(); !error.empty(); error = audio_player.poll_error())
+            {
+                context.fail(error);
+            }
+            return STATUS_FAILURE;
+        }
+
+        if(taps)
+        {
+            Return_Status status = taps->push(frame);
+            check_status(*taps, status, false);
+        }
+
+        clock.advance(frame->nb_samples);
+
+        samples_since_clock_update += frame->nb_samples;
+        if(samples_since_clock_update * 10 >= static_cast<uint64_t>(frame->sample_rate))
+        {
+            pa_usec_t latency = 0;
+            if(audio_player.get_latency(latency) == STATUS_SUCCESS)
+            {
+                clock.update_latency(latency);
+            }
+            samples_since_clock_update = 0;
+        }
+
+        if(stats.frames_played == 0 && profiler.enabled())
+        {
+            profiler.mark("first sample written", "sink");
+            profiler.report(std::cout);
+        }
+
+        stats.frames_played++;
+        stats.samples_played += frame->nb_samples;
+
+        samples_since_latency_check += frame->nb_samples;
+        if(options.stats && samples_since_latency_check * 2 >= static_cast<uint64_t>(frame->sample_rate))
+        {
+            measure_latency(audio_player, stats);
+            samples_since_latency_check = 0;
+        }
+
+        return STATUS_SUCCESS;
+    };
+
+    running_pipeline = &context;
+    void (*previous_handler)(int) = std::signal(SIGINT, cancel_pipeline);
+
+    executor.spawn(sink_stage(resampled, context, play));
+    executor.spawn(resample_stage(resampler, resampled_frames, decoded, resampled, context));
+    executor.spawn(decode_stage(decoder, std::move(first), decoded_frames, decoded, context));
+    executor.wait_idle();
+
+    std::signal(SIGINT, previous_handler);
+    running_pipeline = nullptr;
+
+    Return_Status status = STATUS_SUCCESS;
+    for(std::string error = context.poll_error(); !error.empty(); error = context.poll_error())
+    {
+        std::cerr << error << std::endl;
+        status = STATUS_FAILURE;
+    }
+
+    interrupted = status == STATUS_SUCCESS && context.is_cancelled();
+    if(status == STATUS_SUCCESS)
+    {
+        std::cout << (interrupted ? "Interrupted\n" : "End of file reached\n");
+    }
+
+    if(options.stats)
+    {
+        std::cout << "Pipeline: " << decoded.get_frames_sent() << " frames through " << executor.get_thread_count() << " threads, "
+                  << executor.get_resumes() << " resumes, decoder waited for room " << decoded.get_send_waits()
+                  << " times, sink waited for frames " << resampled.get_receive_waits() << " times\n";
+    }
+
+    return status;
+}
+
+void poll_errors(Mixer &mixer)
+{
+    for(std::string error = mixer.poll_error(); !error.empty(); error = mixer.poll_error())
+    {
+        std::cerr << error << std::endl;
+    }
+}
+
+void print_mixer_stats(Mixer &mixer)
+{
+    std::cout << "Mixer statistics\n";
+
+    for(const Mixer_Source_Stats &source : mixer.get_source_stats())
+    {
+        double audio_seconds = static_cast<double>(source.samples_mixed) / mixer.get_sample_rate();
+
+        std::cout << "  source " << source.id << " (" << source.filename << "): "
+                  << audio_seconds << " s mixed, " << source.cpu_seconds * 1000.0 << " ms CPU";
+
+        if(audio_seconds > 0)
+        {
+            std::cout << ", " << source.cpu_seconds / audio_seconds * 1000.0 << " ms CPU per audio second";
+        }
+
+        std::cout << '\n';
+    }
+}
+
+/* play_mix() function
+ * @desc plays all files given on the command line at the same time through a Mixer and a single Audio_Player
+ * @return the exit code of the program
+ */
+int play_mix(const Player_Options &options)
+{
+    const int MIX_SAMPLE_RATE = 48000;
+    const int MIX_CHANNELS = 2;
+    const int MIX_BLOCK_SAMPLES = 1024;
+
+    Mixer mixer{MIX_SAMPLE_RATE, MIX_CHANNELS};
+    mixer.reset_quality(options.quality);
+
+    for(std::size_t i = 0; i < options.filenames.size(); i++)
+    {
+        if(mixer.add_source(options.filenames[i], options.gains[i]) < 0)
+        {
+            poll_errors(mixer);
+        }
+    }
+
+    Audio_Player audio_player{PA_SAMPLE_FLOAT32NE, MIX_CHANNELS, MIX_SAMPLE_RATE, "Simple Audio Player", "Mix"};
+    audio_player.reset_target_latency(options.target_latency);
+    apply_simulation(audio_player, options);
+
+    Return_Status status = audio_player.init();
+    check_status(audio_player, status, true);
+
+    std::vector<float> block(MIX_BLOCK_SAMPLES * MIX_CHANNELS);
+
+    while(mixer.mix(block.data(), MIX_BLOCK_SAMPLES) > 0)
+    {
+        poll_errors(mixer);
+
+        status = audio_player.play_buffer(reinterpret_cast<const uint8_t *>(block.data()), block.size() * sizeof(float));
+        check_status(audio_player, status, true);
+    }
+
+    poll_errors(mixer);
+
+    status = audio_player.drain();
+    check_status(audio_player, status, false);
+
+    if(options.stats)
+    {
+        print_mixer_stats(mixer);
+        print_simulation_stats(audio_player);
+    }
+
+    return 0;
+}
+
+void poll_errors(Crossfader &crossfader)
+{
+    for(std::string error = crossfader.poll_error(); !error.empty(); error = crossfader.poll_error())
+    {
+        std::cerr << error << std::endl;
+    }
+}
+
+/* play_crossfade() function
+ * @desc plays the files given on the command line one after another through a Crossfader
+ * @return the exit code of the program
+ */
+int play_crossfade(const Player_Options &options)
+{
+    const int CROSSFADE_SAMPLE_RATE = 48000;
+    const int CROSSFADE_CHANNELS = 2;
+    const int CROSSFADE_BLOCK_SAMPLES = 1024;
+
+    Crossfader crossfader{options.filenames, CROSSFADE_SAMPLE_RATE, CROSSFADE_CHANNELS, options.crossfade};
+    crossfader.reset_quality(options.quality);
+
+    Audio_Player audio_player{PA_SAMPLE_FLOAT32NE, CROSSFADE_CHANNELS, CROSSFADE_SAMPLE_RATE, "Simple Audio Player", "Playlist"};
+    audio_player.reset_target_latency(options.target_latency);
+    apply_simulation(audio_player, options);
+
+    Return_Status status = audio_player.init();
+    check_status(audio_player, status, true);
+
+    if(crossfader.start() == STATUS_FAILURE)
+    {
+        poll_errors(crossfader);
+        return 1;
+    }
+
+    std::vector<float> block(CROSSFADE_BLOCK_SAMPLES * CROSSFADE_CHANNELS);
+
+    while(1)
+    {
+        int samples = crossfader.read(block.data(), CROSSFADE_BLOCK_SAMPLES);
+        poll_errors(crossfader);
+
+        if(samples < 0)
+        {
+            return 1;
+        }
+
+        if(samples == 0)
+        {
+            break;
+        }
+
+        status = audio_player.play_buffer(reinterpret_cast<const uint8_t *>(block.data()), samples * CROSSFADE_CHANNELS * sizeof(float));
+        check_status(audio_player, status, true);
+    }
+
+    status = audio_player.drain();
+    check_status(audio_player, status, false);
+
+    if(options.stats)
+    {
+        std::cout << "Crossfade statistics\n";
+        std::cout << "  crossfades that waited for the next track: " << crossfader.get_preroll_waits() << '\n';
+        print_simulation_stats(audio_player);
+    }
+
+    return 0;
+}
+
+void poll_errors(Player_Daemon &daemon)
+{
+    for(std::string error = daemon.poll_error(); !error.empty(); error = daemon.poll_error())
+    {
+        std::cerr << error << std::endl;
+    }
+}
+
+/* run_daemon() function
+ * @desc runs a Player_Daemon on the socket given with --daemon until a client sends SHUTDOWN
+ * @return the exit code of the program
+ */
+int run_daemon(const Player_Options &options)
+{
+    // short enough that PAUSE and STOP are heard right away, the sink is flushed on PLAY anyway
+    const pa_usec_t DAEMON_DEFAULT_LATENCY = 100 * PA_USEC_PER_MSEC;
+
+    Player_Daemon daemon{options.daemon_socket, BACKEND_PULSE, options.target_latency > 0 ? options.target_latency : DAEMON_DEFAULT_LATENCY};
+
+    // catches up with what changed while no daemon ran, then inotify keeps it up to date
+    Media_Library library{options.library_path};
+    if(!options.library_path.empty())
+    {
+        if(library.load() == STATUS_FAILURE)
+        {
+            poll_errors(library);
+        }
+
+        std::string root = options.library_root.empty() ? library.get_root() : options.library_root;
+        if(root.empty())
+        {
+            std::cerr << options.library_path << " has no directory, give one with --update-library\n";
+            return 1;
+        }
+
+        if(update_library(library, root) == STATUS_FAILURE || library.watch() == STATUS_FAILURE)
+        {
+            poll_errors(library);
+            return 1;
+        }
+
+        // directories that could not be watched
+        poll_errors(library);
+        daemon.set_library(&library);
+    }
+
+    if(daemon.start() == STATUS_FAILURE)
+    {
+        poll_errors(daemon);
+        return 1;
+    }
+
+    std::cout << "Listening on " << options.daemon_socket << std::endl;
+
+    while(daemon.is_running())
+    {
+        Return_Status status = daemon.serve();
+        poll_errors(daemon);
+
+        if(status == STATUS_FAILURE)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* send_daemon_command() function
+ * @desc sends the command given with --send to a daemon and prints the reply
+ * @return the exit code of the program, 0 if the daemon replied "OK"
+ */
+int send_daemon_command(const Player_Options &options)
+{
+    Daemon_Client client;
+    std::string reply;
+
+    if(client.connect(options.send_socket) == STATUS_FAILURE || client.send_command(options.command, reply) == STATUS_FAILURE)
+    {
+        for(std::string error = client.poll_error(); !error.empty(); error = client.poll_error())
+        {
+            std::cerr << error << std::endl;
+        }
+        return 1;
+    }
+
+    std::cout << reply << '\n';
+    return reply.compare(0, 2, "OK") == 0 ? 0 : 1;
+}
+
+// the file given with --trace, see write_trace()
+std::string trace_path;
+
+/* write_trace() function
+ * @desc writes the events recorded with --trace, registered with std::atexit() so failures ending in std::exit() are traced too
+ */
+void write_trace()
+{
+    trace_stop();
+
+    std::string error;
+    if(trace_write(trace_path, error) == STATUS_FAILURE)
+    {
+        std::cerr << error << '\n';
+        return;
+    }
+
+    std::cerr << trace_recorded_events() << " trace events written to " << trace_path;
+    if(trace_dropped_events() > 0)
+    {
+        std::cerr << ", " << trace_dropped_events() << " dropped as a thread's buffer was full";
+    }
+    std::cerr << '\n';
+}
+
+int main(int argc, char **argv)
+{
+    const int NUMBER_CHANNELS = 2;
+    const enum AVSampleFormat SAMPLE_FORMAT = AV_SAMPLE_FMT_S16;
+    const pa_sample_format_t SAMPLE_FORMAT_PULSE = PA_SAMPLE_S16NE;
+
+    // 24 bytes an event, a thread decoding a 44.1 kHz flac records a few hundred a second
+    const std::size_t TRACE_EVENTS_PER_THREAD = 256 * 1024;
+
+    Player_Options options;
+    if(!parse_options(argc, argv, options))
+    {
+        std::cerr << "Invalid usage\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if(!options.trace_path.empty())
+    {
+        trace_path = options.trace_path;
+        trace_start(TRACE_EVENTS_PER_THREAD);
+        trace_name_thread("main");
+        std::atexit(write_trace);
+    }
+
+    if(!options.daemon_socket.empty())
+    {
+        return run_daemon(options);
+    }
+
+    if(!options.send_socket.empty())
+    {
+        return send_daemon_command(options);
+    }
+
+    if(options.info)
+    {
+        return print_info(options);
+    }
+
+    if(!options.library_path.empty())
+    {
+        return run_library(options);
+    }
+
+    if(options.mix || options.crossfade >= 0)
+    {
+        int result = options.mix ? play_mix(options) : play_crossfade(options);
+        if(options.memory_report)
+        {
+            print_memory_report();
+        }
+
+        return result;
+    }
+
+    if(options.list_chapters)
+    {
+        return list_chapters(options.filenames[0]);
+    }
+
+    if(options.scan_silence)
+    {
+        return scan_silence(options);
+    }
+
+    Startup_Profiler profiler{options.startup_profile};
+
+    // "-" reads stdin, the pipe has to outlive the decoder reading it
+    std::unique_ptr<Pipe_Input> pipe_input;
+
+    std::cout << "Decoding Audio\n";
+    FFmpeg_Decoder decoder{options.filenames[0], AVMEDIA_TYPE_AUDIO};
+    decoder.set_streaming(options.streaming);
+
+    if(options.filenames[0] == "-")
+    {
+        const std::size_t PIPE_BUFFER_BYTES = 2 * 1024 * 1024;
+        const std::size_t PIPE_PREFILL_BYTES = 256 * 1024;
+
+        pipe_input.reset(new Pipe_Input{STDIN_FILENO, PIPE_BUFFER_BYTES, PIPE_PREFILL_BYTES});
+        check_status(*pipe_input, pipe_input->start(), true);
+        decoder.set_input(pipe_input->get_io_context());
+    }
+
+    FFmpeg_Frame_Resampler resampler{
+        av_get_default_channel_layout(NUMBER_CHANNELS), // set out channel layout
+        SAMPLE_FORMAT,                                  // set out sample format
+        0,                                              // set temporary out sample rate, will be set when decoding starts
+        0,                                              // set in channel layout, unknown right now, will be set when decoding starts
+        AV_SAMPLE_FMT_NONE,                             // set in sample format, unkwonw right now, will be set when decoding starts
+        0};                                             // set in sample rate, unkown, will be set when decoding starts
+
+    Return_Status quality_status = resampler.reset_quality(options.quality);
+    check_status(resampler, quality_status, true);
+
+    // the matrix is worked out once the source layout is known, when startup() initializes the resampler
+    if(options.downmix)
+    {
+        Return_Status mapping_status = resampler.reset_channel_mapping(true, std::vector<float>{});
+        check_status(resampler, mapping_status, true);
+    }
+
+    Audio_Player audio_player{SAMPLE_FORMAT_PULSE, NUMBER_CHANNELS, 0, "Simple Audio Player", options.filenames[0]};
+    audio_player.reset_target_latency(options.target_latency);
+    apply_simulation(audio_player, options);
+
+    const pa_usec_t ADAPTIVE_MIN_TARGET = 20 * PA_USEC_PER_MSEC;
+    const pa_usec_t ADAPTIVE_MAX_TARGET = 2000 * PA_USEC_PER_MSEC;
+    const pa_usec_t ADAPTIVE_INITIAL_TARGET = 100 * PA_USEC_PER_MSEC;
+
+    std::unique_ptr<Adaptive_Buffer> adaptive;
+    if(options.adaptive)
+    {
+        // --latency sets where it starts
+        pa_usec_t initial = options.target_latency > 0 ? options.target_latency : ADAPTIVE_INITIAL_TARGET;
+        adaptive.reset(new Adaptive_Buffer{ADAPTIVE_MIN_TARGET, ADAPTIVE_MAX_TARGET, initial});
+
+        // in real time mode the sink keeps its buffering and the decode ahead in front of the output thread adapts instead
+        if(!options.realtime)
+        {
+            audio_player.reset_target_latency(adaptive->get_target());
+        }
+    }
+
+    Playback_Stats stats;
+    int exit_code = 0;
+
+    AVFrame *first_frame = startup(decoder, resampler, audio_player, profiler);
+    Return_Status status;
+
+    if(options.chapter > 0)
+    {
+        // the sink and resampler are set up for the stream already, only the position changes
+        status = decoder.seek_chapter(options.chapter - 1);
+        check_status(decoder, status, true);
+
+        first_frame = decoder.decode_frame();
+        if(!first_frame)
+        {
+            poll_errors(decoder);
+            return 1;
+        }
+    }
+
+    // a file scanned with --scan-silence is played from the end of its leading silence to the start of its trailing silence,
+    // other files go through a trimmer that finds the silence as they play
+    std::unique_ptr<Silence_Trimmer> trimmer;
+    int64_t end_timestamp = AV_NOPTS_VALUE;
+    if(options.trim_silence)
+    {
+        Silence_Map map;
+        std::string error;
+        if(read_silence_map(options.filenames[0], map, error) == STATUS_SUCCESS && !map.ranges.empty())
+        {
+            int64_t file_end = map.start + map.duration;
+            int64_t start = map.start;
+
+            // a file that is silent throughout is played as it is
+            const Silence_Range &leading = map.ranges.front();
+            if(options.chapter == 0 && leading.start <= map.start && leading.end < file_end)
+            {
+                status = decoder.seek(leading.end);
+                check_status(decoder, status, true);
+
+                first_frame = decoder.decode_frame();
+                if(!first_frame)
+                {
+                    poll_errors(decoder);
+                    return 1;
+                }
+
+                start = leading.end;
+                stats.trimmed_seconds += static_cast<double>(leading.end - map.start) / AV_TIME_BASE;
+            }
+
+            const Silence_Range &trailing = map.ranges.back();
+            if(trailing.end >= file_end && trailing.start > start)
+            {
+                end_timestamp = trailing.start;
+                stats.trimmed_seconds += static_cast<double>(trailing.end - trailing.start) / AV_TIME_BASE;
+            }
+        }
+
+        else
+        {
+            trimmer.reset(new Silence_Trimmer{options.silence_threshold, options.silence_seconds});
+            trimmer->set_time_base(decoder.get_stream()->time_base);
+        }
+    }
+
+    Playback_Clock clock{first_frame->sample_rate};
+    int64_t origin = 0;
+    if(first_frame->best_effort_timestamp != AV_NOPTS_VALUE)
+    {
+        origin = av_rescale_q(first_frame->best_effort_timestamp, decoder.get_stream()->time_base, AVRational{1, AV_TIME_BASE});
+    }
+    clock.reset(origin);
+
+    std::unique_ptr<Output_Thread> output;
+    if(options.realtime || options.burst)
+    {
+        const std::size_t FRAME_SIZE = NUMBER_CHANNELS * av_get_bytes_per_sample(SAMPLE_FORMAT);
+        const std::size_t PERIOD_FRAMES = 1024;
+        const int REALTIME_PRIORITY = 20;
+
+        // a burst decodes 25 seconds, the 5 left cover it, and the sink gets half a second per write
+        const std::size_t BURST_SECONDS = 30;
+        const std::size_t BURST_LOW_WATERMARK_SECONDS = 5;
+
+        // half a second of audio between the decoding thread and the output thread,
+        // with adaptive buffering room for the largest target, filled up to the current one
+        std::size_t buffer_bytes = first_frame->sample_rate / 2 * FRAME_SIZE;
+        std::size_t period_bytes = PERIOD_FRAMES * FRAME_SIZE;
+        if(adaptive)
+        {
+            buffer_bytes = ADAPTIVE_MAX_TARGET * first_frame->sample_rate / PA_USEC_PER_SEC * FRAME_SIZE;
+        }
+
+        if(options.burst)
+        {
+            buffer_bytes = BURST_SECONDS * first_frame->sample_rate * FRAME_SIZE;
+            period_bytes = first_frame->sample_rate / 2 * FRAME_SIZE;
+        }
+        output.reset(new Output_Thread{audio_player, buffer_bytes, period_bytes});
+
+        if(adaptive)
+        {
+            output->set_fill_target(adaptive->get_target() * first_frame->sample_rate / PA_USEC_PER_SEC * FRAME_SIZE);
+        }
+
+        if(options.burst)
+        {
+            output->set_burst(BURST_LOW_WATERMARK_SECONDS * first_frame->sample_rate * FRAME_SIZE);
+        }
+
+        output->set_clock(&clock, FRAME_SIZE);
+
+        status = output->start(options.realtime, REALTIME_PRIORITY);
+        check_status(*output, status, true);
+
+        if(options.realtime && !output->is_realtime())
+        {
+            std::cerr << "Warning: running without real time guarantees\n";
+            poll_errors(*output);
+        }
+    }
+
+    if(adaptive)
+    {
+        adaptive->start();
+    }
+
+    // the WAV file and the meter are taps next to the sink on a fanout, a tap that falls behind drops its oldest frames
+    const std::size_t RECORD_QUEUE_FRAMES = 256;
+    const std::size_t METER_QUEUE_FRAMES = 16;
+
+    std::unique_ptr<Frame_Fanout> taps;
+    Meter_Sink *meter = nullptr;
+    if(!options.record_path.empty() || options.meter)
+    {
+        taps.reset(new Frame_Fanout{});
+
+        if(!options.record_path.empty())
+        {
+            status = taps->add_sink(std::unique_ptr<Frame_Sink>{new Wav_Sink{options.record_path}}, FANOUT_DROP, RECORD_QUEUE_FRAMES);
+            check_status(*taps, status, true);
+        }
+
+        if(options.meter)
+        {
+            meter = new Meter_Sink{&std::cout, 1.0};
+            status = taps->add_sink(std::unique_ptr<Frame_Sink>{meter}, FANOUT_DROP, METER_QUEUE_FRAMES);
+            check_status(*taps, status, true);
+        }
+
+        status = taps->start();
+        check_status(*taps, status, true);
+    }
+
+    std::atomic<bool> stop_positions{false};
+    std::thread position_thread;
+    if(options.position)
+    {
+        position_thread = std::thread{print_positions, std::cref(clock), std::cref(stop_positions)};
+    }
+
+    int sample_rate = first_frame->sample_rate;
+    std::chrono::steady_clock::time_point playback_start = std::chrono::steady_clock::now();
+    double cpu_at_start = 0;
+    uint64_t switches_at_start = 0;
+    read_usage(cpu_at_start, switches_at_start);
+
+    bool interrupted = false;
+    if(options.pipeline)
+    {
+        status = run_pipeline(decoder, resampler, audio_player, clock, taps.get(), first_frame, profiler, options, stats, interrupted);
+        if(status == STATUS_FAILURE)
+        {
+            exit_code = 1;
+        }
+    }
+    else
+    {
+        main_loop(decoder, resampler, audio_player, output.get(), adaptive.get(), clock, taps.get(), trimmer.get(), end_timestamp,
+                  first_frame, profiler, options, stats);
+    }
+
+    if(trimmer)
+    {
+        stats.trimmed_seconds = static_cast<double>(trimmer->get_trimmed_leading() + trimmer->get_trimmed_trailing()) /
+                                trimmer->get_sample_rate();
+    }
+
+    if(taps)
+    {
+        status = taps->finish();
+        check_status(*taps, status, false);
+    }
+
+    if(output)
+    {
+        status = output->finish();
+        check_status(*output, status, false);
+        check_status(audio_player, status, true);
+
+        stats.underruns = output->get_underruns();
+        stats.audit_allocations = output->get_audit_allocations();
+        stats.producer_wakeups = output->get_producer_wakeups();
+    }
+
+    // let the buffered audio play out, freeing the player would cut it off, unless playback was interrupted
+    status = interrupted ? audio_player.flush() : audio_player.drain();
+    check_status(audio_player, status, false);
+
+    std::chrono::duration<double> playback_time = std::chrono::steady_clock::now() - playback_start;
+    read_usage(stats.cpu_seconds, stats.context_switches);
+    stats.cpu_seconds -= cpu_at_start;
+    stats.context_switches -= switches_at_start;
+    stats.wall_seconds = playback_time.count();
+    stats.audio_seconds = static_cast<double>(stats.samples_played) / sample_rate;
+
+    if(position_thread.joinable())
+    {
+        stop_positions.store(true, std::memory_order_release);
+        position_thread.join();
+    }
+
+    if(options.stats)
+    {
+        print_stats(audio_player, stats);
+        print_clock_stats(clock);
+
+        if(taps)
+        {
+            print_fanout_stats(*taps);
+        }
+
+        if(adaptive)
+        {
+            print_adaptive_stats(*adaptive);
+        }
+
+        if(pipe_input)
+        {
+            print_pipe_stats(*pipe_input);
+        }
+    }
+
+    if(meter)
+    {
+        print_levels(*meter);
+    }
+
+    if(options.memory_report)
+    {
+        print_memory_report();
+    }
+
+    if(stats.audit_allocations > 0)
+    {
+        std::cerr << "The output thread allocated " << stats.audit_allocations << " times during steady state playback\n";
+        return 1;
+    }
+
+    return exit_code;
 }
@@ -0,0 +1,1071 @@
+#include "player_daemon.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <queue>
+
+// The format the sink is connected with, every file is resampled to it so the connection never has to change
+const int DAEMON_SAMPLE_RATE = 48000;
+const int DAEMON_CHANNELS = 2;
+const enum AVSampleFormat DAEMON_SAMPLE_FORMAT = AV_SAMPLE_FMT_S16;
+const pa_sample_format_t DAEMON_SAMPLE_FORMAT_PULSE = PA_SAMPLE_S16NE;
+
+// samples written to the sink between checks of the sockets, 10 ms, the longest a command waits while playing
+const int CHUNK_SAMPLES = DAEMON_SAMPLE_RATE / 100;
+
+const std::size_t MAX_CONNECTIONS = 16;
+const std::size_t MAX_LINE_LENGTH = 4096;
+
+// reply bytes kept for a client that does not read them, past this it is disconnected
+const std::size_t MAX_PENDING_OUTPUT = 256 * 1024;
+const int LISTEN_BACKLOG = 8;
+
+// the most files a FIND reply lists, the count is always complete
+const std::size_t MAX_FIND_RESULTS = 100;
+
+// errors past this many are dropped oldest first
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+
+
+
+/* Player_Daemon constructor
+ * @desc sets up the members, the sink is not connected and the socket not created until Player_Daemon::start()
+ * @param socket_path - where to create the listening socket, EX: "/tmp/player.sock"
+ * @param backend - where the sink sends its samples, BACKEND_NULL for benchmarks
+ * @param target_latency - the output latency requested from the sink in microseconds, 0 leaves it to the server
+ */
+Player_Daemon::Player_Daemon(const std::string &socket_path, Audio_Backend backend, pa_usec_t target_latency) :
+    m_socket_path{socket_path},
+    m_audio_player{DAEMON_SAMPLE_FORMAT_PULSE, DAEMON_CHANNELS, DAEMON_SAMPLE_RATE, "Simple Audio Player", "Daemon"},
+    m_decoder{"NO NAME", AVMEDIA_TYPE_AUDIO},
+    m_resampler{av_get_default_channel_layout(DAEMON_CHANNELS), DAEMON_SAMPLE_FORMAT, DAEMON_SAMPLE_RATE, 0, AV_SAMPLE_FMT_NONE, 0}
+{
+    m_audio_player.reset_backend(backend);
+    m_audio_player.reset_target_latency(target_latency);
+
+    m_listen_socket = -1;
+    m_resampler_ready = false;
+    m_new_track = false;
+    m_track_flushed = false;
+
+    m_state = DAEMON_IDLE;
+    m_running = false;
+
+    m_pending = nullptr;
+    m_pending_offset = 0;
+    m_frame_position = 0;
+    m_resume_position = 0;
+
+    m_commands = 0;
+    m_tracks_started = 0;
+    m_samples_played = 0;
+    m_last_start_microseconds = 0;
+    m_total_start_microseconds = 0;
+    m_play_commands = 0;
+
+    m_library = nullptr;
+}
+
+
+
+
+/* Player_Daemon destructor
+ * @desc closes the connections and the listening socket and removes the socket file
+ */
+Player_Daemon::~Player_Daemon()
+{
+    for(Daemon_Connection &connection : m_connections)
+    {
+        close(connection.socket);
+    }
+
+    if(m_listen_socket >= 0)
+    {
+        close(m_listen_socket);
+        unlink(m_socket_path.c_str());
+    }
+}
+
+
+
+
+/* Player_Daemon::start() function
+ * @desc connects the sink and starts listening on the socket
+ * @desc a socket file left behind by a daemon that was killed is replaced, one a daemon is still listening on is not
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ */
+Return_Status Player_Daemon::start()
+{
+    if(m_audio_player.init() == STATUS_FAILURE)
+    {
+        enqueue_error("Failed to connect the sink");
+        enqueue_error(take_errors());
+        return STATUS_FAILURE;
+    }
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(m_socket_path.empty() || m_socket_path.size() >= sizeof(address.sun_path))
+    {
+        enqueue_error("Invalid socket path: " + m_socket_path);
+        return STATUS_FAILURE;
+    }
+
+    std::memcpy(address.sun_path, m_socket_path.c_str(), m_socket_path.size() + 1);
+
+    struct stat file_status;
+    if(lstat(m_socket_path.c_str(), &file_status) == 0 && S_ISSOCK(file_status.st_mode))
+    {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(probe >= 0 && connect(probe, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0)
+        {
+            close(probe);
+            enqueue_error("Another daemon is listening on " + m_socket_path);
+            return STATUS_FAILURE;
+        }
+
+        if(probe >= 0)
+        {
+            close(probe);
+        }
+
+        unlink(m_socket_path.c_str());
+    }
+
+    int listen_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(listen_socket < 0)
+    {
+        enqueue_error("Failed to create socket: " + std::string{std::strerror(errno)});
+        return STATUS_FAILURE;
+    }
+
+    // anyone who can connect can play files as this user, so the socket file is created for the owner only
+    mode_t previous_umask = umask(S_IRWXG | S_IRWXO | S_IXUSR);
+    int bound = bind(listen_socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    int bind_error = errno;
+    umask(previous_umask);
+
+    if(bound < 0)
+    {
+        enqueue_error("Failed to bind " + m_socket_path + ": " + std::string{std::strerror(bind_error)});
+        close(listen_socket);
+        return STATUS_FAILURE;
+    }
+
+    // set only once bound, the destructor removes the socket file
+    m_listen_socket = listen_socket;
+
+    if(listen(m_listen_socket, LISTEN_BACKLOG) < 0)
+    {
+        enqueue_error("Failed to listen on " + m_socket_path + ": " + std::string{std::strerror(errno)});
+        return STATUS_FAILURE;
+    }
+
+    m_running = true;
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Player_Daemon::serve() function
+ * @desc handles the commands that arrived, then writes the next chunk of the current track if playing
+ * @desc while playing it does not wait for commands, the sink paces the calls, otherwise it waits until one arrives
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the sockets can no longer be polled
+ * @note call it until Player_Daemon::is_running() returns false, errors while playing are queued and the track is skipped
+ */
+Return_Status Player_Daemon::serve()
+{
+    // reading changed files, or rescanning after an inotify overflow, and saving the index can take longer than a chunk,
+    // so the changes wait in the inotify queue while playing and are read in once paused or idle
+    int library_descriptor = m_library && m_state != DAEMON_PLAYING ? m_library->get_watch_descriptor() : -1;
+    std::vector<struct pollfd> descriptors(m_connections.size() + (library_descriptor >= 0 ? 2 : 1));
+
+    descriptors[0].fd = m_listen_socket;
+    descriptors[0].events = POLLIN;
+    descriptors[0].revents = 0;
+
+    for(std::size_t i = 0; i < m_connections.size(); i++)
+    {
+        descriptors[i + 1].fd = m_connections[i].socket;
+        descriptors[i + 1].events = m_connections[i].output.empty() ? POLLIN : POLLIN | POLLOUT;
+        descriptors[i + 1].revents = 0;
+    }
+
+    // the library comes last, after the connections
+    if(library_descriptor >= 0)
+    {
+        descriptors.back().fd = library_descriptor;
+        descriptors.back().events = POLLIN;
+        descriptors.back().revents = 0;
+    }
+
+    int ready = poll(descriptors.data(), descriptors.size(), m_state == DAEMON_PLAYING ? 0 : -1);
+    if(ready < 0 && errno != EINTR)
+    {
+        enqueue_error("Failed to poll sockets: " + std::string{std::strerror(errno)});
+        return STATUS_FAILURE;
+    }
+
+    // backwards, so closing a connection doesn't move the ones still to be checked,
+    // connections accepted below are after them and not polled yet
+    for(std::size_t i = m_connections.size(); ready > 0 && i > 0; i--)
+    {
+        bool open = true;
+        if(descriptors[i].revents & POLLOUT)
+        {
+            open = write_connection(m_connections[i - 1]);
+        }
+
+        // hang ups and errors are found by the read
+        if(open && descriptors[i].revents & ~POLLOUT)
+        {
+            open = read_connection(m_connections[i - 1]);
+        }
+
+        if(!open)
+        {
+            close(m_connections[i - 1].socket);
+            m_connections.erase(m_connections.begin() + (i - 1));
+        }
+    }
+
+    if(ready > 0 && descriptors[0].revents & POLLIN)
+    {
+        accept_connection();
+    }
+
+    if(ready > 0 && library_descriptor >= 0 && descriptors.back().revents & POLLIN)
+    {
+        update_library();
+    }
+
+    if(m_state == DAEMON_PLAYING && write_chunk() == STATUS_FAILURE)
+    {
+        // a broken track is skipped, the queue goes on
+        enqueue_error(take_errors());
+        finish_track();
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Player_Daemon::is_running() function
+ * @return true from Player_Daemon::start() until a client sent SHUTDOWN
+ */
+bool Player_Daemon::is_running()
+{
+    return m_running;
+}
+
+
+
+
+/* Player_Daemon::get_state() function
+ * @return what the daemon is doing, see Daemon_State
+ */
+Daemon_State Player_Daemon::get_state()
+{
+    return m_state;
+}
+
+
+
+
+/* Player_Daemon::set_library() function
+ * @desc sets the library FIND searches, if it is watched Player_Daemon::serve() also keeps it up to date and saved
+ * @desc whenever nothing plays
+ * @param library - the library, it must outlive the daemon, nullptr for none
+ */
+void Player_Daemon::set_library(Media_Library *library)
+{
+    m_library = library;
+}
+
+
+
+
+/* Player_Daemon::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Player_Daemon::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Player_Daemon::accept_connection() function
+ * @desc accepts a waiting client, past MAX_CONNECTIONS the client is told so and disconnected
+ * @note this function is under the private specifier
+ */
+void Player_Daemon::accept_connection()
+{
+    // non blocking, a client that stops reading its replies must not block the daemon in send()
+    int connection = accept4(m_listen_socket, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if(connection < 0)
+    {
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            enqueue_error("Failed to accept a connection: " + std::string{std::strerror(errno)});
+        }
+        return;
+    }
+
+    if(m_connections.size() >= MAX_CONNECTIONS)
+    {
+        const char reply[] = "ERR too many connections\n";
+        send(connection, reply, sizeof(reply) - 1, MSG_NOSIGNAL);
+        close(connection);
+        return;
+    }
+
+    m_connections.push_back(Daemon_Connection{connection, std::string{}, std::string{}});
+}
+
+
+
+
+/* Player_Daemon::read_connection() function
+ * @desc reads what a client sent and answers every complete line, the replies are sent as far as the socket takes them
+ * @param connection - the client, its socket is readable
+ * @return false if the client disconnected or misbehaved and the connection should be closed
+ * @note this function is under the private specifier
+ */
+bool Player_Daemon::read_connection(Daemon_Connection &connection)
+{
+    char buffer[1024];
+
+    ssize_t received = recv(connection.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if(received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return true;
+    }
+
+    if(received <= 0)
+    {
+        return false;
+    }
+
+    connection.input.append(buffer, static_cast<std::size_t>(received));
+
+    for(std::size_t end = connection.input.find('\n'); end != std::string::npos; end = connection.input.find('\n'))
+    {
+        std::string line = connection.input.substr(0, end);
+        connection.input.erase(0, end + 1);
+
+        if(!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        connection.output += handle_command(line) + '\n';
+    }
+
+    if(!write_connection(connection))
+    {
+        return false;
+    }
+
+    if(connection.input.size() > MAX_LINE_LENGTH)
+    {
+        const char reply[] = "ERR line too long\n";
+        send(connection.socket, reply, sizeof(reply) - 1, MSG_NOSIGNAL);
+        return false;
+    }
+
+    return true;
+}
+
+
+
+
+/* Player_Daemon::write_connection() function
+ * @desc sends the replies waiting for a client without blocking, what the socket does not take is kept for later
+ * @param connection - the client
+ * @return false if the send failed or the client left more than MAX_PENDING_OUTPUT unread, the connection should be closed
+ * @note this function is under the private specifier
+ */
+bool Player_Daemon::write_connection(Daemon_Connection &connection)
+{
+    while(!connection.output.empty())
+    {
+        ssize_t sent = send(connection.socket, connection.output.data(), connection.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+
+        if(sent < 0)
+        {
+            return false;
+        }
+
+        connection.output.erase(0, static_cast<std::size_t>(sent));
+    }
+
+    return connection.output.size() <= MAX_PENDING_OUTPUT;
+}
+
+
+
+
+/* Player_Daemon::handle_command() function
+ * @desc carries out one command, see the class description for the commands
+ * @param line - the command line without the newline, the command is case insensitive, the argument is the rest of the line
+ * @return the reply, "OK" with details or "ERR" with the reason
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::handle_command(const std::string &line)
+{
+    m_commands++;
+
+    std::size_t space = line.find(' ');
+    std::string command = line.substr(0, space);
+    std::string argument = space == std::string::npos ? std::string{} : line.substr(space + 1);
+
+    std::transform(command.begin(), command.end(), command.begin(), [](unsigned char c) { return std::toupper(c); });
+
+    if(command == "PLAY" || command == "ENQUEUE")
+    {
+        if(argument.empty())
+        {
+            return "ERR " + command + " needs a file";
+        }
+
+        if(command == "PLAY" || m_state == DAEMON_IDLE)
+        {
+            return play(argument);
+        }
+
+        m_queue.push_back(argument);
+        return "OK queued=" + std::to_string(m_queue.size());
+    }
+
+    else if(command == "PAUSE")
+    {
+        return pause();
+    }
+
+    else if(command == "RESUME")
+    {
+        return resume();
+    }
+
+    else if(command == "SEEK")
+    {
+        return seek(argument);
+    }
+
+    else if(command == "STOP")
+    {
+        m_queue.clear();
+        stop_playback();
+        return "OK";
+    }
+
+    else if(command == "STATS")
+    {
+        return "OK " + get_stats();
+    }
+
+    else if(command == "FIND")
+    {
+        return find(argument);
+    }
+
+    else if(command == "SHUTDOWN")
+    {
+        m_queue.clear();
+        stop_playback();
+        m_running = false;
+        return "OK";
+    }
+
+    return "ERR unknown command: " + command;
+}
+
+
+
+
+/* Player_Daemon::play() function
+ * @desc replaces whatever plays with a file, returning once its first chunk was written to the sink
+ * @param filename - the file to play
+ * @return the reply, "OK start_ms=<time from the command to the first sample written>" or "ERR <reason>"
+ * @note the queue is cleared, use ENQUEUE to play files after the current one
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::play(const std::string &filename)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    // what is left of the previous track in the sink is dropped, so the new one is heard right away
+    m_queue.clear();
+    stop_playback();
+
+    if(open_track(filename) == STATUS_FAILURE)
+    {
+        return "ERR " + take_errors();
+    }
+
+    m_state = DAEMON_PLAYING;
+    if(write_chunk() == STATUS_FAILURE)
+    {
+        std::string errors = take_errors();
+        stop_playback();
+        return "ERR " + errors;
+    }
+
+    if(m_state != DAEMON_PLAYING)
+    {
+        return "ERR no audio in " + filename;
+    }
+
+    uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    m_last_start_microseconds = microseconds;
+    m_total_start_microseconds += microseconds;
+    m_play_commands++;
+
+    std::ostringstream reply;
+    reply << "OK start_ms=" << std::fixed << std::setprecision(3) << microseconds / 1000.0;
+    return reply.str();
+}
+
+
+
+
+/* Player_Daemon::pause() function
+ * @desc stops writing and drops what the sink still buffers, so the sound stops right away
+ * @return the reply, "OK position=<seconds>" or "ERR <reason>"
+ * @note pa_simple can't hold a stream, so the buffered audio is flushed and the position it started at is remembered,
+ * @note Player_Daemon::resume() seeks back to it
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::pause()
+{
+    if(m_state != DAEMON_PLAYING)
+    {
+        return "ERR not playing";
+    }
+
+    pa_usec_t latency = 0;
+    if(m_audio_player.get_latency(latency) == STATUS_FAILURE)
+    {
+        enqueue_error(take_errors());
+        latency = 0;
+    }
+
+    m_resume_position = std::max<int64_t>(get_position() - static_cast<int64_t>(latency), 0);
+
+    if(m_audio_player.flush() == STATUS_FAILURE)
+    {
+        enqueue_error(take_errors());
+    }
+
+    m_pending = nullptr;
+    m_state = DAEMON_PAUSED;
+
+    std::ostringstream reply;
+    reply << "OK position=" << std::fixed << std::setprecision(3) << static_cast<double>(m_resume_position) / AV_TIME_BASE;
+    return reply.str();
+}
+
+
+
+
+/* Player_Daemon::resume() function
+ * @desc continues a paused track where it was heard last
+ * @return the reply, "OK" or "ERR <reason>"
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::resume()
+{
+    if(m_state != DAEMON_PAUSED)
+    {
+        return "ERR not paused";
+    }
+
+    if(m_decoder.seek(m_resume_position) == STATUS_FAILURE || clear_resampler() == STATUS_FAILURE)
+    {
+        std::string errors = take_errors();
+        stop_playback();
+        return "ERR " + errors;
+    }
+
+    m_frame_position = m_resume_position;
+    m_state = DAEMON_PLAYING;
+    return "OK";
+}
+
+
+
+
+/* Player_Daemon::seek() function
+ * @desc moves the current track to a position, while paused it is where Player_Daemon::resume() continues
+ * @param argument - the position in seconds
+ * @return the reply, "OK" or "ERR <reason>"
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::seek(const std::string &argument)
+{
+    char *end = nullptr;
+    double seconds = std::strtod(argument.c_str(), &end);
+    if(argument.empty() || *end != '\0' || seconds < 0)
+    {
+        return "ERR SEEK needs a position in seconds";
+    }
+
+    int64_t timestamp = static_cast<int64_t>(seconds * AV_TIME_BASE);
+
+    if(m_state == DAEMON_IDLE)
+    {
+        return "ERR nothing to seek in";
+    }
+
+    if(m_state == DAEMON_PAUSED)
+    {
+        m_resume_position = timestamp;
+        return "OK";
+    }
+
+    if(m_decoder.seek(timestamp) == STATUS_FAILURE || clear_resampler() == STATUS_FAILURE)
+    {
+        return "ERR " + take_errors();
+    }
+
+    if(m_audio_player.flush() == STATUS_FAILURE)
+    {
+        enqueue_error(take_errors());
+    }
+
+    m_pending = nullptr;
+    m_frame_position = timestamp;
+    return "OK";
+}
+
+
+
+
+/* Player_Daemon::find() function
+ * @desc looks up the files of the library with a tag
+ * @param argument - "<tag>=<value>", EX: "album=Kind of Blue", both case insensitive
+ * @return the reply, "OK count=<files found>" followed by the files separated by tabs, at most MAX_FIND_RESULTS of them,
+ * @return or "ERR <reason>"
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::find(const std::string &argument)
+{
+    if(!m_library)
+    {
+        return "ERR no library";
+    }
+
+    std::size_t equals = argument.find('=');
+    if(equals == std::string::npos || equals == 0)
+    {
+        return "ERR FIND needs <tag>=<value>";
+    }
+
+    std::vector<const Library_Entry*> found = m_library->find_by_tag(argument.substr(0, equals), argument.substr(equals + 1));
+
+    std::string reply = "OK count=" + std::to_string(found.size());
+    for(std::size_t i = 0; i < found.size() && i < MAX_FIND_RESULTS; i++)
+    {
+        reply += '\t' + found[i]->metadata.path;
+    }
+
+    return reply;
+}
+
+
+
+
+/* Player_Daemon::update_library() function
+ * @desc reads in what changed in the library, its inotify descriptor is readable, and saves it if anything did
+ * @note this function is under the private specifier
+ */
+void Player_Daemon::update_library()
+{
+    Library_Update_Stats stats;
+    Return_Status status = m_library->process_events(std::thread::hardware_concurrency(), stats);
+
+    if(status == STATUS_SUCCESS && stats.added + stats.changed + stats.removed > 0)
+    {
+        m_library->save();
+    }
+
+    // also the directories a rescan could not watch
+    for(std::string error = m_library->poll_error(); !error.empty(); error = m_library->poll_error())
+    {
+        enqueue_error(error);
+    }
+}
+
+
+
+
+/* Player_Daemon::open_track() function
+ * @desc opens a file in the decoder, the resampler is set up once the first frame is decoded
+ * @param filename - the file to open
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note this function is under the private specifier
+ */
+Return_Status Player_Daemon::open_track(const std::string &filename)
+{
+    m_pending = nullptr;
+    m_pending_offset = 0;
+    m_frame_position = 0;
+
+    // the decoder object is reused, reset_file() frees what the previous file needed but keeps the codec context,
+    // a file with the same codec and parameters continues with it
+    m_decoder.reset_file(filename);
+    m_track_flushed = false;
+
+    if(m_decoder.open_file() == STATUS_FAILURE || m_decoder.init() == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
+    m_new_track = true;
+    m_tracks_started++;
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Player_Daemon::next_frame() function
+ * @desc decodes and resamples the next frame of the current track into m_pending,
+ * @desc at the end of the track the next one in the queue is started, or the daemon goes idle
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note on success m_pending is nullptr only if the daemon went idle
+ * @note this function is under the private specifier
+ */
+Return_Status Player_Daemon::next_frame()
+{
+    while(!m_pending && m_state == DAEMON_PLAYING)
+    {
+        AVFrame *decoded_frame = m_decoder.decode_frame();
+        if(!decoded_frame)
+        {
+            if(!m_decoder.end_of_file_reached())
+            {
+                return STATUS_FAILURE;
+            }
+
+            // what swresample held back is the end of the track, it is played before the next one starts
+            if(!m_track_flushed && !m_new_track)
+            {
+                m_track_flushed = true;
+
+                AVFrame *tail = m_resampler.flush();
+                if(!tail)
+                {
+                    return STATUS_FAILURE;
+                }
+
+                if(tail->nb_samples > 0)
+                {
+                    m_pending = tail;
+                    m_pending_offset = 0;
+                    continue;
+                }
+            }
+
+            finish_track();
+            continue;
+        }
+
+        if(m_new_track)
+        {
+            // the SwrContext is kept from track to track, only its options change,
+            // the swr_init() that applies them also drops what an interrupted track left in it
+            Return_Status status = m_resampler.reset_options(av_get_default_channel_layout(DAEMON_CHANNELS), DAEMON_SAMPLE_FORMAT, DAEMON_SAMPLE_RATE,
+                                                             decoded_frame->channel_layout,
+                                                             static_cast<enum AVSampleFormat>(decoded_frame->format),
+                                                             decoded_frame->sample_rate);
+            if(status == STATUS_SUCCESS && !m_resampler_ready)
+            {
+                status = m_resampler.init();
+                m_resampler_ready = status == STATUS_SUCCESS;
+            }
+
+            if(status == STATUS_FAILURE)
+            {
+                return STATUS_FAILURE;
+            }
+
+            m_new_track = false;
+        }
+
+        if(decoded_frame->best_effort_timestamp != AV_NOPTS_VALUE)
+        {
+            m_frame_position = av_rescale_q(decoded_frame->best_effort_timestamp, m_decoder.get_stream()->time_base, AVRational{1, AV_TIME_BASE});
+        }
+
+        AVFrame *resampled_frame = m_resampler.resample_frame(decoded_frame);
+        if(!resampled_frame)
+        {
+            return STATUS_FAILURE;
+        }
+
+        // the resampler may hold back the first samples, then there is nothing to write yet
+        if(resampled_frame->nb_samples > 0)
+        {
+            m_pending = resampled_frame;
+            m_pending_offset = 0;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Player_Daemon::write_chunk() function
+ * @desc writes up to CHUNK_SAMPLES of the current track to the sink, decoding the next frame when needed
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note the write blocks while the sink is full, which paces the daemon
+ * @note this function is under the private specifier
+ */
+Return_Status Player_Daemon::write_chunk()
+{
+    if(next_frame() == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
+    if(!m_pending)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    const std::size_t FRAME_SIZE = DAEMON_CHANNELS * av_get_bytes_per_sample(DAEMON_SAMPLE_FORMAT);
+    int samples = std::min(CHUNK_SAMPLES, m_pending->nb_samples - m_pending_offset);
+
+    Return_Status status = m_audio_player.play_buffer(m_pending->extended_data[0] + m_pending_offset * FRAME_SIZE, samples * FRAME_SIZE);
+    if(status == STATUS_FAILURE)
+    {
+        return STATUS_FAILURE;
+    }
+
+    m_pending_offset += samples;
+    m_samples_played += samples;
+
+    if(m_pending_offset == m_pending->nb_samples)
+    {
+        m_frame_position += av_rescale(m_pending->nb_samples, AV_TIME_BASE, DAEMON_SAMPLE_RATE);
+        m_pending = nullptr;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Player_Daemon::finish_track() function
+ * @desc ends the current track and starts the next one in the queue that opens, or goes idle if there is none
+ * @note the sink is not flushed, the end of the track plays out and the next one follows it
+ * @note this function is under the private specifier
+ */
+void Player_Daemon::finish_track()
+{
+    m_pending = nullptr;
+
+    while(!m_queue.empty())
+    {
+        std::string filename = m_queue.front();
+        m_queue.pop_front();
+
+        if(open_track(filename) == STATUS_SUCCESS)
+        {
+            m_state = DAEMON_PLAYING;
+            return;
+        }
+
+        enqueue_error(take_errors());
+    }
+
+    m_state = DAEMON_IDLE;
+}
+
+
+
+
+/* Player_Daemon::stop_playback() function
+ * @desc stops the current track and drops what the sink still buffers, the queue is kept
+ * @note this function is under the private specifier
+ */
+void Player_Daemon::stop_playback()
+{
+    m_pending = nullptr;
+    m_state = DAEMON_IDLE;
+
+    if(m_audio_player.flush() == STATUS_FAILURE)
+    {
+        enqueue_error(take_errors());
+    }
+}
+
+
+
+
+/* Player_Daemon::clear_resampler() function
+ * @desc drops what the resampler holds back of the current track, after a seek it would be played before the new position
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note before the first frame of a track the resampler is set up for it anyway, which clears it
+ * @note this function is under the private specifier
+ */
+Return_Status Player_Daemon::clear_resampler()
+{
+    // a seek back from the end plays the track's end again, it is flushed again
+    m_track_flushed = false;
+
+    if(!m_resampler_ready || m_new_track)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    return m_resampler.clear();
+}
+
+
+
+
+/* Player_Daemon::get_position() function
+ * @return the position in the current track of the next sample to be written, in AV_TIME_BASE units
+ * @note this function is under the private specifier
+ */
+int64_t Player_Daemon::get_position()
+{
+    if(!m_pending)
+    {
+        return m_frame_position;
+    }
+
+    return m_frame_position + av_rescale(m_pending_offset, AV_TIME_BASE, DAEMON_SAMPLE_RATE);
+}
+
+
+
+
+/* Player_Daemon::get_stats() function
+ * @return the state of the daemon as space separated key=value pairs, the file name comes last as it may contain spaces
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::get_stats()
+{
+    const char *STATE_NAMES[] = {"idle", "playing", "paused"};
+
+    std::ostringstream stats;
+    stats << std::fixed << std::setprecision(3);
+
+    stats << "state=" << STATE_NAMES[m_state];
+    stats << " position=" << static_cast<double>(m_state == DAEMON_PAUSED ? m_resume_position : get_position()) / AV_TIME_BASE;
+    stats << " queued=" << m_queue.size();
+    stats << " tracks=" << m_tracks_started;
+    stats << " samples=" << m_samples_played;
+    stats << " commands=" << m_commands;
+    stats << " start_ms_last=" << m_last_start_microseconds / 1000.0;
+    stats << " start_ms_avg=" << (m_play_commands > 0 ? m_total_start_microseconds / 1000.0 / m_play_commands : 0.0);
+    stats << " file=" << (m_state == DAEMON_IDLE ? std::string{} : m_decoder.get_filename());
+
+    return stats.str();
+}
+
+
+
+
+/* Player_Daemon::take_errors() function
+ * @desc empties the error queues of the decoder, the resampler and the sink
+ * @return their errors joined with "; ", to pass on in a reply
+ * @note this function is under the private specifier
+ */
+std::string Player_Daemon::take_errors()
+{
+    std::string errors;
+    auto append = [&errors](const std::string &error)
+    {
+        errors += errors.empty() ? error : "; " + error;
+    };
+
+    for(std::string error = m_decoder.poll_error(); !error.empty(); error = m_decoder.poll_error())
+    {
+        append(error);
+    }
+
+    for(std::string error = m_resampler.poll_error(); !error.empty(); error = m_resampler.poll_error())
+    {
+        append(error);
+    }
+
+    for(std::string error = m_audio_player.poll_error(); !error.empty(); error = m_audio_player.poll_error())
+    {
+        append(error);
+    }
+
+    return errors.empty() ? std::string{"unknown error"} : errors;
+}
+
+
+
+
+/* Player_Daemon::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, dropping the oldest past MAX_QUEUED_ERRORS
+ * @note this function is under the private specifier
+ */
+void Player_Daemon::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "audio_player.h"
+#include "ffmpeg_decoder.h"
+#include "ffmpeg_resampler.h"
+#include "media_library.h"
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Daemon_State Enum
+ * @desc what a Player_Daemon is doing
+ * @member DAEMON_IDLE - nothing loaded, or the last track ended
+ * @member DAEMON_PLAYING - writing the current track to the sink
+ * @member DAEMON_PAUSED - a track is loaded but nothing is written
+ */
+enum Daemon_State
+{
+    DAEMON_IDLE,
+    DAEMON_PLAYING,
+    DAEMON_PAUSED,
+};
+
+/* Daemon_Connection Struct
+ * @desc a connected client of a Player_Daemon
+ * @member socket - the accepted socket
+ * @member input - received bytes not yet ending in a newline
+ * @member output - reply bytes the socket did not take yet, sent once it is writable again
+ */
+struct Daemon_Connection
+{
+    int socket;
+    std::string input;
+    std::string output;
+};
+
+/* Player_Daemon Class
+ * @desc Plays files on command from clients connected to a Unix domain socket, see daemon_client.h.
+ * @desc The sink is connected once in a fixed format and kept open, every file is resampled to it, and the decoder and
+ * @desc resampler objects are reused, so starting a file costs only opening and decoding its first frame.
+ * @desc Commands are lines of "<COMMAND> [argument]", each answered with one line starting with "OK" or "ERR":
+ * @desc PLAY <file>, ENQUEUE <file>, PAUSE, RESUME, SEEK <seconds>, STOP, STATS, SHUTDOWN and, with a library set,
+ * @desc FIND <tag>=<value>.
+ * @desc Everything runs on the thread calling Player_Daemon::serve(), which writes the sink in small chunks and checks
+ * @desc the sockets between them, so a command waits for at most one chunk. The client sockets are non blocking, a reply
+ * @desc a client does not read is kept until its socket is writable, so a stuck client never stalls playback.
+ * @desc A watched Media_Library is polled with the sockets while nothing plays, changes inotify reports are read in and saved
+ * @desc then, so a rescan never holds up the sink.
+ * @member m_socket_path - the path of the listening socket, removed again by the destructor
+ * @member m_listen_socket - the listening socket, -1 before Player_Daemon::start()
+ * @member m_connections - the connected clients
+ * @member m_audio_player - the sink, connected by Player_Daemon::start()
+ * @member m_decoder - decodes the current track
+ * @member m_resampler - converts the current track to the sink format
+ * @member m_resampler_ready - true once m_resampler was initialized, later tracks only reset its options
+ * @member m_new_track - true from opening a track until m_resampler was set up for its first frame
+ * @member m_track_flushed - true once the samples m_resampler held back at the end of the current track were taken
+ * @member m_state - see Daemon_State
+ * @member m_running - false once a client sent SHUTDOWN
+ * @member m_queue - the files to play after the current one
+ * @member m_pending - the resampled frame being written, owned by m_resampler, nullptr if none
+ * @member m_pending_offset - the number of samples of m_pending already written
+ * @member m_frame_position - the position of the first sample of m_pending in AV_TIME_BASE units
+ * @member m_resume_position - where playback continues after a pause, in AV_TIME_BASE units
+ * @member m_commands - the number of commands handled
+ * @member m_tracks_started - the number of tracks started
+ * @member m_samples_played - the number of samples per channel written to the sink
+ * @member m_last_start_microseconds - the time from the last PLAY command to its first sample reaching the sink
+ * @member m_total_start_microseconds - the sum of those times over all PLAY commands, for the average
+ * @member m_play_commands - the number of PLAY commands that started a track
+ * @member m_library - the library FIND searches, nullptr if none, see Player_Daemon::set_library()
+ * @member m_errors - a std::queue<std::string> of error messages, the oldest are dropped past a limit
+ * @note see player_daemon.cpp for comments on functions
+ */
+class Player_Daemon
+{
+    std::string m_socket_path;
+    int m_listen_socket;
+    std::vector<Daemon_Connection> m_connections;
+
+    Audio_Player m_audio_player;
+    FFmpeg_Decoder m_decoder;
+    FFmpeg_Frame_Resampler m_resampler;
+    bool m_resampler_ready;
+    bool m_new_track;
+    bool m_track_flushed;
+
+    Daemon_State m_state;
+    bool m_running;
+    std::deque<std::string> m_queue;
+
+    AVFrame *m_pending;
+    int m_pending_offset;
+    int64_t m_frame_position;
+    int64_t m_resume_position;
+
+    uint64_t m_commands;
+    uint64_t m_tracks_started;
+    uint64_t m_samples_played;
+    uint64_t m_last_start_microseconds;
+    uint64_t m_total_start_microseconds;
+    uint64_t m_play_commands;
+
+    Media_Library *m_library;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Player_Daemon(const std::string&, Audio_Backend, pa_usec_t);
+    ~Player_Daemon();
+
+    Return_Status start();
+    Return_Status serve();
+
+    void set_library(Media_Library *);
+
+    bool is_running();
+    Daemon_State get_state();
+
+    std::string poll_error();
+
+    private:
+
+    void accept_connection();
+    bool read_connection(Daemon_Connection&);
+    bool write_connection(Daemon_Connection&);
+    std::string handle_command(const std::string&);
+
+    std::string play(const std::string&);
+    std::string pause();
+    std::string resume();
+    std::string seek(const std::string&);
+    std::string find(const std::string&);
+    void update_library();
+
+    Return_Status open_track(const std::string&);
+    Return_Status next_frame();
+    Return_Status write_chunk();
+    void finish_track();
+    void stop_playback();
+    Return_Status clear_resampler();
+
+    int64_t get_position();
+    std::string get_stats();
+    std::string take_errors();
+    void enqueue_error(const std::string &error);
+};
@@ -0,0 +1,120 @@
+#include "ring_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+
+
+
+/* Ring_Buffer constructor
+ * @desc allocates the storage, nothing is allocated after this
+ * @param capacity - the size of the buffer in bytes
+ */
+Ring_Buffer::Ring_Buffer(std::size_t capacity) :
+    m_buffer(capacity), m_capacity{capacity}, m_write_position{0}, m_read_position{0}
+{}
+
+
+
+
+/* Ring_Buffer::write() function
+ * @desc copies as much of the given data into the buffer as fits
+ * @param data - the bytes to write
+ * @param size - the number of bytes to write
+ * @return the number of bytes actually written, less than size if the buffer filled up
+ * @note must only be called from the producer thread
+ */
+std::size_t Ring_Buffer::write(const uint8_t *data, std::size_t size)
+{
+    uint64_t write_position = m_write_position.load(std::memory_order_relaxed);
+    uint64_t read_position = m_read_position.load(std::memory_order_acquire);
+
+    size = std::min(size, m_capacity - static_cast<std::size_t>(write_position - read_position));
+
+    std::size_t offset = write_position % m_capacity;
+    std::size_t first = std::min(size, m_capacity - offset);
+
+    std::memcpy(m_buffer.data() + offset, data, first);
+    std::memcpy(m_buffer.data(), data + first, size - first);
+
+    m_write_position.store(write_position + size, std::memory_order_release);
+    return size;
+}
+
+
+
+
+/* Ring_Buffer::read() function
+ * @desc copies as much data out of the buffer as is available, up to size
+ * @param data - where to copy the bytes to
+ * @param size - the maximum number of bytes to read
+ * @return the number of bytes actually read
+ * @note must only be called from the consumer thread
+ */
+std::size_t Ring_Buffer::read(uint8_t *data, std::size_t size)
+{
+    uint64_t read_position = m_read_position.load(std::memory_order_relaxed);
+    uint64_t write_position = m_write_position.load(std::memory_order_acquire);
+
+    size = std::min(size, static_cast<std::size_t>(write_position - read_position));
+
+    std::size_t offset = read_position % m_capacity;
+    std::size_t first = std::min(size, m_capacity - offset);
+
+    std::memcpy(data, m_buffer.data() + offset, first);
+    std::memcpy(data + first, m_buffer.data(), size - first);
+
+    m_read_position.store(read_position + size, std::memory_order_release);
+    return size;
+}
+
+
+
+
+/* Ring_Buffer::clear() function
+ * @desc discards all buffered data
+ * @note must only be called from the consumer thread, or while neither thread is using the buffer
+ */
+void Ring_Buffer::clear()
+{
+    m_read_position.store(m_write_position.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+
+
+
+/* Ring_Buffer::read_available() function
+ * @return the number of bytes that can be read
+ */
+std::size_t Ring_Buffer::read_available() const
+{
+    // load the read position first, it can never pass a write position loaded after it
+    uint64_t read_position = m_read_position.load(std::memory_order_acquire);
+    uint64_t write_position = m_write_position.load(std::memory_order_acquire);
+
+    return write_position - read_position;
+}
+
+
+
+
+/* Ring_Buffer::write_available() function
+ * @return the number of bytes that can be written
+ */
+std::size_t Ring_Buffer::write_available() const
+{
+    return m_capacity - read_available();
+}
+
+
+
+
+/* Ring_Buffer::capacity() function
+ * @return the size of the buffer in bytes
+ */
+std::size_t Ring_Buffer::capacity() const
+{
+    return m_capacity;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Ring_Buffer Class
+ * @desc A lock free single producer, single consumer byte ring buffer.
+ * @desc One thread may call Ring_Buffer::write(), another Ring_Buffer::read(), neither call allocates, locks or blocks.
+ * @member m_buffer - the storage, allocated once in the constructor
+ * @member m_capacity - the size of m_buffer in bytes
+ * @member m_write_position - total bytes ever written, only modified by the producer
+ * @member m_read_position - total bytes ever read, only modified by the consumer
+ * @note the positions only ever increase, their difference is the fill level, so a full and an empty buffer are told apart
+ * @note see ring_buffer.cpp for comments on functions
+ */
+class Ring_Buffer
+{
+    std::vector<uint8_t> m_buffer;
+    std::size_t m_capacity;
+
+    std::atomic<uint64_t> m_write_position;
+    std::atomic<uint64_t> m_read_position;
+
+    public:
+
+    explicit Ring_Buffer(std::size_t);
+
+    std::size_t write(const uint8_t *, std::size_t);
+    std::size_t read(uint8_t *, std::size_t);
+    void clear();
+
+    std::size_t read_available() const;
+    std::size_t write_available() const;
+    std::size_t capacity() const;
+};
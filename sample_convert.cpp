@@ -0,0 +1,77 @@
+#include "sample_convert.h"
+
+extern "C"
+{
+#include <libavutil/samplefmt.h>
+}
+
+#include <cstddef>
+
+namespace
+{
+    /* Converter_Entry Struct
+     * @desc one row of the dispatch table
+     */
+    struct Converter_Entry
+    {
+        enum AVSampleFormat in;
+        enum AVSampleFormat out;
+        int channels;
+        Convert_Function convert;
+    };
+
+    template<enum AVSampleFormat In, enum AVSampleFormat Out, int Channels>
+    constexpr Converter_Entry entry()
+    {
+        return Converter_Entry{In, Out, Channels, &Sample_Converter<In, Out, Channels>::convert};
+    }
+
+    // every decoder output format, to every format the player plays, for mono and stereo
+    #define CONVERTERS_TO(OUT, CHANNELS) \
+        entry<AV_SAMPLE_FMT_U8, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_S16, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_S32, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_FLT, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_DBL, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_U8P, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_S16P, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_S32P, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_FLTP, OUT, CHANNELS>(), \
+        entry<AV_SAMPLE_FMT_DBLP, OUT, CHANNELS>()
+
+    const Converter_Entry CONVERTERS[] =
+    {
+        CONVERTERS_TO(AV_SAMPLE_FMT_S16, 1),
+        CONVERTERS_TO(AV_SAMPLE_FMT_S16, 2),
+        CONVERTERS_TO(AV_SAMPLE_FMT_S32, 1),
+        CONVERTERS_TO(AV_SAMPLE_FMT_S32, 2),
+        CONVERTERS_TO(AV_SAMPLE_FMT_FLT, 1),
+        CONVERTERS_TO(AV_SAMPLE_FMT_FLT, 2),
+    };
+
+    #undef CONVERTERS_TO
+}
+
+
+
+
+/* find_sample_converter() function
+ * @desc looks up the specialized converter for a combination of formats and channel count
+ * @param in - the input sample format
+ * @param out - the output sample format
+ * @param channels - the number of channels, the same on both sides
+ * @return the converter, or nullptr if the combination is not instantiated
+ * @note call this once when the pipeline is set up, not per frame
+ */
+Convert_Function find_sample_converter(enum AVSampleFormat in, enum AVSampleFormat out, int channels)
+{
+    for(const Converter_Entry &converter : CONVERTERS)
+    {
+        if(converter.in == in && converter.out == out && converter.channels == channels)
+        {
+            return converter.convert;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/samplefmt.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Compile time specialized sample format conversion.
+//
+// Every (input format, output format, channel count) combination is its own instantiation of
+// Sample_Converter, so the sample types, strides and frame sizes are constants and the inner
+// loop has no branches. find_sample_converter() picks the instantiation once, when the pipeline
+// is set up, and returns a plain function pointer to it. Combinations that are not instantiated
+// return nullptr and the caller falls back to the generic (libswresample) path.
+
+/* Convert_Function
+ * @desc converts nb_samples sample frames
+ * @param in - the input planes, one per channel if the input is planar, only in[0] otherwise
+ * @param out - the output planes, one per channel if the output is planar, only out[0] otherwise
+ * @param nb_samples - the number of sample frames to convert
+ */
+typedef void (*Convert_Function)(const uint8_t *const *in, uint8_t *const *out, int nb_samples);
+
+Convert_Function find_sample_converter(enum AVSampleFormat, enum AVSampleFormat, int);
+
+/* Sample_Traits Struct
+ * @desc compile time description of a sample format
+ * @member type - the C++ type of one sample
+ * @member planar - true if each channel is in its own plane
+ * @member bytes - size of one sample in bytes
+ * @member to_float() - converts one sample to a float in [-1, 1]
+ * @member from_float() - converts a float in [-1, 1] to one sample, clipping
+ */
+template<enum AVSampleFormat Format>
+struct Sample_Traits;
+
+template<>
+struct Sample_Traits<AV_SAMPLE_FMT_U8>
+{
+    typedef uint8_t type;
+    static constexpr bool planar = false;
+    static constexpr int bytes = sizeof(type);
+
+    static float to_float(type sample) { return (static_cast<int>(sample) - 128) * (1.0f / 128.0f); }
+    static type from_float(float sample)
+    {
+        float scaled = sample * 128.0f + 128.0f;
+        return static_cast<type>(scaled <= 0.0f ? 0 : scaled >= 255.0f ? 255 : scaled + 0.5f);
+    }
+};
+
+template<>
+struct Sample_Traits<AV_SAMPLE_FMT_S16>
+{
+    typedef int16_t type;
+    static constexpr bool planar = false;
+    static constexpr int bytes = sizeof(type);
+
+    static float to_float(type sample) { return sample * (1.0f / 32768.0f); }
+    static type from_float(float sample)
+    {
+        float scaled = sample * 32768.0f;
+        return static_cast<type>(scaled <= -32768.0f ? -32768 : scaled >= 32767.0f ? 32767 : __builtin_lrintf(scaled));
+    }
+};
+
+template<>
+struct Sample_Traits<AV_SAMPLE_FMT_S32>
+{
+    typedef int32_t type;
+    static constexpr bool planar = false;
+    static constexpr int bytes = sizeof(type);
+
+    static float to_float(type sample) { return sample * (1.0f / 2147483648.0f); }
+    static type from_float(float sample)
+    {
+        double scaled = sample * 2147483648.0;
+        return static_cast<type>(scaled <= -2147483648.0 ? INT32_MIN : scaled >= 2147483647.0 ? INT32_MAX : __builtin_llrint(scaled));
+    }
+};
+
+template<>
+struct Sample_Traits<AV_SAMPLE_FMT_FLT>
+{
+    typedef float type;
+    static constexpr bool planar = false;
+    static constexpr int bytes = sizeof(type);
+
+    static float to_float(type sample) { return sample; }
+    static type from_float(float sample) { return sample; }
+};
+
+template<>
+struct Sample_Traits<AV_SAMPLE_FMT_DBL>
+{
+    typedef double type;
+    static constexpr bool planar = false;
+    static constexpr int bytes = sizeof(type);
+
+    static float to_float(type sample) { return static_cast<float>(sample); }
+    static type from_float(float sample) { return sample; }
+};
+
+// the planar formats behave like their packed counterparts, one plane per channel
+template<enum AVSampleFormat Packed>
+struct Planar_Sample_Traits : Sample_Traits<Packed>
+{
+    static constexpr bool planar = true;
+};
+
+template<> struct Sample_Traits<AV_SAMPLE_FMT_U8P> : Planar_Sample_Traits<AV_SAMPLE_FMT_U8> {};
+template<> struct Sample_Traits<AV_SAMPLE_FMT_S16P> : Planar_Sample_Traits<AV_SAMPLE_FMT_S16> {};
+template<> struct Sample_Traits<AV_SAMPLE_FMT_S32P> : Planar_Sample_Traits<AV_SAMPLE_FMT_S32> {};
+template<> struct Sample_Traits<AV_SAMPLE_FMT_FLTP> : Planar_Sample_Traits<AV_SAMPLE_FMT_FLT> {};
+template<> struct Sample_Traits<AV_SAMPLE_FMT_DBLP> : Planar_Sample_Traits<AV_SAMPLE_FMT_DBL> {};
+
+/* convert_sample() function
+ * @desc converts one sample between two formats, through float unless a cheaper exact conversion exists
+ */
+template<enum AVSampleFormat In, enum AVSampleFormat Out>
+inline typename Sample_Traits<Out>::type convert_sample(typename Sample_Traits<In>::type sample)
+{
+    typedef typename Sample_Traits<In>::type In_Type;
+    typedef typename Sample_Traits<Out>::type Out_Type;
+
+    if constexpr(std::is_same<In_Type, Out_Type>::value)
+    {
+        return sample;
+    }
+    else if constexpr(std::is_same<In_Type, int16_t>::value && std::is_same<Out_Type, int32_t>::value)
+    {
+        return static_cast<int32_t>(sample) * 65536;
+    }
+    else if constexpr(std::is_same<In_Type, int32_t>::value && std::is_same<Out_Type, int16_t>::value)
+    {
+        return static_cast<int16_t>(sample >> 16);
+    }
+    else
+    {
+        return Sample_Traits<Out>::from_float(Sample_Traits<In>::to_float(sample));
+    }
+}
+
+/* Sample_Converter Struct
+ * @desc converts between two sample formats for a fixed channel count
+ * @member in_stride - distance in samples between two sample frames of one channel in the input
+ * @member out_stride - distance in samples between two sample frames of one channel in the output
+ * @member in_frame_bytes - size of one input sample frame across all channels
+ * @member out_frame_bytes - size of one output sample frame across all channels
+ * @member convert() - a Convert_Function
+ */
+template<enum AVSampleFormat In, enum AVSampleFormat Out, int Channels>
+struct Sample_Converter
+{
+    typedef Sample_Traits<In> In_Traits;
+    typedef Sample_Traits<Out> Out_Traits;
+
+    static constexpr int in_stride = In_Traits::planar ? 1 : Channels;
+    static constexpr int out_stride = Out_Traits::planar ? 1 : Channels;
+    static constexpr int in_frame_bytes = In_Traits::bytes * Channels;
+    static constexpr int out_frame_bytes = Out_Traits::bytes * Channels;
+
+    static void convert(const uint8_t *const *in, uint8_t *const *out, int nb_samples)
+    {
+        typedef typename In_Traits::type In_Type;
+        typedef typename Out_Traits::type Out_Type;
+
+        const In_Type *in_planes[Channels];
+        Out_Type *out_planes[Channels];
+
+        for(int channel = 0; channel < Channels; channel++)
+        {
+            in_planes[channel] = In_Traits::planar ? reinterpret_cast<const In_Type *>(in[channel])
+                                                   : reinterpret_cast<const In_Type *>(in[0]) + channel;
+            out_planes[channel] = Out_Traits::planar ? reinterpret_cast<Out_Type *>(out[channel])
+                                                     : reinterpret_cast<Out_Type *>(out[0]) + channel;
+        }
+
+        for(int i = 0; i < nb_samples; i++)
+        {
+            for(int channel = 0; channel < Channels; channel++)
+            {
+                out_planes[channel][i * out_stride] = convert_sample<In, Out>(in_planes[channel][i * in_stride]);
+            }
+        }
+    }
+};
@@ -0,0 +1,1046 @@
+#include "silence_detector.h"
+#include "ffmpeg_decoder.h"
+#include "ffmpeg_resampler.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+#if defined(__AVX2__) || defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <queue>
+
+#include <sys/stat.h>
+
+// errors past this many are dropped oldest first
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+
+
+
+/* find_loud_s16() function
+ * @desc finds the first sample louder than the threshold
+ * @param samples - interleaved signed 16 bit samples
+ * @param count - the number of samples, channels * sample frames
+ * @param threshold - the loudest silent magnitude, 0 to 32767
+ * @return the index of the first loud sample, count if there is none
+ */
+std::size_t find_loud_s16(const int16_t *samples, std::size_t count, int16_t threshold)
+{
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    __m256i upper = _mm256_set1_epi16(threshold);
+    __m256i lower = _mm256_set1_epi16(static_cast<int16_t>(-threshold));
+    for(; i + 16 <= count; i += 16)
+    {
+        __m256i vector = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        __m256i loud = _mm256_or_si256(_mm256_cmpgt_epi16(vector, upper), _mm256_cmpgt_epi16(lower, vector));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(loud));
+        if(mask)
+        {
+            return i + __builtin_ctz(mask) / 2;
+        }
+    }
+#elif defined(__SSE2__)
+    __m128i upper = _mm_set1_epi16(threshold);
+    __m128i lower = _mm_set1_epi16(static_cast<int16_t>(-threshold));
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i vector = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        __m128i loud = _mm_or_si128(_mm_cmpgt_epi16(vector, upper), _mm_cmplt_epi16(vector, lower));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(loud));
+        if(mask)
+        {
+            return i + __builtin_ctz(mask) / 2;
+        }
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        if(samples[i] > threshold || samples[i] < -threshold)
+        {
+            return i;
+        }
+    }
+
+    return count;
+}
+
+
+
+
+/* find_loud_flt() function
+ * @desc finds the first sample louder than the threshold
+ * @param samples - interleaved float samples
+ * @param count - the number of samples, channels * sample frames
+ * @param threshold - the loudest silent magnitude, EX: 0.001 for -60 dBFS
+ * @return the index of the first loud sample, count if there is none
+ */
+std::size_t find_loud_flt(const float *samples, std::size_t count, float threshold)
+{
+    std::size_t i = 0;
+
+#if defined(__AVX__)
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 limit = _mm256_set1_ps(threshold);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 magnitude = _mm256_andnot_ps(sign, _mm256_loadu_ps(samples + i));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(magnitude, limit, _CMP_GT_OQ));
+        if(mask)
+        {
+            return i + __builtin_ctz(static_cast<unsigned int>(mask));
+        }
+    }
+#elif defined(__SSE2__)
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 limit = _mm_set1_ps(threshold);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 magnitude = _mm_andnot_ps(sign, _mm_loadu_ps(samples + i));
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(magnitude, limit));
+        if(mask)
+        {
+            return i + __builtin_ctz(static_cast<unsigned int>(mask));
+        }
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        if(std::fabs(samples[i]) > threshold)
+        {
+            return i;
+        }
+    }
+
+    return count;
+}
+
+
+
+
+/* rfind_loud_s16() function
+ * @desc finds the last sample louder than the threshold, searching backwards from the end
+ * @param samples - interleaved signed 16 bit samples
+ * @param count - the number of samples, channels * sample frames
+ * @param threshold - the loudest silent magnitude, 0 to 32767
+ * @return one past the index of the last loud sample, 0 if there is none
+ */
+std::size_t rfind_loud_s16(const int16_t *samples, std::size_t count, int16_t threshold)
+{
+    std::size_t i = count;
+
+#if defined(__AVX2__)
+    __m256i upper = _mm256_set1_epi16(threshold);
+    __m256i lower = _mm256_set1_epi16(static_cast<int16_t>(-threshold));
+    for(; i >= 16; i -= 16)
+    {
+        __m256i vector = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i - 16));
+        __m256i loud = _mm256_or_si256(_mm256_cmpgt_epi16(vector, upper), _mm256_cmpgt_epi16(lower, vector));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(loud));
+        if(mask)
+        {
+            return i - 16 + (31 - __builtin_clz(mask)) / 2 + 1;
+        }
+    }
+#elif defined(__SSE2__)
+    __m128i upper = _mm_set1_epi16(threshold);
+    __m128i lower = _mm_set1_epi16(static_cast<int16_t>(-threshold));
+    for(; i >= 8; i -= 8)
+    {
+        __m128i vector = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i - 8));
+        __m128i loud = _mm_or_si128(_mm_cmpgt_epi16(vector, upper), _mm_cmplt_epi16(vector, lower));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(loud));
+        if(mask)
+        {
+            return i - 8 + (31 - __builtin_clz(mask)) / 2 + 1;
+        }
+    }
+#endif
+
+    for(; i > 0; i--)
+    {
+        if(samples[i - 1] > threshold || samples[i - 1] < -threshold)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+
+
+
+/* rfind_loud_flt() function
+ * @desc finds the last sample louder than the threshold, searching backwards from the end
+ * @param samples - interleaved float samples
+ * @param count - the number of samples, channels * sample frames
+ * @param threshold - the loudest silent magnitude, EX: 0.001 for -60 dBFS
+ * @return one past the index of the last loud sample, 0 if there is none
+ */
+std::size_t rfind_loud_flt(const float *samples, std::size_t count, float threshold)
+{
+    std::size_t i = count;
+
+#if defined(__AVX__)
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 limit = _mm256_set1_ps(threshold);
+    for(; i >= 8; i -= 8)
+    {
+        __m256 magnitude = _mm256_andnot_ps(sign, _mm256_loadu_ps(samples + i - 8));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(magnitude, limit, _CMP_GT_OQ));
+        if(mask)
+        {
+            return i - 8 + (31 - __builtin_clz(static_cast<unsigned int>(mask))) + 1;
+        }
+    }
+#elif defined(__SSE2__)
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 limit = _mm_set1_ps(threshold);
+    for(; i >= 4; i -= 4)
+    {
+        __m128 magnitude = _mm_andnot_ps(sign, _mm_loadu_ps(samples + i - 4));
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(magnitude, limit));
+        if(mask)
+        {
+            return i - 4 + (31 - __builtin_clz(static_cast<unsigned int>(mask))) + 1;
+        }
+    }
+#endif
+
+    for(; i > 0; i--)
+    {
+        if(std::fabs(samples[i - 1]) > threshold)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+
+
+
+/* Silence_Detector constructor
+ * @param threshold_db - the loudest silent level in dBFS, EX: -60
+ * @param min_seconds - the shortest stretch of silence that is recorded
+ */
+Silence_Detector::Silence_Detector(double threshold_db, double min_seconds) :
+    m_threshold_db{threshold_db}, m_min_seconds{min_seconds}
+{
+    double threshold = std::pow(10.0, threshold_db / 20);
+
+    m_threshold_s16 = static_cast<int16_t>(std::min(threshold * 32768, 32767.0));
+    m_threshold_flt = static_cast<float>(threshold);
+
+    m_sample_rate = 0;
+    m_channels = 0;
+    m_min_samples = 0;
+
+    m_position = 0;
+    m_quiet_start = 0;
+}
+
+
+
+
+/* Silence_Detector::scan() function
+ * @desc looks for silence in the next frame of the stream
+ * @param frame - interleaved signed 16 bit or float samples, with the same rate and channels as the frames before it
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the frame's format is not supported
+ */
+Return_Status Silence_Detector::scan(const AVFrame *frame)
+{
+    if(!frame || (frame->format != AV_SAMPLE_FMT_S16 && frame->format != AV_SAMPLE_FMT_FLT))
+    {
+        enqueue_error("Silence detection needs interleaved s16 or float samples");
+        return STATUS_FAILURE;
+    }
+
+    if(m_sample_rate == 0)
+    {
+        m_sample_rate = frame->sample_rate;
+        m_channels = frame->channels;
+        m_min_samples = std::max<int64_t>(1, std::llround(m_min_seconds * m_sample_rate));
+    }
+
+    else if(frame->sample_rate != m_sample_rate || frame->channels != m_channels)
+    {
+        enqueue_error("The sample rate or channels changed during silence detection");
+        return STATUS_FAILURE;
+    }
+
+    int64_t count = frame->nb_samples;
+    int64_t current = 0;
+
+    while(current < count)
+    {
+        // the silence running up to here ends at the next loud sample frame
+        int64_t loud = find_loud(frame, current, count);
+        if(loud == count)
+        {
+            break;
+        }
+
+        add_range(m_quiet_start, m_position + loud);
+
+        // skip the loud audio: look back from a window ahead, silence can only start after its last loud sample
+        current = loud + 1;
+        while(current < count)
+        {
+            int64_t end = std::min(current + m_min_samples, count);
+            int64_t last = rfind_loud(frame, current, end);
+            if(last == current)
+            {
+                break;
+            }
+            current = last;
+        }
+
+        m_quiet_start = m_position + current;
+    }
+
+    m_position += count;
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Silence_Detector::finish() function
+ * @desc ends the stream, the silence running up to its end is recorded if it is long enough
+ */
+void Silence_Detector::finish()
+{
+    // a range can only end on the last sample frame when it was added here
+    if(m_sample_rate == 0 || (!m_ranges.empty() && m_ranges.back().end == m_position))
+    {
+        return;
+    }
+
+    add_range(m_quiet_start, m_position);
+}
+
+
+
+
+/* Silence_Detector::get_ranges() function
+ * @return the stretches of silence found so far, in sample frames from the start of the stream
+ */
+const std::vector<Silence_Range> &Silence_Detector::get_ranges()
+{
+    return m_ranges;
+}
+
+
+
+
+/* Silence_Detector::get_position() function
+ * @return the number of sample frames scanned
+ */
+int64_t Silence_Detector::get_position()
+{
+    return m_position;
+}
+
+
+
+
+/* Silence_Detector::get_quiet_start() function
+ * @return where the silence running up to the end of the last frame started, the position itself if it ended loud
+ */
+int64_t Silence_Detector::get_quiet_start()
+{
+    return m_quiet_start;
+}
+
+
+
+
+/* Silence_Detector::get_min_samples() function
+ * @return the shortest silence in sample frames, 0 before the first frame
+ */
+int64_t Silence_Detector::get_min_samples()
+{
+    return m_min_samples;
+}
+
+
+
+
+/* Silence_Detector::get_sample_rate() function
+ * @return the sample rate of the stream, 0 before the first frame
+ */
+int Silence_Detector::get_sample_rate()
+{
+    return m_sample_rate;
+}
+
+
+
+
+/* Silence_Detector::get_threshold_db() function
+ * @return the loudest silent level in dBFS
+ */
+double Silence_Detector::get_threshold_db()
+{
+    return m_threshold_db;
+}
+
+
+
+
+/* Silence_Detector::get_min_seconds() function
+ * @return the shortest stretch of silence that is recorded in seconds
+ */
+double Silence_Detector::get_min_seconds()
+{
+    return m_min_seconds;
+}
+
+
+
+
+/* Silence_Detector::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Silence_Detector::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Silence_Detector::find_loud() function
+ * @desc finds the first loud sample frame in [from, to) of a frame
+ * @return the index of the sample frame, to if there is none
+ * @note this function is under the private specifier
+ */
+std::size_t Silence_Detector::find_loud(const AVFrame *frame, int64_t from, int64_t to)
+{
+    std::size_t offset = static_cast<std::size_t>(from) * m_channels;
+    std::size_t count = static_cast<std::size_t>(to - from) * m_channels;
+    std::size_t found = 0;
+
+    if(frame->format == AV_SAMPLE_FMT_S16)
+    {
+        found = find_loud_s16(reinterpret_cast<const int16_t *>(frame->extended_data[0]) + offset, count, m_threshold_s16);
+    }
+    else
+    {
+        found = find_loud_flt(reinterpret_cast<const float *>(frame->extended_data[0]) + offset, count, m_threshold_flt);
+    }
+
+    return found == count ? to : from + found / m_channels;
+}
+
+
+
+
+/* Silence_Detector::rfind_loud() function
+ * @desc finds the last loud sample frame in [from, to) of a frame
+ * @return one past the index of the sample frame, from if there is none
+ * @note this function is under the private specifier
+ */
+std::size_t Silence_Detector::rfind_loud(const AVFrame *frame, int64_t from, int64_t to)
+{
+    std::size_t offset = static_cast<std::size_t>(from) * m_channels;
+    std::size_t count = static_cast<std::size_t>(to - from) * m_channels;
+    std::size_t found = 0;
+
+    if(frame->format == AV_SAMPLE_FMT_S16)
+    {
+        found = rfind_loud_s16(reinterpret_cast<const int16_t *>(frame->extended_data[0]) + offset, count, m_threshold_s16);
+    }
+    else
+    {
+        found = rfind_loud_flt(reinterpret_cast<const float *>(frame->extended_data[0]) + offset, count, m_threshold_flt);
+    }
+
+    return found == 0 ? from : from + (found - 1) / m_channels + 1;
+}
+
+
+
+
+/* Silence_Detector::add_range() function
+ * @desc records a stretch of silence if it is at least m_min_samples long
+ * @note this function is under the private specifier
+ */
+void Silence_Detector::add_range(int64_t start, int64_t end)
+{
+    if(end - start >= m_min_samples)
+    {
+        m_ranges.push_back(Silence_Range{start, end});
+    }
+}
+
+
+
+
+/* Silence_Detector::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, the oldest is dropped once MAX_QUEUED_ERRORS are queued
+ * @note this function is under the private specifier
+ */
+void Silence_Detector::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
+
+
+
+
+/* Silence_Trimmer constructor
+ * @param threshold_db - the loudest silent level in dBFS, EX: -60
+ * @param min_seconds - the shortest leading or trailing silence that is dropped
+ */
+Silence_Trimmer::Silence_Trimmer(double threshold_db, double min_seconds) :
+    m_detector{threshold_db, min_seconds}
+{
+    m_held_start = 0;
+    m_leading = true;
+    m_time_base = AVRational{0, 1};
+
+    m_trimmed_leading = 0;
+    m_trimmed_trailing = 0;
+}
+
+
+
+
+/* Silence_Trimmer::push() function
+ * @desc takes the next frame of the stream, what is known not to be leading or trailing silence becomes ready to play
+ * @param frame - interleaved signed 16 bit or float samples, see Silence_Detector::scan()
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the frame could not be scanned
+ */
+Return_Status Silence_Trimmer::push(Frame_Handle frame)
+{
+    if(m_detector.scan(frame.get()) == STATUS_FAILURE)
+    {
+        for(std::string error = m_detector.poll_error(); !error.empty(); error = m_detector.poll_error())
+        {
+            enqueue_error(error);
+        }
+        return STATUS_FAILURE;
+    }
+
+    m_held.push_back(std::move(frame));
+
+    int64_t position = m_detector.get_position();
+    int64_t quiet_start = m_detector.get_quiet_start();
+
+    if(m_leading)
+    {
+        // nothing loud yet, once the silence is long enough it is dropped whatever follows
+        if(quiet_start == 0)
+        {
+            if(position >= m_detector.get_min_samples())
+            {
+                m_trimmed_leading += release(position, true);
+            }
+            return STATUS_SUCCESS;
+        }
+
+        m_leading = false;
+
+        const std::vector<Silence_Range> &ranges = m_detector.get_ranges();
+        if(!ranges.empty() && ranges.front().start == 0)
+        {
+            m_trimmed_leading += release(ranges.front().end, true);
+        }
+    }
+
+    // everything before the silence running up to here is played, the silence waits until it is known not to be trailing
+    release(quiet_start, false);
+
+    int64_t max_held = static_cast<int64_t>(MAX_HELD_SECONDS * m_detector.get_sample_rate());
+    if(position - m_held_start > max_held)
+    {
+        release(position - max_held, false);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Silence_Trimmer::pop() function
+ * @return the next frame to play, an empty handle if none is ready
+ */
+Frame_Handle Silence_Trimmer::pop()
+{
+    if(m_ready.empty())
+    {
+        return Frame_Handle{};
+    }
+
+    Frame_Handle frame = std::move(m_ready.front());
+    m_ready.pop_front();
+    return frame;
+}
+
+
+
+
+/* Silence_Trimmer::finish() function
+ * @desc ends the stream, the silence held back is dropped if it is long enough and played otherwise
+ */
+void Silence_Trimmer::finish()
+{
+    m_detector.finish();
+
+    int64_t position = m_detector.get_position();
+    const std::vector<Silence_Range> &ranges = m_detector.get_ranges();
+
+    if(!ranges.empty() && ranges.back().end == position && position > 0)
+    {
+        int64_t trimmed = release(position, true);
+        (m_leading ? m_trimmed_leading : m_trimmed_trailing) += trimmed;
+    }
+
+    release(position, false);
+}
+
+
+
+
+/* Silence_Trimmer::get_trimmed_leading() function
+ * @return the number of sample frames of leading silence dropped
+ */
+int64_t Silence_Trimmer::get_trimmed_leading()
+{
+    return m_trimmed_leading;
+}
+
+
+
+
+/* Silence_Trimmer::get_trimmed_trailing() function
+ * @return the number of sample frames of trailing silence dropped, only known after Silence_Trimmer::finish()
+ */
+int64_t Silence_Trimmer::get_trimmed_trailing()
+{
+    return m_trimmed_trailing;
+}
+
+
+
+
+/* Silence_Trimmer::set_time_base() function
+ * @desc sets the time base of the timestamps of the frames pushed, so the rest of a split frame gets the timestamp it starts at
+ * @param time_base - EX: the stream's time base, without one the timestamps of split frames are left as they are
+ */
+void Silence_Trimmer::set_time_base(AVRational time_base)
+{
+    m_time_base = time_base;
+}
+
+
+
+
+/* Silence_Trimmer::get_sample_rate() function
+ * @return the sample rate of the stream, 0 before the first frame
+ */
+int Silence_Trimmer::get_sample_rate()
+{
+    return m_detector.get_sample_rate();
+}
+
+
+
+
+/* Silence_Trimmer::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Silence_Trimmer::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Silence_Trimmer::release() function
+ * @desc moves the held audio before a position to the frames ready to play, or drops it
+ * @param until - the position in sample frames
+ * @param drop - true to drop the audio instead
+ * @return the number of sample frames moved or dropped
+ * @note a frame reaching past until is split: a new reference to its buffers covers the part before, the held frame's
+ * @note data pointer and timestamps are moved past it, nothing is copied
+ * @note this function is under the private specifier
+ */
+int64_t Silence_Trimmer::release(int64_t until, bool drop)
+{
+    int64_t released = 0;
+
+    while(!m_held.empty() && m_held_start < until)
+    {
+        Frame_Handle &held = m_held.front();
+        int64_t count = std::min<int64_t>(held->nb_samples, until - m_held_start);
+        Frame_Handle part;
+
+        if(count < held->nb_samples)
+        {
+            part = Frame_Handle::allocate();
+            if(!part || av_frame_ref(part.get(), held.get()) < 0)
+            {
+                // play the whole frame rather than lose it
+                enqueue_error("Failed to split frame");
+                count = held->nb_samples;
+            }
+        }
+
+        if(count == held->nb_samples)
+        {
+            part = std::move(held);
+            m_held.pop_front();
+        }
+
+        else
+        {
+            std::size_t bytes = static_cast<std::size_t>(count) * held->channels *
+                                av_get_bytes_per_sample(static_cast<enum AVSampleFormat>(held->format));
+
+            part->nb_samples = static_cast<int>(count);
+            held->data[0] += bytes;
+            held->extended_data[0] = held->data[0];
+            held->nb_samples -= static_cast<int>(count);
+
+            if(m_time_base.num > 0)
+            {
+                int64_t skipped = av_rescale_q(count, AVRational{1, held->sample_rate}, m_time_base);
+                if(held->pts != AV_NOPTS_VALUE)
+                {
+                    held->pts += skipped;
+                }
+                if(held->best_effort_timestamp != AV_NOPTS_VALUE)
+                {
+                    held->best_effort_timestamp += skipped;
+                }
+            }
+        }
+
+        m_held_start += count;
+        released += count;
+
+        if(!drop)
+        {
+            m_ready.push_back(std::move(part));
+        }
+    }
+
+    return released;
+}
+
+
+
+
+/* Silence_Trimmer::enqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors, the oldest is dropped once MAX_QUEUED_ERRORS are queued
+ * @note this function is under the private specifier
+ */
+void Silence_Trimmer::enqueue_error(const std::string &error)
+{
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
+
+
+
+
+/* get_silence_map_path() function
+ * @param path - a media file
+ * @return the path of its sidecar file, EX: "song.flac.silence"
+ */
+std::string get_silence_map_path(const std::string &path)
+{
+    return path + ".silence";
+}
+
+
+
+
+/* scan_silence_map() function
+ * @desc decodes a whole file and records its silence, for write_silence_map()
+ * @param path - the file to scan
+ * @param threshold_db - the loudest silent level in dBFS
+ * @param min_seconds - the shortest stretch of silence recorded
+ * @param map - set to the silence found, with the size and modification time of the file
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note the frames are converted to interleaved float at their own rate, which is no more than a format conversion
+ */
+Return_Status scan_silence_map(const std::string &path, double threshold_db, double min_seconds, Silence_Map &map, std::string &error)
+{
+    struct stat file_status;
+    if(stat(path.c_str(), &file_status) < 0)
+    {
+        error = "Failed to read the size of " + path;
+        return STATUS_FAILURE;
+    }
+
+    FFmpeg_Decoder decoder{path, AVMEDIA_TYPE_AUDIO};
+    if(decoder.open_file() == STATUS_FAILURE || decoder.init() == STATUS_FAILURE)
+    {
+        error = "Failed to open " + path + ": " + decoder.poll_error();
+        return STATUS_FAILURE;
+    }
+
+    AVFrame *frame = decoder.decode_frame();
+    if(!frame)
+    {
+        error = "Failed to decode " + path + ": " + decoder.poll_error();
+        return STATUS_FAILURE;
+    }
+
+    int64_t layout = frame->channel_layout ? static_cast<int64_t>(frame->channel_layout) : av_get_default_channel_layout(frame->channels);
+    int sample_rate = frame->sample_rate;
+    FFmpeg_Frame_Resampler resampler{layout, AV_SAMPLE_FMT_FLT, sample_rate, layout, static_cast<enum AVSampleFormat>(frame->format), sample_rate};
+    if(resampler.init() == STATUS_FAILURE)
+    {
+        error = "Failed to initialize resampler: " + resampler.poll_error();
+        return STATUS_FAILURE;
+    }
+
+    // the ranges are counted from the first sample, which is not always at 0 on the file's timeline
+    int64_t origin = 0;
+    if(frame->best_effort_timestamp != AV_NOPTS_VALUE)
+    {
+        origin = av_rescale_q(frame->best_effort_timestamp, decoder.get_stream()->time_base, AVRational{1, AV_TIME_BASE});
+    }
+
+    Silence_Detector detector{threshold_db, min_seconds};
+
+    for(; frame; frame = decoder.decode_frame())
+    {
+        AVFrame *converted = resampler.resample_frame(frame);
+        if(!converted)
+        {
+            error = "Failed to convert " + path + ": " + resampler.poll_error();
+            return STATUS_FAILURE;
+        }
+
+        if(detector.scan(converted) == STATUS_FAILURE)
+        {
+            error = "Failed to scan " + path + ": " + detector.poll_error();
+            return STATUS_FAILURE;
+        }
+    }
+
+    if(!decoder.end_of_file_reached())
+    {
+        error = "Failed to decode " + path + ": " + decoder.poll_error();
+        return STATUS_FAILURE;
+    }
+
+    detector.finish();
+
+    AVRational sample_time_base{1, sample_rate};
+    AVRational time_base{1, AV_TIME_BASE};
+
+    map = Silence_Map{};
+    map.file_size = file_status.st_size;
+    map.file_mtime = file_status.st_mtime;
+    map.threshold_db = threshold_db;
+    map.min_seconds = min_seconds;
+    map.start = origin;
+    map.duration = av_rescale_q(detector.get_position(), sample_time_base, time_base);
+
+    for(const Silence_Range &range : detector.get_ranges())
+    {
+        map.ranges.push_back(Silence_Range{origin + av_rescale_q(range.start, sample_time_base, time_base),
+                                           origin + av_rescale_q(range.end, sample_time_base, time_base)});
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* write_silence_map() function
+ * @desc writes the sidecar file of a media file, a few lines of text, EX:
+ * @desc "silence-map 1", "file-size 4519023", "file-mtime 1700000000", "threshold-db -60", "min-seconds 2",
+ * @desc "start 0", "duration 215402000", "range 0 3512000", "range 211000000 215402000", times are in microseconds
+ * @param path - the media file, the sidecar is written next to it, see get_silence_map_path()
+ * @param map - the silence of the file
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE on failure
+ * @note the sidecar is written to a temporary file first and renamed, a reader never sees half of it
+ */
+Return_Status write_silence_map(const std::string &path, const Silence_Map &map, std::string &error)
+{
+    std::string sidecar = get_silence_map_path(path);
+    std::string temporary = sidecar + ".tmp";
+
+    {
+        std::ofstream out{temporary};
+        out << "silence-map 1\n";
+        out << "file-size " << map.file_size << '\n';
+        out << "file-mtime " << map.file_mtime << '\n';
+        out << "threshold-db " << map.threshold_db << '\n';
+        out << "min-seconds " << map.min_seconds << '\n';
+        out << "start " << map.start << '\n';
+        out << "duration " << map.duration << '\n';
+
+        for(const Silence_Range &range : map.ranges)
+        {
+            out << "range " << range.start << ' ' << range.end << '\n';
+        }
+
+        if(!out.flush())
+        {
+            error = "Failed to write " + temporary;
+            std::remove(temporary.c_str());
+            return STATUS_FAILURE;
+        }
+    }
+
+    if(std::rename(temporary.c_str(), sidecar.c_str()) != 0)
+    {
+        error = "Failed to rename " + temporary + " to " + sidecar;
+        std::remove(temporary.c_str());
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* read_silence_map() function
+ * @desc reads the sidecar file of a media file, see write_silence_map()
+ * @param path - the media file
+ * @param map - set to the silence recorded
+ * @param error - set to a description of the problem on failure
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if there is no sidecar, it can't be read,
+ * @return or the media file changed since it was scanned
+ */
+Return_Status read_silence_map(const std::string &path, Silence_Map &map, std::string &error)
+{
+    std::string sidecar = get_silence_map_path(path);
+
+    std::ifstream in{sidecar};
+    if(!in)
+    {
+        error = "No silence map for " + path;
+        return STATUS_FAILURE;
+    }
+
+    map = Silence_Map{};
+    bool versioned = false;
+
+    for(std::string line; std::getline(in, line);)
+    {
+        std::istringstream fields{line};
+        std::string key;
+        fields >> key;
+
+        bool valid = true;
+        if(key == "silence-map")
+        {
+            int version = 0;
+            valid = static_cast<bool>(fields >> version) && version == 1;
+            versioned = valid;
+        }
+        else if(key == "file-size")
+        {
+            valid = static_cast<bool>(fields >> map.file_size);
+        }
+        else if(key == "file-mtime")
+        {
+            valid = static_cast<bool>(fields >> map.file_mtime);
+        }
+        else if(key == "threshold-db")
+        {
+            valid = static_cast<bool>(fields >> map.threshold_db);
+        }
+        else if(key == "min-seconds")
+        {
+            valid = static_cast<bool>(fields >> map.min_seconds);
+        }
+        else if(key == "start")
+        {
+            valid = static_cast<bool>(fields >> map.start);
+        }
+        else if(key == "duration")
+        {
+            valid = static_cast<bool>(fields >> map.duration);
+        }
+        else if(key == "range")
+        {
+            Silence_Range range{0, 0};
+            valid = static_cast<bool>(fields >> range.start >> range.end) && range.start <= range.end;
+            map.ranges.push_back(range);
+        }
+
+        if(!valid)
+        {
+            error = "Invalid line in " + sidecar + ": " + line;
+            return STATUS_FAILURE;
+        }
+    }
+
+    if(!versioned)
+    {
+        error = sidecar + " is not a silence map";
+        return STATUS_FAILURE;
+    }
+
+    struct stat file_status;
+    if(stat(path.c_str(), &file_status) < 0 || file_status.st_size != map.file_size || file_status.st_mtime != map.file_mtime)
+    {
+        error = path + " changed since " + sidecar + " was written";
+        return STATUS_FAILURE;
+    }
+
+    return STATUS_SUCCESS;
+}
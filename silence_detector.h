@@ -0,0 +1,189 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+#include "frame_handle.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+// Silence kernels, they look for the first or last sample louder than a threshold in interleaved samples.
+// SSE2 / AVX2 versions are used when the compiler targets them, otherwise plain loops are used.
+// A sample is loud when its magnitude is above the threshold, the threshold itself counts as silent.
+
+std::size_t find_loud_s16(const int16_t *, std::size_t, int16_t);
+std::size_t find_loud_flt(const float *, std::size_t, float);
+std::size_t rfind_loud_s16(const int16_t *, std::size_t, int16_t);
+std::size_t rfind_loud_flt(const float *, std::size_t, float);
+
+/* Silence_Range Struct
+ * @desc a stretch of silence, in sample frames from the start of the stream when found by a Silence_Detector,
+ * @desc in AV_TIME_BASE units (microseconds) on the file's timeline in a Silence_Map
+ * @member start - where the silence starts
+ * @member end - where the silence ends, the first loud sample or the end of the stream
+ */
+struct Silence_Range
+{
+    int64_t start;
+    int64_t end;
+};
+
+/* Silence_Detector Class
+ * @desc Finds the stretches of silence at least min_seconds long in a stream of frames, EX: the silent intro of a track.
+ * @desc A sample frame is silent when every channel is at or below the threshold. Frames must be interleaved signed 16 bit
+ * @desc or float, EX: what FFmpeg_Frame_Resampler gives the player.
+ * @desc Frames are searched with the SIMD kernels: after a loud sample the detector jumps a whole min_seconds window ahead
+ * @desc and looks backwards for the last loud sample in it, so loud audio costs one reverse search per window and
+ * @desc silence one forward search until the next loud sample.
+ * @member m_threshold_db - the threshold in dBFS
+ * @member m_min_seconds - the shortest stretch that counts as silence
+ * @member m_threshold_s16 - the threshold for signed 16 bit samples
+ * @member m_threshold_flt - the threshold for float samples
+ * @member m_sample_rate - the sample rate of the stream, 0 until the first frame
+ * @member m_channels - the number of channels of the stream, 0 until the first frame
+ * @member m_min_samples - min_seconds in sample frames, set with the first frame
+ * @member m_position - the number of sample frames scanned
+ * @member m_quiet_start - where the silence that runs up to m_position started, m_position if the last sample frame was loud
+ * @member m_ranges - the stretches of silence found, in order
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see silence_detector.cpp for comments on functions
+ */
+class Silence_Detector
+{
+    double m_threshold_db;
+    double m_min_seconds;
+    int16_t m_threshold_s16;
+    float m_threshold_flt;
+
+    int m_sample_rate;
+    int m_channels;
+    int64_t m_min_samples;
+
+    int64_t m_position;
+    int64_t m_quiet_start;
+    std::vector<Silence_Range> m_ranges;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    Silence_Detector(double, double);
+
+    Return_Status scan(const AVFrame *);
+    void finish();
+
+    const std::vector<Silence_Range> &get_ranges();
+    int64_t get_position();
+    int64_t get_quiet_start();
+    int64_t get_min_samples();
+    int get_sample_rate();
+    double get_threshold_db();
+    double get_min_seconds();
+
+    std::string poll_error();
+
+    private:
+
+    std::size_t find_loud(const AVFrame *, int64_t, int64_t);
+    std::size_t rfind_loud(const AVFrame *, int64_t, int64_t);
+    void add_range(int64_t, int64_t);
+    void enqueue_error(const std::string &error);
+};
+
+/* Silence_Trimmer Class
+ * @desc Drops the leading and trailing silence of a stream of frames while it plays, silence in between is kept.
+ * @desc Frames go in with Silence_Trimmer::push() and come out with Silence_Trimmer::pop(). Audio that may belong to
+ * @desc a silence is held back until the next loud sample shows it was not trailing, or dropped when the stream ends.
+ * @desc Held back audio is bounded by MAX_HELD_SECONDS, beyond that the oldest is played, so trailing silence longer
+ * @desc than that is only trimmed in part. Leading silence is dropped as soon as it is min_seconds long.
+ * @desc Frames are split without copying, the parts reference the same buffers with their data pointers moved.
+ * @member m_detector - finds the silence
+ * @member m_time_base - the time base of the frames' timestamps, moved forward when a frame is split, {0, 1} if unknown
+ * @member m_held - the frames held back, the first starts at m_held_start
+ * @member m_ready - the frames to play
+ * @member m_held_start - the position of the first held sample frame
+ * @member m_leading - true until the first loud sample
+ * @member m_trimmed_leading - the number of sample frames dropped at the start
+ * @member m_trimmed_trailing - the number of sample frames dropped at the end
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note see silence_detector.cpp for comments on functions
+ */
+class Silence_Trimmer
+{
+    Silence_Detector m_detector;
+
+    std::deque<Frame_Handle> m_held;
+    std::deque<Frame_Handle> m_ready;
+    int64_t m_held_start;
+    bool m_leading;
+    AVRational m_time_base;
+
+    int64_t m_trimmed_leading;
+    int64_t m_trimmed_trailing;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    static constexpr double MAX_HELD_SECONDS = 30.0;
+
+    Silence_Trimmer(double, double);
+
+    Return_Status push(Frame_Handle);
+    Frame_Handle pop();
+    void finish();
+    void set_time_base(AVRational);
+
+    int64_t get_trimmed_leading();
+    int64_t get_trimmed_trailing();
+    int get_sample_rate();
+
+    std::string poll_error();
+
+    private:
+
+    int64_t release(int64_t, bool);
+    void enqueue_error(const std::string &error);
+};
+
+/* Silence_Map Struct
+ * @desc the silence of a file recorded by a pre-scan, kept in a sidecar file next to it, see write_silence_map()
+ * @member file_size - the size of the file when it was scanned, a sidecar for a file that changed is ignored
+ * @member file_mtime - the modification time of the file when it was scanned, in seconds
+ * @member threshold_db - the threshold the file was scanned with
+ * @member min_seconds - the shortest silence recorded
+ * @member start - the timestamp of the first sample in AV_TIME_BASE units (microseconds), usually 0
+ * @member duration - the length of the file in AV_TIME_BASE units, a range ending at start + duration is trailing silence
+ * @member ranges - the stretches of silence in AV_TIME_BASE units on the file's timeline
+ */
+struct Silence_Map
+{
+    int64_t file_size = 0;
+    int64_t file_mtime = 0;
+    double threshold_db = 0;
+    double min_seconds = 0;
+    int64_t start = 0;
+    int64_t duration = 0;
+    std::vector<Silence_Range> ranges;
+};
+
+std::string get_silence_map_path(const std::string&);
+Return_Status scan_silence_map(const std::string&, double, double, Silence_Map&, std::string&);
+Return_Status write_silence_map(const std::string&, const Silence_Map&, std::string&);
+Return_Status read_silence_map(const std::string&, Silence_Map&, std::string&);
@@ -0,0 +1,494 @@
+#include "simulated_sink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <thread>
+
+// errors past this many are dropped oldest first
+const std::size_t MAX_QUEUED_ERRORS = 32;
+
+
+
+
+/* Simulated_Sink constructor
+ * @desc sets the default config, a stepped clock without jitter or stalls, Simulated_Sink::init() must be called before writing
+ */
+Simulated_Sink::Simulated_Sink()
+{
+    m_initialized = false;
+    m_frame_size = 0;
+    m_capacity = 0;
+    m_period_samples = 0;
+    m_period_ns = 0;
+    m_time = 0;
+    m_buffered = 0;
+    m_playing = false;
+    m_draining = false;
+    m_start = 0;
+    m_periods = 0;
+    m_next_period = 0;
+    m_silence_start = -1;
+    m_jitter_state = 0;
+    m_next_stall = 0;
+}
+
+
+
+
+/* Simulated_Sink::init() function
+ * @desc empties the buffer, resets the clock to 0 and the stats, and sizes the buffer and the periods for the stream
+ * @param sample_rate - the nominal sample rate of the device, EX: 48000 Hz
+ * @param frame_size - the size of one sample frame in bytes
+ * @param latency - the size of the buffer in microseconds, 0 for DEFAULT_LATENCY
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if the stream or the config is invalid
+ */
+Return_Status Simulated_Sink::init(uint32_t sample_rate, std::size_t frame_size, uint64_t latency)
+{
+    m_initialized = false;
+
+    if(sample_rate == 0 || frame_size == 0)
+    {
+        enqueue_error("Invalid sample rate or frame size");
+        return STATUS_FAILURE;
+    }
+
+    if(m_config.period == 0 || m_config.rate_ppm <= -1e6 || (m_config.clock == SINK_CLOCK_ACCELERATED && !(m_config.speed > 0)))
+    {
+        enqueue_error("Invalid simulated sink config");
+        return STATUS_FAILURE;
+    }
+
+    if(latency == 0)
+    {
+        latency = DEFAULT_LATENCY;
+    }
+
+    m_frame_size = frame_size;
+    m_capacity = std::max<int64_t>(static_cast<int64_t>(latency * sample_rate / 1000000), 1);
+    m_period_samples = std::clamp<int64_t>(static_cast<int64_t>(m_config.period * sample_rate / 1000000), 1, m_capacity);
+
+    double device_rate = sample_rate * (1 + m_config.rate_ppm / 1e6);
+    m_period_ns = m_period_samples * 1e9 / device_rate;
+
+    m_origin = std::chrono::steady_clock::now();
+    m_time = 0;
+    m_buffered = 0;
+    m_playing = false;
+    m_draining = false;
+    m_start = 0;
+    m_periods = 0;
+    m_next_period = 0;
+    m_silence_start = -1;
+    m_jitter_state = m_config.seed;
+    m_next_stall = 0;
+    m_stats = Simulated_Sink_Stats{};
+
+    m_initialized = true;
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Simulated_Sink::write() function
+ * @desc writes samples to the buffer, waiting while it is full or a stall is injected, like pa_simple_write()
+ * @param size - the size of the samples in bytes, only their number matters as the samples are not kept
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if not initialized
+ * @note nothing is allocated, so this is safe to call from a real time thread
+ */
+Return_Status Simulated_Sink::write(std::size_t size)
+{
+    if(!m_initialized)
+    {
+        enqueue_error("Not initialized");
+        return STATUS_FAILURE;
+    }
+
+    int64_t samples = static_cast<int64_t>(size / m_frame_size);
+    m_stats.samples_written += samples;
+
+    int64_t time = now();
+    update(time);
+
+    // the write is held up until the stall ends, the device keeps playing what it has meanwhile
+    while(m_next_stall < m_config.stalls.size() && m_config.stalls[m_next_stall].at <= time)
+    {
+        const Sink_Stall &stall = m_config.stalls[m_next_stall];
+        m_next_stall++;
+        m_stats.stalls++;
+
+        wait_until(stall.at + stall.duration);
+        time = now();
+        update(time);
+    }
+
+    bool blocked = false;
+    while(1)
+    {
+        int64_t fits = std::min(samples, m_capacity - m_buffered);
+        m_buffered += fits;
+        samples -= fits;
+
+        // like a PulseAudio stream the device starts, and starts again after an underrun, once the buffer is full
+        if(!m_playing && m_buffered == m_capacity)
+        {
+            start(time);
+            update(time);
+        }
+
+        if(samples == 0)
+        {
+            break;
+        }
+
+        // the buffer is full and the device is playing, there is room again once it takes the next period
+        blocked = true;
+        wait_until(m_next_period);
+        time = now();
+        update(time);
+    }
+
+    if(blocked)
+    {
+        m_stats.blocked_writes++;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Simulated_Sink::drain() function
+ * @desc waits until everything written has been played, the device starts if it was still waiting for the buffer to fill
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if not initialized
+ */
+Return_Status Simulated_Sink::drain()
+{
+    if(!m_initialized)
+    {
+        enqueue_error("Not initialized");
+        return STATUS_FAILURE;
+    }
+
+    int64_t time = now();
+    update(time);
+
+    m_draining = true;
+
+    if(!m_playing && m_buffered > 0)
+    {
+        start(time);
+        update(time);
+    }
+
+    while(m_playing)
+    {
+        wait_until(m_next_period);
+        update(now());
+    }
+
+    // the device stopped when it took the last samples, they are heard until then
+    wait_until(m_next_period);
+    m_draining = false;
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Simulated_Sink::flush() function
+ * @desc discards the samples in the buffer, the period the device is playing plays out
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if not initialized
+ */
+Return_Status Simulated_Sink::flush()
+{
+    if(!m_initialized)
+    {
+        enqueue_error("Not initialized");
+        return STATUS_FAILURE;
+    }
+
+    update(now());
+    m_buffered = 0;
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Simulated_Sink::get_latency() function
+ * @desc works out the time until a sample written now is heard, the buffered samples and the rest of the period playing
+ * @param latency - set to the latency in microseconds on success
+ * @return Return_Status::STATUS_SUCCESS on success, Return_Status::STATUS_FAILURE if not initialized
+ */
+Return_Status Simulated_Sink::get_latency(uint64_t &latency)
+{
+    if(!m_initialized)
+    {
+        enqueue_error("Not initialized");
+        return STATUS_FAILURE;
+    }
+
+    int64_t time = now();
+    update(time);
+
+    double nanoseconds = m_buffered * m_period_ns / m_period_samples;
+    if(m_playing && m_next_period > time)
+    {
+        nanoseconds += m_next_period - time;
+    }
+
+    latency = static_cast<uint64_t>(nanoseconds / 1000);
+    m_stats.max_latency = std::max(m_stats.max_latency, latency);
+
+    return STATUS_SUCCESS;
+}
+
+
+
+
+/* Simulated_Sink::advance() function
+ * @desc moves the stepped clock forward, EX: by the time decoding a frame would take on the target machine
+ * @param nanoseconds - how far
+ * @note the realtime and accelerated clocks move on their own, for them this does nothing
+ */
+void Simulated_Sink::advance(int64_t nanoseconds)
+{
+    if(m_config.clock != SINK_CLOCK_STEPPED || nanoseconds <= 0)
+    {
+        return;
+    }
+
+    m_time += nanoseconds;
+
+    if(m_initialized)
+    {
+        update(m_time);
+    }
+}
+
+
+
+
+/* Simulated_Sink::reset_config() function
+ * @desc resets how the sink behaves, m_config
+ * @note in order for the new config to take affect Simulated_Sink::init() must be called again
+ */
+void Simulated_Sink::reset_config(const Simulated_Sink_Config &config)
+{
+    m_config = config;
+
+    std::sort(m_config.stalls.begin(), m_config.stalls.end(), [](const Sink_Stall &a, const Sink_Stall &b)
+    {
+        return a.at < b.at;
+    });
+}
+
+
+
+
+/* Simulated_Sink::get_config() function
+ * @return m_config, how the sink behaves
+ */
+const Simulated_Sink_Config &Simulated_Sink::get_config()
+{
+    return m_config;
+}
+
+
+
+
+/* Simulated_Sink::get_stats() function
+ * @return m_stats, what the sink did since Simulated_Sink::init()
+ */
+const Simulated_Sink_Stats &Simulated_Sink::get_stats()
+{
+    return m_stats;
+}
+
+
+
+
+/* Simulated_Sink::get_time() function
+ * @return the sink time in nanoseconds since Simulated_Sink::init()
+ */
+int64_t Simulated_Sink::get_time()
+{
+    return now();
+}
+
+
+
+
+/* Simulated_Sink::poll_error() function
+ * @desc used to get std::string errors enqueued onto m_errors
+ * @return error message as std::string, if no errors on enqueued and empty std::string is returned
+ */
+std::string Simulated_Sink::poll_error()
+{
+    if(!m_errors.empty())
+    {
+        std::string error;
+        error = m_errors.front();
+        m_errors.pop();
+
+        return error;
+    }
+
+    return std::string{};
+}
+
+
+
+
+/* Simulated_Sink::now() function
+ * @desc reads the sink's clock
+ * @return the sink time in nanoseconds since Simulated_Sink::init()
+ * @note this function is under the private specifier
+ */
+int64_t Simulated_Sink::now()
+{
+    if(m_config.clock == SINK_CLOCK_STEPPED)
+    {
+        return m_time;
+    }
+
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin).count();
+    if(m_config.clock == SINK_CLOCK_ACCELERATED)
+    {
+        return static_cast<int64_t>(elapsed * m_config.speed);
+    }
+
+    return elapsed;
+}
+
+
+
+
+/* Simulated_Sink::update() function
+ * @desc lets the device take every period that was due up to a time, it stops when the buffer cannot fill a period
+ * @param time - the sink time to catch up to, in nanoseconds
+ * @note this function is under the private specifier
+ */
+void Simulated_Sink::update(int64_t time)
+{
+    while(m_playing && m_next_period <= time)
+    {
+        int64_t taken = std::min(m_buffered, m_period_samples);
+        m_buffered -= taken;
+        m_stats.samples_played += taken;
+
+        if(taken < m_period_samples)
+        {
+            // what there was plays out, then the device waits for the buffer to fill again
+            m_playing = false;
+            m_next_period += static_cast<int64_t>(std::llround(taken * m_period_ns / m_period_samples));
+
+            if(!m_draining)
+            {
+                m_stats.underruns++;
+                m_silence_start = m_next_period;
+            }
+            break;
+        }
+
+        m_periods++;
+        m_next_period = period_time(m_periods);
+    }
+}
+
+
+
+
+/* Simulated_Sink::start() function
+ * @desc starts the device, it takes the first period right away
+ * @param time - the sink time it starts at, in nanoseconds
+ * @note this function is under the private specifier
+ */
+void Simulated_Sink::start(int64_t time)
+{
+    if(m_silence_start >= 0)
+    {
+        m_stats.silence += std::max<int64_t>(time - m_silence_start, 0);
+        m_silence_start = -1;
+    }
+
+    m_playing = true;
+    m_start = time;
+    m_periods = 0;
+    m_next_period = time;
+}
+
+
+
+
+/* Simulated_Sink::wait_until() function
+ * @desc waits for a sink time, the stepped clock jumps to it, the others sleep until it comes
+ * @param time - the sink time in nanoseconds, nothing is done if it passed
+ * @note this function is under the private specifier
+ */
+void Simulated_Sink::wait_until(int64_t time)
+{
+    if(m_config.clock == SINK_CLOCK_STEPPED)
+    {
+        m_time = std::max(m_time, time);
+        return;
+    }
+
+    if(m_config.clock == SINK_CLOCK_ACCELERATED)
+    {
+        time = static_cast<int64_t>(time / m_config.speed);
+    }
+
+    std::this_thread::sleep_until(m_origin + std::chrono::nanoseconds{time});
+}
+
+
+
+
+/* Simulated_Sink::period_time() function
+ * @desc works out when the device takes a period, late by a random jitter of less than a period, so periods stay in order
+ * @desc and the jitter never adds up
+ * @param period - the number of the period, counting from the one taken when the device started
+ * @return the sink time in nanoseconds
+ * @note called once per period in order, every call draws the next jitter, so the same config gives the same times
+ * @note this function is under the private specifier
+ */
+int64_t Simulated_Sink::period_time(int64_t period)
+{
+    int64_t time = m_start + static_cast<int64_t>(std::llround(period * m_period_ns));
+
+    if(m_config.jitter > 0)
+    {
+        m_jitter_state = m_jitter_state * 1664525u + 1013904223u;
+        double late = std::min(m_config.jitter * 1000.0, m_period_ns);
+        time += static_cast<int64_t>(static_cast<double>(m_jitter_state >> 8) / (1 << 24) * late);
+    }
+
+    return time;
+}
+
+
+
+
+/* Simulated_Sink::endqueue_error() function
+ * @desc enqueues an std::string error message onto m_errors
+ * @note this function is under the private specifier
+ */
+void Simulated_Sink::enqueue_error(const std::string &error)
+{
+    // drop the oldest error so a long run of failures can't grow the queue without bound
+    if(m_errors.size() >= MAX_QUEUED_ERRORS)
+    {
+        m_errors.pop();
+    }
+
+    m_errors.push(error);
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifndef RETURN_STATUS
+#define RETURN_STATUS
+enum Return_Status
+{
+    STATUS_SUCCESS,
+    STATUS_FAILURE,
+};
+#endif
+
+/* Sink_Clock Enum
+ * @desc what drives the time of a Simulated_Sink
+ * @member SINK_CLOCK_REALTIME - the steady clock, a write that has to wait sleeps, like a real device
+ * @member SINK_CLOCK_ACCELERATED - the steady clock sped up by Simulated_Sink_Config::speed, waits sleep that much shorter
+ * @member SINK_CLOCK_STEPPED - simulated time that only moves when a write has to wait or Simulated_Sink::advance() is
+ * @member SINK_CLOCK_STEPPED - called, nothing sleeps, so a run is deterministic and as fast as the code feeding the sink
+ */
+enum Sink_Clock
+{
+    SINK_CLOCK_REALTIME,
+    SINK_CLOCK_ACCELERATED,
+    SINK_CLOCK_STEPPED,
+};
+
+/* Sink_Stall Struct
+ * @desc a time the sink stops taking samples, EX: an audio server that was not scheduled, the device keeps playing what is buffered
+ * @member at - when the stall begins, nanoseconds of sink time after Simulated_Sink::init()
+ * @member duration - how long it lasts in nanoseconds, a write made during it waits until it ends
+ */
+struct Sink_Stall
+{
+    int64_t at;
+    int64_t duration;
+};
+
+/* Simulated_Sink_Config Struct
+ * @desc how a Simulated_Sink behaves, see Simulated_Sink::reset_config()
+ * @member clock - what drives the sink's time
+ * @member speed - how many times faster than real time the accelerated clock runs, ignored by the other clocks
+ * @member rate_ppm - how much faster the device plays than its nominal rate, in parts per million, negative if slower
+ * @member period - how much the device takes from the buffer at once, in microseconds
+ * @member jitter - each period is taken up to this many microseconds late, at most a period, the average rate is kept
+ * @member seed - the seed of the jitter, the same seed gives the same jitter
+ * @member stalls - the stalls to inject, sorted by Sink_Stall::at
+ */
+struct Simulated_Sink_Config
+{
+    Sink_Clock clock = SINK_CLOCK_STEPPED;
+    double speed = 1;
+    double rate_ppm = 0;
+    uint64_t period = 10000;
+    uint64_t jitter = 0;
+    uint32_t seed = 1;
+    std::vector<Sink_Stall> stalls;
+};
+
+/* Simulated_Sink_Stats Struct
+ * @desc what a Simulated_Sink did since Simulated_Sink::init()
+ * @member samples_written - the samples written to the sink
+ * @member samples_played - the samples the device took from the buffer
+ * @member underruns - the number of times the device found the buffer empty while playing
+ * @member silence - the time the device played silence after an underrun until it started again, in nanoseconds
+ * @member blocked_writes - the writes that had to wait for room in the buffer, each one a wakeup of the writing thread
+ * @member stalls - the stalls injected
+ * @member max_latency - the largest latency reported by Simulated_Sink::get_latency(), in microseconds
+ */
+struct Simulated_Sink_Stats
+{
+    uint64_t samples_written = 0;
+    uint64_t samples_played = 0;
+    uint64_t underruns = 0;
+    int64_t silence = 0;
+    uint64_t blocked_writes = 0;
+    uint64_t stalls = 0;
+    uint64_t max_latency = 0;
+};
+
+/* Simulated_Sink Class
+ * @desc A stand in for an audio server and device, for testing buffering and scheduling without either.
+ * @desc Writes go into a buffer of the requested latency, a write waits while the buffer is full. Like a PulseAudio
+ * @desc stream, the device starts once the buffer was filled or drained and takes a period at a time at the sample rate,
+ * @desc adjusted by Simulated_Sink_Config::rate_ppm. Each period can be taken late by a random jitter and writes can be
+ * @desc stalled at given times. When the device finds the buffer empty it counts an underrun and waits to be filled again.
+ * @desc With the stepped clock the time is simulated, an hour of audio takes as long as the code writing it, and the
+ * @desc same writes with the same config always give the same results.
+ * @member m_config - how the sink behaves, see Simulated_Sink::reset_config()
+ * @member m_initialized - true once Simulated_Sink::init() succeeded
+ * @member m_frame_size - the size of one sample frame in bytes
+ * @member m_capacity - the size of the buffer in samples
+ * @member m_period_samples - the samples the device takes at once
+ * @member m_period_ns - the length of a period at the device rate, in nanoseconds
+ * @member m_origin - the steady clock time of Simulated_Sink::init(), sink time 0 of the realtime and accelerated clocks
+ * @member m_time - the sink time of the stepped clock in nanoseconds
+ * @member m_buffered - the samples in the buffer
+ * @member m_playing - true while the device takes periods from the buffer
+ * @member m_draining - true during Simulated_Sink::drain(), an empty buffer then ends playback without an underrun
+ * @member m_start - when the device last started, the periods are counted from it
+ * @member m_periods - the periods taken since m_start
+ * @member m_next_period - when the device takes the next period, after it stopped when the last samples it took end
+ * @member m_silence_start - when the silence of the last underrun began, -1 once the device started again
+ * @member m_jitter_state - the state of the jitter's random number generator
+ * @member m_next_stall - the first stall in m_config.stalls not injected yet
+ * @member m_stats - what the sink did since Simulated_Sink::init()
+ * @member m_errors - a std::queue<std::string> of error messages
+ * @note not thread safe, the thread writing to it also reads the latency and the stats, like with an Audio_Player
+ * @note see simulated_sink.cpp for comments on functions
+ */
+class Simulated_Sink
+{
+    Simulated_Sink_Config m_config;
+    bool m_initialized;
+
+    std::size_t m_frame_size;
+    int64_t m_capacity;
+    int64_t m_period_samples;
+    double m_period_ns;
+
+    std::chrono::steady_clock::time_point m_origin;
+    int64_t m_time;
+
+    int64_t m_buffered;
+    bool m_playing;
+    bool m_draining;
+    int64_t m_start;
+    int64_t m_periods;
+    int64_t m_next_period;
+    int64_t m_silence_start;
+    uint32_t m_jitter_state;
+    std::size_t m_next_stall;
+
+    Simulated_Sink_Stats m_stats;
+
+    std::queue<std::string> m_errors;
+
+    public:
+
+    // the buffer when no latency is requested, about what a PulseAudio server gives a stream by default
+    static constexpr uint64_t DEFAULT_LATENCY = 2000000;
+
+    Simulated_Sink();
+
+    Return_Status init(uint32_t, std::size_t, uint64_t);
+    Return_Status write(std::size_t);
+    Return_Status drain();
+    Return_Status flush();
+    Return_Status get_latency(uint64_t &);
+
+    void advance(int64_t);
+    void reset_config(const Simulated_Sink_Config&);
+
+    const Simulated_Sink_Config &get_config();
+    const Simulated_Sink_Stats &get_stats();
+    int64_t get_time();
+
+    std::string poll_error();
+
+    private:
+
+    int64_t now();
+    void update(int64_t);
+    void start(int64_t);
+    void wait_until(int64_t);
+    int64_t period_time(int64_t);
+    void enqueue_error(const std::string &error);
+};
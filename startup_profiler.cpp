@@ -0,0 +1,197 @@
+#include "startup_profiler.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+
+
+/* Startup_Profiler constructor
+ * @desc sets time zero of the profile to the moment of construction
+ * @param enabled - if false the profiler records nothing and the report is empty
+ */
+Startup_Profiler::Startup_Profiler(bool enabled) :
+    m_enabled{enabled}, m_start{std::chrono::steady_clock::now()}
+{}
+
+
+
+
+/* Startup_Profiler::now() function
+ * @return the current time on the clock used for all phases
+ */
+std::chrono::steady_clock::time_point Startup_Profiler::now() const
+{
+    return std::chrono::steady_clock::now();
+}
+
+
+
+
+/* Startup_Profiler::record() function
+ * @desc records a finished phase, safe to call from any thread
+ * @param name - the name of the phase
+ * @param thread_label - a short label for the thread that ran the phase
+ * @param begin - when the phase began, as returned by Startup_Profiler::now()
+ * @param end - when the phase ended, as returned by Startup_Profiler::now()
+ */
+void Startup_Profiler::record(const std::string &name, const std::string &thread_label,
+                              std::chrono::steady_clock::time_point begin,
+                              std::chrono::steady_clock::time_point end)
+{
+    if(!m_enabled)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_phases.push_back(Startup_Phase{name, thread_label, begin, end});
+}
+
+
+
+
+/* Startup_Profiler::mark() function
+ * @desc records an instantaneous event, EX: the first sample being written
+ * @param name - the name of the event
+ * @param thread_label - a short label for the thread the event happened on
+ */
+void Startup_Profiler::mark(const std::string &name, const std::string &thread_label)
+{
+    std::chrono::steady_clock::time_point time = now();
+    record(name, thread_label, time, time);
+}
+
+
+
+
+/* Startup_Profiler::enabled() function
+ * @return true if the profiler is recording, false otherwise
+ */
+bool Startup_Profiler::enabled() const
+{
+    return m_enabled;
+}
+
+
+
+
+/* Startup_Profiler::report() function
+ * @desc writes a table of all recorded phases, ordered by start time, to the given stream
+ * @param out - the stream to write the report to
+ * @note times are in milliseconds relative to the construction of the profiler,
+ * @note the time spent before main() (exec, dynamic linking, static init) is reported separately
+ */
+void Startup_Profiler::report(std::ostream &out)
+{
+    if(!m_enabled)
+    {
+        return;
+    }
+
+    std::vector<Startup_Phase> phases;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        phases = m_phases;
+    }
+
+    std::sort(phases.begin(), phases.end(), [](const Startup_Phase &a, const Startup_Phase &b)
+    {
+        return a.begin < b.begin;
+    });
+
+    auto to_ms = [](std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+
+    out << "Startup profile (ms, relative to main)\n";
+
+    double pre_main = pre_main_milliseconds();
+    if(pre_main >= 0)
+    {
+        out << "  process start -> main: ~" << std::fixed << std::setprecision(1) << pre_main << '\n';
+    }
+
+    out << "  " << std::left << std::setw(28) << "phase"
+        << std::setw(10) << "thread"
+        << std::right << std::setw(10) << "start"
+        << std::setw(10) << "end"
+        << std::setw(10) << "duration" << '\n';
+
+    for(const Startup_Phase &phase : phases)
+    {
+        out << "  " << std::left << std::setw(28) << phase.name
+            << std::setw(10) << phase.thread_label
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << to_ms(phase.begin - m_start)
+            << std::setw(10) << to_ms(phase.end - m_start)
+            << std::setw(10) << to_ms(phase.end - phase.begin) << '\n';
+    }
+
+    out << std::defaultfloat;
+}
+
+
+
+
+/* Startup_Profiler::pre_main_milliseconds() function
+ * @desc estimates the time between the process being started and the profiler being created
+ * @return the estimate in milliseconds, or a negative value if it could not be determined
+ * @note the kernel reports the process start time in clock ticks, so the resolution is 1 / _SC_CLK_TCK seconds
+ * @note this function is under the private specifier
+ */
+double Startup_Profiler::pre_main_milliseconds() const
+{
+    std::ifstream stat_file{"/proc/self/stat"};
+    std::string stat;
+    if(!std::getline(stat_file, stat))
+    {
+        return -1;
+    }
+
+    // the process name may contain spaces, fields are counted after the closing parenthesis
+    std::size_t name_end = stat.rfind(')');
+    if(name_end == std::string::npos)
+    {
+        return -1;
+    }
+
+    std::istringstream fields{stat.substr(name_end + 2)};
+    std::string field;
+    unsigned long long start_ticks = 0;
+
+    // starttime is field 22, the first field after the name is field 3
+    for(int i = 3; i <= 22; i++)
+    {
+        if(!(fields >> field))
+        {
+            return -1;
+        }
+    }
+    start_ticks = std::stoull(field);
+
+    long ticks_per_second = sysconf(_SC_CLK_TCK);
+    struct timespec boot_time;
+    if(ticks_per_second <= 0 || clock_gettime(CLOCK_BOOTTIME, &boot_time) != 0)
+    {
+        return -1;
+    }
+
+    // shift the current boot time back by however long ago the profiler was created
+    double since_start = std::chrono::duration<double, std::milli>(now() - m_start).count();
+    double boot_ms = boot_time.tv_sec * 1000.0 + boot_time.tv_nsec / 1000000.0 - since_start;
+    double start_ms = start_ticks * 1000.0 / ticks_per_second;
+
+    return std::max(0.0, boot_ms - start_ms);
+}
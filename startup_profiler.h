@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Startup_Phase Struct
+ * @desc holds the timing of one startup phase
+ * @member name - the name of the phase, EX: "open_file"
+ * @member thread_label - a short label of the thread the phase ran on, EX: "sink"
+ * @member begin - when the phase began
+ * @member end - when the phase ended, equal to begin for instantaneous marks
+ */
+struct Startup_Phase
+{
+    std::string name;
+    std::string thread_label;
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::steady_clock::time_point end;
+};
+
+/* Startup_Profiler Class
+ * @desc Records the phases of the player startup sequence, which may run on several threads,
+ * @desc and reports them relative to the moment the profiler was created
+ * @member m_enabled - if false recording functions do nothing
+ * @member m_start - the time the profiler was created, used as time zero in the report
+ * @member m_phases - the recorded phases, guarded by m_mutex
+ * @member m_mutex - guards m_phases, phases are recorded from several threads
+ * @note see startup_profiler.cpp for comments on functions
+ */
+class Startup_Profiler
+{
+    bool m_enabled;
+    std::chrono::steady_clock::time_point m_start;
+
+    std::vector<Startup_Phase> m_phases;
+    std::mutex m_mutex;
+
+    public:
+
+    explicit Startup_Profiler(bool);
+
+    std::chrono::steady_clock::time_point now() const;
+    void record(const std::string&, const std::string&, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point);
+    void mark(const std::string&, const std::string&);
+
+    bool enabled() const;
+    void report(std::ostream&);
+
+    private:
+
+    double pre_main_milliseconds() const;
+};